@@ -27,6 +27,14 @@ namespace Microsoft {
 				enc.encode(str, &q, sizeof(q));
 				return str;
 			}
+
+			static std::wstring ToString(const stdex::sha256_t& q)
+			{
+				stdex::hex_enc enc;
+				wstring str;
+				enc.encode(str, &q, sizeof(q));
+				return str;
+			}
 		}
 	}
 }
@@ -41,6 +49,82 @@ namespace UnitTests
 		h.hash(data, sizeof(data) - sizeof(*data));
 		h.finalize();
 		Assert::AreEqual<stdex::crc32_t>(0xc6c3c95d, h);
+
+		vector<uint8_t> large = random_data(100000);
+		h.clear();
+		h.hash(large.data(), large.size());
+		h.finalize();
+		Assert::AreEqual<stdex::crc32_t>(0xdd0d690d, h);
+		h.clear();
+		h.hash(large.data() + 3, large.size() - 3); // Unaligned
+		h.finalize();
+		Assert::AreEqual<stdex::crc32_t>(0x8eb15e76, h);
+
+		// Forces the lookup table implementation regardless of CPU features
+		class crc32_table_hash : public stdex::crc32_hash
+		{
+		public:
+			crc32_table_hash() { m_update = update_table; }
+		} h_table;
+		h_table.hash(large.data(), large.size());
+		h_table.finalize();
+		Assert::AreEqual<stdex::crc32_t>(0xdd0d690d, h_table);
+
+		// Chunked hashing and combining
+		for (size_t split : { 0, 1, 15, 64, 100, 1000, 99999, 100000 }) {
+			stdex::crc32_hash h1, h2;
+			h1.hash(large.data(), split);
+			h1.finalize();
+			h2.hash(large.data() + split, large.size() - split);
+			h2.finalize();
+			Assert::AreEqual<stdex::crc32_t>(0xdd0d690d, stdex::crc32_hash::combine(h1, h2, large.size() - split));
+			stdex::crc32_hash h3(h1.data()); // Continue from CRC value
+			h3.hash(large.data() + split, large.size() - split);
+			h3.finalize();
+			Assert::AreEqual<stdex::crc32_t>(0xdd0d690d, h3);
+		}
+	}
+
+	void hash::crc32c()
+	{
+		stdex::crc32c_hash h;
+		static const char data[] = "123456789";
+		h.hash(data, sizeof(data) - sizeof(*data));
+		h.finalize();
+		Assert::AreEqual<stdex::crc32_t>(0xe3069283, h);
+
+		vector<uint8_t> large = random_data(100000);
+		h.clear();
+		h.hash(large.data() + 3, large.size() - 3); // Unaligned
+		h.finalize();
+		Assert::AreEqual<stdex::crc32_t>(0xf56a049d, h);
+
+		// Forces the lookup table implementation regardless of CPU features
+		class crc32c_table_hash : public stdex::crc32c_hash
+		{
+		public:
+			crc32c_table_hash() { m_update = update_table; }
+		} h_table;
+		h_table.hash(large.data() + 3, large.size() - 3);
+		h_table.finalize();
+		Assert::AreEqual<stdex::crc32_t>(0xf56a049d, h_table);
+
+		for (size_t split : { 0, 1, 1536, 5000, 100000 }) {
+			stdex::crc32c_hash h1, h2;
+			h1.hash(large.data(), split);
+			h1.finalize();
+			h2.hash(large.data() + split, large.size() - split);
+			h2.finalize();
+			Assert::AreEqual<stdex::crc32_t>(0xac3f3648, stdex::crc32c_hash::combine(h1, h2, large.size() - split));
+		}
+
+		stdex::stream::memory_file source(large.data(), large.size());
+		h.clear();
+		stdex::stream_hasher<stdex::crc32_t> hasher(h, source);
+		uint8_t buf[0x1000];
+		while (hasher.read(buf, sizeof(buf)));
+		h.finalize();
+		Assert::AreEqual<stdex::crc32_t>(0xac3f3648, h);
 	}
 
 	void hash::md5()
@@ -50,6 +134,60 @@ namespace UnitTests
 		h.hash(data, sizeof(data) - sizeof(*data));
 		h.finalize();
 		Assert::AreEqual<stdex::md5_t>({{0x12,0x0e,0xa8,0xa2,0x5e,0x5d,0x48,0x7b,0xf6,0x8b,0x5f,0x70,0x96,0x44,0x00,0x19}}, h);
+
+		vector<uint8_t> large = random_data(100000);
+		h.clear();
+		h.hash(large.data(), large.size());
+		h.finalize();
+		Assert::AreEqual<stdex::md5_t>({{0xef,0x4e,0x02,0x7e,0xfd,0xa3,0xba,0xe7,0xb7,0x78,0x9d,0xbc,0x1a,0x22,0x93,0x8a}}, h);
+		h.clear();
+		h.hash(large.data() + 3, large.size() - 3); // Unaligned
+		h.finalize();
+		Assert::AreEqual<stdex::md5_t>({{0x45,0xb8,0x5a,0x1c,0xef,0x98,0x65,0x16,0x45,0xc0,0xa9,0xd7,0x06,0x34,0x36,0x2f}}, h);
+
+		vector<const void*> msgs;
+		vector<size_t> lengths;
+		for (size_t i = 0; i < 40; ++i) {
+			msgs.push_back(large.data() + i * 7);
+			lengths.push_back(i * i * 37 % 3000);
+		}
+		auto many = stdex::md5_hash::hash_many(msgs.data(), lengths.data(), msgs.size());
+		Assert::AreEqual(msgs.size(), many.size());
+		for (size_t i = 0; i < msgs.size(); ++i) {
+			h.clear();
+			h.hash(msgs[i], lengths[i]);
+			h.finalize();
+			Assert::AreEqual<stdex::md5_t>(h, many[i]);
+		}
+
+		// Runs every lane width the CPU supports, not just the one hash_many() picks
+		class md5_lanes_hash : public stdex::md5_hash
+		{
+		public:
+			static vector<vector<stdex::md5_t>> hash_many_all(_In_reads_(count) const void* const* data, _In_reads_(count) const size_t* length, _In_ size_t count)
+			{
+				vector<vector<stdex::md5_t>> result;
+				result.emplace_back(count);
+				hash_lanes<md5_hash, 1>(compress_single, data, length, count, result.back().data());
+#if defined(_STDEX_CPU_X86)
+				if (stdex::cpu_features.avx2) {
+					result.emplace_back(count);
+					hash_lanes<md5_hash, 8>(compress_avx2, data, length, count, result.back().data());
+				}
+				if (stdex::cpu_features.avx512) {
+					result.emplace_back(count);
+					hash_lanes<md5_hash, 16>(compress_avx512, data, length, count, result.back().data());
+				}
+#elif defined(_STDEX_CPU_ARM64)
+				result.emplace_back(count);
+				hash_lanes<md5_hash, 4>(compress_neon, data, length, count, result.back().data());
+#endif
+				return result;
+			}
+		};
+		for (auto& lanes : md5_lanes_hash::hash_many_all(msgs.data(), lengths.data(), msgs.size()))
+			for (size_t i = 0; i < msgs.size(); ++i)
+				Assert::AreEqual<stdex::md5_t>(many[i], lanes[i]);
 	}
 
 	void hash::sha1()
@@ -59,5 +197,104 @@ namespace UnitTests
 		h.hash(data, sizeof(data) - sizeof(*data));
 		h.finalize();
 		Assert::AreEqual<stdex::sha1_t>({{0xaf,0xa6,0xc8,0xb3,0xa2,0xfa,0xe9,0x57,0x85,0xdc,0x7d,0x96,0x85,0xa5,0x78,0x35,0xd7,0x03,0xac,0x88}}, h);
+
+		vector<uint8_t> large = random_data(100000);
+		h.clear();
+		h.hash(large.data(), large.size());
+		h.finalize();
+		Assert::AreEqual<stdex::sha1_t>({{0x04,0x2f,0xd2,0x93,0x2b,0xf0,0x88,0xd3,0x90,0x90,0x4f,0x57,0x6c,0xad,0x54,0x4d,0x1a,0x73,0x6b,0x9a}}, h);
+		h.clear();
+		h.hash(large.data() + 3, large.size() - 3); // Unaligned
+		h.finalize();
+		Assert::AreEqual<stdex::sha1_t>({{0x45,0xb4,0xd8,0xa5,0x1d,0x37,0xb4,0x26,0x60,0x11,0x1a,0xc5,0x09,0x88,0x3d,0xce,0xaf,0x74,0x02,0xb8}}, h);
+
+		vector<const void*> msgs;
+		vector<size_t> lengths;
+		for (size_t i = 0; i < 40; ++i) {
+			msgs.push_back(large.data() + i * 7);
+			lengths.push_back(i * i * 37 % 3000);
+		}
+		auto many = stdex::sha1_hash::hash_many(msgs.data(), lengths.data(), msgs.size());
+		Assert::AreEqual(msgs.size(), many.size());
+		for (size_t i = 0; i < msgs.size(); ++i) {
+			h.clear();
+			h.hash(msgs[i], lengths[i]);
+			h.finalize();
+			Assert::AreEqual<stdex::sha1_t>(h, many[i]);
+		}
+
+		// Runs every lane width the CPU supports, not just the one hash_many() picks
+		class sha1_lanes_hash : public stdex::sha1_hash
+		{
+		public:
+			static vector<vector<stdex::sha1_t>> hash_many_all(_In_reads_(count) const void* const* data, _In_reads_(count) const size_t* length, _In_ size_t count)
+			{
+				vector<vector<stdex::sha1_t>> result;
+				result.emplace_back(count);
+				hash_lanes<sha1_hash, 1>(compress_single, data, length, count, result.back().data());
+#if defined(_STDEX_CPU_X86)
+				if (stdex::cpu_features.avx2) {
+					result.emplace_back(count);
+					hash_lanes<sha1_hash, 8>(compress_avx2, data, length, count, result.back().data());
+				}
+				if (stdex::cpu_features.avx512) {
+					result.emplace_back(count);
+					hash_lanes<sha1_hash, 16>(compress_avx512, data, length, count, result.back().data());
+				}
+#elif defined(_STDEX_CPU_ARM64)
+				result.emplace_back(count);
+				hash_lanes<sha1_hash, 4>(compress_neon, data, length, count, result.back().data());
+#endif
+				return result;
+			}
+		};
+		for (auto& lanes : sha1_lanes_hash::hash_many_all(msgs.data(), lengths.data(), msgs.size()))
+			for (size_t i = 0; i < msgs.size(); ++i)
+				Assert::AreEqual<stdex::sha1_t>(many[i], lanes[i]);
+	}
+
+	void hash::sha256()
+	{
+		stdex::sha256_hash h;
+		static const char data[] = "This is a test.";
+		h.hash(data, sizeof(data) - sizeof(*data));
+		h.finalize();
+		Assert::AreEqual<stdex::sha256_t>({{0xa8,0xa2,0xf6,0xeb,0xe2,0x86,0x69,0x7c,0x52,0x7e,0xb3,0x5a,0x58,0xb5,0x53,0x95,0x32,0xe9,0xb3,0xae,0x3b,0x64,0xd4,0xeb,0x0a,0x46,0xfb,0x65,0x7b,0x41,0x56,0x2c}}, h);
+
+		vector<uint8_t> large = random_data(100000);
+		stdex::stream::memory_file source(large.data(), large.size());
+		h.clear();
+		stdex::stream_hasher<stdex::sha256_t> hasher(h, source);
+		uint8_t buf[1000];
+		while (hasher.read(buf, sizeof(buf)));
+		h.finalize();
+		Assert::AreEqual<stdex::sha256_t>({{0x1e,0xf3,0x7a,0xbd,0xa5,0xdc,0x5e,0xc1,0x55,0x56,0xf0,0x61,0xd1,0xa8,0xfc,0x9a,0x54,0x74,0x58,0x58,0x39,0x18,0xdc,0xca,0x8d,0x89,0xc1,0x7b,0x38,0xf5,0x4f,0xcd}}, h);
+	}
+
+	void hash::sha256_benchmark()
+	{
+		if (!benchmark_enabled())
+			return;
+
+		// Forces the portable compression function regardless of CPU features
+		class sha256_generic_hash : public stdex::sha256_hash
+		{
+		public:
+			sha256_generic_hash() { m_compress = compress_generic; }
+		};
+
+		constexpr size_t total = 0x4000000;
+		vector<uint8_t> data = random_data(total);
+		stdex::sha256_hash h;
+		sha256_generic_hash h_generic;
+		benchmark("sha256_hash generic", total, [&] {
+			h_generic.hash(data.data(), data.size());
+			h_generic.finalize();
+		});
+		benchmark("sha256_hash dispatched", total, [&] {
+			h.hash(data.data(), data.size());
+			h.finalize();
+		});
+		Assert::AreEqual<stdex::sha256_t>(h_generic, h);
 	}
 }
@@ -0,0 +1,151 @@
+﻿/*
+	SPDX-License-Identifier: MIT
+	Copyright © 2023-2024 Amebis
+*/
+
+#pragma once
+
+#include <stdex/compat.hpp>
+#include <stdex/stream.hpp>
+#include <stdex/string.hpp>
+#ifdef _WIN32
+#include <CppUnitTest.h>
+#else
+#include <iostream>
+#endif
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace UnitTests
+{
+#ifdef _WIN32
+	using Microsoft::VisualStudio::CppUnitTestFramework::Assert;
+#endif
+
+	///
+	/// Returns reproducible pseudo-random number
+	///
+	/// \param[in,out] seed  Generator state
+	///
+	/// \return Number in range [0, 0xffff]
+	///
+	inline uint32_t random_number(_Inout_ uint32_t& seed)
+	{
+		seed = seed * 1103515245 + 12345;
+		return seed >> 16;
+	}
+
+	///
+	/// Returns reproducible pseudo-random number below limit
+	///
+	/// \param[in,out] seed  Generator state
+	/// \param[in]     n     Limit. Must not be zero.
+	///
+	/// \return Number in range [0, n)
+	///
+	inline uint32_t random_number(_Inout_ uint32_t& seed, _In_ uint32_t n)
+	{
+		uint32_t r = random_number(seed);
+		if (n > 0x10000)
+			r = r << 16 | random_number(seed);
+		return r % n;
+	}
+
+	///
+	/// Fills buffer with reproducible pseudo-random data
+	///
+	/// \param[out] data  Buffer to fill
+	/// \param[in]  size  Size of the buffer in bytes
+	///
+	inline void random_data(_Out_writes_bytes_(size) uint8_t* data, _In_ size_t size)
+	{
+		uint32_t seed = 1;
+		for (size_t i = 0; i < size; ++i)
+			data[i] = static_cast<uint8_t>(random_number(seed));
+	}
+
+	///
+	/// Returns reproducible pseudo-random data
+	///
+	/// \param[in] size  Number of bytes
+	///
+	inline std::vector<uint8_t> random_data(_In_ size_t size)
+	{
+		std::vector<uint8_t> data(size);
+		random_data(data.data(), size);
+		return data;
+	}
+
+	///
+	/// Checks if benchmarks should run
+	///
+	/// Benchmarks are opt-in: set STDEX_BENCHMARK environment variable to run them.
+	///
+	inline bool benchmark_enabled()
+	{
+#ifdef _WIN32
+		return GetEnvironmentVariableW(L"STDEX_BENCHMARK", NULL, 0) != 0;
+#else
+		return getenv("STDEX_BENCHMARK") != nullptr;
+#endif
+	}
+
+	///
+	/// Times a call and reports its throughput
+	///
+	/// \param[in] name  Benchmark name to report
+	/// \param[in] size  Number of bytes processed by the call
+	/// \param[in] f     Function to time
+	///
+	template <class F>
+	void benchmark(_In_z_ const char* name, _In_ uint64_t size, _In_ F f)
+	{
+		auto start = std::chrono::steady_clock::now();
+		f();
+		double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::string msg = stdex::sprintf("%s: %.1f MB/s\n", nullptr, name, static_cast<double>(size) / 1e6 / duration);
+#ifdef _WIN32
+		Microsoft::VisualStudio::CppUnitTestFramework::Logger::WriteMessage(msg.c_str());
+#else
+		std::cout << msg;
+#endif
+	}
+
+	///
+	/// Writes data to stream in chunks of varying size
+	///
+	/// \param[in,out] stream     Stream to write to
+	/// \param[in]     data       Data to write
+	/// \param[in]     length     Number of bytes to write
+	/// \param[in]     max_chunk  Maximum chunk size
+	///
+	inline void write_chunked(_Inout_ stdex::stream::basic& stream, _In_reads_bytes_(length) const uint8_t* data, _In_ size_t length, _In_ size_t max_chunk = 0x1fff)
+	{
+		for (size_t offset = 0, n = 1; offset < length; offset += n, n = n * 3 % max_chunk + 1) {
+			n = std::min(n, length - offset);
+			Assert::AreEqual(n, stream.write(data + offset, n));
+		}
+	}
+
+	///
+	/// Reads data from stream in chunks of varying size and compares it to the expected data
+	///
+	/// \param[in,out] stream     Stream to read from
+	/// \param[in]     data       Expected data
+	/// \param[in]     length     Number of bytes to read
+	/// \param[in]     max_chunk  Maximum chunk size
+	///
+	inline void read_chunked(_Inout_ stdex::stream::basic& stream, _In_reads_bytes_(length) const uint8_t* data, _In_ size_t length, _In_ size_t max_chunk = 0x1fff)
+	{
+		std::unique_ptr<uint8_t[]> buf(new uint8_t[max_chunk]);
+		for (size_t offset = 0, n = 1; offset < length; offset += n, n = n * 5 % max_chunk + 1) {
+			n = std::min(n, length - offset);
+			Assert::AreEqual(n, stream.read(buf.get(), n));
+			Assert::AreEqual(0, memcmp(data + offset, buf.get(), n));
+		}
+	}
+}
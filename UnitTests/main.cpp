@@ -10,22 +10,44 @@ int main(int, const char *[])
 {
 	try {
 		UnitTests::hash::crc32();
+		UnitTests::hash::crc32c();
 		UnitTests::hash::md5();
 		UnitTests::hash::sha1();
+		UnitTests::hash::sha256();
+		UnitTests::hash::sha256_benchmark();
 		UnitTests::langid::from_rfc1766();
 		UnitTests::math::add();
+		UnitTests::math::msb();
 		UnitTests::math::mul();
 		UnitTests::parser::http_test();
 		UnitTests::parser::sgml_test();
 		UnitTests::parser::wtest();
 		UnitTests::pool::test();
 		UnitTests::ring::test();
+		UnitTests::ring::spsc();
 		UnitTests::sgml::sgml2str();
 		UnitTests::sgml::str2sgml();
+		UnitTests::stream::advise();
+		UnitTests::stream::aligned_buffer();
 		UnitTests::stream::async();
+		UnitTests::stream::cache();
+		UnitTests::stream::chunked_memory_file();
+		UnitTests::stream::coroutine();
+		UnitTests::stream::fifo();
 		UnitTests::stream::file_stat();
+		UnitTests::stream::mapped_file();
 		UnitTests::stream::open_close();
+		UnitTests::stream::peek();
+		UnitTests::stream::reactor();
+		UnitTests::stream::read_data();
+		UnitTests::stream::read_at();
+		UnitTests::stream::readln();
 		UnitTests::stream::replicator();
+		UnitTests::stream::stats();
+		UnitTests::stream::uring();
+		UnitTests::stream::uring_benchmark();
+		UnitTests::stream::vectored();
+		UnitTests::stream::write_stream();
 		UnitTests::string::strncpy();
 		UnitTests::string::sprintf();
 		UnitTests::unicode::charset_encoder();
@@ -33,6 +55,8 @@ int main(int, const char *[])
 		UnitTests::unicode::str2wstr();
 		UnitTests::unicode::wstr2str();
 		UnitTests::watchdog::test();
+		UnitTests::zlib::parallel();
+		UnitTests::zlib::seekable();
 		UnitTests::zlib::test();
 		std::cout << "PASS\n";
 		return 0;
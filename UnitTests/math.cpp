@@ -37,4 +37,14 @@ namespace UnitTests
 		Assert::ExpectException<std::invalid_argument>([] { stdex::add(SIZE_MAX, 1); });
 		Assert::ExpectException<std::invalid_argument>([] { stdex::add(1, SIZE_MAX); });
 	}
+
+	void math::msb()
+	{
+		Assert::AreEqual(0, stdex::msb(1));
+		Assert::AreEqual(1, stdex::msb(2));
+		Assert::AreEqual(1, stdex::msb(3));
+		Assert::AreEqual(31, stdex::msb(0xffffffff));
+		Assert::AreEqual(32, stdex::msb(0x100000000));
+		Assert::AreEqual(63, stdex::msb(UINT64_MAX));
+	}
 }
@@ -23,6 +23,7 @@
 #include <stdex/parser.hpp>
 #include <stdex/pool.hpp>
 #include <stdex/progress.hpp>
+#include <stdex/reactor.hpp>
 #include <stdex/ring.hpp>
 #include <stdex/scoped_executor.hpp>
 #include <stdex/sgml.hpp>
@@ -39,6 +40,7 @@
 #include <stdex/zlib.hpp>
 
 #include "compat.hpp"
+#include "helpers.hpp"
 
 #include <cstdlib>
 #include <filesystem>
@@ -51,8 +53,11 @@ namespace UnitTests
 	{
 	public:
 		TEST_METHOD(crc32);
+		TEST_METHOD(crc32c);
 		TEST_METHOD(md5);
 		TEST_METHOD(sha1);
+		TEST_METHOD(sha256);
+		TEST_METHOD(sha256_benchmark);
 	};
 
 	TEST_CLASS(langid)
@@ -66,6 +71,7 @@ namespace UnitTests
 	public:
 		TEST_METHOD(mul);
 		TEST_METHOD(add);
+		TEST_METHOD(msb);
 	};
 
 	TEST_CLASS(parser)
@@ -86,6 +92,7 @@ namespace UnitTests
 	{
 	public:
 		TEST_METHOD(test);
+		TEST_METHOD(spsc);
 	};
 
 	TEST_CLASS(sgml)
@@ -98,10 +105,27 @@ namespace UnitTests
 	TEST_CLASS(stream)
 	{
 	public:
+		TEST_METHOD(advise);
+		TEST_METHOD(aligned_buffer);
 		TEST_METHOD(async);
 		TEST_METHOD(replicator);
 		TEST_METHOD(open_close);
+		TEST_METHOD(fifo);
 		TEST_METHOD(file_stat);
+		TEST_METHOD(mapped_file);
+		TEST_METHOD(peek);
+		TEST_METHOD(cache);
+		TEST_METHOD(chunked_memory_file);
+		TEST_METHOD(coroutine);
+		TEST_METHOD(reactor);
+		TEST_METHOD(read_data);
+		TEST_METHOD(read_at);
+		TEST_METHOD(readln);
+		TEST_METHOD(vectored);
+		TEST_METHOD(stats);
+		TEST_METHOD(uring);
+		TEST_METHOD(uring_benchmark);
+		TEST_METHOD(write_stream);
 	};
 
 	TEST_CLASS(string)
@@ -129,6 +153,8 @@ namespace UnitTests
 	TEST_CLASS(zlib)
 	{
 	public:
+		TEST_METHOD(parallel);
+		TEST_METHOD(seekable);
 		TEST_METHOD(test);
 	};
 }
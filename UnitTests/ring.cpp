@@ -12,11 +12,9 @@ using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
 namespace UnitTests
 {
-	constexpr size_t ring_capacity = 50;
-
-	void ring::test()
+	template <class ring_t, size_t ring_capacity>
+	static void test_ring()
 	{
-		using ring_t = stdex::ring<int, ring_capacity>;
 		ring_t ring;
 		thread writer([](_Inout_ ring_t& ring)
 			{
@@ -57,4 +55,16 @@ namespace UnitTests
 		}
 		writer.join();
 	}
+
+	void ring::test()
+	{
+		constexpr size_t ring_capacity = 50;
+		test_ring<stdex::ring<int, ring_capacity>, ring_capacity>();
+	}
+
+	void ring::spsc()
+	{
+		constexpr size_t ring_capacity = 64;
+		test_ring<stdex::spsc_ring<int, ring_capacity>, ring_capacity>();
+	}
 }
@@ -23,8 +23,178 @@ static stdex::sstring temp_path()
 #endif
 }
 
+#if __cpp_impl_coroutine >= 201902L
+struct detached_task
+{
+	struct promise_type
+	{
+		detached_task get_return_object() noexcept { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { std::terminate(); }
+	};
+};
+
+static detached_task read_all(_Inout_ basic& s, _Inout_ std::vector<uint8_t>& data, _Inout_ std::atomic<size_t>& done)
+{
+	for (;;) {
+		uint8_t buf[0x1000];
+		size_t num_read = co_await s.async_read(buf, sizeof(buf));
+		if (!num_read)
+			break;
+		data.insert(data.end(), buf, buf + num_read);
+	}
+	++done;
+}
+
+static detached_task write_all(_Inout_ basic& s, _In_reads_bytes_(length) const uint8_t* data, _In_ size_t length, _Inout_ std::atomic<size_t>& done)
+{
+	for (size_t offset = 0, n = 1; offset < length; offset += n, n = n * 3 % 0x1fff + 1) {
+		n = std::min(n, length - offset);
+		if (co_await s.async_write(data + offset, n) < n)
+			break;
+	}
+	if (auto sock = dynamic_cast<stdex::stream::socket*>(&s))
+		sock->shutdown_write();
+	++done;
+}
+
+#ifdef __linux__
+static detached_task echo(_Inout_ stdex::stream::socket& s, _Inout_ std::atomic<size_t>& done)
+{
+	uint8_t buf[0x1000];
+	for (;;) {
+		size_t num_read = co_await s.async_read(buf, sizeof(buf));
+		if (!num_read)
+			break;
+		if (co_await s.async_write(buf, num_read) < num_read)
+			break;
+	}
+	s.shutdown_write();
+	++done;
+}
+#endif
+#endif
+
 namespace UnitTests
 {
+	void stream::advise()
+	{
+		static const size_t total = 0x30000;
+		std::unique_ptr<uint8_t[]> data(new uint8_t[total]);
+		for (size_t i = 0; i < total; ++i)
+			data[i] = static_cast<uint8_t>(i * 17 + (i >> 11));
+		stdex::sstring filename = temp_path() + _T("stdex-stream-advise.tmp");
+		{
+			file f(filename, mode_for_writing | mode_create | mode_binary);
+			f.write(data.get(), total);
+		}
+		std::unique_ptr<uint8_t[]> buf(new uint8_t[total]);
+		auto check = [&](_Inout_ basic_file& f) {
+			f.advise(access_hint_t::random);
+			f.prefetch(0x1000, 0x2000);
+			f.advise(access_hint_t::dontneed, 0x10000);
+			f.advise(access_hint_t::sequential);
+			f.seekbeg(0);
+			Assert::AreEqual(total, f.read(buf.get(), total));
+			Assert::AreEqual(0, memcmp(data.get(), buf.get(), total));
+			f.advise(access_hint_t::normal);
+		};
+		{
+			file f(filename, mode_for_reading | mode_open_existing | mode_binary);
+			check(f);
+		}
+		{
+			cached_file f(filename, mode_for_reading | mode_open_existing | mode_binary, 0x1000, 8);
+			check(f);
+		}
+		{
+			stdex::stream::mapped_file f(filename, mode_for_reading | mode_open_existing | mode_binary);
+			check(f);
+		}
+		{
+			file f(filename, mode_for_reading | mode_open_existing | mode_binary);
+			{
+				async_reader<0x1000> r(f);
+				Assert::AreEqual(total, r.read(buf.get(), total));
+			}
+			Assert::AreEqual(0, memcmp(data.get(), buf.get(), total));
+		}
+		std::filesystem::remove(filename);
+	}
+
+	void stream::aligned_buffer()
+	{
+		static const size_t total = 0x5555;
+		std::unique_ptr<uint8_t[]> data(new uint8_t[total]);
+		for (size_t i = 0; i < total; ++i)
+			data[i] = static_cast<uint8_t>(i * 13 + (i >> 10));
+		stdex::sstring filename = temp_path() + _T("stdex-stream-aligned_buffer.tmp");
+		{
+			file f(filename, mode_for_writing | mode_create | mode_binary);
+			for (size_t i = 0; i < 0x3000; ++i)
+				f.write_byte(0xcc);
+		}
+		auto open_direct = [&](_Inout_ file& f, _In_ int mode) {
+			f.open(filename, mode | mode_direct);
+			if (!f.ok()) {
+				// File system does not support direct I/O.
+				f.open(filename, mode);
+			}
+		};
+		{
+			file f;
+			open_direct(f, mode_for_reading | mode_for_writing | mode_open_existing | mode_binary);
+			Assert::IsTrue(f.ok());
+			f.seekbeg(0x1234);
+			{
+				stdex::stream::aligned_buffer b(f, 0x2000);
+				for (size_t offset = 0, n = 1; offset < total; offset += n, n = n * 3 % 0x1fff + 1) {
+					n = std::min(n, total - offset);
+					Assert::AreEqual(n, b.write(data.get() + offset, n));
+				}
+				b.flush();
+				Assert::IsTrue(b.ok());
+			}
+			Assert::AreEqual<stdex::stream::fpos_t>(0x1234 + total, f.tell());
+			Assert::AreEqual<fsize_t>(0x1234 + total, f.size());
+			f.seekbeg(0x10);
+			{
+				stdex::stream::aligned_buffer b(f);
+				b.write_byte(0x55);
+			}
+			Assert::AreEqual<fsize_t>(0x1234 + total, f.size());
+		}
+		{
+			file f(filename, mode_for_reading | mode_open_existing | mode_binary);
+			std::unique_ptr<uint8_t[]> buf(new uint8_t[0x1234 + total]);
+			Assert::AreEqual(0x1234 + total, f.read(buf.get(), 0x1234 + total));
+			for (size_t i = 0; i < 0x1234; ++i)
+				Assert::AreEqual<uint8_t>(i == 0x10 ? 0x55 : 0xcc, buf[i]);
+			Assert::AreEqual(0, memcmp(data.get(), buf.get() + 0x1234, total));
+		}
+		{
+			file f;
+			open_direct(f, mode_for_reading | mode_open_existing | mode_binary);
+			f.seekbeg(0x1234 + 0x100);
+			std::unique_ptr<uint8_t[]> buf(new uint8_t[total]);
+			{
+				stdex::stream::aligned_buffer b(f, 0x1000);
+				size_t offset = 0x100;
+				for (size_t n = 1; offset < total; offset += n, n = n * 5 % 0x2345 + 1) {
+					n = std::min(n, total - offset);
+					Assert::AreEqual(n, b.read(buf.get() + offset, n));
+				}
+				Assert::AreEqual(0, memcmp(data.get() + 0x100, buf.get() + 0x100, total - 0x100));
+				Assert::AreEqual<size_t>(0, b.read(buf.get(), 1));
+				Assert::IsTrue(b.state() == state_t::eof);
+			}
+			Assert::AreEqual<stdex::stream::fpos_t>(0x1234 + total, f.tell());
+		}
+		std::filesystem::remove(filename);
+	}
+
 	void stream::async()
 	{
 		constexpr uint32_t total = 1000;
@@ -50,7 +220,7 @@ namespace UnitTests
 		}
 	}
 
-	void stream::replicator()
+	static void test_replicator(_In_ size_t queue_limit)
 	{
 		constexpr uint32_t total = 1000;
 
@@ -70,15 +240,31 @@ namespace UnitTests
 			128);
 
 		{
-			stdex::stream::replicator writer;
+			stdex::stream::replicator writer(queue_limit);
 			buffer f2_buf(f2, 0, 32);
+			basic f4(state_t::fail); // Sink failing on every write
 			writer.push_back(&f1);
 			writer.push_back(&f2_buf);
 			writer.push_back(&f3);
+			if (queue_limit) {
+				// In pipelined mode, write errors are reported on flush.
+				writer.push_back(&f4);
+			}
 			for (uint32_t i = 0; i < total; ++i) {
 				Assert::IsTrue(writer.ok());
 				writer << i;
 			}
+			if (queue_limit) {
+				writer.flush();
+				Assert::IsFalse(writer.ok());
+				Assert::IsTrue(writer.sink_state(&f1) == state_t::ok);
+				Assert::IsTrue(writer.sink_state(&f2_buf) == state_t::ok);
+				Assert::IsTrue(writer.sink_state(&f3) == state_t::ok);
+				Assert::IsTrue(writer.sink_state(&f4) == state_t::fail);
+				writer.remove(&f4);
+			}
+			writer.flush();
+			Assert::IsTrue(writer.ok());
 		}
 
 		f1.seekbeg(0);
@@ -112,6 +298,53 @@ namespace UnitTests
 		std::filesystem::remove(filename3);
 	}
 
+	void stream::replicator()
+	{
+		test_replicator(0);
+		test_replicator(0x100);
+	}
+
+	void stream::cache()
+	{
+		stdex::sstring filename = temp_path() + _T("stdex-stream-cache.tmp");
+		stdex::sstring filename_ref = temp_path() + _T("stdex-stream-cache-ref.tmp");
+		{
+			cached_file f1(filename, mode_for_reading | mode_for_writing | mode_create | mode_binary, 128, 4);
+			file f2(filename_ref, mode_for_reading | mode_for_writing | mode_create | mode_binary); // Uncached reference: OS zero-fills the gaps after EOF
+			basic_file* files[] = { &f1, &f2 };
+			diag_file f(files, _countof(files));
+			uint32_t seed = 1;
+			uint8_t data[0x200];
+			for (uint32_t i = 0; i < 10000; ++i) {
+				f.seekbeg(random_number(seed, static_cast<uint32_t>(f.size()) + 0x100)); // Occasionally seek past EOF
+				size_t length = random_number(seed, static_cast<uint32_t>(sizeof(data)));
+				switch (random_number(seed, 8)) {
+				case 0:
+					f.truncate();
+					break;
+				case 1: case 2: case 3:
+					for (size_t j = 0; j < length; ++j)
+						data[j] = static_cast<uint8_t>(random_number(seed));
+					f.write(data, length);
+					break;
+				default:
+					f.read(data, length); // diag_file compares the data
+				}
+			}
+			f.flush();
+			Assert::IsTrue(f1.cache_hits() > 0);
+
+			file f3(filename, mode_for_reading | mode_open_existing | share_all | mode_binary);
+			auto content = f3.read_remainder();
+			f2.seekbeg(0);
+			auto content_ref = f2.read_remainder();
+			Assert::AreEqual(content_ref.size(), content.size());
+			Assert::AreEqual(0, memcmp(content_ref.data(), content.data(), content.size()));
+		}
+		std::filesystem::remove(filename);
+		std::filesystem::remove(filename_ref);
+	}
+
 	void stream::open_close()
 	{
 		cached_file dat(stdex::invalid_handle, state_t::fail, 4096);
@@ -147,6 +380,1081 @@ namespace UnitTests
 			std::filesystem::remove(filename[i]);
 	}
 
+	void stream::mapped_file()
+	{
+		constexpr uint32_t total = 1000;
+		stdex::sstring filename = temp_path() + _T("stdex-stream-mapped_file.tmp");
+		{
+			stdex::stream::mapped_file f(filename, mode_for_writing | mode_create | mode_binary);
+			Assert::IsTrue(f.ok());
+			for (uint32_t i = 0; i < total; ++i) {
+				f << i;
+				Assert::IsTrue(f.ok());
+			}
+			Assert::AreEqual<stdex::stream::fsize_t>(total * sizeof(uint32_t), f.size());
+		}
+		{
+			file f(filename, mode_for_reading | mode_open_existing | mode_binary);
+			Assert::AreEqual<stdex::stream::fsize_t>(total * sizeof(uint32_t), f.size());
+		}
+		{
+			stdex::stream::mapped_file f(filename, mode_for_reading | mode_open_existing | mode_binary);
+			Assert::IsTrue(f.ok());
+			auto data = reinterpret_cast<const uint32_t*>(f.data());
+			for (uint32_t i = 0; i < total; ++i)
+				Assert::AreEqual(i, LE2HE(data[i]));
+			uint32_t x;
+			f.seekbeg(sizeof(uint32_t) * (total - 1));
+			f >> x;
+			Assert::IsTrue(f.ok());
+			Assert::AreEqual(total - 1, x);
+			f >> x;
+			Assert::IsFalse(f.ok());
+		}
+		std::filesystem::remove(filename);
+	}
+
+	void stream::read_at()
+	{
+		constexpr size_t total = 0x10000;
+		std::unique_ptr<uint8_t[]> data(new uint8_t[total]);
+		for (size_t i = 0; i < total; ++i)
+			data[i] = static_cast<uint8_t>(i ^ (i >> 8));
+		auto check = [&](_Inout_ basic_file& f, _In_ size_t num_workers) {
+			std::vector<std::thread> workers(num_workers);
+			for (size_t i = 0; i < num_workers; ++i) {
+				workers[i] = std::thread([&, i] {
+					uint8_t buf[0x100];
+					for (size_t offset = i * 0x80; offset < total; offset += num_workers * 0x80) {
+						state_t state;
+						size_t num_read = f.read_at(offset, buf, sizeof(buf), &state);
+						Assert::IsTrue(state == state_t::ok);
+						Assert::AreEqual(std::min<size_t>(sizeof(buf), total - offset), num_read);
+						Assert::AreEqual(0, memcmp(data.get() + offset, buf, num_read));
+					}
+				});
+			}
+			for (auto& w : workers)
+				w.join();
+			uint8_t x;
+			state_t state;
+			Assert::AreEqual<size_t>(0, f.read_at(total, &x, sizeof(x), &state));
+			Assert::IsTrue(state == state_t::eof);
+		};
+
+		{
+			memory_file f;
+			Assert::AreEqual<size_t>(total - 0x10, f.write_at(0x10, data.get() + 0x10, total - 0x10));
+			Assert::AreEqual<size_t>(0x10, f.write_at(0, data.get(), 0x10));
+			Assert::AreEqual<stdex::stream::fpos_t>(0, f.tell());
+			check(f, 4);
+		}
+		stdex::sstring filename = temp_path() + _T("stdex-stream-read_at.tmp");
+		{
+			file f(filename, mode_for_reading | mode_for_writing | mode_create | mode_binary);
+			Assert::AreEqual<size_t>(total - 0x10, f.write_at(0x10, data.get() + 0x10, total - 0x10));
+			Assert::AreEqual<size_t>(0x10, f.write_at(0, data.get(), 0x10));
+			f.seekbeg(0x20);
+#ifdef _WIN32
+			check(f, 1); // Seeks and reads: not safe for concurrent use
+#else
+			check(f, 4);
+#endif
+			Assert::AreEqual<stdex::stream::fpos_t>(0x20, f.tell());
+		}
+		std::filesystem::remove(filename);
+	}
+
+	void stream::readln()
+	{
+		std::vector<std::string> lines;
+		std::string text;
+		for (size_t i = 0; i < 200; ++i) {
+			std::string line(i % 7 == 0 ? 0 : (i * 37) % 300, static_cast<char>('a' + i % 26));
+			text += line;
+			text += i % 3 ? "\n" : "\r\n";
+			lines.push_back(std::move(line));
+		}
+		text += "last\r";
+		lines.push_back("last\r");
+
+		stdex::sstring filename = temp_path() + _T("stdex-stream-readln.tmp");
+		{
+			file f(filename, mode_for_writing | mode_create | mode_binary);
+			f.write(text.data(), text.size());
+			Assert::IsTrue(f.ok());
+		}
+
+		auto check = [&](_Inout_ basic& f) {
+			std::string line;
+			for (size_t i = 0; ; ++i) {
+				f.readln(line);
+				if (!f.ok() && line.empty()) {
+					Assert::AreEqual(lines.size(), i);
+					break;
+				}
+				Assert::IsTrue(i < lines.size());
+				Assert::AreEqual(lines[i].c_str(), line.c_str());
+			}
+		};
+		auto check_lines = [&](_Inout_ basic& f) {
+			size_t i = 0;
+			for (auto line : stdex::stream::lines(f)) {
+				Assert::IsTrue(i < lines.size());
+				Assert::AreEqual(lines[i].c_str(), std::string(line).c_str());
+				++i;
+			}
+			Assert::AreEqual(lines.size(), i);
+		};
+
+		{
+			memory_file f;
+			f.write(text.data(), text.size());
+			f.seekbeg(0);
+			check(f);
+			f.seekbeg(0);
+			check_lines(f);
+		}
+		{
+			memory_file source;
+			source.write(text.data(), text.size());
+			source.seekbeg(0);
+			buffer f(source, 0x40, 0);
+			check(f);
+			source.seekbeg(0);
+			buffer f2(source, 0x40, 0);
+			check_lines(f2);
+		}
+		{
+			cached_file f(filename, mode_for_reading | mode_open_existing | mode_binary, 0x80, 4);
+			check(f);
+			f.seekbeg(0);
+			check_lines(f);
+		}
+		{
+			file f(filename, mode_for_reading | mode_open_existing | mode_binary);
+			check(f);
+			f.seekbeg(0);
+			check_lines(f);
+		}
+		std::filesystem::remove(filename);
+	}
+
+	void stream::vectored()
+	{
+		uint8_t data[0x1000];
+		for (size_t i = 0; i < sizeof(data); ++i)
+			data[i] = static_cast<uint8_t>(i * 7);
+		const_iovec_t out[] = {
+			{ data, 3 },
+			{ data + 3, 0 },
+			{ data + 3, 0x20 },
+			{ data + 0x23, sizeof(data) - 0x23 },
+		};
+		auto check = [&](_Inout_ basic& f) {
+			uint8_t buf[sizeof(data) + 0x10];
+			iovec_t in[] = {
+				{ buf, 0x100 },
+				{ buf + 0x100, 1 },
+				{ buf + 0x101, sizeof(buf) - 0x101 },
+			};
+			Assert::AreEqual(sizeof(data), f.readv(in, _countof(in)));
+			Assert::IsTrue(f.ok());
+			Assert::AreEqual(0, memcmp(data, buf, sizeof(data)));
+			Assert::AreEqual<size_t>(0, f.readv(in, _countof(in)));
+			Assert::IsFalse(f.ok());
+		};
+
+		{
+			memory_file f;
+			Assert::AreEqual(sizeof(data), f.writev(out, _countof(out)));
+			Assert::IsTrue(f.ok());
+			f.seekbeg(0);
+			check(f);
+		}
+
+		stdex::sstring filename = temp_path() + _T("stdex-stream-vectored.tmp");
+		{
+			file f(filename, mode_for_writing | mode_create | mode_binary);
+			Assert::AreEqual(sizeof(data), f.writev(out, _countof(out)));
+			Assert::IsTrue(f.ok());
+		}
+		{
+			file f(filename, mode_for_reading | mode_open_existing | mode_binary);
+			check(f);
+		}
+		{
+			file f(filename, mode_for_writing | mode_create | mode_binary);
+			buffer b(f, 0, 0x100);
+			Assert::AreEqual<size_t>(0x23, b.writev(out, 3)); // Buffered
+			Assert::AreEqual(sizeof(data) - 0x23, b.writev(out + 3, 1)); // Bypass
+			Assert::IsTrue(b.ok());
+		}
+		{
+			file f(filename, mode_for_reading | mode_open_existing | mode_binary);
+			buffer b(f, 0x100, 0);
+			check(b);
+		}
+		std::filesystem::remove(filename);
+	}
+
+	void stream::stats()
+	{
+		for (uint64_t v = 0; v < 0x10000; v = v * 9 / 8 + 1) {
+			size_t b = latency_histogram::bucket(v);
+			Assert::IsTrue(b < latency_histogram::num_buckets);
+			Assert::IsTrue(v <= latency_histogram::upper_bound(b));
+			Assert::IsTrue(!b || latency_histogram::upper_bound(b - 1) < v);
+			Assert::IsTrue(latency_histogram::upper_bound(b) - v <= v / 16);
+		}
+		Assert::AreEqual(latency_histogram::num_buckets - 1, latency_histogram::bucket(UINT64_MAX));
+		Assert::AreEqual<uint64_t>(UINT64_MAX, latency_histogram::upper_bound(latency_histogram::num_buckets - 1));
+
+		latency_histogram h;
+		Assert::AreEqual<uint64_t>(0, h.percentile(50));
+		for (uint64_t v = 1; v <= 100; ++v)
+			h.record(v * 1000);
+		Assert::AreEqual<uint64_t>(100, h.count());
+		Assert::AreEqual<uint64_t>(5050000, h.sum());
+		Assert::AreEqual<uint64_t>(100000, h.maximum());
+		uint64_t p50 = h.percentile(50);
+		Assert::IsTrue(50000 <= p50 && p50 <= 50000 + 50000 / 16);
+		Assert::AreEqual<uint64_t>(100000, h.percentile(100));
+
+		memory_file m;
+		{
+			stats_stream s(m);
+			s.write("Hello, ", 7);
+			const_iovec_t iov[] = { { "World", 5 }, { "!", 1 } };
+			s.writev(iov, _countof(iov));
+			s.flush();
+			Assert::AreEqual<uint64_t>(2, s.stats().write.calls);
+			Assert::AreEqual<uint64_t>(13, s.stats().write.bytes);
+			Assert::AreEqual<uint64_t>(2, s.stats().write.latency.count());
+			Assert::AreEqual<uint64_t>(1, s.stats().flush.calls);
+			Assert::AreEqual<uint64_t>(0, s.stats().read.calls);
+		}
+		{
+			stats_file f(m);
+			f.seekbeg(0);
+			char buf[0x10];
+			Assert::AreEqual<size_t>(13, f.read(buf, sizeof(buf)));
+			Assert::AreEqual<size_t>(5, f.read_at(7, buf, 5));
+			Assert::AreEqual<uint64_t>(1, f.stats().seek.calls);
+			Assert::AreEqual<uint64_t>(2, f.stats().read.calls);
+			Assert::AreEqual<uint64_t>(18, f.stats().read.bytes);
+
+			memory_file out;
+			f.stats().dump_json(out);
+			out.write_byte(0);
+			auto json = reinterpret_cast<const char*>(out.data());
+			static const char json_prefix[] = "{\"read\":{\"calls\":2,\"bytes\":18,";
+			Assert::IsTrue(strncmp(json, json_prefix, _countof(json_prefix) - 1) == 0);
+			Assert::IsTrue(strstr(json, "\"seek\":{\"calls\":1,\"bytes\":0,") != nullptr);
+			Assert::IsTrue(json[strlen(json) - 1] == '}');
+
+			out.seekbeg(0);
+			out.truncate();
+			f.stats().dump_text(out);
+			out.write_byte(0);
+			Assert::IsTrue(strstr(reinterpret_cast<const char*>(out.data()), "\nread ") != nullptr);
+
+			f.stats().reset();
+			Assert::AreEqual<uint64_t>(0, f.stats().read.calls);
+			Assert::AreEqual<uint64_t>(0, f.stats().read.latency.count());
+		}
+		{
+			// Direct access and stream copies reach the source and are counted too.
+			stats_file f(m);
+			const void* data;
+			size_t length;
+			f.seekbeg(0);
+			Assert::IsTrue(f.read_until('!', data, length));
+			Assert::AreEqual<size_t>(13, length);
+			f.seekbeg(0);
+			Assert::IsTrue(f.peek(5, data, length));
+			Assert::IsTrue(length >= 5);
+			Assert::AreEqual(0, memcmp(data, "Hello", 5));
+			f.consume(5);
+			Assert::AreEqual<stdex::stream::fpos_t>(5, f.tell());
+			Assert::AreEqual<uint64_t>(2, f.stats().read.calls);
+			Assert::AreEqual<uint64_t>(18, f.stats().read.bytes);
+
+			memory_file out;
+			stats_stream s(out);
+			Assert::AreEqual<fsize_t>(8, s.write_stream(f));
+			Assert::AreEqual<uint64_t>(1, s.stats().write.calls);
+			Assert::AreEqual<uint64_t>(8, s.stats().write.bytes);
+			Assert::AreEqual<fsize_t>(8, out.size());
+		}
+	}
+
+	void stream::uring()
+	{
+#ifdef __linux__
+		static const size_t total = 0x12345;
+		std::unique_ptr<uint8_t[]> data(new uint8_t[total]);
+		for (size_t i = 0; i < total; ++i)
+			data[i] = static_cast<uint8_t>(i * 7 + (i >> 8));
+		stdex::sstring filename = temp_path() + _T("stdex-stream-uring.tmp");
+		{
+			file f(filename, mode_for_writing | mode_create | mode_binary);
+			f.write_byte(0);
+			{
+				uring_writer w(f, 0x1000, 4);
+				for (size_t offset = 0, n = 1; offset < total; offset += n, n = n * 3 % 0x2345 + 1) {
+					n = std::min(n, total - offset);
+					Assert::AreEqual(n, w.write(data.get() + offset, n));
+				}
+				w.flush();
+				Assert::IsTrue(w.ok());
+			}
+			Assert::AreEqual<stdex::stream::fpos_t>(total + 1, f.tell());
+			Assert::AreEqual<fsize_t>(total + 1, f.size());
+		}
+		{
+			file f(filename, mode_for_reading | mode_open_existing | mode_binary);
+			Assert::AreEqual<uint8_t>(0, f.read_byte());
+			std::unique_ptr<uint8_t[]> buf(new uint8_t[total]);
+			{
+				uring_reader r(f, 0x1000, 4);
+				size_t offset = 0;
+				for (size_t n = 1; offset < total; offset += n, n = n * 5 % 0x3456 + 1) {
+					n = std::min(n, total - offset);
+					Assert::AreEqual(n, r.read(buf.get() + offset, n));
+				}
+				Assert::AreEqual(0, memcmp(data.get(), buf.get(), total));
+				Assert::AreEqual<size_t>(0, r.read(buf.get(), 1));
+				Assert::IsTrue(r.state() == state_t::eof);
+			}
+			Assert::AreEqual<stdex::stream::fpos_t>(total + 1, f.tell());
+		}
+		{
+			file f(filename, mode_for_reading | mode_open_existing | mode_binary);
+			f.seekbeg(0x1001);
+			{
+				uring_reader r(f, 0x800, 3);
+				uint8_t buf[0x10];
+				Assert::AreEqual(sizeof(buf), r.read(buf, sizeof(buf)));
+				Assert::AreEqual(0, memcmp(data.get() + 0x1000, buf, sizeof(buf)));
+			}
+			Assert::AreEqual<stdex::stream::fpos_t>(0x1011, f.tell());
+		}
+		{
+			// Simulates a source returning short reads, like pipes, FUSE or network file systems do
+			class short_uring_reader : public uring_reader
+			{
+			public:
+				short_uring_reader(_Inout_ file& source) : uring_reader(source, 0x1000, 4) {}
+
+			protected:
+				virtual void complete(_In_ size_t i, _In_ int res)
+				{
+					uring_reader::complete(i, std::min(res, 0x123));
+				}
+			};
+
+			file f(filename, mode_for_reading | mode_open_existing | mode_binary);
+			Assert::AreEqual<uint8_t>(0, f.read_byte());
+			short_uring_reader r(f);
+			std::vector<uint8_t> content = r.read_remainder();
+			Assert::AreEqual(total, content.size());
+			Assert::AreEqual(0, memcmp(data.get(), content.data(), total));
+			Assert::IsTrue(r.state() == state_t::eof);
+		}
+		std::filesystem::remove(filename);
+#endif
+	}
+
+	void stream::uring_benchmark()
+	{
+#ifdef __linux__
+		if (!benchmark_enabled())
+			return;
+		constexpr size_t total = 0x4000000, run = 0x40000, num_runs = 0x100;
+		stdex::sstring filename = temp_path() + _T("stdex-stream-uring_benchmark.tmp");
+		std::unique_ptr<uint8_t[]> buf(new uint8_t[run]);
+		random_data(buf.get(), run);
+		{
+			file f(filename, mode_for_writing | mode_create | mode_binary);
+			for (size_t offset = 0; offset < total; offset += run)
+				f.write(buf.get(), run);
+			f.flush();
+		}
+		{
+			file f(filename, mode_for_reading | mode_open_existing | mode_binary);
+			auto measure = [&](_In_z_ const char* name, _In_ bool random, _In_ const std::function<std::unique_ptr<basic>()>& open) {
+				f.seekbeg(0);
+				f.advise(access_hint_t::dontneed); // Drop file from OS cache to read it from the device
+				benchmark(name, random ? num_runs * run : total, [&] {
+					if (!random) {
+						auto r = open();
+						while (r->read(buf.get(), run) == run);
+						return;
+					}
+					uint32_t seed = 1;
+					for (size_t i = 0; i < num_runs; ++i) {
+						f.seekbeg(static_cast<stdex::stream::fpos_t>(random_number(seed, static_cast<uint32_t>(total / run))) * run);
+						auto r = open();
+						r->read(buf.get(), run);
+					}
+				});
+			};
+			auto open_async = [&] { return std::unique_ptr<basic>(new async_reader<>(f)); };
+			auto open_uring = [&] { return std::unique_ptr<basic>(new uring_reader(f)); };
+			measure("async_reader sequential", false, open_async);
+			measure("uring_reader sequential", false, open_uring);
+			measure("async_reader random", true, open_async);
+			measure("uring_reader random", true, open_uring);
+		}
+		std::filesystem::remove(filename);
+#endif
+	}
+
+	void stream::write_stream()
+	{
+		static const size_t total = 0x23456;
+		std::unique_ptr<uint8_t[]> data(new uint8_t[total]);
+		for (size_t i = 0; i < total; ++i)
+			data[i] = static_cast<uint8_t>(i * 11 + (i >> 9));
+		stdex::sstring filename = temp_path() + _T("stdex-stream-write_stream.tmp");
+		stdex::sstring filename2 = temp_path() + _T("stdex-stream-write_stream2.tmp");
+		{
+			file f(filename, mode_for_writing | mode_create | mode_binary);
+			f.write(data.get(), total);
+		}
+		{
+			file src(filename, mode_for_reading | mode_open_existing | mode_binary);
+			file dst(filename2, mode_for_writing | mode_create | mode_binary);
+			src.seekbeg(0x100);
+			Assert::AreEqual<fsize_t>(0x10000, dst.write_stream(src, 0x10000));
+			Assert::IsTrue(dst.ok());
+			Assert::IsTrue(src.ok());
+			Assert::AreEqual<stdex::stream::fpos_t>(0x10100, src.tell());
+			Assert::AreEqual<fsize_t>(total - 0x10100, dst.write_stream(src));
+			Assert::IsTrue(dst.ok());
+			Assert::IsTrue(src.state() == state_t::eof);
+			Assert::AreEqual<stdex::stream::fpos_t>(total - 0x100, dst.tell());
+		}
+		{
+			file f(filename2, mode_for_reading | mode_open_existing | mode_binary);
+			std::unique_ptr<uint8_t[]> buf(new uint8_t[total]);
+			Assert::AreEqual(total - 0x100, f.read(buf.get(), total));
+			Assert::AreEqual(0, memcmp(data.get() + 0x100, buf.get(), total - 0x100));
+		}
+#ifndef _WIN32
+		{
+			// File to pipe to file
+			int fd[2];
+			Assert::IsTrue(pipe(fd) >= 0);
+			basic_sys p_in(fd[0]), p_out(fd[1]);
+			std::thread writer([&] {
+				file src(filename, mode_for_reading | mode_open_existing | mode_binary);
+				Assert::AreEqual<fsize_t>(total, p_out.write_stream(src));
+				p_out.close();
+			});
+			{
+				file dst(filename2, mode_for_writing | mode_create | mode_binary);
+				Assert::AreEqual<fsize_t>(total, dst.write_stream(p_in));
+				Assert::IsTrue(dst.ok());
+			}
+			writer.join();
+			file f(filename2, mode_for_reading | mode_open_existing | mode_binary);
+			std::unique_ptr<uint8_t[]> buf(new uint8_t[total]);
+			Assert::AreEqual(total, f.read(buf.get(), total));
+			Assert::AreEqual(0, memcmp(data.get(), buf.get(), total));
+		}
+#endif
+		std::filesystem::remove(filename);
+		std::filesystem::remove(filename2);
+	}
+
+	void stream::chunked_memory_file()
+	{
+		static const size_t total = 0x2345;
+		std::vector<uint8_t> data = random_data(total);
+		stdex::stream::chunked_memory_file f(0x100);
+		write_chunked(f, data.data(), total, 0x3ff);
+		Assert::AreEqual<fsize_t>(total, f.size());
+
+		std::unique_ptr<uint8_t[]> buf(new uint8_t[total + 0x100]);
+		f.seekbeg(0x10);
+		Assert::AreEqual(total - 0x10, f.read(buf.get(), total));
+		Assert::AreEqual(0, memcmp(data.data() + 0x10, buf.get(), total - 0x10));
+		Assert::AreEqual<size_t>(0, f.read(buf.get(), 1));
+		Assert::IsTrue(f.state() == state_t::eof);
+		Assert::AreEqual<size_t>(0x200, f.read_at(0xff, buf.get(), 0x200));
+		Assert::AreEqual(0, memcmp(data.data() + 0xff, buf.get(), 0x200));
+
+		const_iovec_t iov[0x10];
+		size_t count = f.segments(iov, _countof(iov), 0x180);
+		Assert::AreEqual<size_t>(0x10, count);
+		Assert::IsTrue(iov[0].length == 0x80 && iov[1].length == 0x100);
+		count = f.segments(iov, _countof(iov), 0x2000);
+		Assert::AreEqual<size_t>(4, count);
+		Assert::AreEqual<size_t>(0x45, iov[3].length);
+		{
+			memory_file g;
+			Assert::AreEqual<size_t>(total - 0x2000, g.writev(iov, count));
+			Assert::AreEqual(0, memcmp(data.data() + 0x2000, g.data(), total - 0x2000));
+		}
+
+		// Sparse write zero-fills the gap.
+		Assert::AreEqual<size_t>(1, f.write_at(total + 0x200, data.data(), 1));
+		Assert::AreEqual<fsize_t>(total + 0x201, f.size());
+		Assert::AreEqual<size_t>(0x201, f.read_at(total, buf.get(), 0x300));
+		for (size_t i = 0; i < 0x200; ++i)
+			Assert::AreEqual<uint8_t>(0, buf[i]);
+		Assert::AreEqual(data[0], buf[0x200]);
+
+		f.seekbeg(0x123);
+		f.truncate();
+		Assert::AreEqual<fsize_t>(0x123, f.size());
+		f.seekbeg(0x180);
+		f.truncate();
+		f.seekbeg(0);
+		Assert::AreEqual<size_t>(0x180, f.read(buf.get(), total));
+		Assert::AreEqual(0, memcmp(data.data(), buf.get(), 0x123));
+		for (size_t i = 0x123; i < 0x180; ++i)
+			Assert::AreEqual<uint8_t>(0, buf[i]);
+
+		{
+			// Chunk count must not wrap for offsets near fsize_max.
+			stdex::stream::chunked_memory_file g(SIZE_MAX / 2 + 1);
+			state_t state;
+			Assert::AreEqual<size_t>(0, g.write_at(fsize_max - 0x10, data.data(), 1, &state));
+			Assert::IsTrue(state == state_t::fail);
+			Assert::AreEqual<fsize_t>(0, g.size());
+		}
+
+		// Line spanning chunks
+		f.seekbeg(0xfe);
+		std::string line;
+		f.write("abc\ndef", 7);
+		f.seekbeg(0xfe);
+		f.readln(line);
+		Assert::AreEqual("abc", line.c_str());
+	}
+
+	void stream::fifo()
+	{
+		static const size_t total = 0x3456;
+		std::vector<uint8_t> data = random_data(total);
+		std::unique_ptr<uint8_t[]> buf(new uint8_t[total]);
+		auto fill = [&](_Inout_ basic& f) { write_chunked(f, data.data(), total, 0x7ff); };
+
+		{
+			stdex::stream::fifo f(0x100);
+			fill(f);
+			Assert::AreEqual(total, f.size());
+			read_chunked(f, data.data(), total, 0x3ff);
+			Assert::AreEqual<size_t>(0, f.read(buf.get(), 1));
+			Assert::IsTrue(f.state() == state_t::eof);
+
+			// Splice to a stream and to another fifo.
+			fill(f);
+			Assert::AreEqual<size_t>(5, f.read(buf.get(), 5));
+			memory_file m;
+			Assert::AreEqual<size_t>(0x1000, f.splice_to(m, 0x1000));
+			Assert::AreEqual(0, memcmp(data.data() + 5, m.data(), 0x1000));
+			stdex::stream::fifo g(0x80);
+			g.write(data.data(), 3);
+			Assert::AreEqual(total - 0x1005, f.splice_to(g));
+			Assert::AreEqual<size_t>(0, f.size());
+			Assert::AreEqual(total - 0x1002, g.size());
+			g.write(data.data(), 7);
+			Assert::AreEqual(total - 0x1002 + 7, g.read(buf.get(), total));
+			Assert::AreEqual(0, memcmp(data.data(), buf.get(), 3));
+			Assert::AreEqual(0, memcmp(data.data() + 0x1005, buf.get() + 3, total - 0x1005));
+			Assert::AreEqual(0, memcmp(data.data(), buf.get() + total - 0x1002, 7));
+		}
+
+		{
+			// In-process pipe
+			stdex::stream::fifo f(0x100, true);
+			std::thread writer([&] {
+				for (size_t i = 0; i < 0x10; ++i)
+					fill(f);
+				f.quit();
+			});
+			for (size_t i = 0; i < 0x10; ++i) {
+				Assert::AreEqual(total, f.read(buf.get(), total));
+				Assert::AreEqual(0, memcmp(data.data(), buf.get(), total));
+			}
+			Assert::AreEqual<size_t>(0, f.read(buf.get(), 1));
+			Assert::IsTrue(f.state() == state_t::eof);
+			writer.join();
+		}
+		{
+			stdex::stream::fifo f(0x100, true);
+			std::thread writer([&] {
+				for (size_t i = 0; i < 0x10; ++i)
+					fill(f);
+				f.quit();
+			});
+			memory_file m;
+			for (;;) {
+				uint8_t b;
+				if (!f.read(&b, 1))
+					break;
+				m.write_byte(b);
+				f.splice_to(m);
+			}
+			writer.join();
+			Assert::AreEqual<fsize_t>(0x10 * total, m.size());
+			for (size_t i = 0; i < 0x10; ++i)
+				Assert::AreEqual(0, memcmp(data.data(), reinterpret_cast<const uint8_t*>(m.data()) + i * total, total));
+		}
+		{
+			// Reuse after close
+			stdex::stream::fifo f(0x100, true);
+			fill(f);
+			f.close();
+			Assert::AreEqual<size_t>(0, f.size());
+			std::thread writer([&] {
+				fill(f);
+				f.quit();
+			});
+			Assert::AreEqual(total, f.read(buf.get(), total));
+			Assert::AreEqual(0, memcmp(data.data(), buf.get(), total));
+			writer.join();
+		}
+		{
+			// Two fifos splicing to each other
+			stdex::stream::fifo f(0x80, true), g(0x80, true);
+			fill(f);
+			fill(g);
+			std::thread splicer([&] {
+				for (size_t i = 0; i < 0x1000; ++i)
+					f.splice_to(g);
+			});
+			for (size_t i = 0; i < 0x1000; ++i)
+				g.splice_to(f);
+			splicer.join();
+			Assert::AreEqual(2 * total, f.size() + g.size());
+		}
+	}
+
+	void stream::peek()
+	{
+		static const size_t total = 0x3456;
+		std::vector<uint8_t> data = random_data(total);
+		auto drain = [&](_Inout_ basic& f) {
+			size_t offset = 0;
+			for (size_t n = 1;; n = n * 3 % 0x1ff + 1) {
+				const void* view;
+				size_t available;
+				Assert::IsTrue(f.peek(n, view, available));
+				if (!available) {
+					Assert::IsTrue(f.state() == state_t::eof);
+					break;
+				}
+				Assert::IsTrue(f.ok());
+				Assert::IsTrue(offset + available <= total);
+				Assert::AreEqual(0, memcmp(data.data() + offset, view, available));
+				n = std::min(n, available);
+				f.consume(n);
+				offset += n;
+			}
+			Assert::AreEqual(total, offset);
+		};
+
+		memory_file m(data.data(), total);
+		drain(m);
+
+		{
+			m.seekbeg(0);
+			stdex::stream::buffer b(m, 0x100, 0);
+			uint8_t x[0x11];
+			Assert::AreEqual(sizeof(x), b.read(x, sizeof(x)));
+			const void* view;
+			size_t available;
+			// Request more than buffered: the remaining data should be moved to the front and topped up.
+			Assert::IsTrue(b.peek(0x100, view, available));
+			Assert::AreEqual<size_t>(0x100, available);
+			Assert::AreEqual(0, memcmp(data.data() + sizeof(x), view, available));
+			b.consume(0x7f);
+			Assert::AreEqual(sizeof(x), b.read(x, sizeof(x)));
+			Assert::AreEqual(0, memcmp(data.data() + sizeof(x) + 0x7f, x, sizeof(x)));
+
+			// Let a parser match directly against buffered bytes.
+			size_t offset = sizeof(x) * 2 + 0x7f;
+			stdex::parser::string p(reinterpret_cast<const char*>(data.data() + offset), 0x20);
+			Assert::IsTrue(b.peek(0x20, view, available));
+			Assert::IsTrue(p.match(reinterpret_cast<const char*>(view), 0, available));
+			b.consume(p.interval.end);
+			Assert::AreEqual(sizeof(x), b.read(x, sizeof(x)));
+			Assert::AreEqual(0, memcmp(data.data() + offset + p.interval.end, x, sizeof(x)));
+		}
+
+		{
+			m.seekbeg(0);
+			stdex::stream::buffer b(m, 0x100, 0);
+			drain(b);
+		}
+
+		{
+			m.seekbeg(0);
+			stdex::stream::cache c(m, 0x100);
+			drain(c);
+		}
+
+		{
+			stdex::stream::fifo f(0x100);
+			f.write(data.data(), total);
+			drain(f);
+		}
+
+		{
+			// Source making no progress without reaching end of file, like a non-blocking socket
+			class idle_stream : public basic
+			{
+			public:
+				virtual _Success_(return != 0 || length == 0) size_t read(
+					_Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length)
+				{
+					_Unreferenced_(data);
+					_Unreferenced_(length);
+					m_state = state_t::ok;
+					return 0;
+				}
+			} s;
+			stdex::stream::buffer b(s, 0x100, 0);
+			const void* view;
+			size_t available;
+			Assert::IsTrue(b.peek(0x10, view, available));
+			Assert::AreEqual<size_t>(0, available);
+		}
+	}
+
+	void stream::coroutine()
+	{
+#if __cpp_impl_coroutine >= 201902L
+		static const size_t total = 0x12345;
+		std::unique_ptr<uint8_t[]> data(new uint8_t[total]);
+		for (size_t i = 0; i < total; ++i)
+			data[i] = static_cast<uint8_t>(i * 17 + (i >> 8));
+		std::atomic<size_t> done(0);
+
+		{
+			// Memory streams complete in place.
+			memory_file m;
+			write_all(m, data.get(), total, done);
+			Assert::AreEqual<size_t>(1, done);
+			m.seekbeg(0);
+			std::vector<uint8_t> content;
+			read_all(m, content, done);
+			Assert::AreEqual<size_t>(2, done);
+			Assert::AreEqual(total, content.size());
+			Assert::AreEqual(0, memcmp(data.get(), content.data(), total));
+		}
+
+		{
+			// Converters forward requests to their source. Memory streams complete them in place.
+			memory_file m;
+			{
+				base64_writer w(m);
+				done = 0;
+				write_all(w, data.get(), total, done);
+				while (done < 1) std::this_thread::yield();
+			}
+			m.seekbeg(0);
+			base64_reader r(m);
+			stdex::stream::buffer b(r, 0x100, 0);
+			std::vector<uint8_t> content;
+			read_all(b, content, done);
+			while (done < 2) std::this_thread::yield();
+			Assert::AreEqual(total, content.size());
+			Assert::AreEqual(0, memcmp(data.get(), content.data(), total));
+		}
+
+#ifdef __linux__
+		{
+			// One thread drives many connections.
+			static const size_t count = 0x10;
+			stdex::reactor reactor;
+			stdex::stream::socket server[count], client[count];
+			std::vector<uint8_t> content[count];
+			done = 0;
+			for (size_t i = 0; i < count; ++i) {
+				int sv[2];
+				Assert::AreEqual(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+				server[i] = stdex::stream::socket(sv[0]);
+				client[i] = stdex::stream::socket(sv[1]);
+				for (auto s : { &server[i], &client[i] }) {
+					Assert::IsTrue(s->set_nonblocking());
+					s->set_reactor(&reactor);
+				}
+				echo(server[i], done);
+				// Read and write on the same socket at the same time.
+				write_all(client[i], data.get(), total, done);
+				read_all(client[i], content[i], done);
+			}
+			while (done < count * 3)
+				reactor.run_once();
+			Assert::AreEqual<size_t>(0, reactor.size());
+			for (size_t i = 0; i < count; ++i) {
+				Assert::AreEqual(total, content[i].size());
+				Assert::AreEqual(0, memcmp(data.get(), content[i].data(), total));
+			}
+		}
+
+		{
+			// Converters over a socket complete on reactor's thread too.
+			stdex::reactor reactor;
+			int sv[2];
+			Assert::AreEqual(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+			stdex::stream::socket server(sv[0]), client(sv[1]);
+			for (auto s : { &server, &client }) {
+				Assert::IsTrue(s->set_nonblocking());
+				s->set_reactor(&reactor);
+			}
+			stdex::stream::buffer b(client, 0x100, 0);
+			std::vector<uint8_t> content;
+			done = 0;
+			reactor.run_once(std::chrono::milliseconds(0)); // Make this the reactor's thread
+			read_all(b, content, done);
+			std::thread writer([&] {
+				// Submitted from another thread, requests are posted to reactor's thread.
+				write_all(server, data.get(), total, done);
+			});
+			while (done < 2)
+				reactor.run_once();
+			writer.join();
+			Assert::AreEqual<size_t>(0, reactor.size());
+			Assert::AreEqual(total, content.size());
+			Assert::AreEqual(0, memcmp(data.get(), content.data(), total));
+		}
+#endif
+#endif
+	}
+
+	void stream::reactor()
+	{
+#ifdef __linux__
+		static const size_t total = 0x23456;
+		std::vector<uint8_t> data = random_data(total);
+		stdex::reactor r;
+
+		{
+			// Echo server multiplexing several connections
+			struct connection_t {
+				stdex::stream::socket s;
+				std::vector<uint8_t> pending;
+				bool closing = false;
+			};
+			static const size_t count = 4;
+			std::unique_ptr<connection_t> server[count];
+			stdex::stream::socket client[count];
+			for (size_t i = 0; i < count; ++i) {
+				int sv[2];
+				Assert::AreEqual(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+				client[i] = stdex::stream::socket(sv[0]);
+				server[i].reset(new connection_t);
+				server[i]->s = stdex::stream::socket(sv[1]);
+				auto c = server[i].get();
+				Assert::IsTrue(c->s.set_nonblocking());
+				auto flush = [&r, c] {
+					size_t num_written = c->s.write(c->pending.data(), c->pending.size());
+					c->pending.erase(c->pending.begin(), c->pending.begin() + num_written);
+					if (!c->pending.empty()) {
+						// Wait for the peer to catch up before reading more.
+						r.modify(c->s.get(), stdex::reactor::event_write);
+						return;
+					}
+					if (c->closing) {
+						c->s.shutdown_write();
+						r.remove(c->s.get());
+						return;
+					}
+					r.modify(c->s.get(), stdex::reactor::event_read);
+				};
+				r.add(c->s.get(), stdex::reactor::event_read, [c, flush](_In_ uint32_t events) {
+					if (events & stdex::reactor::event_read) {
+						uint8_t buf[0x1000];
+						size_t num_read = c->s.read(buf, sizeof(buf));
+						c->pending.insert(c->pending.end(), buf, buf + num_read);
+						if (!num_read && c->s.state() != state_t::wait)
+							c->closing = true;
+					}
+					flush();
+				});
+			}
+			Assert::AreEqual(count, r.size());
+			std::thread server_thread([&] { r.run(); });
+			std::vector<std::thread> threads;
+			for (size_t i = 0; i < count; ++i) {
+				threads.push_back(std::thread([&, i] {
+					// Stream state is not thread-safe. Write using a duplicated handle.
+					stdex::stream::socket writer(dup(client[i].get()));
+					write_chunked(writer, data.data(), total);
+					writer.shutdown_write();
+				}));
+			}
+			for (size_t i = 0; i < count; ++i) {
+				std::unique_ptr<uint8_t[]> buf(new uint8_t[total]);
+				Assert::AreEqual(total, client[i].read(buf.get(), total));
+				Assert::AreEqual(0, memcmp(data.data(), buf.get(), total));
+				uint8_t x;
+				Assert::AreEqual<size_t>(0, client[i].read(&x, 1));
+				Assert::IsTrue(client[i].state() == state_t::eof);
+			}
+			for (auto& t : threads)
+				t.join();
+			server_thread.join();
+			Assert::AreEqual<size_t>(0, r.size());
+		}
+
+		{
+			// Idle timeout and quit
+			int sv[2];
+			Assert::AreEqual(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+			stdex::stream::socket a(sv[0]), b(sv[1]);
+			uint32_t reported = 0;
+			r.add(a.get(), stdex::reactor::event_read, [&](_In_ uint32_t events) { reported |= events; }, std::chrono::milliseconds(10));
+			while (!reported)
+				r.run_once();
+			Assert::AreEqual(stdex::reactor::event_timeout, reported);
+			std::thread t([&] { r.run(); });
+			r.quit();
+			t.join();
+			r.remove(a.get());
+		}
+
+		{
+			// Would-block is reported distinctly from end of file.
+			int sv[2];
+			Assert::AreEqual(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+			stdex::stream::socket a(sv[0]), b(sv[1]);
+			Assert::IsTrue(a.set_nonblocking());
+			uint8_t buf[0x10];
+			Assert::AreEqual<size_t>(0, a.read(buf, sizeof(buf)));
+			Assert::IsTrue(a.state() == state_t::wait);
+			b.close();
+			Assert::AreEqual<size_t>(0, a.read(buf, sizeof(buf)));
+			Assert::IsTrue(a.state() == state_t::eof);
+
+			// Closing socket stops monitoring it.
+			r.run_once(std::chrono::milliseconds(0)); // Make this the reactor's thread
+			a.set_reactor(&r);
+			r.add(a.get(), stdex::reactor::event_read, [](_In_ uint32_t) {});
+			a.close();
+			Assert::AreEqual<size_t>(0, r.size());
+
+			// Off reactor's thread, removal is posted to it.
+			Assert::AreEqual(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+			a = stdex::stream::socket(sv[0]);
+			b = stdex::stream::socket(sv[1]);
+			a.set_reactor(&r);
+			r.add(a.get(), stdex::reactor::event_read, [](_In_ uint32_t) {});
+			std::thread([&] { a.close(); }).join();
+			Assert::AreEqual<size_t>(1, r.size());
+			r.run_once(std::chrono::milliseconds(0));
+			Assert::AreEqual<size_t>(0, r.size());
+		}
+
+		{
+			// Batched writes over loopback TCP
+			stdex::stream::socket listener(AF_INET, SOCK_STREAM, 0);
+			Assert::IsTrue(listener.ok());
+			sockaddr_in addr = {};
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			socklen_t addr_len = sizeof(addr);
+			Assert::AreEqual(0, bind(listener.get(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+			Assert::AreEqual(0, listen(listener.get(), 1));
+			Assert::AreEqual(0, getsockname(listener.get(), reinterpret_cast<sockaddr*>(&addr), &addr_len));
+			stdex::stream::socket sender(AF_INET, SOCK_STREAM, 0);
+			Assert::AreEqual(0, connect(sender.get(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+			stdex::stream::socket receiver(accept(listener.get(), nullptr, nullptr));
+			Assert::IsTrue(receiver);
+			Assert::IsTrue(sender.cork());
+			sender.more();
+			write_chunked(sender, data.data(), 0x1000, 0x1f);
+			sender.more(false);
+			Assert::IsTrue(sender.cork(false));
+			uint8_t buf[0x1000];
+			Assert::AreEqual(sizeof(buf), receiver.read(buf, sizeof(buf)));
+			Assert::AreEqual(0, memcmp(data.data(), buf, sizeof(buf)));
+		}
+#endif
+	}
+
+	void stream::read_data()
+	{
+		static const size_t count = 0x123;
+		uint16_t a16[count];
+		uint32_t a32[count];
+		double a64[count];
+		for (size_t i = 0; i < count; ++i) {
+			a16[i] = static_cast<uint16_t>(i * 0x1357);
+			a32[i] = static_cast<uint32_t>(i * 0x13579bdf);
+			a64[i] = static_cast<double>(i) / 3;
+		}
+
+		// Array byte swap should match element byte swap, including remainders not filling a vector register.
+		for (size_t n = 0; n < 0x13; ++n) {
+			uint16_t b16[0x13];
+			uint32_t b32[0x13];
+			double b64[0x13];
+			memcpy(b16, a16, n * sizeof(*b16));
+			memcpy(b32, a32, n * sizeof(*b32));
+			memcpy(b64, a64, n * sizeof(*b64));
+			stdex::byteswap(b16, n);
+			stdex::byteswap(b32, n);
+			stdex::byteswap(b64, n);
+			for (size_t i = 0; i < n; ++i) {
+				Assert::AreEqual(stdex::byteswap(a16[i]), b16[i]);
+				Assert::AreEqual(stdex::byteswap(a32[i]), b32[i]);
+				Assert::IsTrue(stdex::byteswap(a64[i]) == b64[i]);
+			}
+		}
+
+		memory_file f;
+		f.write_data(a16, count).write_data(a32, count).write_data(a64, count);
+		std::vector<uint32_t> v32(a32, a32 + count);
+		basic& b = f;
+		b.write_data(a32, count);
+		b << v32;
+		Assert::IsTrue(f.ok());
+		f.seekbeg(0);
+		for (size_t i = 0; i < count; ++i) {
+			uint16_t x;
+			f >> x;
+			Assert::AreEqual(a16[i], x);
+		}
+		f.seekbeg(0);
+		uint16_t b16[count];
+		uint32_t b32[count];
+		double b64[count];
+		f.read_data(b16, count).read_data(b32, count).read_data(b64, count);
+		Assert::IsTrue(f.ok());
+		Assert::AreEqual(0, memcmp(a16, b16, sizeof(a16)));
+		Assert::AreEqual(0, memcmp(a32, b32, sizeof(a32)));
+		Assert::AreEqual(0, memcmp(a64, b64, sizeof(a64)));
+		memset(b32, 0, sizeof(b32));
+		b.read_data(b32, count);
+		Assert::AreEqual(0, memcmp(a32, b32, sizeof(a32)));
+		std::vector<uint32_t> w32;
+		b >> w32;
+		Assert::IsTrue(f.ok());
+		Assert::IsTrue(v32 == w32);
+
+		// Reading past the end zeroes the remainder.
+		for (int i = 0; i < 2; ++i) {
+			f.seekbeg(sizeof(a16) + sizeof(a32) * 2 + sizeof(a64) + sizeof(uint32_t) + (count - 2) * sizeof(uint32_t));
+			if (i)
+				b.read_data(b32, 4);
+			else
+				f.read_data(b32, 4);
+			Assert::IsTrue(f.state() == state_t::eof);
+			Assert::AreEqual(a32[count - 2], b32[0]);
+			Assert::AreEqual(a32[count - 1], b32[1]);
+			Assert::AreEqual<uint32_t>(0, b32[2]);
+			Assert::AreEqual<uint32_t>(0, b32[3]);
+		}
+	}
+
 	void stream::file_stat()
 	{
 		stdex::sstring path(temp_path());
@@ -33,4 +33,122 @@ namespace UnitTests
 		Assert::AreEqual<stdex::stream::fsize_t>(sizeof(inflated) - sizeof(*inflated), dat_inflated.size());
 		Assert::AreEqual(0, memcmp(inflated, dat_inflated.data(), sizeof(inflated) - sizeof(*inflated)));
 	}
+
+	void zlib::seekable()
+	{
+		static const size_t total = 0x345678;
+		std::unique_ptr<uint8_t[]> data(new uint8_t[total]);
+		random_data(data.get(), total);
+		for (size_t i = 0; i < total; ++i)
+			data[i] = static_cast<uint8_t>("0123456789abcdef"[data[i] % 16]);
+
+		for (int gzip = 0; gzip < 2; ++gzip) {
+			// Embed gzip data in a container to check index offsets are relative to the compressed data.
+			static const char header[] = "container header";
+			stdex::stream::fpos_t base = gzip ? sizeof(header) : 0;
+			stdex::stream::memory_file dat_deflated;
+			if (gzip) {
+				dat_deflated.write(header, sizeof(header));
+				stdex::parallel_zlib_writer zlib(dat_deflated, Z_DEFAULT_COMPRESSION, 2, 0x10000, true);
+				zlib.write(data.get(), total);
+			}
+			else {
+				stdex::zlib_writer zlib(dat_deflated, Z_DEFAULT_COMPRESSION);
+				zlib.write(data.get(), total);
+			}
+
+			stdex::zlib_index index;
+			dat_deflated.seekbeg(base);
+			index.build(dat_deflated, 0x40000);
+			Assert::AreEqual<stdex::stream::fsize_t>(total, index.size());
+			Assert::IsTrue(index.checkpoints().size() > 4);
+			Assert::AreEqual<stdex::stream::fpos_t>(0, index.checkpoints().front().out);
+
+			// Serialize and deserialize the index.
+			stdex::stream::memory_file dat_index;
+			dat_index << index;
+			dat_index.seekbeg(0);
+			stdex::zlib_index index2;
+			dat_index >> index2;
+			Assert::IsTrue(dat_index.ok());
+			Assert::AreEqual(index.size(), index2.size());
+			Assert::AreEqual(index.checkpoints().size(), index2.checkpoints().size());
+			for (size_t i = 0; i < index.checkpoints().size(); ++i) {
+				Assert::AreEqual(index.checkpoints()[i].in, index2.checkpoints()[i].in);
+				Assert::AreEqual(index.checkpoints()[i].out, index2.checkpoints()[i].out);
+				Assert::AreEqual(index.checkpoints()[i].bits, index2.checkpoints()[i].bits);
+				Assert::IsTrue(index.checkpoints()[i].window == index2.checkpoints()[i].window);
+			}
+
+			dat_deflated.seekbeg(base);
+			stdex::seekable_zlib_reader reader(dat_deflated, index2);
+			Assert::AreEqual<stdex::stream::fsize_t>(total, reader.size());
+			uint8_t buf[0x1234];
+			uint32_t seed = 1;
+			for (uint32_t i = 0; i < 50; ++i) {
+				size_t offset = random_number(seed, static_cast<uint32_t>(total));
+				Assert::AreEqual<stdex::stream::fpos_t>(offset, reader.seekbeg(offset));
+				size_t n = std::min(sizeof(buf), total - offset);
+				Assert::AreEqual(n, reader.read(buf, sizeof(buf)));
+				Assert::AreEqual(0, memcmp(data.get() + offset, buf, n));
+				Assert::AreEqual<stdex::stream::fpos_t>(offset + n, reader.tell());
+			}
+			reader.seek(-0x10, stdex::stream::seek_t::end);
+			Assert::AreEqual<size_t>(0x10, reader.read(buf, sizeof(buf)));
+			Assert::AreEqual(0, memcmp(data.get() + total - 0x10, buf, 0x10));
+			Assert::AreEqual<size_t>(0, reader.read(buf, sizeof(buf)));
+			Assert::IsTrue(reader.state() == stdex::stream::state_t::eof);
+			reader.seekbeg(0);
+			std::vector<uint8_t> content = reader.read_remainder();
+			Assert::AreEqual(total, content.size());
+			Assert::AreEqual(0, memcmp(data.get(), content.data(), total));
+		}
+	}
+
+	void zlib::parallel()
+	{
+		static const size_t total = 0x123456;
+		std::unique_ptr<uint8_t[]> data(new uint8_t[total]);
+		random_data(data.get(), total);
+		for (size_t i = 0; i < total; ++i) {
+			// Compressible, but not trivially
+			data[i] = static_cast<uint8_t>("abcdefgh"[data[i] % 8] + (i % 0x3000 < 0x100 ? 0 : i / 0x3000 % 3));
+		}
+
+		for (int gzip = 0; gzip < 2; ++gzip) {
+			stdex::stream::memory_file dat_deflated;
+			{
+				stdex::parallel_zlib_writer zlib(dat_deflated, Z_DEFAULT_COMPRESSION, 4, 0x10000, gzip != 0);
+				for (size_t offset = 0, n = 1; offset < total; offset += n, n = n * 3 % 0x7fff + 1) {
+					n = std::min(n, total - offset);
+					Assert::AreEqual(n, zlib.write(data.get() + offset, n));
+					if (offset < 0x10000 && offset + n >= 0x10000)
+						zlib.flush();
+				}
+			}
+
+			// Decompress with zlib directly to check the stream is valid zlib or gzip.
+			std::unique_ptr<uint8_t[]> inflated(new uint8_t[total + 1]);
+			z_stream z;
+			memset(&z, 0, sizeof(z));
+			Assert::AreEqual(Z_OK, inflateInit2(&z, gzip ? MAX_WBITS + 16 : MAX_WBITS));
+			z.next_in = reinterpret_cast<Bytef*>(const_cast<void*>(dat_deflated.data()));
+			z.avail_in = static_cast<uInt>(dat_deflated.size());
+			z.next_out = inflated.get();
+			z.avail_out = static_cast<uInt>(total + 1);
+			Assert::AreEqual(Z_STREAM_END, inflate(&z, Z_FINISH));
+			Assert::AreEqual<uLong>(total, z.total_out);
+			Assert::AreEqual<uInt>(0, z.avail_in);
+			inflateEnd(&z);
+			Assert::AreEqual(0, memcmp(data.get(), inflated.get(), total));
+
+			// Compression ratio should be close to single-threaded compression.
+			stdex::stream::memory_file dat_deflated1;
+			{
+				stdex::zlib_writer zlib(dat_deflated1, Z_DEFAULT_COMPRESSION);
+				zlib.write(data.get(), total);
+			}
+			Assert::IsTrue(dat_deflated.size() < dat_deflated1.size() + dat_deflated1.size() / 50);
+		}
+	}
 }
@@ -92,6 +92,9 @@
 #ifndef _Inout_updates_z_
 #define _Inout_updates_z_(p)
 #endif
+#ifndef _Inout_updates_
+#define _Inout_updates_(p)
+#endif
 
 #ifndef _Use_decl_annotations_
 #define _Use_decl_annotations_
@@ -133,6 +136,9 @@
 #ifndef _Out_writes_bytes_to_opt_
 #define _Out_writes_bytes_to_opt_(p, q)
 #endif
+#ifndef _Outptr_result_bytebuffer_
+#define _Outptr_result_bytebuffer_(p)
+#endif
 
 #ifndef _Success_
 #define _Success_(p)
@@ -194,6 +200,12 @@
 #define _NoReturn_ [[noreturn]]
 #endif
 
+#if defined(__GNUC__) || defined(__clang__)
+#define _Target_(features) __attribute__((target(features)))
+#else
+#define _Target_(features)
+#endif
+
 #ifdef _WIN32
 #define _Unreferenced_(x) UNREFERENCED_PARAMETER(x)
 #else
@@ -218,4 +230,6 @@ size_t _countof(const T (&arr)[N])
 #define lseek64 lseek
 #define lockf64 lockf
 #define ftruncate64 ftruncate
+#define pread64 pread
+#define pwrite64 pwrite
 #endif
@@ -0,0 +1,130 @@
+﻿/*
+	SPDX-License-Identifier: MIT
+	Copyright © 2023-2024 Amebis
+*/
+
+#pragma once
+
+#include "compat.hpp"
+#include <stdint.h>
+#if defined(_WIN32)
+#include "windows.h"
+#endif
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define _STDEX_CPU_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define _STDEX_CPU_ARM64
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#include <arm_neon.h>
+#if !defined(_MSC_VER)
+#include <arm_acle.h>
+#endif
+#endif
+
+namespace stdex
+{
+	///
+	/// Instruction set extensions supported by the CPU and operating system this process is running on
+	///
+	/// Flags of other architectures are always false.
+	///
+	inline const struct cpu_features_t
+	{
+		bool ssse3;   ///< x86 SSSE3
+		bool sse41;   ///< x86 SSE4.1
+		bool sse42;   ///< x86 SSE4.2 including CRC32C instruction
+		bool pclmul;  ///< x86 PCLMULQDQ carry-less multiplication
+		bool avx2;    ///< x86 AVX2
+		bool avx512;  ///< x86 AVX-512 Foundation
+		bool sha;     ///< x86 SHA-1 and SHA-256 extensions
+		bool pmull;   ///< ARMv8 PMULL 64-bit carry-less multiplication
+		bool crc32;   ///< ARMv8 CRC32 and CRC32C instructions
+		bool sha1;    ///< ARMv8 SHA-1 instructions
+		bool sha2;    ///< ARMv8 SHA-256 instructions
+
+		cpu_features_t() :
+			ssse3(false),
+			sse41(false),
+			sse42(false),
+			pclmul(false),
+			avx2(false),
+			avx512(false),
+			sha(false),
+			pmull(false),
+			crc32(false),
+			sha1(false),
+			sha2(false)
+		{
+#if defined(_STDEX_CPU_X86)
+			uint32_t r[4]; // eax, ebx, ecx, edx
+			cpuid(0, r);
+			uint32_t max_leaf = r[0];
+			if (max_leaf < 1) _Unlikely_
+				return;
+			cpuid(1, r);
+			ssse3 = (r[2] & (1 << 9)) != 0;
+			sse41 = (r[2] & (1 << 19)) != 0;
+			sse42 = (r[2] & (1 << 20)) != 0;
+			pclmul = (r[2] & (1 << 1)) != 0;
+			bool ymm = false, zmm = false;
+			if (r[2] & (1 << 27)) { // OSXSAVE
+				uint64_t xcr0 = xgetbv();
+				ymm = (xcr0 & 0x06) == 0x06;
+				zmm = (xcr0 & 0xe6) == 0xe6;
+			}
+			if (max_leaf < 7)
+				return;
+			cpuid(7, r);
+			avx2 = ymm && (r[1] & (1 << 5)) != 0;
+			avx512 = zmm && (r[1] & (1 << 16)) != 0;
+			sha = (r[1] & (1 << 29)) != 0;
+#elif defined(_STDEX_CPU_ARM64)
+#if defined(_WIN32)
+			pmull = sha1 = sha2 = IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE) != 0;
+			crc32 = IsProcessorFeaturePresent(PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE) != 0;
+#elif defined(__linux__)
+			unsigned long hwcap = getauxval(AT_HWCAP);
+			pmull = (hwcap & HWCAP_PMULL) != 0;
+			crc32 = (hwcap & HWCAP_CRC32) != 0;
+			sha1 = (hwcap & HWCAP_SHA1) != 0;
+			sha2 = (hwcap & HWCAP_SHA2) != 0;
+#elif defined(__APPLE__)
+			// All Apple Silicon CPUs implement these.
+			pmull = crc32 = sha1 = sha2 = true;
+#endif
+#endif
+		}
+
+#if defined(_STDEX_CPU_X86)
+	protected:
+		static void cpuid(_In_ uint32_t leaf, _Out_writes_(4) uint32_t r[4])
+		{
+#if defined(_MSC_VER)
+			__cpuidex(reinterpret_cast<int*>(r), static_cast<int>(leaf), 0);
+#else
+			__cpuid_count(leaf, 0, r[0], r[1], r[2], r[3]);
+#endif
+		}
+
+		static uint64_t xgetbv()
+		{
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#else
+			uint32_t eax, edx;
+			__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+			return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+		}
+#endif
+	} cpu_features;
+}
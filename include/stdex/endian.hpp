@@ -9,6 +9,12 @@
 #include "compat.hpp"
 #include "system.hpp"
 #include <stdint.h>
+#if defined(__SSSE3__) || defined(__AVX__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#endif
+#include <type_traits>
 
 #ifndef LITTLE_ENDIAN
 #define LITTLE_ENDIAN 1234
@@ -126,6 +132,95 @@ namespace stdex
 	inline void byteswap(_Inout_ int64_t* value) { byteswap(reinterpret_cast<uint64_t*>(value)); }
 	inline void byteswap(_Inout_ float* value) { byteswap(reinterpret_cast<uint32_t*>(value)); }
 	inline void byteswap(_Inout_ double* value) { byteswap(reinterpret_cast<uint64_t*>(value)); }
+
+	///
+	/// Reverses byte order of array elements in place
+	///
+	/// \param[in,out] values  Array of values
+	/// \param[in]     count   Number of elements
+	///
+	inline void byteswap(_Inout_updates_(count) uint16_t* values, _In_ size_t count)
+	{
+		stdex_assert(values || !count);
+		size_t i = 0;
+#if defined(__SSSE3__) || defined(__AVX__)
+		const __m128i mask = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+		for (; i + 8 <= count; i += 8)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i)), mask));
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+		for (; i + 8 <= count; i += 8)
+			vst1q_u8(reinterpret_cast<uint8_t*>(values + i), vrev16q_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(values + i))));
+#endif
+		for (; i < count; ++i)
+			values[i] = byteswap(values[i]);
+	}
+
+	///
+	/// Reverses byte order of array elements in place
+	///
+	/// \param[in,out] values  Array of values
+	/// \param[in]     count   Number of elements
+	///
+	inline void byteswap(_Inout_updates_(count) uint32_t* values, _In_ size_t count)
+	{
+		stdex_assert(values || !count);
+		size_t i = 0;
+#if defined(__SSSE3__) || defined(__AVX__)
+		const __m128i mask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+		for (; i + 4 <= count; i += 4)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i)), mask));
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+		for (; i + 4 <= count; i += 4)
+			vst1q_u8(reinterpret_cast<uint8_t*>(values + i), vrev32q_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(values + i))));
+#endif
+		for (; i < count; ++i)
+			values[i] = byteswap(values[i]);
+	}
+
+	///
+	/// Reverses byte order of array elements in place
+	///
+	/// \param[in,out] values  Array of values
+	/// \param[in]     count   Number of elements
+	///
+	inline void byteswap(_Inout_updates_(count) uint64_t* values, _In_ size_t count)
+	{
+		stdex_assert(values || !count);
+		size_t i = 0;
+#if defined(__SSSE3__) || defined(__AVX__)
+		const __m128i mask = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+		for (; i + 2 <= count; i += 2)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i)), mask));
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+		for (; i + 2 <= count; i += 2)
+			vst1q_u8(reinterpret_cast<uint8_t*>(values + i), vrev64q_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(values + i))));
+#endif
+		for (; i < count; ++i)
+			values[i] = byteswap(values[i]);
+	}
+
+	///
+	/// Reverses byte order of array elements in place
+	///
+	/// \param[in,out] values  Array of values
+	/// \param[in]     count   Number of elements
+	///
+	template <class T>
+	void byteswap(_Inout_updates_(count) T* values, _In_ size_t count)
+	{
+		static_assert(std::is_arithmetic<T>::value, "T must be arithmetic type");
+		if constexpr (sizeof(T) == sizeof(uint16_t))
+			byteswap(reinterpret_cast<uint16_t*>(values), count);
+		else if constexpr (sizeof(T) == sizeof(uint32_t))
+			byteswap(reinterpret_cast<uint32_t*>(values), count);
+		else if constexpr (sizeof(T) == sizeof(uint64_t))
+			byteswap(reinterpret_cast<uint64_t*>(values), count);
+		else {
+			static_assert(sizeof(T) == sizeof(uint8_t), "unsupported element size");
+			_Unreferenced_(values);
+			_Unreferenced_(count);
+		}
+	}
 }
 
 #if BYTE_ORDER == BIG_ENDIAN
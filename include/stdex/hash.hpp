@@ -7,9 +7,11 @@
 
 #include "assert.hpp"
 #include "compat.hpp"
+#include "cpu.hpp"
 #include "math.h"
 #include "stream.hpp"
 #include <stdint.h>
+#include <vector>
 
 #if defined(__GNUC__)
 #pragma GCC diagnostic push
@@ -98,12 +100,13 @@ namespace stdex
 				stdex_assert(remainder <= length);
 				memcpy(m_queue + j, data, remainder);
 				hash_block();
-				for (i = remainder; i + 64 <= length; i += 64) {
-#pragma warning(push)
-#pragma warning(disable: 6385)
-					memcpy(m_queue, reinterpret_cast<const uint8_t*>(data) + i, 64);
-#pragma warning(pop)
-					hash_block();
+				i = remainder;
+
+				// Transform full blocks in place.
+				size_t count = (length - i) / 64;
+				if (count) {
+					hash_blocks(reinterpret_cast<const uint8_t*>(data) + i, count);
+					i += count * 64;
 				}
 
 				j = 0;
@@ -118,8 +121,137 @@ namespace stdex
 		}
 
 	protected:
+		///
+		/// Hashes block in m_queue
+		///
 		virtual void hash_block() = 0;
 
+		///
+		/// Hashes consecutive blocks of caller's data
+		///
+		/// Default implementation copies each block to m_queue and calls hash_block(). Override to compress blocks
+		/// directly from data.
+		///
+		/// \param[in] data   Blocks. Alignment is not guaranteed.
+		/// \param[in] count  Number of 64-byte blocks
+		///
+		virtual void hash_blocks(_In_reads_bytes_(count * 64) const uint8_t* data, _In_ size_t count)
+		{
+			for (; count; --count, data += 64) {
+#pragma warning(push)
+#pragma warning(disable: 6385)
+				memcpy(m_queue, data, 64);
+#pragma warning(pop)
+				hash_block();
+			}
+		}
+
+		///
+		/// Hashes multiple independent messages in parallel lanes
+		///
+		/// Full blocks of messages are compressed by a multi-buffer compression function. Each lane is assigned the
+		/// next message as soon as its previous message runs out of full blocks. The remaining data, padding and
+		/// finalization are left to each lane's hash object.
+		///
+		/// \tparam H      Hash class
+		/// \tparam lanes  Number of lanes
+		///
+		/// \param[in]  compress  Compresses given number of blocks of each lane into the state of the lane's hash
+		/// \param[in]  data      Pointers to messages
+		/// \param[in]  length    Lengths of messages in bytes
+		/// \param[in]  count     Number of messages
+		/// \param[out] result    Hash values
+		///
+		template <class H, size_t lanes>
+		static void hash_lanes(
+			_In_ void (*compress)(_In_reads_(lanes) H* const* h, _In_reads_(lanes) const uint8_t* const* data, _In_ size_t count),
+			_In_reads_(count) const void* const* data, _In_reads_(count) const size_t* length, _In_ size_t count,
+			_Out_writes_(count) T* result)
+		{
+			H h[lanes], idle;
+			H* lane_h[lanes];
+			const uint8_t* lane_data[lanes];
+			size_t msg[lanes], blocks[lanes], next = 0, active = 0;
+			for (size_t l = 0; l < lanes; ++l)
+				msg[l] = SIZE_MAX;
+			for (;;) {
+				// Assign messages to idle lanes. Messages shorter than a block are hashed directly.
+				for (size_t l = 0; l < lanes; ++l) {
+					while (msg[l] == SIZE_MAX && next < count) {
+						size_t n = next++;
+						stdex_assert(data[n] || !length[n]);
+						h[l].clear();
+						if (length[n] < 64) {
+							h[l].hash(data[n], length[n]);
+							h[l].finalize();
+							result[n] = h[l];
+							continue;
+						}
+						msg[l] = n;
+						lane_data[l] = reinterpret_cast<const uint8_t*>(data[n]);
+						blocks[l] = length[n] / 64;
+						active++;
+					}
+				}
+				if (!active)
+					break;
+
+				// Compress blocks all active lanes have. Idle lanes shadow an active lane into a throw-away state.
+				size_t n = SIZE_MAX, shadow = 0;
+				for (size_t l = 0; l < lanes; ++l) {
+					if (msg[l] != SIZE_MAX && blocks[l] < n) {
+						n = blocks[l];
+						shadow = l;
+					}
+				}
+				const uint8_t* src[lanes];
+				for (size_t l = 0; l < lanes; ++l) {
+					lane_h[l] = msg[l] != SIZE_MAX ? &h[l] : &idle;
+					src[l] = msg[l] != SIZE_MAX ? lane_data[l] : lane_data[shadow];
+				}
+				compress(lane_h, src, n);
+
+				// Finish messages out of full blocks.
+				for (size_t l = 0; l < lanes; ++l) {
+					if (msg[l] == SIZE_MAX)
+						continue;
+					lane_data[l] += n * 64;
+					if (blocks[l] -= n)
+						continue;
+					uint64_t bits = static_cast<uint64_t>(length[msg[l]] / 64) << 9;
+					h[l].m_counter[0] = static_cast<uint32_t>(bits);
+					h[l].m_counter[1] = static_cast<uint32_t>(bits >> 32);
+					h[l].hash(lane_data[l], length[msg[l]] % 64);
+					h[l].finalize();
+					result[msg[l]] = h[l];
+					msg[l] = SIZE_MAX;
+					active--;
+				}
+			}
+		}
+
+		///
+		/// Transposes 32-bit words of a block of each lane
+		///
+		/// \tparam lanes       Number of lanes
+		/// \tparam big_endian  Are words stored big-endian?
+		///
+		/// \param[out] w       Words. w[i * lanes + l] is word i of lane l.
+		/// \param[in]  data    Data of each lane
+		/// \param[in]  offset  Offset of the block
+		///
+		template <size_t lanes, bool big_endian>
+		static void load_lanes(_Out_writes_(16 * lanes) uint32_t* w, _In_reads_(lanes) const uint8_t* const* data, _In_ size_t offset)
+		{
+			for (size_t l = 0; l < lanes; ++l) {
+				const uint8_t* p = data[l] + offset;
+				for (size_t i = 0; i < 16; ++i, p += 4)
+					w[i * lanes + l] = big_endian ?
+						(static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3] :
+						(static_cast<uint32_t>(p[3]) << 24) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[0];
+			}
+		}
+
 	protected:
 		uint32_t m_counter[2];
 		union {
@@ -167,13 +299,121 @@ namespace stdex
 	///
 	using crc32_t = uint32_t;
 
+	///
+	/// Reflected CRC-32 arithmetic
+	///
+	/// Software CRC computation using slicing-by-16 lookup tables and CRC combining.
+	///
+	/// \tparam poly  Bit-reflected generator polynomial
+	///
+	template <uint32_t poly>
+	class reflected_crc32
+	{
+	public:
+		///
+		/// Builds lookup tables
+		///
+		/// m_table[k][b] is CRC of byte b followed by k zero bytes. m_table[0] is the classic byte-at-a-time table.
+		///
+		constexpr reflected_crc32() : m_table()
+		{
+			for (uint32_t b = 0; b < 256; ++b) {
+				uint32_t crc = b;
+				for (int i = 0; i < 8; ++i)
+					crc = (crc >> 1) ^ (poly & (0 - (crc & 1)));
+				m_table[0][b] = crc;
+			}
+			for (size_t k = 1; k < 16; ++k)
+				for (size_t b = 0; b < 256; ++b)
+					m_table[k][b] = (m_table[k - 1][b] >> 8) ^ m_table[0][m_table[k - 1][b] & 0xff];
+		}
+
+		///
+		/// Updates CRC register with data
+		///
+		/// \param[in] crc     CRC register (inverted CRC value)
+		/// \param[in] data    Pointer to data
+		/// \param[in] length  Amount of data in bytes
+		///
+		/// \return Updated CRC register
+		///
+		uint32_t update(_In_ uint32_t crc, _In_reads_bytes_opt_(length) const void* data, _In_ size_t length) const
+		{
+			auto p = reinterpret_cast<const uint8_t*>(data);
+			for (; length >= 16; p += 16, length -= 16) {
+				crc =
+					m_table[15][p[0] ^ (crc & 0xff)] ^
+					m_table[14][p[1] ^ ((crc >> 8) & 0xff)] ^
+					m_table[13][p[2] ^ ((crc >> 16) & 0xff)] ^
+					m_table[12][p[3] ^ (crc >> 24)] ^
+					m_table[11][p[4]] ^ m_table[10][p[5]] ^ m_table[9][p[6]] ^ m_table[8][p[7]] ^
+					m_table[7][p[8]] ^ m_table[6][p[9]] ^ m_table[5][p[10]] ^ m_table[4][p[11]] ^
+					m_table[3][p[12]] ^ m_table[2][p[13]] ^ m_table[1][p[14]] ^ m_table[0][p[15]];
+			}
+			for (; length; ++p, --length)
+				crc = m_table[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+			return crc;
+		}
+
+		///
+		/// Combines CRC values of two consecutive blocks of data
+		///
+		/// \param[in] crc1     Final CRC value of the first block
+		/// \param[in] crc2     Final CRC value of the second block
+		/// \param[in] length2  Length of the second block in bytes
+		///
+		/// \return Final CRC value of both blocks concatenated
+		///
+		static uint32_t combine(_In_ uint32_t crc1, _In_ uint32_t crc2, _In_ uint64_t length2)
+		{
+			return multiply(x8n(length2), crc1) ^ crc2;
+		}
+
+		///
+		/// Returns x^(8*n) mod P
+		///
+		/// Multiplying CRC register by this value shifts it over n zero bytes.
+		///
+		static uint32_t x8n(_In_ uint64_t n)
+		{
+			// Repeated squaring
+			uint32_t p = 0x80000000, x2n = 0x00800000; // x^0, x^8
+			for (; n; n >>= 1) {
+				if (n & 1)
+					p = multiply(x2n, p);
+				x2n = multiply(x2n, x2n);
+			}
+			return p;
+		}
+
+		///
+		/// Returns a * b mod P
+		///
+		static uint32_t multiply(_In_ uint32_t a, _In_ uint32_t b)
+		{
+			uint32_t p = 0;
+			for (uint32_t m = 0x80000000; m; m >>= 1) {
+				if (a & m)
+					p ^= b;
+				b = (b >> 1) ^ (poly & (0 - (b & 1)));
+			}
+			return p;
+		}
+
+	protected:
+		uint32_t m_table[16][256];
+	};
+
 	///
 	/// Hashes as CRC32
 	///
+	/// Uses PCLMULQDQ (x86) or PMULL (AArch64) carry-less multiplication folding when the CPU supports it, and
+	/// slicing-by-16 lookup tables otherwise.
+	///
 	class crc32_hash : public basic_hash<crc32_t>
 	{
 	public:
-		crc32_hash(crc32_t crc = 0)
+		crc32_hash(crc32_t crc = 0) : m_update(select())
 		{
 			m_value = ~crc;
 		}
@@ -185,70 +425,314 @@ namespace stdex
 
 		virtual void hash(_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
 		{
-			static const uint32_t crc32_table[256] = {
-				0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419,
-				0x706af48f, 0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4,
-				0xe0d5e91e, 0x97d2d988, 0x09b64c2b, 0x7eb17cbd, 0xe7b82d07,
-				0x90bf1d91, 0x1db71064, 0x6ab020f2, 0xf3b97148, 0x84be41de,
-				0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7, 0x136c9856,
-				0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9,
-				0xfa0f3d63, 0x8d080df5, 0x3b6e20c8, 0x4c69105e, 0xd56041e4,
-				0xa2677172, 0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b,
-				0x35b5a8fa, 0x42b2986c, 0xdbbbc9d6, 0xacbcf940, 0x32d86ce3,
-				0x45df5c75, 0xdcd60dcf, 0xabd13d59, 0x26d930ac, 0x51de003a,
-				0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423, 0xcfba9599,
-				0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
-				0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d, 0x76dc4190,
-				0x01db7106, 0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f,
-				0x9fbfe4a5, 0xe8b8d433, 0x7807c9a2, 0x0f00f934, 0x9609a88e,
-				0xe10e9818, 0x7f6a0dbb, 0x086d3d2d, 0x91646c97, 0xe6635c01,
-				0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e, 0x6c0695ed,
-				0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
-				0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3,
-				0xfbd44c65, 0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2,
-				0x4adfa541, 0x3dd895d7, 0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a,
-				0x346ed9fc, 0xad678846, 0xda60b8d0, 0x44042d73, 0x33031de5,
-				0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa, 0xbe0b1010,
-				0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
-				0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17,
-				0x2eb40d81, 0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6,
-				0x03b6e20c, 0x74b1d29a, 0xead54739, 0x9dd277af, 0x04db2615,
-				0x73dc1683, 0xe3630b12, 0x94643b84, 0x0d6d6a3e, 0x7a6a5aa8,
-				0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1, 0xf00f9344,
-				0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
-				0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a,
-				0x67dd4acc, 0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5,
-				0xd6d6a3e8, 0xa1d1937e, 0x38d8c2c4, 0x4fdff252, 0xd1bb67f1,
-				0xa6bc5767, 0x3fb506dd, 0x48b2364b, 0xd80d2bda, 0xaf0a1b4c,
-				0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55, 0x316e8eef,
-				0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
-				0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe,
-				0xb2bd0b28, 0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31,
-				0x2cd99e8b, 0x5bdeae1d, 0x9b64c2b0, 0xec63f226, 0x756aa39c,
-				0x026d930a, 0x9c0906a9, 0xeb0e363f, 0x72076785, 0x05005713,
-				0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38, 0x92d28e9b,
-				0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
-				0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1,
-				0x18b74777, 0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c,
-				0x8f659eff, 0xf862ae69, 0x616bffd3, 0x166ccf45, 0xa00ae278,
-				0xd70dd2ee, 0x4e048354, 0x3903b3c2, 0xa7672661, 0xd06016f7,
-				0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc, 0x40df0b66,
-				0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
-				0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605,
-				0xcdd70693, 0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8,
-				0x5d681b02, 0x2a6f2b94, 0xb40bbe37, 0xc30c8ea1, 0x5a05df1b,
-				0x2d02ef8d
-			};
+			stdex_assert(data || !length);
+			m_value = m_update(m_value, reinterpret_cast<const uint8_t*>(data), length);
+		}
+
+		virtual void finalize()
+		{
+			m_value = ~m_value;
+		}
 
+		///
+		/// Combines CRC32 values of two consecutive blocks of data
+		///
+		/// \param[in] crc1     CRC32 of the first block
+		/// \param[in] crc2     CRC32 of the second block
+		/// \param[in] length2  Length of the second block in bytes
+		///
+		/// \return CRC32 of both blocks concatenated
+		///
+		static crc32_t combine(_In_ crc32_t crc1, _In_ crc32_t crc2, _In_ uint64_t length2)
+		{
+			return reflected_crc32<0xedb88320>::combine(crc1, crc2, length2);
+		}
+
+	protected:
+		using update_t = uint32_t(*)(_In_ uint32_t crc, _In_reads_bytes_opt_(length) const uint8_t* data, _In_ size_t length);
+
+		static update_t select()
+		{
+#if defined(_STDEX_CPU_X86)
+			if (cpu_features.pclmul)
+				return update_pclmul;
+#elif defined(_STDEX_CPU_ARM64) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+			if (cpu_features.pmull)
+				return update_pmull;
+#endif
+			return update_table;
+		}
+
+		static const reflected_crc32<0xedb88320>& table()
+		{
+			static constexpr reflected_crc32<0xedb88320> t;
+			return t;
+		}
+
+		static uint32_t update_table(_In_ uint32_t crc, _In_reads_bytes_opt_(length) const uint8_t* data, _In_ size_t length)
+		{
+			return table().update(crc, data, length);
+		}
+
+		// Carry-less multiplication folding is described in "Fast CRC Computation for Generic Polynomials Using
+		// PCLMULQDQ Instruction" by Intel. Four 128-bit lanes are folded 64 bytes forward, then into a single lane.
+		// The remaining lane is reduced to CRC using lookup tables: its CRC with zero initial register equals CRC of
+		// all data folded into it.
+
+#if defined(_STDEX_CPU_X86)
+		_Target_("pclmul")
+		static __m128i fold(_In_ __m128i x, _In_ __m128i k, _In_ __m128i next)
+		{
+			return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11)), next);
+		}
+
+		_Target_("pclmul")
+		static uint32_t update_pclmul(_In_ uint32_t crc, _In_reads_bytes_opt_(length) const uint8_t* data, _In_ size_t length)
+		{
+			if (length < 64)
+				return table().update(crc, data, length);
+			const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4); // x^(4*128+32), x^(4*128-32) mod P
+			const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0); // x^(128+32), x^(128-32) mod P
+			__m128i
+				x1 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), _mm_cvtsi32_si128(static_cast<int>(crc))),
+				x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)),
+				x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32)),
+				x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48));
+			for (data += 64, length -= 64; length >= 64; data += 64, length -= 64) {
+				x1 = fold(x1, k1k2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+				x2 = fold(x2, k1k2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)));
+				x3 = fold(x3, k1k2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32)));
+				x4 = fold(x4, k1k2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48)));
+			}
+			x1 = fold(x1, k3k4, x2);
+			x1 = fold(x1, k3k4, x3);
+			x1 = fold(x1, k3k4, x4);
+			for (; length >= 16; data += 16, length -= 16)
+				x1 = fold(x1, k3k4, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+			uint8_t rest[16];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(rest), x1);
+			return table().update(table().update(0, rest, sizeof(rest)), data, length);
+		}
+#elif defined(_STDEX_CPU_ARM64) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+		static uint64x2_t fold(_In_ uint64x2_t x, _In_ uint64x2_t k, _In_ uint64x2_t next)
+		{
+			poly128_t lo = vmull_p64(vgetq_lane_p64(vreinterpretq_p64_u64(x), 0), vgetq_lane_p64(vreinterpretq_p64_u64(k), 0));
+			poly128_t hi = vmull_high_p64(vreinterpretq_p64_u64(x), vreinterpretq_p64_u64(k));
+			return veorq_u64(veorq_u64(vreinterpretq_u64_p128(lo), vreinterpretq_u64_p128(hi)), next);
+		}
+
+		static uint64x2_t load(_In_reads_bytes_(16) const uint8_t* data)
+		{
+			return vreinterpretq_u64_u8(vld1q_u8(data));
+		}
+
+		static uint32_t update_pmull(_In_ uint32_t crc, _In_reads_bytes_opt_(length) const uint8_t* data, _In_ size_t length)
+		{
+			if (length < 64)
+				return table().update(crc, data, length);
+			const uint64x2_t k1k2 = vcombine_u64(vcreate_u64(0x0154442bd4), vcreate_u64(0x01c6e41596)); // x^(4*128-32), x^(4*128+32) mod P
+			const uint64x2_t k3k4 = vcombine_u64(vcreate_u64(0x01751997d0), vcreate_u64(0x00ccaa009e)); // x^(128-32), x^(128+32) mod P
+			uint64x2_t
+				x1 = veorq_u64(load(data), vcombine_u64(vcreate_u64(crc), vcreate_u64(0))),
+				x2 = load(data + 16),
+				x3 = load(data + 32),
+				x4 = load(data + 48);
+			for (data += 64, length -= 64; length >= 64; data += 64, length -= 64) {
+				x1 = fold(x1, k1k2, load(data));
+				x2 = fold(x2, k1k2, load(data + 16));
+				x3 = fold(x3, k1k2, load(data + 32));
+				x4 = fold(x4, k1k2, load(data + 48));
+			}
+			x1 = fold(x1, k3k4, x2);
+			x1 = fold(x1, k3k4, x3);
+			x1 = fold(x1, k3k4, x4);
+			for (; length >= 16; data += 16, length -= 16)
+				x1 = fold(x1, k3k4, load(data));
+			uint8_t rest[16];
+			vst1q_u8(rest, vreinterpretq_u8_u64(x1));
+			return table().update(table().update(0, rest, sizeof(rest)), data, length);
+		}
+#endif
+
+	protected:
+		update_t m_update;
+	};
+
+	///
+	/// Hashes as CRC32C (Castagnoli)
+	///
+	/// Uses SSE4.2 (x86-64) or ARMv8 CRC32 instructions when the CPU supports it, and slicing-by-16 lookup tables
+	/// otherwise.
+	///
+	class crc32c_hash : public basic_hash<crc32_t>
+	{
+	public:
+		crc32c_hash(crc32_t crc = 0) : m_update(select())
+		{
+			m_value = ~crc;
+		}
+
+		virtual void clear()
+		{
+			m_value = 0xffffffff;
+		}
+
+		virtual void hash(_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
+		{
 			stdex_assert(data || !length);
-			for (size_t i = 0; i < length; i++)
-				m_value = crc32_table[(m_value ^ reinterpret_cast<const uint8_t*>(data)[i]) & 0xff] ^ (m_value >> 8);
+			m_value = m_update(m_value, reinterpret_cast<const uint8_t*>(data), length);
 		}
 
 		virtual void finalize()
 		{
 			m_value = ~m_value;
 		}
+
+		///
+		/// Combines CRC32C values of two consecutive blocks of data
+		///
+		/// \param[in] crc1     CRC32C of the first block
+		/// \param[in] crc2     CRC32C of the second block
+		/// \param[in] length2  Length of the second block in bytes
+		///
+		/// \return CRC32C of both blocks concatenated
+		///
+		static crc32_t combine(_In_ crc32_t crc1, _In_ crc32_t crc2, _In_ uint64_t length2)
+		{
+			return reflected_crc32<poly>::combine(crc1, crc2, length2);
+		}
+
+	protected:
+		static constexpr uint32_t poly = 0x82f63b78;
+		static constexpr size_t stride = 0x200; ///< Length of each of three interleaved streams
+
+		using update_t = uint32_t(*)(_In_ uint32_t crc, _In_reads_bytes_opt_(length) const uint8_t* data, _In_ size_t length);
+
+		static update_t select()
+		{
+#if defined(_M_X64) || defined(__x86_64__)
+			if (cpu_features.sse42)
+				return update_sse42;
+#elif defined(_STDEX_CPU_ARM64) && defined(__ARM_FEATURE_CRC32)
+			if (cpu_features.crc32)
+				return update_armv8;
+#endif
+			return update_table;
+		}
+
+		static const reflected_crc32<poly>& table()
+		{
+			static constexpr reflected_crc32<poly> t;
+			return t;
+		}
+
+		static uint32_t update_table(_In_ uint32_t crc, _In_reads_bytes_opt_(length) const uint8_t* data, _In_ size_t length)
+		{
+			return table().update(crc, data, length);
+		}
+
+		///
+		/// Shifts CRC register over fixed number of zero bytes
+		///
+		/// Multiplication by x^(8*n) mod P is linear, so it is looked up for each byte of the register separately.
+		///
+		class shifter
+		{
+		public:
+			shifter(_In_ uint64_t n)
+			{
+				uint32_t k = reflected_crc32<poly>::x8n(n);
+				for (size_t j = 0; j < 4; ++j)
+					for (uint32_t b = 0; b < 256; ++b)
+						m_table[j][b] = reflected_crc32<poly>::multiply(b << (8 * j), k);
+			}
+
+			uint32_t operator()(_In_ uint32_t crc) const
+			{
+				return
+					m_table[0][crc & 0xff] ^
+					m_table[1][(crc >> 8) & 0xff] ^
+					m_table[2][(crc >> 16) & 0xff] ^
+					m_table[3][crc >> 24];
+			}
+
+		protected:
+			uint32_t m_table[4][256];
+		};
+
+		static const shifter& shift1()
+		{
+			static const shifter s(stride);
+			return s;
+		}
+
+		static const shifter& shift2()
+		{
+			static const shifter s(2 * stride);
+			return s;
+		}
+
+		static uint64_t load64(_In_reads_bytes_(8) const uint8_t* data)
+		{
+			uint64_t value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		// Latency of CRC32 instruction is three times its throughput. Three independent streams are computed in
+		// parallel and combined by shifting.
+
+#if defined(_M_X64) || defined(__x86_64__)
+		_Target_("sse4.2")
+		static uint32_t update_sse42(_In_ uint32_t crc, _In_reads_bytes_opt_(length) const uint8_t* data, _In_ size_t length)
+		{
+			if (length >= 3 * stride) {
+				const shifter& s1 = shift1(), & s2 = shift2();
+				do {
+					uint64_t c0 = crc, c1 = 0, c2 = 0;
+					for (size_t i = 0; i < stride; i += 8) {
+						c0 = _mm_crc32_u64(c0, load64(data + i));
+						c1 = _mm_crc32_u64(c1, load64(data + stride + i));
+						c2 = _mm_crc32_u64(c2, load64(data + 2 * stride + i));
+					}
+					crc = s2(static_cast<uint32_t>(c0)) ^ s1(static_cast<uint32_t>(c1)) ^ static_cast<uint32_t>(c2);
+					data += 3 * stride;
+					length -= 3 * stride;
+				} while (length >= 3 * stride);
+			}
+			for (; length >= 8; data += 8, length -= 8)
+				crc = static_cast<uint32_t>(_mm_crc32_u64(crc, load64(data)));
+			for (; length; ++data, --length)
+				crc = _mm_crc32_u8(crc, *data);
+			return crc;
+		}
+#elif defined(_STDEX_CPU_ARM64) && defined(__ARM_FEATURE_CRC32)
+		static uint32_t update_armv8(_In_ uint32_t crc, _In_reads_bytes_opt_(length) const uint8_t* data, _In_ size_t length)
+		{
+			if (length >= 3 * stride) {
+				const shifter& s1 = shift1(), & s2 = shift2();
+				do {
+					uint32_t c0 = crc, c1 = 0, c2 = 0;
+					for (size_t i = 0; i < stride; i += 8) {
+						c0 = __crc32cd(c0, load64(data + i));
+						c1 = __crc32cd(c1, load64(data + stride + i));
+						c2 = __crc32cd(c2, load64(data + 2 * stride + i));
+					}
+					crc = s2(c0) ^ s1(c1) ^ c2;
+					data += 3 * stride;
+					length -= 3 * stride;
+				} while (length >= 3 * stride);
+			}
+			for (; length >= 8; data += 8, length -= 8)
+				crc = __crc32cd(crc, load64(data));
+			for (; length; ++data, --length)
+				crc = __crc32cb(crc, *data);
+			return crc;
+		}
+#endif
+
+	protected:
+		update_t m_update;
 	};
 
 	///
@@ -340,8 +824,57 @@ namespace stdex
 			memcpy(&m_value, m_state, sizeof(md5_t));
 		}
 
+		///
+		/// Hashes multiple independent messages
+		///
+		/// Messages are compressed in parallel SIMD lanes: 16 with AVX-512, 8 with AVX2 and 4 with NEON. Hashing many
+		/// messages of similar length is most efficient.
+		///
+		/// \param[in] data    Pointers to messages
+		/// \param[in] length  Lengths of messages in bytes
+		/// \param[in] count   Number of messages
+		///
+		/// \return Hash values
+		///
+		static std::vector<md5_t> hash_many(_In_reads_(count) const void* const* data, _In_reads_(count) const size_t* length, _In_ size_t count)
+		{
+			std::vector<md5_t> result(count);
+#if defined(_STDEX_CPU_X86)
+			if (cpu_features.avx512)
+				hash_lanes<md5_hash, 16>(compress_avx512, data, length, count, result.data());
+			else if (cpu_features.avx2)
+				hash_lanes<md5_hash, 8>(compress_avx2, data, length, count, result.data());
+			else
+				hash_lanes<md5_hash, 1>(compress_single, data, length, count, result.data());
+#elif defined(_STDEX_CPU_ARM64)
+			hash_lanes<md5_hash, 4>(compress_neon, data, length, count, result.data());
+#else
+			hash_lanes<md5_hash, 1>(compress_single, data, length, count, result.data());
+#endif
+			return result;
+		}
+
 	protected:
 		virtual void hash_block()
+		{
+			transform(m_temp);
+		}
+
+		virtual void hash_blocks(_In_reads_bytes_(count * 64) const uint8_t* data, _In_ size_t count)
+		{
+#if BYTE_ORDER == LITTLE_ENDIAN
+			// Blocks are little-endian words already. Load them directly, skipping the queue.
+			for (; count; --count, data += 64) {
+				uint32_t x[16];
+				memcpy(x, data, sizeof(x));
+				transform(x);
+			}
+#else
+			block_hash::hash_blocks(data, count);
+#endif
+		}
+
+		void transform(_In_reads_(16) const uint32_t* x)
 		{
 			constexpr int S11 = 7;
 			constexpr int S12 = 12;
@@ -364,10 +897,10 @@ namespace stdex
 			uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
 
 			// MD5 rounds
-			#define MD5_R1(a, b, c, d, i, s, ac) { (a) += (((b) & (c)) | ((~b) & (d))) + m_temp[(i)] + static_cast<uint32_t>(ac); (a) = rol((a), (s)); (a) += (b); }
-			#define MD5_R2(a, b, c, d, i, s, ac) { (a) += (((b) & (d)) | ((c) & (~d))) + m_temp[(i)] + static_cast<uint32_t>(ac); (a) = rol((a), (s)); (a) += (b); }
-			#define MD5_R3(a, b, c, d, i, s, ac) { (a) += ((b) ^ (c) ^ (d)) + m_temp[(i)] + static_cast<uint32_t>(ac); (a) = rol((a), (s)); (a) += (b); }
-			#define MD5_R4(a, b, c, d, i, s, ac) { (a) += ((c) ^ ((b) | (~d))) + m_temp[(i)] + static_cast<uint32_t>(ac); (a) = rol((a), (s)); (a) += (b); }
+			#define MD5_R1(a, b, c, d, i, s, ac) { (a) += (((b) & (c)) | ((~b) & (d))) + x[(i)] + static_cast<uint32_t>(ac); (a) = rol((a), (s)); (a) += (b); }
+			#define MD5_R2(a, b, c, d, i, s, ac) { (a) += (((b) & (d)) | ((c) & (~d))) + x[(i)] + static_cast<uint32_t>(ac); (a) = rol((a), (s)); (a) += (b); }
+			#define MD5_R3(a, b, c, d, i, s, ac) { (a) += ((b) ^ (c) ^ (d)) + x[(i)] + static_cast<uint32_t>(ac); (a) = rol((a), (s)); (a) += (b); }
+			#define MD5_R4(a, b, c, d, i, s, ac) { (a) += ((c) ^ ((b) | (~d))) + x[(i)] + static_cast<uint32_t>(ac); (a) = rol((a), (s)); (a) += (b); }
 
 			// 4 rounds of 16 operations each. Loop unrolled.
 			MD5_R1(a, b, c, d, 0, S11, 0xd76aa478);
@@ -447,6 +980,178 @@ namespace stdex
 			m_state[3] += d;
 		}
 
+		static constexpr uint32_t k[64] = {
+			0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+			0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+			0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+			0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+			0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+			0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+			0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+			0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+		}; ///< Additive constant of each step
+
+		static constexpr int rot[64] = {
+			7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+			5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+			4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+			6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+		}; ///< Rotation of each step
+
+		static constexpr uint8_t word[64] = {
+			0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+			1, 6, 11, 0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12,
+			5, 8, 11, 14, 1, 4, 7, 10, 13, 0, 3, 6, 9, 12, 15, 2,
+			0, 7, 14, 5, 12, 3, 10, 1, 8, 15, 6, 13, 4, 11, 2, 9
+		}; ///< Message word of each step
+
+		///
+		/// Compresses blocks of a single lane
+		///
+		static void compress_single(_In_reads_(1) md5_hash* const* h, _In_reads_(1) const uint8_t* const* data, _In_ size_t count)
+		{
+			h[0]->hash_blocks(data[0], count);
+		}
+
+		// Multi-buffer compression functions process one message per 32-bit lane. All lanes compress the same
+		// number of blocks.
+
+#if defined(_STDEX_CPU_X86)
+		_Target_("avx2")
+		static void compress_avx2(_In_reads_(8) md5_hash* const* h, _In_reads_(8) const uint8_t* const* data, _In_ size_t count)
+		{
+			alignas(32) uint32_t s[4][8], w[16][8];
+			for (size_t l = 0; l < 8; ++l)
+				for (size_t j = 0; j < 4; ++j)
+					s[j][l] = h[l]->m_state[j];
+			__m256i
+				a = _mm256_load_si256(reinterpret_cast<const __m256i*>(s[0])),
+				b = _mm256_load_si256(reinterpret_cast<const __m256i*>(s[1])),
+				c = _mm256_load_si256(reinterpret_cast<const __m256i*>(s[2])),
+				d = _mm256_load_si256(reinterpret_cast<const __m256i*>(s[3]));
+
+			for (size_t offset = 0; count; --count, offset += 64) {
+				load_lanes<8, false>(&w[0][0], data, offset);
+				__m256i aa = a, bb = b, cc = c, dd = d;
+
+				#define MD5MB_STEP(f) { \
+					__m256i t = _mm256_add_epi32(_mm256_add_epi32(a, (f)), _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(k[i])), _mm256_load_si256(reinterpret_cast<const __m256i*>(w[word[i]])))); \
+					a = d; d = c; c = b; \
+					b = _mm256_add_epi32(b, _mm256_or_si256(_mm256_sll_epi32(t, _mm_cvtsi32_si128(rot[i])), _mm256_srl_epi32(t, _mm_cvtsi32_si128(32 - rot[i])))); \
+				}
+				size_t i = 0;
+				for (; i < 16; ++i) MD5MB_STEP(_mm256_or_si256(_mm256_and_si256(b, c), _mm256_andnot_si256(b, d)));
+				for (; i < 32; ++i) MD5MB_STEP(_mm256_or_si256(_mm256_and_si256(b, d), _mm256_andnot_si256(d, c)));
+				for (; i < 48; ++i) MD5MB_STEP(_mm256_xor_si256(_mm256_xor_si256(b, c), d));
+				for (; i < 64; ++i) MD5MB_STEP(_mm256_xor_si256(c, _mm256_or_si256(b, _mm256_xor_si256(d, _mm256_set1_epi32(-1)))));
+				#undef MD5MB_STEP
+
+				a = _mm256_add_epi32(a, aa);
+				b = _mm256_add_epi32(b, bb);
+				c = _mm256_add_epi32(c, cc);
+				d = _mm256_add_epi32(d, dd);
+			}
+
+			_mm256_store_si256(reinterpret_cast<__m256i*>(s[0]), a);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(s[1]), b);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(s[2]), c);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(s[3]), d);
+			for (size_t l = 0; l < 8; ++l)
+				for (size_t j = 0; j < 4; ++j)
+					h[l]->m_state[j] = s[j][l];
+		}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized" // AVX-512 intrinsics of GCC 12 and older
+#endif
+		_Target_("avx512f")
+		static void compress_avx512(_In_reads_(16) md5_hash* const* h, _In_reads_(16) const uint8_t* const* data, _In_ size_t count)
+		{
+			alignas(64) uint32_t s[4][16], w[16][16];
+			for (size_t l = 0; l < 16; ++l)
+				for (size_t j = 0; j < 4; ++j)
+					s[j][l] = h[l]->m_state[j];
+			__m512i
+				a = _mm512_load_si512(s[0]),
+				b = _mm512_load_si512(s[1]),
+				c = _mm512_load_si512(s[2]),
+				d = _mm512_load_si512(s[3]);
+
+			for (size_t offset = 0; count; --count, offset += 64) {
+				load_lanes<16, false>(&w[0][0], data, offset);
+				__m512i aa = a, bb = b, cc = c, dd = d;
+
+				#define MD5MB_STEP(f) { \
+					__m512i t = _mm512_add_epi32(_mm512_add_epi32(a, (f)), _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(k[i])), _mm512_load_si512(w[word[i]]))); \
+					a = d; d = c; c = b; \
+					b = _mm512_add_epi32(b, _mm512_rolv_epi32(t, _mm512_set1_epi32(rot[i]))); \
+				}
+				size_t i = 0;
+				for (; i < 16; ++i) MD5MB_STEP(_mm512_or_si512(_mm512_and_si512(b, c), _mm512_andnot_si512(b, d)));
+				for (; i < 32; ++i) MD5MB_STEP(_mm512_or_si512(_mm512_and_si512(b, d), _mm512_andnot_si512(d, c)));
+				for (; i < 48; ++i) MD5MB_STEP(_mm512_xor_si512(_mm512_xor_si512(b, c), d));
+				for (; i < 64; ++i) MD5MB_STEP(_mm512_xor_si512(c, _mm512_or_si512(b, _mm512_xor_si512(d, _mm512_set1_epi32(-1)))));
+				#undef MD5MB_STEP
+
+				a = _mm512_add_epi32(a, aa);
+				b = _mm512_add_epi32(b, bb);
+				c = _mm512_add_epi32(c, cc);
+				d = _mm512_add_epi32(d, dd);
+			}
+
+			_mm512_store_si512(s[0], a);
+			_mm512_store_si512(s[1], b);
+			_mm512_store_si512(s[2], c);
+			_mm512_store_si512(s[3], d);
+			for (size_t l = 0; l < 16; ++l)
+				for (size_t j = 0; j < 4; ++j)
+					h[l]->m_state[j] = s[j][l];
+		}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#elif defined(_STDEX_CPU_ARM64)
+		static void compress_neon(_In_reads_(4) md5_hash* const* h, _In_reads_(4) const uint8_t* const* data, _In_ size_t count)
+		{
+			uint32_t s[4][4], w[16][4];
+			for (size_t l = 0; l < 4; ++l)
+				for (size_t j = 0; j < 4; ++j)
+					s[j][l] = h[l]->m_state[j];
+			uint32x4_t a = vld1q_u32(s[0]), b = vld1q_u32(s[1]), c = vld1q_u32(s[2]), d = vld1q_u32(s[3]);
+
+			for (size_t offset = 0; count; --count, offset += 64) {
+				load_lanes<4, false>(&w[0][0], data, offset);
+				uint32x4_t aa = a, bb = b, cc = c, dd = d;
+
+				#define MD5MB_STEP(f) { \
+					uint32x4_t t = vaddq_u32(vaddq_u32(a, (f)), vaddq_u32(vdupq_n_u32(k[i]), vld1q_u32(w[word[i]]))); \
+					a = d; d = c; c = b; \
+					b = vaddq_u32(b, vorrq_u32(vshlq_u32(t, vdupq_n_s32(rot[i])), vshlq_u32(t, vdupq_n_s32(rot[i] - 32)))); \
+				}
+				size_t i = 0;
+				for (; i < 16; ++i) MD5MB_STEP(vbslq_u32(b, c, d));
+				for (; i < 32; ++i) MD5MB_STEP(vbslq_u32(d, b, c));
+				for (; i < 48; ++i) MD5MB_STEP(veorq_u32(veorq_u32(b, c), d));
+				for (; i < 64; ++i) MD5MB_STEP(veorq_u32(c, vornq_u32(b, d)));
+				#undef MD5MB_STEP
+
+				a = vaddq_u32(a, aa);
+				b = vaddq_u32(b, bb);
+				c = vaddq_u32(c, cc);
+				d = vaddq_u32(d, dd);
+			}
+
+			vst1q_u32(s[0], a);
+			vst1q_u32(s[1], b);
+			vst1q_u32(s[2], c);
+			vst1q_u32(s[3], d);
+			for (size_t l = 0; l < 4; ++l)
+				for (size_t j = 0; j < 4; ++j)
+					h[l]->m_state[j] = s[j][l];
+		}
+#endif
+
 	protected:
 		uint32_t m_state[4];
 	};
@@ -500,10 +1205,12 @@ namespace stdex
 	///
 	/// Hashes as SHA1
 	///
+	/// Uses SHA-NI (x86) or ARMv8 SHA1 instructions when the CPU supports it.
+	///
 	class sha1_hash : public block_hash<sha1_t>
 	{
 	public:
-		sha1_hash()
+		sha1_hash() : m_compress(select())
 		{
 			clear();
 		}
@@ -537,66 +1244,381 @@ namespace stdex
 				m_value.data8[i] = static_cast<uint8_t>((m_state[i >> 2] >> ((3 - (i & 3)) * 8)) & 255);
 		}
 
+		///
+		/// Hashes multiple independent messages
+		///
+		/// Messages are compressed in parallel SIMD lanes: 16 with AVX-512, 8 with AVX2 and 4 with NEON. On CPUs with
+		/// SHA extensions but without AVX-512, messages are hashed one after another using SHA extensions instead.
+		/// Hashing many messages of similar length is most efficient.
+		///
+		/// \param[in] data    Pointers to messages
+		/// \param[in] length  Lengths of messages in bytes
+		/// \param[in] count   Number of messages
+		///
+		/// \return Hash values
+		///
+		static std::vector<sha1_t> hash_many(_In_reads_(count) const void* const* data, _In_reads_(count) const size_t* length, _In_ size_t count)
+		{
+			std::vector<sha1_t> result(count);
+#if defined(_STDEX_CPU_X86)
+			if (cpu_features.avx512)
+				hash_lanes<sha1_hash, 16>(compress_avx512, data, length, count, result.data());
+			else if (cpu_features.avx2 && !(cpu_features.sha && cpu_features.sse41))
+				hash_lanes<sha1_hash, 8>(compress_avx2, data, length, count, result.data());
+			else
+				hash_lanes<sha1_hash, 1>(compress_single, data, length, count, result.data());
+#elif defined(_STDEX_CPU_ARM64)
+			hash_lanes<sha1_hash, 4>(compress_neon, data, length, count, result.data());
+#else
+			hash_lanes<sha1_hash, 1>(compress_single, data, length, count, result.data());
+#endif
+			return result;
+		}
+
 	protected:
 		virtual void hash_block()
 		{
-			// Copy m_state[] to working vars.
-			uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3], e = m_state[4];
+			m_compress(m_state, m_queue, 1);
+		}
+
+		virtual void hash_blocks(_In_reads_bytes_(count * 64) const uint8_t* data, _In_ size_t count)
+		{
+			m_compress(m_state, data, count);
+		}
+
+		using compress_t = void(*)(_Inout_updates_(5) uint32_t state[5], _In_reads_bytes_(count * 64) const uint8_t* data, _In_ size_t count);
+
+		static compress_t select()
+		{
+#if defined(_STDEX_CPU_X86)
+			if (cpu_features.sha && cpu_features.sse41)
+				return compress_shani;
+#elif defined(_STDEX_CPU_ARM64) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+			if (cpu_features.sha1)
+				return compress_armv8;
+#endif
+			return compress_generic;
+		}
+
+		///
+		/// Compresses 64-byte blocks
+		///
+		/// \param[in,out] state  Hash state
+		/// \param[in]     data   Blocks
+		/// \param[in]     count  Number of blocks
+		///
+		static void compress_generic(_Inout_updates_(5) uint32_t state[5], _In_reads_bytes_(count * 64) const uint8_t* data, _In_ size_t count)
+		{
+			for (; count; --count, data += 64) {
+				// Message schedule is computed in place.
+				uint32_t temp[16];
+				memcpy(temp, data, sizeof(temp));
+
+				// Copy state[] to working vars.
+				uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
 
 #if BYTE_ORDER == BIG_ENDIAN
-			#define SHA1BLK0(i) (m_temp[i])
+				#define SHA1BLK0(i) (temp[i])
 #else
-			#define SHA1BLK0(i) (m_temp[i] = (rol(m_temp[i],24) & 0xFF00FF00) | (rol(m_temp[i],8) & 0x00FF00FF))
+				#define SHA1BLK0(i) (temp[i] = (rol(temp[i],24) & 0xFF00FF00) | (rol(temp[i],8) & 0x00FF00FF))
+#endif
+				#define SHA1BLK(i) (temp[i&15] = rol(temp[(i+13)&15] ^ temp[(i+8)&15] ^ temp[(i+2)&15] ^ temp[i&15],1))
+
+				// SHA1 rounds
+				#define SHA1_R0(v, w, x, y, z, i) { (z) += (((w)&((x)^(y)))^(y))+SHA1BLK0((i))+0x5A827999+rol((v),5); (w)=rol((w),30); }
+				#define SHA1_R1(v, w, x, y, z, i) { (z) += (((w)&((x)^(y)))^(y))+SHA1BLK((i))+0x5A827999+rol((v),5); (w)=rol((w),30); }
+				#define SHA1_R2(v, w, x, y, z, i) { (z) += ((w)^(x)^(y))+SHA1BLK((i))+0x6ED9EBA1+rol((v),5); (w)=rol((w),30); }
+				#define SHA1_R3(v, w, x, y, z, i) { (z) += ((((w)|(x))&(y))|((w)&(x)))+SHA1BLK((i))+0x8F1BBCDC+rol((v),5); (w)=rol((w),30); }
+				#define SHA1_R4(v, w, x, y, z, i) { (z) += ((w)^(x)^(y))+SHA1BLK((i))+0xCA62C1D6+rol((v),5); (w)=rol((w),30); }
+
+				// 5 rounds of 16 operations each. Loop unrolled.
+				SHA1_R0(a, b, c, d, e, 0); SHA1_R0(e, a, b, c, d, 1); SHA1_R0(d, e, a, b, c, 2); SHA1_R0(c, d, e, a, b, 3);
+				SHA1_R0(b, c, d, e, a, 4); SHA1_R0(a, b, c, d, e, 5); SHA1_R0(e, a, b, c, d, 6); SHA1_R0(d, e, a, b, c, 7);
+				SHA1_R0(c, d, e, a, b, 8); SHA1_R0(b, c, d, e, a, 9); SHA1_R0(a, b, c, d, e, 10); SHA1_R0(e, a, b, c, d, 11);
+				SHA1_R0(d, e, a, b, c, 12); SHA1_R0(c, d, e, a, b, 13); SHA1_R0(b, c, d, e, a, 14); SHA1_R0(a, b, c, d, e, 15);
+				SHA1_R1(e, a, b, c, d, 16); SHA1_R1(d, e, a, b, c, 17); SHA1_R1(c, d, e, a, b, 18); SHA1_R1(b, c, d, e, a, 19);
+				SHA1_R2(a, b, c, d, e, 20); SHA1_R2(e, a, b, c, d, 21); SHA1_R2(d, e, a, b, c, 22); SHA1_R2(c, d, e, a, b, 23);
+				SHA1_R2(b, c, d, e, a, 24); SHA1_R2(a, b, c, d, e, 25); SHA1_R2(e, a, b, c, d, 26); SHA1_R2(d, e, a, b, c, 27);
+				SHA1_R2(c, d, e, a, b, 28); SHA1_R2(b, c, d, e, a, 29); SHA1_R2(a, b, c, d, e, 30); SHA1_R2(e, a, b, c, d, 31);
+				SHA1_R2(d, e, a, b, c, 32); SHA1_R2(c, d, e, a, b, 33); SHA1_R2(b, c, d, e, a, 34); SHA1_R2(a, b, c, d, e, 35);
+				SHA1_R2(e, a, b, c, d, 36); SHA1_R2(d, e, a, b, c, 37); SHA1_R2(c, d, e, a, b, 38); SHA1_R2(b, c, d, e, a, 39);
+				SHA1_R3(a, b, c, d, e, 40); SHA1_R3(e, a, b, c, d, 41); SHA1_R3(d, e, a, b, c, 42); SHA1_R3(c, d, e, a, b, 43);
+				SHA1_R3(b, c, d, e, a, 44); SHA1_R3(a, b, c, d, e, 45); SHA1_R3(e, a, b, c, d, 46); SHA1_R3(d, e, a, b, c, 47);
+				SHA1_R3(c, d, e, a, b, 48); SHA1_R3(b, c, d, e, a, 49); SHA1_R3(a, b, c, d, e, 50); SHA1_R3(e, a, b, c, d, 51);
+				SHA1_R3(d, e, a, b, c, 52); SHA1_R3(c, d, e, a, b, 53); SHA1_R3(b, c, d, e, a, 54); SHA1_R3(a, b, c, d, e, 55);
+				SHA1_R3(e, a, b, c, d, 56); SHA1_R3(d, e, a, b, c, 57); SHA1_R3(c, d, e, a, b, 58); SHA1_R3(b, c, d, e, a, 59);
+				SHA1_R4(a, b, c, d, e, 60); SHA1_R4(e, a, b, c, d, 61); SHA1_R4(d, e, a, b, c, 62); SHA1_R4(c, d, e, a, b, 63);
+				SHA1_R4(b, c, d, e, a, 64); SHA1_R4(a, b, c, d, e, 65); SHA1_R4(e, a, b, c, d, 66); SHA1_R4(d, e, a, b, c, 67);
+				SHA1_R4(c, d, e, a, b, 68); SHA1_R4(b, c, d, e, a, 69); SHA1_R4(a, b, c, d, e, 70); SHA1_R4(e, a, b, c, d, 71);
+				SHA1_R4(d, e, a, b, c, 72); SHA1_R4(c, d, e, a, b, 73); SHA1_R4(b, c, d, e, a, 74); SHA1_R4(a, b, c, d, e, 75);
+				SHA1_R4(e, a, b, c, d, 76); SHA1_R4(d, e, a, b, c, 77); SHA1_R4(c, d, e, a, b, 78); SHA1_R4(b, c, d, e, a, 79);
+
+				// Add the working vars back into state.
+				state[0] += a;
+				state[1] += b;
+				state[2] += c;
+				state[3] += d;
+				state[4] += e;
+
+				#undef SHA1_R0
+				#undef SHA1_R1
+				#undef SHA1_R2
+				#undef SHA1_R3
+				#undef SHA1_R4
+				#undef SHA1BLK0
+				#undef SHA1BLK0
+				#undef SHA1BLK
+			}
+		}
+
+#if defined(_STDEX_CPU_X86)
+		_Target_("sha,sse4.1")
+		static void compress_shani(_Inout_updates_(5) uint32_t state[5], _In_reads_bytes_(count * 64) const uint8_t* data, _In_ size_t count)
+		{
+			const __m128i bswap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+			// SHA-NI operates on state arranged as DCBA and E in the most significant lane.
+			__m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0x1b);
+			__m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+
+			for (; count; --count, data += 64) {
+				__m128i abcd_save = abcd, e0_save = e0, e[2], msg[4];
+
+				// Four rounds. msg[] holds message schedule of the next 16 rounds.
+				#define SHA1NI_R(i) { \
+					if ((i) < 4) \
+						msg[(i) & 3] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * (i))), bswap); \
+					e[(i) & 1] = (i) ? _mm_sha1nexte_epu32(e[(i) & 1], msg[(i) & 3]) : _mm_add_epi32(e0, msg[0]); \
+					e[((i) + 1) & 1] = abcd; \
+					if (3 <= (i) && (i) < 19) \
+						msg[((i) + 1) & 3] = _mm_sha1msg2_epu32(msg[((i) + 1) & 3], msg[(i) & 3]); \
+					abcd = _mm_sha1rnds4_epu32(abcd, e[(i) & 1], (i) / 5); \
+					if (1 <= (i) && (i) < 17) \
+						msg[((i) - 1) & 3] = _mm_sha1msg1_epu32(msg[((i) - 1) & 3], msg[(i) & 3]); \
+					if (2 <= (i) && (i) < 18) \
+						msg[((i) + 2) & 3] = _mm_xor_si128(msg[((i) + 2) & 3], msg[(i) & 3]); \
+				}
+
+				// 20 groups of 4 rounds each. Loop unrolled.
+				SHA1NI_R(0); SHA1NI_R(1); SHA1NI_R(2); SHA1NI_R(3); SHA1NI_R(4);
+				SHA1NI_R(5); SHA1NI_R(6); SHA1NI_R(7); SHA1NI_R(8); SHA1NI_R(9);
+				SHA1NI_R(10); SHA1NI_R(11); SHA1NI_R(12); SHA1NI_R(13); SHA1NI_R(14);
+				SHA1NI_R(15); SHA1NI_R(16); SHA1NI_R(17); SHA1NI_R(18); SHA1NI_R(19);
+
+				#undef SHA1NI_R
+
+				e0 = _mm_sha1nexte_epu32(e[0], e0_save);
+				abcd = _mm_add_epi32(abcd, abcd_save);
+			}
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), _mm_shuffle_epi32(abcd, 0x1b));
+			state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+		}
+#elif defined(_STDEX_CPU_ARM64) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+		static void compress_armv8(_Inout_updates_(5) uint32_t state[5], _In_reads_bytes_(count * 64) const uint8_t* data, _In_ size_t count)
+		{
+			static const uint32_t k[4] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+			uint32x4_t state0 = vld1q_u32(&state[0]);
+			uint32_t state1 = state[4];
+
+			for (; count; --count, data += 64) {
+				uint32x4_t abcd = state0, msg[4];
+				uint32_t e = state1;
+				for (size_t i = 0; i < 4; ++i)
+					msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+				for (size_t i = 0; i < 20; ++i) {
+					// Four rounds per iteration. msg[] holds message schedule of the next 16 rounds.
+					uint32x4_t m = vaddq_u32(msg[i & 3], vdupq_n_u32(k[i / 5]));
+					uint32_t e_next = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+					switch (i / 5) {
+					case 0: abcd = vsha1cq_u32(abcd, e, m); break;
+					case 2: abcd = vsha1mq_u32(abcd, e, m); break;
+					default: abcd = vsha1pq_u32(abcd, e, m); break;
+					}
+					e = e_next;
+					if (i < 16)
+						msg[i & 3] = vsha1su1q_u32(vsha1su0q_u32(msg[i & 3], msg[(i + 1) & 3], msg[(i + 2) & 3]), msg[(i + 3) & 3]);
+				}
+				state0 = vaddq_u32(state0, abcd);
+				state1 += e;
+			}
+
+			vst1q_u32(&state[0], state0);
+			state[4] = state1;
+		}
 #endif
-			#define SHA1BLK(i) (m_temp[i&15] = rol(m_temp[(i+13)&15] ^ m_temp[(i+8)&15] ^ m_temp[(i+2)&15] ^ m_temp[i&15],1))
-
-			// SHA1 rounds
-			#define SHA1_R0(v, w, x, y, z, i) { (z) += (((w)&((x)^(y)))^(y))+SHA1BLK0((i))+0x5A827999+rol((v),5); (w)=rol((w),30); }
-			#define SHA1_R1(v, w, x, y, z, i) { (z) += (((w)&((x)^(y)))^(y))+SHA1BLK((i))+0x5A827999+rol((v),5); (w)=rol((w),30); }
-			#define SHA1_R2(v, w, x, y, z, i) { (z) += ((w)^(x)^(y))+SHA1BLK((i))+0x6ED9EBA1+rol((v),5); (w)=rol((w),30); }
-			#define SHA1_R3(v, w, x, y, z, i) { (z) += ((((w)|(x))&(y))|((w)&(x)))+SHA1BLK((i))+0x8F1BBCDC+rol((v),5); (w)=rol((w),30); }
-			#define SHA1_R4(v, w, x, y, z, i) { (z) += ((w)^(x)^(y))+SHA1BLK((i))+0xCA62C1D6+rol((v),5); (w)=rol((w),30); }
-
-			// 5 rounds of 16 operations each. Loop unrolled.
-			SHA1_R0(a, b, c, d, e, 0); SHA1_R0(e, a, b, c, d, 1); SHA1_R0(d, e, a, b, c, 2); SHA1_R0(c, d, e, a, b, 3);
-			SHA1_R0(b, c, d, e, a, 4); SHA1_R0(a, b, c, d, e, 5); SHA1_R0(e, a, b, c, d, 6); SHA1_R0(d, e, a, b, c, 7);
-			SHA1_R0(c, d, e, a, b, 8); SHA1_R0(b, c, d, e, a, 9); SHA1_R0(a, b, c, d, e, 10); SHA1_R0(e, a, b, c, d, 11);
-			SHA1_R0(d, e, a, b, c, 12); SHA1_R0(c, d, e, a, b, 13); SHA1_R0(b, c, d, e, a, 14); SHA1_R0(a, b, c, d, e, 15);
-			SHA1_R1(e, a, b, c, d, 16); SHA1_R1(d, e, a, b, c, 17); SHA1_R1(c, d, e, a, b, 18); SHA1_R1(b, c, d, e, a, 19);
-			SHA1_R2(a, b, c, d, e, 20); SHA1_R2(e, a, b, c, d, 21); SHA1_R2(d, e, a, b, c, 22); SHA1_R2(c, d, e, a, b, 23);
-			SHA1_R2(b, c, d, e, a, 24); SHA1_R2(a, b, c, d, e, 25); SHA1_R2(e, a, b, c, d, 26); SHA1_R2(d, e, a, b, c, 27);
-			SHA1_R2(c, d, e, a, b, 28); SHA1_R2(b, c, d, e, a, 29); SHA1_R2(a, b, c, d, e, 30); SHA1_R2(e, a, b, c, d, 31);
-			SHA1_R2(d, e, a, b, c, 32); SHA1_R2(c, d, e, a, b, 33); SHA1_R2(b, c, d, e, a, 34); SHA1_R2(a, b, c, d, e, 35);
-			SHA1_R2(e, a, b, c, d, 36); SHA1_R2(d, e, a, b, c, 37); SHA1_R2(c, d, e, a, b, 38); SHA1_R2(b, c, d, e, a, 39);
-			SHA1_R3(a, b, c, d, e, 40); SHA1_R3(e, a, b, c, d, 41); SHA1_R3(d, e, a, b, c, 42); SHA1_R3(c, d, e, a, b, 43);
-			SHA1_R3(b, c, d, e, a, 44); SHA1_R3(a, b, c, d, e, 45); SHA1_R3(e, a, b, c, d, 46); SHA1_R3(d, e, a, b, c, 47);
-			SHA1_R3(c, d, e, a, b, 48); SHA1_R3(b, c, d, e, a, 49); SHA1_R3(a, b, c, d, e, 50); SHA1_R3(e, a, b, c, d, 51);
-			SHA1_R3(d, e, a, b, c, 52); SHA1_R3(c, d, e, a, b, 53); SHA1_R3(b, c, d, e, a, 54); SHA1_R3(a, b, c, d, e, 55);
-			SHA1_R3(e, a, b, c, d, 56); SHA1_R3(d, e, a, b, c, 57); SHA1_R3(c, d, e, a, b, 58); SHA1_R3(b, c, d, e, a, 59);
-			SHA1_R4(a, b, c, d, e, 60); SHA1_R4(e, a, b, c, d, 61); SHA1_R4(d, e, a, b, c, 62); SHA1_R4(c, d, e, a, b, 63);
-			SHA1_R4(b, c, d, e, a, 64); SHA1_R4(a, b, c, d, e, 65); SHA1_R4(e, a, b, c, d, 66); SHA1_R4(d, e, a, b, c, 67);
-			SHA1_R4(c, d, e, a, b, 68); SHA1_R4(b, c, d, e, a, 69); SHA1_R4(a, b, c, d, e, 70); SHA1_R4(e, a, b, c, d, 71);
-			SHA1_R4(d, e, a, b, c, 72); SHA1_R4(c, d, e, a, b, 73); SHA1_R4(b, c, d, e, a, 74); SHA1_R4(a, b, c, d, e, 75);
-			SHA1_R4(e, a, b, c, d, 76); SHA1_R4(d, e, a, b, c, 77); SHA1_R4(c, d, e, a, b, 78); SHA1_R4(b, c, d, e, a, 79);
-
-			// Add the working vars back into m_state.
-			m_state[0] += a;
-			m_state[1] += b;
-			m_state[2] += c;
-			m_state[3] += d;
-			m_state[4] += e;
 
-			#undef SHA1_R0
-			#undef SHA1_R1
-			#undef SHA1_R2
-			#undef SHA1_R3
-			#undef SHA1_R4
-			#undef SHA1BLK0
-			#undef SHA1BLK0
-			#undef SHA1BLK
+		///
+		/// Compresses blocks of a single lane
+		///
+		static void compress_single(_In_reads_(1) sha1_hash* const* h, _In_reads_(1) const uint8_t* const* data, _In_ size_t count)
+		{
+			h[0]->hash_blocks(data[0], count);
+		}
+
+		// Multi-buffer compression functions process one message per 32-bit lane. All lanes compress the same
+		// number of blocks. Message schedule is computed in place.
+
+#if defined(_STDEX_CPU_X86)
+		_Target_("avx2")
+		static void compress_avx2(_In_reads_(8) sha1_hash* const* h, _In_reads_(8) const uint8_t* const* data, _In_ size_t count)
+		{
+			alignas(32) uint32_t s[5][8], w[16][8];
+			for (size_t l = 0; l < 8; ++l)
+				for (size_t j = 0; j < 5; ++j)
+					s[j][l] = h[l]->m_state[j];
+			__m256i
+				a = _mm256_load_si256(reinterpret_cast<const __m256i*>(s[0])),
+				b = _mm256_load_si256(reinterpret_cast<const __m256i*>(s[1])),
+				c = _mm256_load_si256(reinterpret_cast<const __m256i*>(s[2])),
+				d = _mm256_load_si256(reinterpret_cast<const __m256i*>(s[3])),
+				e = _mm256_load_si256(reinterpret_cast<const __m256i*>(s[4]));
+
+			for (size_t offset = 0; count; --count, offset += 64) {
+				load_lanes<8, true>(&w[0][0], data, offset);
+				__m256i x[16], aa = a, bb = b, cc = c, dd = d, ee = e;
+				for (size_t i = 0; i < 16; ++i)
+					x[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(w[i]));
+
+				#define SHA1MB_ROL(v, n) _mm256_or_si256(_mm256_slli_epi32((v), (n)), _mm256_srli_epi32((v), 32 - (n)))
+				#define SHA1MB_STEP(f, k) { \
+					if (i >= 16) \
+						x[i & 15] = SHA1MB_ROL(_mm256_xor_si256(_mm256_xor_si256(x[(i + 13) & 15], x[(i + 8) & 15]), _mm256_xor_si256(x[(i + 2) & 15], x[i & 15])), 1); \
+					__m256i t = _mm256_add_epi32(_mm256_add_epi32(SHA1MB_ROL(a, 5), (f)), _mm256_add_epi32(_mm256_add_epi32(e, _mm256_set1_epi32(static_cast<int>(k))), x[i & 15])); \
+					e = d; d = c; c = SHA1MB_ROL(b, 30); b = a; a = t; \
+				}
+				size_t i = 0;
+				for (; i < 20; ++i) SHA1MB_STEP(_mm256_xor_si256(_mm256_and_si256(b, _mm256_xor_si256(c, d)), d), 0x5A827999);
+				for (; i < 40; ++i) SHA1MB_STEP(_mm256_xor_si256(_mm256_xor_si256(b, c), d), 0x6ED9EBA1);
+				for (; i < 60; ++i) SHA1MB_STEP(_mm256_or_si256(_mm256_and_si256(b, c), _mm256_and_si256(d, _mm256_or_si256(b, c))), 0x8F1BBCDC);
+				for (; i < 80; ++i) SHA1MB_STEP(_mm256_xor_si256(_mm256_xor_si256(b, c), d), 0xCA62C1D6);
+				#undef SHA1MB_STEP
+				#undef SHA1MB_ROL
+
+				a = _mm256_add_epi32(a, aa);
+				b = _mm256_add_epi32(b, bb);
+				c = _mm256_add_epi32(c, cc);
+				d = _mm256_add_epi32(d, dd);
+				e = _mm256_add_epi32(e, ee);
+			}
+
+			_mm256_store_si256(reinterpret_cast<__m256i*>(s[0]), a);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(s[1]), b);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(s[2]), c);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(s[3]), d);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(s[4]), e);
+			for (size_t l = 0; l < 8; ++l)
+				for (size_t j = 0; j < 5; ++j)
+					h[l]->m_state[j] = s[j][l];
+		}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized" // AVX-512 intrinsics of GCC 12 and older
+#endif
+		_Target_("avx512f")
+		static void compress_avx512(_In_reads_(16) sha1_hash* const* h, _In_reads_(16) const uint8_t* const* data, _In_ size_t count)
+		{
+			alignas(64) uint32_t s[5][16], w[16][16];
+			for (size_t l = 0; l < 16; ++l)
+				for (size_t j = 0; j < 5; ++j)
+					s[j][l] = h[l]->m_state[j];
+			__m512i
+				a = _mm512_load_si512(s[0]),
+				b = _mm512_load_si512(s[1]),
+				c = _mm512_load_si512(s[2]),
+				d = _mm512_load_si512(s[3]),
+				e = _mm512_load_si512(s[4]);
+
+			for (size_t offset = 0; count; --count, offset += 64) {
+				load_lanes<16, true>(&w[0][0], data, offset);
+				__m512i x[16], aa = a, bb = b, cc = c, dd = d, ee = e;
+				for (size_t i = 0; i < 16; ++i)
+					x[i] = _mm512_load_si512(w[i]);
+
+				// Ternary logic immediates: 0xca = b ? c : d, 0x96 = b ^ c ^ d, 0xe8 = majority of b, c and d
+				#define SHA1MB_STEP(f, k) { \
+					if (i >= 16) \
+						x[i & 15] = _mm512_rol_epi32(_mm512_ternarylogic_epi32(_mm512_xor_si512(x[(i + 13) & 15], x[(i + 8) & 15]), x[(i + 2) & 15], x[i & 15], 0x96), 1); \
+					__m512i t = _mm512_add_epi32(_mm512_add_epi32(_mm512_rol_epi32(a, 5), _mm512_ternarylogic_epi32(b, c, d, (f))), _mm512_add_epi32(_mm512_add_epi32(e, _mm512_set1_epi32(static_cast<int>(k))), x[i & 15])); \
+					e = d; d = c; c = _mm512_rol_epi32(b, 30); b = a; a = t; \
+				}
+				size_t i = 0;
+				for (; i < 20; ++i) SHA1MB_STEP(0xca, 0x5A827999);
+				for (; i < 40; ++i) SHA1MB_STEP(0x96, 0x6ED9EBA1);
+				for (; i < 60; ++i) SHA1MB_STEP(0xe8, 0x8F1BBCDC);
+				for (; i < 80; ++i) SHA1MB_STEP(0x96, 0xCA62C1D6);
+				#undef SHA1MB_STEP
+
+				a = _mm512_add_epi32(a, aa);
+				b = _mm512_add_epi32(b, bb);
+				c = _mm512_add_epi32(c, cc);
+				d = _mm512_add_epi32(d, dd);
+				e = _mm512_add_epi32(e, ee);
+			}
+
+			_mm512_store_si512(s[0], a);
+			_mm512_store_si512(s[1], b);
+			_mm512_store_si512(s[2], c);
+			_mm512_store_si512(s[3], d);
+			_mm512_store_si512(s[4], e);
+			for (size_t l = 0; l < 16; ++l)
+				for (size_t j = 0; j < 5; ++j)
+					h[l]->m_state[j] = s[j][l];
+		}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#elif defined(_STDEX_CPU_ARM64)
+		static void compress_neon(_In_reads_(4) sha1_hash* const* h, _In_reads_(4) const uint8_t* const* data, _In_ size_t count)
+		{
+			uint32_t s[5][4], w[16][4];
+			for (size_t l = 0; l < 4; ++l)
+				for (size_t j = 0; j < 5; ++j)
+					s[j][l] = h[l]->m_state[j];
+			uint32x4_t a = vld1q_u32(s[0]), b = vld1q_u32(s[1]), c = vld1q_u32(s[2]), d = vld1q_u32(s[3]), e = vld1q_u32(s[4]);
+
+			for (size_t offset = 0; count; --count, offset += 64) {
+				load_lanes<4, true>(&w[0][0], data, offset);
+				uint32x4_t x[16], aa = a, bb = b, cc = c, dd = d, ee = e;
+				for (size_t i = 0; i < 16; ++i)
+					x[i] = vld1q_u32(w[i]);
+
+				#define SHA1MB_ROL(v, n) vsriq_n_u32(vshlq_n_u32((v), (n)), (v), 32 - (n))
+				#define SHA1MB_STEP(f, k) { \
+					if (i >= 16) \
+						x[i & 15] = SHA1MB_ROL(veorq_u32(veorq_u32(x[(i + 13) & 15], x[(i + 8) & 15]), veorq_u32(x[(i + 2) & 15], x[i & 15])), 1); \
+					uint32x4_t t = vaddq_u32(vaddq_u32(SHA1MB_ROL(a, 5), (f)), vaddq_u32(vaddq_u32(e, vdupq_n_u32(k)), x[i & 15])); \
+					e = d; d = c; c = SHA1MB_ROL(b, 30); b = a; a = t; \
+				}
+				size_t i = 0;
+				for (; i < 20; ++i) SHA1MB_STEP(vbslq_u32(b, c, d), 0x5A827999);
+				for (; i < 40; ++i) SHA1MB_STEP(veorq_u32(veorq_u32(b, c), d), 0x6ED9EBA1);
+				for (; i < 60; ++i) SHA1MB_STEP(vbslq_u32(veorq_u32(b, c), d, b), 0x8F1BBCDC);
+				for (; i < 80; ++i) SHA1MB_STEP(veorq_u32(veorq_u32(b, c), d), 0xCA62C1D6);
+				#undef SHA1MB_STEP
+				#undef SHA1MB_ROL
+
+				a = vaddq_u32(a, aa);
+				b = vaddq_u32(b, bb);
+				c = vaddq_u32(c, cc);
+				d = vaddq_u32(d, dd);
+				e = vaddq_u32(e, ee);
+			}
+
+			vst1q_u32(s[0], a);
+			vst1q_u32(s[1], b);
+			vst1q_u32(s[2], c);
+			vst1q_u32(s[3], d);
+			vst1q_u32(s[4], e);
+			for (size_t l = 0; l < 4; ++l)
+				for (size_t j = 0; j < 5; ++j)
+					h[l]->m_state[j] = s[j][l];
 		}
+#endif
 
 	protected:
+		compress_t m_compress;
 		uint32_t m_state[5];
 	};
 
@@ -643,6 +1665,217 @@ namespace stdex
 			return stream;
 		}
 	};
+
+	///
+	/// Hashes as SHA256
+	///
+	/// Uses SHA-NI (x86) or ARMv8 SHA2 instructions when the CPU supports it.
+	///
+	class sha256_hash : public block_hash<sha256_t>
+	{
+	public:
+		sha256_hash() : m_compress(select())
+		{
+			clear();
+		}
+
+		virtual void clear()
+		{
+			block_hash::clear();
+
+			// SHA256 initialization constants
+			m_state[0] = 0x6a09e667;
+			m_state[1] = 0xbb67ae85;
+			m_state[2] = 0x3c6ef372;
+			m_state[3] = 0xa54ff53a;
+			m_state[4] = 0x510e527f;
+			m_state[5] = 0x9b05688c;
+			m_state[6] = 0x1f83d9ab;
+			m_state[7] = 0x5be0cd19;
+		}
+
+		virtual void finalize()
+		{
+			static const uint8_t sha256_padding[64] = { 0x80 };
+
+			// Save number of bits. Big-endian.
+			uint8_t final[8];
+			for (size_t i = 0; i < 8; i++)
+				final[i] = static_cast<uint8_t>((m_counter[((i >= 4) ? 0 : 1)] >> ((3 - (i & 3)) * 8)) & 255);
+
+			// Pad out to 56 mod 64.
+			size_t index = (m_counter[0] >> 3) & 0x3f;
+			size_t remainder = index < 56 ? 56 - index : 120 - index;
+			hash(sha256_padding, remainder);
+
+			// Append length (before padding).
+			hash(final, 8);
+
+			// Store m_state in m_value.
+			for (size_t i = 0; i < 32; i++)
+				m_value.data8[i] = static_cast<uint8_t>((m_state[i >> 2] >> ((3 - (i & 3)) * 8)) & 255);
+		}
+
+	protected:
+		virtual void hash_block()
+		{
+			m_compress(m_state, m_queue, 1);
+		}
+
+		virtual void hash_blocks(_In_reads_bytes_(count * 64) const uint8_t* data, _In_ size_t count)
+		{
+			m_compress(m_state, data, count);
+		}
+
+		using compress_t = void(*)(_Inout_updates_(8) uint32_t state[8], _In_reads_bytes_(count * 64) const uint8_t* data, _In_ size_t count);
+
+		static compress_t select()
+		{
+#if defined(_STDEX_CPU_X86)
+			if (cpu_features.sha && cpu_features.sse41)
+				return compress_shani;
+#elif defined(_STDEX_CPU_ARM64) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+			if (cpu_features.sha2)
+				return compress_armv8;
+#endif
+			return compress_generic;
+		}
+
+		static constexpr uint32_t k[64] = {
+			0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+			0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+			0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+			0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+			0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+			0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+			0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+			0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+		};
+
+		///
+		/// Compresses 64-byte blocks
+		///
+		/// \param[in,out] state  Hash state
+		/// \param[in]     data   Blocks
+		/// \param[in]     count  Number of blocks
+		///
+		static void compress_generic(_Inout_updates_(8) uint32_t state[8], _In_reads_bytes_(count * 64) const uint8_t* data, _In_ size_t count)
+		{
+			for (; count; --count, data += 64) {
+				uint32_t w[64];
+				for (size_t i = 0; i < 16; ++i)
+					w[i] =
+						(static_cast<uint32_t>(data[4 * i]) << 24) |
+						(static_cast<uint32_t>(data[4 * i + 1]) << 16) |
+						(static_cast<uint32_t>(data[4 * i + 2]) << 8) |
+						static_cast<uint32_t>(data[4 * i + 3]);
+				for (size_t i = 16; i < 64; ++i) {
+					uint32_t s0 = rol(w[i - 15], 25) ^ rol(w[i - 15], 14) ^ (w[i - 15] >> 3);
+					uint32_t s1 = rol(w[i - 2], 15) ^ rol(w[i - 2], 13) ^ (w[i - 2] >> 10);
+					w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+				}
+
+				// Copy state[] to working vars.
+				uint32_t
+					a = state[0], b = state[1], c = state[2], d = state[3],
+					e = state[4], f = state[5], g = state[6], h = state[7];
+
+				for (size_t i = 0; i < 64; ++i) {
+					uint32_t t1 = h + (rol(e, 26) ^ rol(e, 21) ^ rol(e, 7)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+					uint32_t t2 = (rol(a, 30) ^ rol(a, 19) ^ rol(a, 10)) + ((a & b) ^ (a & c) ^ (b & c));
+					h = g;
+					g = f;
+					f = e;
+					e = d + t1;
+					d = c;
+					c = b;
+					b = a;
+					a = t1 + t2;
+				}
+
+				// Add the working vars back into state.
+				state[0] += a;
+				state[1] += b;
+				state[2] += c;
+				state[3] += d;
+				state[4] += e;
+				state[5] += f;
+				state[6] += g;
+				state[7] += h;
+			}
+		}
+
+#if defined(_STDEX_CPU_X86)
+		_Target_("sha,sse4.1")
+		static void compress_shani(_Inout_updates_(8) uint32_t state[8], _In_reads_bytes_(count * 64) const uint8_t* data, _In_ size_t count)
+		{
+			const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+			// SHA-NI operates on state arranged as ABEF and CDGH.
+			__m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xb1); // CDAB
+			__m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1b); // EFGH
+			__m128i state0 = _mm_alignr_epi8(tmp, state1, 8); // ABEF
+			state1 = _mm_blend_epi16(state1, tmp, 0xf0); // CDGH
+
+			for (; count; --count, data += 64) {
+				__m128i abef = state0, cdgh = state1, msg[4];
+				for (size_t i = 0; i < 16; ++i) {
+					// Four rounds per iteration. msg[] holds message schedule of the next 16 rounds.
+					if (i < 4)
+						msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)), bswap);
+					__m128i m = _mm_add_epi32(msg[i & 3], _mm_loadu_si128(reinterpret_cast<const __m128i*>(&k[4 * i])));
+					state1 = _mm_sha256rnds2_epu32(state1, state0, m);
+					if (3 <= i && i < 15) {
+						__m128i& next = msg[(i + 1) & 3];
+						next = _mm_add_epi32(next, _mm_alignr_epi8(msg[i & 3], msg[(i - 1) & 3], 4));
+						next = _mm_sha256msg2_epu32(next, msg[i & 3]);
+					}
+					state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(m, 0x0e));
+					if (1 <= i && i < 13)
+						msg[(i - 1) & 3] = _mm_sha256msg1_epu32(msg[(i - 1) & 3], msg[i & 3]);
+				}
+				state0 = _mm_add_epi32(state0, abef);
+				state1 = _mm_add_epi32(state1, cdgh);
+			}
+
+			tmp = _mm_shuffle_epi32(state0, 0x1b); // FEBA
+			state1 = _mm_shuffle_epi32(state1, 0xb1); // DCHG
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), _mm_blend_epi16(tmp, state1, 0xf0)); // DCBA
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), _mm_alignr_epi8(state1, tmp, 8)); // HGFE
+		}
+#elif defined(_STDEX_CPU_ARM64) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+		static void compress_armv8(_Inout_updates_(8) uint32_t state[8], _In_reads_bytes_(count * 64) const uint8_t* data, _In_ size_t count)
+		{
+			uint32x4_t state0 = vld1q_u32(&state[0]), state1 = vld1q_u32(&state[4]);
+
+			for (; count; --count, data += 64) {
+				uint32x4_t abcd = state0, efgh = state1, msg[4];
+				for (size_t i = 0; i < 4; ++i)
+					msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+				for (size_t i = 0; i < 16; ++i) {
+					// Four rounds per iteration. msg[] holds message schedule of the next 16 rounds.
+					uint32x4_t m = vaddq_u32(msg[i & 3], vld1q_u32(&k[4 * i]));
+					if (i < 12)
+						msg[i & 3] = vsha256su0q_u32(msg[i & 3], msg[(i + 1) & 3]);
+					uint32x4_t tmp = state0;
+					state0 = vsha256hq_u32(state0, state1, m);
+					state1 = vsha256h2q_u32(state1, tmp, m);
+					if (i < 12)
+						msg[i & 3] = vsha256su1q_u32(msg[i & 3], msg[(i + 2) & 3], msg[(i + 3) & 3]);
+				}
+				state0 = vaddq_u32(state0, abcd);
+				state1 = vaddq_u32(state1, efgh);
+			}
+
+			vst1q_u32(&state[0], state0);
+			vst1q_u32(&state[4], state1);
+		}
+#endif
+
+	protected:
+		compress_t m_compress;
+		uint32_t m_state[8];
+	};
 }
 
 #if defined(__GNUC__)
@@ -84,6 +84,30 @@ namespace stdex
 #endif
 	}
 
+	///
+	/// Returns index of the most significant bit set
+	///
+	/// \param[in] value  Value. Must not be zero.
+	///
+	/// \return Bit index (0-63)
+	///
+	inline int msb(_In_ uint64_t value)
+	{
+#if defined(_MSC_VER) && defined(_WIN64)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return static_cast<int>(index);
+#elif defined(_MSC_VER)
+		unsigned long index;
+		if (_BitScanReverse(&index, static_cast<uint32_t>(value >> 32)))
+			return static_cast<int>(index) + 32;
+		_BitScanReverse(&index, static_cast<uint32_t>(value));
+		return static_cast<int>(index);
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+
 	///
 	/// Calculate n*k/q
 	///
@@ -0,0 +1,387 @@
+﻿/*
+	SPDX-License-Identifier: MIT
+	Copyright © 2023-2024 Amebis
+*/
+
+#pragma once
+
+#include "assert.hpp"
+#include "compat.hpp"
+#include "socket.hpp"
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace stdex
+{
+	///
+	/// Default maximum number of events reaped by a single reactor iteration
+	///
+	constexpr size_t default_reactor_events = 0x40;
+
+	///
+	/// Linux epoll reactor
+	///
+	/// Multiplexes many non-blocking sockets on a single thread. Readiness handlers are called on the thread running
+	/// run() or run_once(). Sockets are monitored level-triggered: a handler is called again on the next iteration
+	/// while the socket remains ready.
+	///
+	/// Not thread-safe: only post(), in_thread() and quit() may be called from other threads. Handlers may add, modify
+	/// and remove sockets, including their own.
+	///
+	class reactor
+	{
+	public:
+		///
+		/// Readiness handler
+		///
+		/// \param[in] events  Combination of event_* flags
+		///
+		using handler_t = std::function<void(uint32_t events)>;
+
+		static constexpr uint32_t event_read = 0x1;    ///< Socket is ready for reading
+		static constexpr uint32_t event_write = 0x2;   ///< Socket is ready for writing
+		static constexpr uint32_t event_hangup = 0x4;  ///< Peer closed connection
+		static constexpr uint32_t event_error = 0x8;   ///< Socket error
+		static constexpr uint32_t event_timeout = 0x10; ///< No events within the socket's timeout
+
+		using clock = std::chrono::steady_clock;
+		using duration = std::chrono::milliseconds;
+
+	public:
+		///
+		/// Creates reactor
+		///
+		/// \param[in] max_events  Maximum number of events reaped by a single iteration
+		///
+		reactor(_In_ size_t max_events = default_reactor_events) :
+			m_events(max_events),
+			m_quit(false),
+			m_thread(std::thread::id())
+		{
+			m_epoll = epoll_create1(EPOLL_CLOEXEC);
+			if (m_epoll < 0) _Unlikely_
+				throw std::system_error(errno, std::system_category(), "epoll_create1 failed");
+			m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (m_wake < 0) _Unlikely_ {
+				int err = errno;
+				::close(m_epoll);
+				throw std::system_error(err, std::system_category(), "eventfd failed");
+			}
+			epoll_event e = {};
+			e.events = EPOLLIN;
+			e.data.fd = m_wake;
+			if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &e) < 0) _Unlikely_ {
+				int err = errno;
+				::close(m_wake);
+				::close(m_epoll);
+				throw std::system_error(err, std::system_category(), "epoll_ctl failed");
+			}
+		}
+
+		virtual ~reactor()
+		{
+			run_tasks(); // Posted functions might release resources.
+			::close(m_wake);
+			::close(m_epoll);
+		}
+
+	private:
+		reactor(_In_ const reactor& other);
+		reactor& operator =(_In_ const reactor& other);
+
+	public:
+		///
+		/// Starts monitoring socket
+		///
+		/// \param[in] h        Socket handle. Socket should be in non-blocking mode.
+		/// \param[in] events   Combination of event_read and event_write to monitor. event_hangup and event_error are
+		///                     always reported.
+		/// \param[in] handler  Function to call when socket is ready or times out
+		/// \param[in] timeout  Idle timeout. When no event is reported for this long, handler is called once with
+		///                     event_timeout. Call set_timeout() to re-arm it. Zero disables timeout.
+		///
+		void add(_In_ socket_t h, _In_ uint32_t events, _In_ handler_t handler, _In_ duration timeout = duration::zero())
+		{
+			stdex_assert(h != invalid_socket && h != m_wake);
+			auto s = std::make_shared<entry_t>();
+			s->events = events;
+			s->handler = std::move(handler);
+			epoll_event e = {};
+			e.events = to_epoll(events);
+			e.data.fd = h;
+			if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, h, &e) < 0) _Unlikely_
+				throw std::system_error(errno, std::system_category(), "epoll_ctl failed");
+			m_sockets[h] = s;
+			set_timeout(h, timeout);
+		}
+
+		///
+		/// Changes events monitored on socket
+		///
+		/// \param[in] h       Socket handle
+		/// \param[in] events  Combination of event_read and event_write to monitor
+		///
+		void modify(_In_ socket_t h, _In_ uint32_t events)
+		{
+			auto& s = find(h);
+			if (s.events == events)
+				return;
+			epoll_event e = {};
+			e.events = to_epoll(events);
+			e.data.fd = h;
+			if (epoll_ctl(m_epoll, EPOLL_CTL_MOD, h, &e) < 0) _Unlikely_
+				throw std::system_error(errno, std::system_category(), "epoll_ctl failed");
+			s.events = events;
+		}
+
+		///
+		/// Sets socket idle timeout and restarts its countdown
+		///
+		/// \param[in] h        Socket handle
+		/// \param[in] timeout  Idle timeout. Zero disables timeout.
+		///
+		void set_timeout(_In_ socket_t h, _In_ duration timeout)
+		{
+			auto& s = find(h);
+			if (s.timeout != duration::zero())
+				m_deadlines.erase(std::make_pair(s.deadline, h));
+			s.timeout = timeout;
+			if (timeout != duration::zero()) {
+				s.deadline = clock::now() + timeout;
+				m_deadlines.insert(std::make_pair(s.deadline, h));
+			}
+		}
+
+		///
+		/// Stops monitoring socket
+		///
+		/// Call before closing the socket.
+		///
+		/// \param[in] h  Socket handle
+		///
+		void remove(_In_ socket_t h)
+		{
+			auto i = m_sockets.find(h);
+			if (i == m_sockets.end()) _Unlikely_
+				throw std::invalid_argument("socket not registered");
+			if (i->second->timeout != duration::zero())
+				m_deadlines.erase(std::make_pair(i->second->deadline, h));
+			m_sockets.erase(i);
+			epoll_ctl(m_epoll, EPOLL_CTL_DEL, h, nullptr);
+		}
+
+		///
+		/// Returns true if socket is monitored
+		///
+		bool contains(_In_ socket_t h) const { return m_sockets.find(h) != m_sockets.end(); }
+
+		///
+		/// Returns number of monitored sockets
+		///
+		size_t size() const { return m_sockets.size(); }
+
+		///
+		/// Queues a function to be called on the thread running run() or run_once()
+		///
+		/// May be called from any thread. Use it to add, modify or remove sockets from other threads.
+		///
+		/// \param[in] task  Function to call. Functions still queued are called on reactor destruction.
+		///
+		void post(_In_ std::function<void()> task)
+		{
+			{
+				const std::lock_guard<std::mutex> lk(m_tasks_mutex);
+				m_tasks.push_back(std::move(task));
+			}
+			wake();
+		}
+
+		///
+		/// Returns true if called on the thread that last ran run() or run_once(), or if reactor has not run yet
+		///
+		/// May be called from any thread.
+		///
+		bool in_thread() const
+		{
+			auto id = m_thread.load(std::memory_order_relaxed);
+			return id == std::thread::id() || id == std::this_thread::get_id();
+		}
+
+		///
+		/// Calls posted functions, waits for events and calls handlers
+		///
+		/// \param[in] max_wait  Maximum time to wait for events. Negative waits until an event or nearest socket
+		///                      timeout.
+		///
+		/// \return Number of handler and posted function calls
+		///
+		size_t run_once(_In_ duration max_wait = duration(-1))
+		{
+			m_thread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+			size_t num_calls = run_tasks();
+			if (num_calls)
+				max_wait = duration::zero(); // Posted functions might have made progress. Just poll.
+			int wait_ms = max_wait < duration::zero() ? -1 : static_cast<int>(max_wait.count());
+			if (!m_deadlines.empty()) {
+				auto until = std::chrono::ceil<duration>(m_deadlines.begin()->first - clock::now()).count();
+				if (until < 0)
+					until = 0;
+				if (wait_ms < 0 || until < wait_ms)
+					wait_ms = static_cast<int>(until);
+			}
+			int count = epoll_wait(m_epoll, m_events.data(), static_cast<int>(m_events.size()), wait_ms);
+			if (count < 0) _Unlikely_ {
+				if (errno == EINTR)
+					return 0;
+				throw std::system_error(errno, std::system_category(), "epoll_wait failed");
+			}
+			// Functions posted while waiting might remove sockets reported ready. Run them first.
+			num_calls += run_tasks();
+			for (int i = 0; i < count; ++i) {
+				socket_t h = m_events[i].data.fd;
+				if (h == m_wake) {
+					uint64_t value;
+					while (::read(m_wake, &value, sizeof(value)) > 0);
+					continue;
+				}
+				auto s = m_sockets.find(h);
+				if (s == m_sockets.end())
+					continue; // Removed by a previous handler
+				auto entry = s->second; // Keep handler alive while running
+				if (entry->timeout != duration::zero()) {
+					m_deadlines.erase(std::make_pair(entry->deadline, h));
+					entry->deadline = clock::now() + entry->timeout;
+					m_deadlines.insert(std::make_pair(entry->deadline, h));
+				}
+				entry->handler(from_epoll(m_events[i].events));
+				++num_calls;
+			}
+			if (!m_deadlines.empty()) {
+				auto now = clock::now();
+				while (!m_deadlines.empty() && m_deadlines.begin()->first <= now) {
+					socket_t h = m_deadlines.begin()->second;
+					m_deadlines.erase(m_deadlines.begin());
+					auto entry = m_sockets[h];
+					entry->timeout = duration::zero(); // Timeout is one-shot. Handler may re-arm it.
+					entry->handler(event_timeout);
+					++num_calls;
+				}
+			}
+			return num_calls + run_tasks();
+		}
+
+		///
+		/// Runs event loop until quit() is called or no sockets and posted functions are left
+		///
+		void run()
+		{
+			while (!m_quit.load(std::memory_order_acquire) && (!m_sockets.empty() || has_tasks()))
+				run_once();
+			m_quit.store(false, std::memory_order_relaxed);
+		}
+
+		///
+		/// Stops run() loop
+		///
+		/// May be called from any thread.
+		///
+		void quit()
+		{
+			m_quit.store(true, std::memory_order_release);
+			wake();
+		}
+
+	protected:
+		///
+		/// Interrupts epoll_wait()
+		///
+		void wake()
+		{
+			uint64_t value = 1;
+			if (::write(m_wake, &value, sizeof(value)) < 0) _Unlikely_
+				throw std::system_error(errno, std::system_category(), "eventfd write failed");
+		}
+
+		bool has_tasks()
+		{
+			const std::lock_guard<std::mutex> lk(m_tasks_mutex);
+			return !m_tasks.empty();
+		}
+
+		///
+		/// Calls functions posted so far
+		///
+		/// \return Number of calls
+		///
+		size_t run_tasks()
+		{
+			std::vector<std::function<void()>> tasks;
+			{
+				const std::lock_guard<std::mutex> lk(m_tasks_mutex);
+				tasks.swap(m_tasks);
+			}
+			for (auto& task : tasks)
+				task();
+			return tasks.size();
+		}
+
+		struct entry_t
+		{
+			uint32_t events;
+			handler_t handler;
+			duration timeout = duration::zero();
+			clock::time_point deadline;
+		};
+
+		entry_t& find(_In_ socket_t h)
+		{
+			auto i = m_sockets.find(h);
+			if (i == m_sockets.end()) _Unlikely_
+				throw std::invalid_argument("socket not registered");
+			return *i->second;
+		}
+
+		static uint32_t to_epoll(_In_ uint32_t events)
+		{
+			return
+				((events & event_read) ? static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP) : 0) |
+				((events & event_write) ? static_cast<uint32_t>(EPOLLOUT) : 0);
+		}
+
+		static uint32_t from_epoll(_In_ uint32_t events)
+		{
+			return
+				((events & EPOLLIN) ? event_read : 0) |
+				((events & EPOLLOUT) ? event_write : 0) |
+				((events & (EPOLLHUP | EPOLLRDHUP)) ? event_hangup : 0) |
+				((events & EPOLLERR) ? event_error : 0);
+		}
+
+	protected:
+		int m_epoll;
+		int m_wake; ///< eventfd to interrupt epoll_wait() on quit()
+		std::vector<epoll_event> m_events;
+		std::atomic<bool> m_quit;
+		std::unordered_map<socket_t, std::shared_ptr<entry_t>> m_sockets;
+		std::set<std::pair<clock::time_point, socket_t>> m_deadlines; ///< Socket timeouts ordered by deadline
+		std::mutex m_tasks_mutex;
+		std::vector<std::function<void()>> m_tasks; ///< Functions posted by post()
+		std::atomic<std::thread::id> m_thread; ///< Thread that last ran the reactor
+	};
+}
+#endif
@@ -7,6 +7,11 @@
 
 #include "assert.hpp"
 #include "compat.hpp"
+#ifdef _WIN32
+#include <intrin.h>
+#endif
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <tuple>
@@ -131,8 +136,10 @@ namespace stdex
 	protected:
 		size_t wrap(_In_ size_t idx) const
 		{
-			// TODO: When N_cap is power of 2, use & ~(N_cap - 1) instead.
-			return idx % N_cap;
+			if constexpr ((N_cap & (N_cap - 1)) == 0)
+				return idx & (N_cap - 1);
+			else
+				return idx % N_cap;
 		}
 
 		size_t space() const
@@ -152,6 +159,194 @@ namespace stdex
 		bool m_quit;
 		T m_data[N_cap];
 	};
+
+	///
+	/// Lock-free single-producer/single-consumer ring buffer
+	///
+	/// Same interface as ring, but back()/push() may only be called from one thread and front()/pop() from another.
+	/// Head and tail indices are exchanged using acquire/release atomics. A waiting side spins briefly before it parks,
+	/// and the other side notifies it only when it is actually parked.
+	///
+	/// \tparam T      Ring element type
+	/// \tparam N_cap  Ring capacity (in number of elements). Power of 2 is recommended.
+	///
+	template <class T, size_t N_cap>
+	class spsc_ring
+	{
+	public:
+#pragma warning(suppress:26495) // Don't bother to initialize m_data
+		spsc_ring() :
+			m_head(0),
+			m_tail(0),
+			m_quit(false),
+			m_producer_parked(false),
+			m_consumer_parked(false)
+		{}
+
+		///
+		/// Allocates the data after the ring tail. Use push() after the allocated data is populated.
+		///
+		/// \return Pointer to data available for writing and maximum data size to write. Or, `{nullptr, 0}` if quit() has been called.
+		///
+		std::tuple<T*, size_t> back()
+		{
+			size_t tail = m_tail.load(std::memory_order_relaxed);
+			size_t head = m_head.load(std::memory_order_acquire);
+			if (tail - head >= N_cap) {
+				wait(m_producer_parked, m_head_moved, [&] {
+					head = m_head.load(std::memory_order_acquire);
+					return tail - head < N_cap;
+				});
+				if (m_quit.load(std::memory_order_relaxed)) _Unlikely_
+					return { nullptr, 0 };
+			}
+			size_t idx = wrap(tail);
+			return { &m_data[idx], std::min(N_cap - (tail - head), N_cap - idx) };
+		}
+
+		///
+		/// Notifies the receiver the data was populated.
+		///
+		/// \param[in] size  Amount of data that was really populated
+		///
+		void push(_In_ size_t size)
+		{
+			size_t tail = m_tail.load(std::memory_order_relaxed);
+#ifndef NDEBUG
+			size_t head = m_head.load(std::memory_order_acquire);
+			stdex_assert(size <= std::min(N_cap - (tail - head), N_cap - wrap(tail)));
+#endif
+			m_tail.store(tail + size, std::memory_order_release);
+			notify(m_consumer_parked, m_tail_moved);
+		}
+
+		///
+		/// Peeks the data at the ring head. Use pop() after the data was consumed.
+		///
+		/// \return Pointer to data available for reading and maximum data size to read. Or, `{nullptr, 0}` if quit() has been called.
+		///
+		std::tuple<T*, size_t> front()
+		{
+			size_t head = m_head.load(std::memory_order_relaxed);
+			size_t tail = m_tail.load(std::memory_order_acquire);
+			if (tail == head) {
+				wait(m_consumer_parked, m_tail_moved, [&] {
+					tail = m_tail.load(std::memory_order_acquire);
+					return tail != head;
+				});
+				tail = m_tail.load(std::memory_order_acquire);
+				if (tail == head) _Unlikely_
+					return { nullptr, 0 };
+			}
+			size_t idx = wrap(head);
+			return { &m_data[idx], std::min(tail - head, N_cap - idx) };
+		}
+
+		///
+		/// Notifies the sender the data was consumed.
+		///
+		/// \param[in] size  Amount of data that was really consumed
+		///
+		void pop(_In_ size_t size)
+		{
+			size_t head = m_head.load(std::memory_order_relaxed);
+#ifndef NDEBUG
+			size_t tail = m_tail.load(std::memory_order_acquire);
+			stdex_assert(size <= std::min(tail - head, N_cap - wrap(head)));
+#endif
+			m_head.store(head + size, std::memory_order_release);
+			notify(m_producer_parked, m_head_moved);
+		}
+
+		///
+		/// Cancells waiting sender and receiver
+		///
+		void quit()
+		{
+			m_quit.store(true);
+			{
+				const std::lock_guard<std::mutex> lg(m_mutex);
+			}
+			m_head_moved.notify_one();
+			m_tail_moved.notify_one();
+		}
+
+		///
+		/// Waits until the ring is flush
+		///
+		/// Must be called from the producer thread.
+		///
+		void sync()
+		{
+			size_t tail = m_tail.load(std::memory_order_relaxed);
+			wait(m_producer_parked, m_head_moved, [&] { return m_head.load(std::memory_order_acquire) == tail; });
+		}
+
+	protected:
+		size_t wrap(_In_ size_t idx) const
+		{
+			if constexpr ((N_cap & (N_cap - 1)) == 0)
+				return idx & (N_cap - 1);
+			else
+				return idx % N_cap;
+		}
+
+		///
+		/// Waits until the condition is met or quit() is called. Spins first, then parks.
+		///
+		template <class T_pred>
+		void wait(_Inout_ std::atomic<bool>& parked, _Inout_ std::condition_variable& cv, _In_ T_pred pred)
+		{
+			for (size_t i = 0; i < spin_count; ++i) {
+				if (pred() || m_quit.load(std::memory_order_relaxed))
+					return;
+				// Issue X86 PAUSE or ARM YIELD instruction to reduce contention between hyper-threads
+#if _M_ARM || _M_ARM64
+				__yield();
+#elif _M_IX86 || _M_X64
+				_mm_pause();
+#elif __aarch64__
+				asm volatile("yield");
+#elif __i386__ || __x86_64__
+				__builtin_ia32_pause();
+#endif
+			}
+			std::unique_lock<std::mutex> lk(m_mutex);
+			parked.store(true, std::memory_order_relaxed);
+			// Pairs with the fence in notify(): either we see the peer's index update, or the peer sees us parked.
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			cv.wait(lk, [&] { return m_quit.load() || pred(); });
+			parked.store(false, std::memory_order_relaxed);
+		}
+
+		///
+		/// Wakes the peer if it is parked
+		///
+		void notify(_Inout_ std::atomic<bool>& parked, _Inout_ std::condition_variable& cv)
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (parked.load(std::memory_order_relaxed)) {
+				{
+					// The peer is either waiting on cv already, or will re-check its condition after it releases the mutex.
+					const std::lock_guard<std::mutex> lg(m_mutex);
+				}
+				cv.notify_one();
+			}
+		}
+
+	protected:
+		static constexpr size_t spin_count = 0x100;
+#pragma warning(push)
+#pragma warning(disable: 4324) // Structure was padded due to alignment specifier
+		alignas(64) std::atomic<size_t> m_head; ///< Read index. Written by consumer only.
+		alignas(64) std::atomic<size_t> m_tail; ///< Write index. Written by producer only.
+		alignas(64) std::atomic<bool> m_quit;
+		std::atomic<bool> m_producer_parked, m_consumer_parked;
+		std::mutex m_mutex;
+		std::condition_variable m_head_moved, m_tail_moved;
+#pragma warning(pop)
+		T m_data[N_cap];
+	};
 }
 
 #if defined(__GNUC__)
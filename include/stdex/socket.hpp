@@ -12,7 +12,10 @@
 #include <WinSock2.h>
 #include <WS2tcpip.h>
 #else
+#include <fcntl.h>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
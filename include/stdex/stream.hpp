@@ -11,10 +11,12 @@
 #include "interval.hpp"
 #include "locale.hpp"
 #include "math.hpp"
+#include "reactor.hpp"
 #include "ring.hpp"
 #include "socket.hpp"
 #include "string.hpp"
 #include "unicode.hpp"
+#include "uring.hpp"
 #include <stdint.h>
 #include <stdlib.h>
 #if defined(_WIN32)
@@ -23,15 +25,31 @@
 #include <objidl.h>
 #else
 #include <fcntl.h>
+#include <limits.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#if __cpp_impl_coroutine >= 201902L
+#include <coroutine>
+#include <functional>
+#endif
+#include <iterator>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
@@ -64,6 +82,7 @@ namespace stdex
 			ok = 0,
 			eof,
 			fail,
+			wait, ///< Non-blocking stream is not ready. Retry when it is.
 		};
 
 		///
@@ -78,6 +97,136 @@ namespace stdex
 		constexpr utf32_t utf32_bom = U'\ufeff'; ///< Byte-order-mark written at each UTF-32 file start
 		constexpr const char utf8_bom[3] = { '\xef', '\xbb', '\xbf' }; ///> UTF-8 byte-order-mark
 
+		///
+		/// Data buffer descriptor for vectored reads
+		///
+		/// On POSIX, layout matches struct iovec.
+		///
+		struct iovec_t
+		{
+			void* data; ///< Buffer to store read data
+			size_t length; ///< Buffer size in bytes
+		};
+
+		///
+		/// Data buffer descriptor for vectored writes
+		///
+		/// On POSIX, layout matches struct iovec.
+		///
+		struct const_iovec_t
+		{
+			const void* data; ///< Buffer to write data from
+			size_t length; ///< Number of bytes to write
+		};
+
+#ifndef _WIN32
+		static_assert(sizeof(iovec_t) == sizeof(struct iovec) && offsetof(iovec_t, data) == offsetof(struct iovec, iov_base) && offsetof(iovec_t, length) == offsetof(struct iovec, iov_len), "iovec_t must match struct iovec");
+		static_assert(sizeof(const_iovec_t) == sizeof(struct iovec) && offsetof(const_iovec_t, data) == offsetof(struct iovec, iov_base) && offsetof(const_iovec_t, length) == offsetof(struct iovec, iov_len), "const_iovec_t must match struct iovec");
+#endif
+
+#if __cpp_impl_coroutine >= 201902L
+		class basic;
+
+		///
+		/// Asynchronous read or write request
+		///
+		struct async_request
+		{
+			enum class op_t {
+				read = 0,
+				write,
+			};
+			op_t op; ///< Operation
+			void* data; ///< Buffer to read data to or write data from
+			size_t length; ///< Number of bytes to read or write
+			size_t result; ///< Number of bytes read or written
+			std::coroutine_handle<> continuation; ///< Coroutine to resume on completion
+			basic* stream; ///< Stream to call read() or write() on. Converters forward requests to their source unchanged.
+		};
+
+		///
+		/// Worker threads completing asynchronous requests on blocking streams
+		///
+		class async_pool
+		{
+		public:
+			///
+			/// Starts worker threads
+			///
+			/// \param[in] num_threads  Number of worker threads
+			///
+			async_pool(_In_ size_t num_threads = std::max<size_t>(std::thread::hardware_concurrency(), 2)) :
+				m_quit(false)
+			{
+				m_workers.reserve(num_threads);
+				for (size_t i = 0; i < num_threads; ++i)
+					m_workers.push_back(std::thread(process, std::ref(*this)));
+			}
+
+			virtual ~async_pool()
+			{
+				{
+					const std::lock_guard<std::mutex> lk(m_mutex);
+					m_quit = true;
+				}
+				m_cv.notify_all();
+				for (auto& w : m_workers)
+					w.join();
+			}
+
+		private:
+			async_pool(_In_ const async_pool& other);
+			async_pool& operator =(_In_ const async_pool& other);
+
+		public:
+			///
+			/// Queues task to run on a worker thread
+			///
+			void post(_Inout_ std::function<void()>&& task)
+			{
+				{
+					const std::lock_guard<std::mutex> lk(m_mutex);
+					m_tasks.push_back(std::move(task));
+				}
+				m_cv.notify_one();
+			}
+
+			///
+			/// Returns default pool
+			///
+			static async_pool& instance()
+			{
+				static async_pool pool;
+				return pool;
+			}
+
+		protected:
+			static void process(_Inout_ async_pool& pool)
+			{
+				for (;;) {
+					std::function<void()> task;
+					{
+						std::unique_lock<std::mutex> lk(pool.m_mutex);
+						while (pool.m_tasks.empty() && !pool.m_quit)
+							pool.m_cv.wait(lk);
+						if (pool.m_tasks.empty())
+							return;
+						task = std::move(pool.m_tasks.front());
+						pool.m_tasks.pop_front();
+					}
+					task();
+				}
+			}
+
+		protected:
+			std::mutex m_mutex;
+			std::condition_variable m_cv;
+			std::list<std::function<void()>> m_tasks;
+			bool m_quit;
+			std::vector<std::thread> m_workers;
+		};
+#endif
+
 		///
 		/// Basic stream operations
 		///
@@ -126,6 +275,115 @@ namespace stdex
 				return 0;
 			}
 
+			///
+			/// Reads data into multiple buffers (scatter)
+			///
+			/// Buffers are filled in order. Buffer is filled completely before data is read into the next one.
+			///
+			/// \param[in] iov    Array of buffers to store read data
+			/// \param[in] count  Number of buffers in iov
+			///
+			/// \return Total number of bytes successfully read.
+			/// On EOF, 0 is returned and stream state is set to state_t::eof.
+			/// On error, 0 is returned and stream state is set to state_t::fail.
+			///
+			virtual size_t readv(_In_reads_(count) const iovec_t* iov, _In_ size_t count)
+			{
+				stdex_assert(iov || !count);
+				size_t total = 0;
+				for (size_t i = 0; i < count; ++i) {
+					size_t num_read = read_array(iov[i].data, sizeof(uint8_t), iov[i].length);
+					total += num_read;
+					if (num_read < iov[i].length) {
+						if (total)
+							m_state = state_t::ok;
+						return total;
+					}
+				}
+				m_state = state_t::ok;
+				return total;
+			}
+
+			///
+			/// Writes data from multiple buffers (gather)
+			///
+			/// \param[in] iov    Array of buffers to write data from
+			/// \param[in] count  Number of buffers in iov
+			///
+			/// \return Total number of bytes successfully written.
+			/// On error, stream state is set to state_t::fail.
+			///
+			virtual size_t writev(_In_reads_(count) const const_iovec_t* iov, _In_ size_t count)
+			{
+				stdex_assert(iov || !count);
+				size_t total = 0;
+				for (size_t i = 0; i < count; ++i) {
+					if (!iov[i].length)
+						continue;
+					size_t num_written = write(iov[i].data, iov[i].length);
+					total += num_written;
+					if (num_written < iov[i].length) _Unlikely_
+						return total;
+				}
+				m_state = state_t::ok;
+				return total;
+			}
+
+			///
+			/// Reads data available in stream's internal memory up to and including given delimiter
+			///
+			/// Streams keeping data in memory override this method to allow scanning data without copying it byte-by-byte.
+			///
+			/// \param[in]  delim   Delimiter byte
+			/// \param[out] data    Pointer to data in stream's internal memory. Valid until the next operation on the stream.
+			/// \param[out] length  Number of bytes available at data. Data ends either with delim or at the end of internal memory.
+			///
+			/// \return true if stream supports direct access; false otherwise and caller should use read() instead.
+			/// On EOF, length is set to 0 and stream state is set to state_t::eof.
+			/// On error, length is set to 0 and stream state is set to state_t::fail.
+			///
+			virtual bool read_until(_In_ uint8_t delim, _Outptr_result_bytebuffer_(length) const void*& data, _Out_ size_t& length)
+			{
+				_Unreferenced_(delim);
+				data = nullptr;
+				length = 0;
+				return false;
+			}
+
+			///
+			/// Returns data available in stream's internal memory without consuming it
+			///
+			/// Streams keeping data in memory override this method to allow parsing data in place. Call consume() to
+			/// advance past the data processed.
+			///
+			/// \param[in]  length     Number of bytes requested. More bytes may be returned. Fewer bytes are returned on EOF
+			///                        or when data is not contiguous in internal memory (buffer capacity, page boundary...).
+			/// \param[out] data       Pointer to data in stream's internal memory. Valid until the next operation on the stream.
+			/// \param[out] available  Number of bytes available at data
+			///
+			/// \return true if stream supports direct access; false otherwise and caller should use read() instead.
+			/// On EOF, available is set to 0 and stream state is set to state_t::eof.
+			/// On error, available is set to 0 and stream state is set to state_t::fail.
+			///
+			virtual bool peek(_In_ size_t length, _Outptr_result_bytebuffer_(available) const void*& data, _Out_ size_t& available)
+			{
+				_Unreferenced_(length);
+				data = nullptr;
+				available = 0;
+				return false;
+			}
+
+			///
+			/// Advances past data returned by peek()
+			///
+			/// \param[in] length  Number of bytes to consume. Must not exceed available bytes returned by the last peek().
+			///
+			virtual void consume(_In_ size_t length)
+			{
+				_Unreferenced_(length);
+				throw std::domain_error("not implemented");
+			}
+
 			///
 			/// Persists volatile element data
 			///
@@ -303,6 +561,64 @@ namespace stdex
 				return *this;
 			}
 
+			///
+			/// Reads an array of primitive data type
+			///
+			/// Reads all elements with a single read and converts them from little-endian in place.
+			/// Like read_data(T&), the method skips reading if stream state is not ok.
+			///
+			/// \param[out] data   Where to store read data
+			/// \param[in]  count  Number of elements to read
+			///
+			/// \returns This stream. On EOF, elements not read are zeroed and stream state is set to state_t::eof.
+			///
+			template <class T>
+			basic& read_data(_Out_writes_(count) T* data, _In_ size_t count)
+			{
+				size_t num_read = ok() && count ? read_array(data, sizeof(T), count) : 0;
+#if BYTE_ORDER == BIG_ENDIAN
+				stdex::byteswap(data, num_read);
+#endif
+				if (num_read < count) _Unlikely_ {
+					memset(data + num_read, 0, (count - num_read) * sizeof(T));
+					if (ok())
+						m_state = state_t::eof;
+				}
+				return *this;
+			}
+
+			///
+			/// Writes an array of primitive data type
+			///
+			/// Writes all elements with a single write. On big-endian platforms, elements are converted to little-endian
+			/// in blocks.
+			/// Like write_data(T), the method skips writing if stream state is not ok.
+			///
+			/// \param[in] data   Data to write
+			/// \param[in] count  Number of elements to write
+			///
+			/// \return This stream
+			///
+			template <class T>
+			basic& write_data(_In_reads_(count) const T* data, _In_ size_t count)
+			{
+				if (!ok() || !count) _Unlikely_
+					return *this;
+#if BYTE_ORDER == BIG_ENDIAN
+				T data_le[default_block_size / 0x10 / sizeof(T)];
+				for (size_t offset = 0; offset < count && ok();) {
+					size_t n = std::min(count - offset, _countof(data_le));
+					memcpy(data_le, data + offset, n * sizeof(T));
+					stdex::byteswap(data_le, n);
+					write(data_le, n * sizeof(T));
+					offset += n;
+				}
+#else
+				write(data, mul(sizeof(T), count));
+#endif
+				return *this;
+			}
+
 			///
 			/// Reads stream to the end-of-line or end-of-file.
 			///
@@ -339,6 +655,27 @@ namespace stdex
 			template<class T, class TR = std::char_traits<T>, class AX = std::allocator<T>>
 			size_t readln_and_attach(_Inout_ std::basic_string<T, TR, AX>& str)
 			{
+				if constexpr (sizeof(T) == sizeof(uint8_t)) {
+					const void* data;
+					size_t length;
+					if (read_until(static_cast<uint8_t>('\n'), data, length)) {
+						// Stream provides direct access to its data. Append whole runs of characters.
+						size_t initial_size = str.size();
+						for (;;) {
+							if (!length)
+								return str.size();
+							auto chars = reinterpret_cast<const T*>(data);
+							if (chars[length - 1] == static_cast<T>('\n')) {
+								str.append(chars, length - 1);
+								if (str.size() > initial_size && str.back() == static_cast<T>('\r'))
+									str.pop_back();
+								return str.size();
+							}
+							str.append(chars, length);
+							read_until(static_cast<uint8_t>('\n'), data, length);
+						}
+					}
+				}
 				bool initial = true;
 				T chr = static_cast<T>(0), previous = static_cast<T>(0);
 				do {
@@ -555,9 +892,12 @@ namespace stdex
 			///
 			/// Writes content of another stream
 			///
+			/// \param[in,out] stream  Source stream
+			/// \param[in]     amount  Maximum number of bytes to copy
+			///
 			/// \return Number of bytes written
 			///
-			fsize_t write_stream(_Inout_ basic& stream, _In_ fsize_t amount = fsize_max)
+			virtual fsize_t write_stream(_Inout_ basic& stream, _In_ fsize_t amount = fsize_max)
 			{
 				std::unique_ptr<uint8_t[]> data(new uint8_t[static_cast<size_t>(std::min<fsize_t>(amount, default_block_size))]);
 				fsize_t num_copied = 0, to_write = amount;
@@ -686,8 +1026,12 @@ namespace stdex
 				if (num > UINT32_MAX) _Unlikely_
 					throw std::invalid_argument("collection too big");
 				*this << static_cast<uint32_t>(num);
-				for (auto& el : data)
-					*this << el;
+				if constexpr (std::is_arithmetic<T>::value && !std::is_same<T, bool>::value)
+					write_data(data.data(), num);
+				else {
+					for (auto& el : data)
+						*this << el;
+				}
 				return *this;
 			}
 
@@ -699,14 +1043,27 @@ namespace stdex
 				*this >> num;
 				if (!ok()) _Unlikely_
 					return *this;
-				data.reserve(num);
-				for (uint32_t i = 0; i < num; ++i) {
-					T el;
-					*this >> el;
-					if (!ok()) _Unlikely_
-						return *this;
-					data.push_back(std::move(el));
+				if constexpr (std::is_arithmetic<T>::value && !std::is_same<T, bool>::value) {
+					data.resize(num);
+					size_t num_read = num ? read_array(data.data(), sizeof(T), num) : 0;
+#if BYTE_ORDER == BIG_ENDIAN
+					stdex::byteswap(data.data(), num_read);
+#endif
+					data.resize(num_read);
+					if (num_read < num && ok()) _Unlikely_
+						m_state = state_t::eof;
+				}
+				else {
+					data.reserve(num);
+					for (uint32_t i = 0; i < num; ++i) {
+						T el;
+						*this >> el;
+						if (!ok()) _Unlikely_
+							return *this;
+						data.push_back(std::move(el));
+					}
 				}
+				return *this;
 			}
 
 			template <class KEY, class PR = std::less<KEY>, class AX = std::allocator<KEY>>
@@ -768,101 +1125,377 @@ namespace stdex
 				return *this;
 			}
 
-		protected:
-			state_t m_state;
-		};
-
-		///
-		/// Absolute file position
-		///
-		using fpos_t = uint64_t;
-		constexpr fpos_t fpos_max = UINT64_MAX;
-		constexpr fpos_t fpos_min = 0;
+#if __cpp_impl_coroutine >= 201902L
+			///
+			/// Awaitable read or write operation
+			///
+			/// Resumes awaiting coroutine with number of bytes read or written. Check stream state after resumption.
+			///
+			class awaitable
+			{
+			public:
+				awaitable(_Inout_ basic& stream, _In_ async_request::op_t op, _In_opt_ void* data, _In_ size_t length) :
+					m_stream(stream),
+					m_req{ op, data, length, 0, nullptr, &stream }
+				{}
 
-		///
-		/// Relative file position
-		///
-		using foff_t = int64_t;
-		constexpr foff_t foff_max = INT64_MAX;
-		constexpr foff_t foff_min = INT64_MIN;
+				bool await_ready() const noexcept { return false; }
 
-		///
-		/// Seek anchor
-		///
-		enum class seek_t {
-#ifdef _WIN32
-			beg = FILE_BEGIN,
-			cur = FILE_CURRENT,
-			end = FILE_END
-#else
-			beg = SEEK_SET,
-			cur = SEEK_CUR,
-			end = SEEK_END
-#endif
-		};
+				bool await_suspend(_In_ std::coroutine_handle<> continuation)
+				{
+					m_req.continuation = continuation;
+					return !m_stream.async_submit(m_req);
+				}
 
-#if _HAS_CXX20
-		using clock = std::chrono::file_clock;
-#else
-		using clock = std::chrono::system_clock;
-#endif
-		using time_point = std::chrono::time_point<clock>;
+				size_t await_resume() const noexcept { return m_req.result; }
 
-		///
-		/// Basic seekable stream operations
-		///
-		class basic_file : virtual public basic
-		{
-		public:
-			virtual std::vector<uint8_t> read_remainder(_In_ size_t max_length = SIZE_MAX)
-			{
-				size_t length = std::min<size_t>(max_length, static_cast<size_t>(size() - tell()));
-				std::vector<uint8_t> result;
-				try { result.resize(length); }
-				catch (const std::bad_alloc&) {
-					m_state = state_t::fail;
-					return result;
-				}
-				result.resize(read_array(result.data(), sizeof(uint8_t), length));
-				return result;
-			}
+			protected:
+				basic& m_stream;
+				async_request m_req;
+			};
 
 			///
-			/// Seeks to specified relative file position
-			///
-			/// \return Absolute file position after seek, or fpos_max if seek failed.
+			/// Reads block of data from the stream asynchronously
 			///
-			virtual fpos_t seek(_In_ foff_t offset, _In_ seek_t how = seek_t::beg) = 0;
-
+			/// Stream must not be used for other operations until the returned awaitable completes. The coroutine may
+			/// resume on another thread.
 			///
-			/// Seeks to absolute file position
+			/// \param[out] data    Buffer to store read data. Must remain valid until completion.
+			/// \param[in]  length  Byte limit of data to read
 			///
-			/// \return Absolute file position after seek
+			/// \return Awaitable resulting in number of bytes read. Non-blocking streams may read fewer bytes than
+			/// requested before EOF.
+			/// On EOF, 0 is returned and stream state is set to state_t::eof.
+			/// On error, 0 is returned and stream state is set to state_t::fail.
 			///
-			fpos_t seekbeg(_In_ fpos_t offset)
+			awaitable async_read(_Out_writes_bytes_(length) void* data, _In_ size_t length)
 			{
-				return seek(static_cast<foff_t>(offset), seek_t::beg);
+				return awaitable(*this, async_request::op_t::read, data, length);
 			}
 
 			///
-			/// Seeks to relative from current file position
-			///
-			/// \return Absolute file position after seek
+			/// Writes block of data to the stream asynchronously
 			///
-			fpos_t seekcur(_In_ foff_t offset) { return seek(offset, seek_t::cur); }
-
+			/// Stream must not be used for other operations until the returned awaitable completes. The coroutine may
+			/// resume on another thread.
 			///
-			/// Seeks to relative from end file position
+			/// \param[in] data    Buffer to write data from. Must remain valid until completion.
+			/// \param[in] length  Number of bytes to write
 			///
-			/// \return Absolute file position after seek
+			/// \return Awaitable resulting in number of bytes written. On error, stream state is set to state_t::fail.
 			///
-			fpos_t seekend(_In_ foff_t offset) { return seek(offset, seek_t::end); }
-
-			virtual void skip(_In_ fsize_t amount)
+			awaitable async_write(_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
 			{
-				if (amount > foff_max)
-					throw std::invalid_argument("file offset too big");
-				seek(static_cast<foff_t>(amount), seek_t::cur);
+				return awaitable(*this, async_request::op_t::write, const_cast<void*>(data), length);
+			}
+
+			///
+			/// Starts asynchronous request
+			///
+			/// Default implementation performs blocking read() or write() of req.stream on async_pool worker thread. Streams
+			/// able to complete requests without blocking override this method. Requests forwarded by converters must be
+			/// completed by calling req.stream's read() or write(), not by accessing own data directly.
+			///
+			/// \param[in,out] req  Request. Must remain valid until completion.
+			///
+			/// \return true if request completed synchronously and continuation should not be resumed; false if
+			/// continuation will be resumed on completion
+			///
+			virtual bool async_submit(_Inout_ async_request& req)
+			{
+				async_pool::instance().post([&req] {
+					req.result = req.op == async_request::op_t::read ?
+						req.stream->read(req.data, req.length) :
+						req.stream->write(req.data, req.length);
+					req.continuation.resume();
+				});
+				return false;
+			}
+#endif
+
+		protected:
+			state_t m_state;
+		};
+
+		///
+		/// Input iterator reading stream line by line
+		///
+		/// Lines are returned without the trailing end-of-line. When the stream provides direct access to its data
+		/// (see basic::read_until()), lines are referenced in stream's internal memory and no copying is done unless
+		/// a line crosses the internal memory boundary. Line is valid until the iterator is advanced.
+		///
+		template<class T = char, class TR = std::char_traits<T>, class AX = std::allocator<T>>
+		class line_iterator
+		{
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = std::basic_string_view<T, TR>;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const value_type*;
+			using reference = const value_type&;
+
+			///
+			/// Constructs end-of-stream iterator
+			///
+			line_iterator() : m_source(nullptr) {}
+
+			///
+			/// Constructs iterator and reads the first line
+			///
+			/// \param[in] source  Stream to read lines from
+			///
+			line_iterator(_Inout_ basic& source) : m_source(&source) { next(); }
+
+			reference operator*() const { return m_line; }
+			pointer operator->() const { return &m_line; }
+
+			line_iterator& operator++()
+			{
+				next();
+				return *this;
+			}
+
+			bool operator==(_In_ const line_iterator& other) const { return m_source == other.m_source; }
+			bool operator!=(_In_ const line_iterator& other) const { return m_source != other.m_source; }
+
+		protected:
+			void next()
+			{
+				if (!m_source) _Unlikely_
+					return;
+				if constexpr (sizeof(T) == sizeof(uint8_t)) {
+					const void* data;
+					size_t length;
+					if (m_source->read_until(static_cast<uint8_t>('\n'), data, length)) {
+						if (!length) {
+							m_source = nullptr;
+							return;
+						}
+						auto chars = reinterpret_cast<const T*>(data);
+						if (chars[length - 1] == static_cast<T>('\n')) {
+							// Complete line in stream's memory.
+							length--;
+							if (length && chars[length - 1] == static_cast<T>('\r'))
+								length--;
+							m_line = value_type(chars, length);
+							return;
+						}
+						// Line continues past stream's memory boundary. Collect it in the buffer.
+						m_buffer.assign(chars, length);
+						for (;;) {
+							m_source->read_until(static_cast<uint8_t>('\n'), data, length);
+							if (!length)
+								break;
+							chars = reinterpret_cast<const T*>(data);
+							if (chars[length - 1] == static_cast<T>('\n')) {
+								m_buffer.append(chars, length - 1);
+								if (m_buffer.back() == static_cast<T>('\r'))
+									m_buffer.pop_back();
+								break;
+							}
+							m_buffer.append(chars, length);
+						}
+						m_line = m_buffer;
+						return;
+					}
+				}
+				m_buffer.clear();
+				m_source->readln_and_attach(m_buffer);
+				if (m_buffer.empty() && !m_source->ok()) {
+					m_source = nullptr;
+					return;
+				}
+				m_line = m_buffer;
+			}
+
+			basic* m_source;
+			value_type m_line;
+			std::basic_string<T, TR, AX> m_buffer;
+		};
+
+		///
+		/// Range of stream lines for use in range-based for loops
+		///
+		template<class T = char, class TR = std::char_traits<T>, class AX = std::allocator<T>>
+		class lines
+		{
+		public:
+			lines(_Inout_ basic& source) : m_source(source) {}
+
+			line_iterator<T, TR, AX> begin() { return line_iterator<T, TR, AX>(m_source); }
+			line_iterator<T, TR, AX> end() { return line_iterator<T, TR, AX>(); }
+
+		protected:
+			basic& m_source;
+		};
+
+		///
+		/// Absolute file position
+		///
+		using fpos_t = uint64_t;
+		constexpr fpos_t fpos_max = UINT64_MAX;
+		constexpr fpos_t fpos_min = 0;
+
+		///
+		/// Relative file position
+		///
+		using foff_t = int64_t;
+		constexpr foff_t foff_max = INT64_MAX;
+		constexpr foff_t foff_min = INT64_MIN;
+
+		///
+		/// Seek anchor
+		///
+		enum class seek_t {
+#ifdef _WIN32
+			beg = FILE_BEGIN,
+			cur = FILE_CURRENT,
+			end = FILE_END
+#else
+			beg = SEEK_SET,
+			cur = SEEK_CUR,
+			end = SEEK_END
+#endif
+		};
+
+		///
+		/// File access hint
+		///
+		enum class access_hint_t {
+			normal = 0, ///< No special treatment
+			sequential, ///< Data will be accessed sequentially: read ahead aggressively
+			random,     ///< Data will be accessed randomly: do not read ahead
+			willneed,   ///< Data will be accessed soon: start reading it into OS cache
+			dontneed,   ///< Data will not be accessed soon: drop it from OS cache
+		};
+
+#if _HAS_CXX20
+		using clock = std::chrono::file_clock;
+#else
+		using clock = std::chrono::system_clock;
+#endif
+		using time_point = std::chrono::time_point<clock>;
+
+		///
+		/// Basic seekable stream operations
+		///
+		class basic_file : virtual public basic
+		{
+		public:
+			virtual std::vector<uint8_t> read_remainder(_In_ size_t max_length = SIZE_MAX)
+			{
+				size_t length = std::min<size_t>(max_length, static_cast<size_t>(size() - tell()));
+				std::vector<uint8_t> result;
+				try { result.resize(length); }
+				catch (const std::bad_alloc&) {
+					m_state = state_t::fail;
+					return result;
+				}
+				result.resize(read_array(result.data(), sizeof(uint8_t), length));
+				return result;
+			}
+
+			///
+			/// Seeks to specified relative file position
+			///
+			/// \return Absolute file position after seek, or fpos_max if seek failed.
+			///
+			virtual fpos_t seek(_In_ foff_t offset, _In_ seek_t how = seek_t::beg) = 0;
+
+			///
+			/// Seeks to absolute file position
+			///
+			/// \return Absolute file position after seek
+			///
+			fpos_t seekbeg(_In_ fpos_t offset)
+			{
+				return seek(static_cast<foff_t>(offset), seek_t::beg);
+			}
+
+			///
+			/// Seeks to relative from current file position
+			///
+			/// \return Absolute file position after seek
+			///
+			fpos_t seekcur(_In_ foff_t offset) { return seek(offset, seek_t::cur); }
+
+			///
+			/// Seeks to relative from end file position
+			///
+			/// \return Absolute file position after seek
+			///
+			fpos_t seekend(_In_ foff_t offset) { return seek(offset, seek_t::end); }
+
+			virtual void skip(_In_ fsize_t amount)
+			{
+				if (amount > foff_max)
+					throw std::invalid_argument("file offset too big");
+				seek(static_cast<foff_t>(amount), seek_t::cur);
+			}
+
+			///
+			/// Reads block of data from given file position without moving the file pointer
+			///
+			/// Neither file position nor stream state are updated. Descendants implementing this method natively
+			/// allow concurrent calls. Default implementation seeks and reads, and is not safe for concurrent use.
+			///
+			/// \param[in]  offset  Absolute file position to read from
+			/// \param[out] data    Buffer to store read data
+			/// \param[in]  length  Byte limit of data to read
+			/// \param[out] state   Operation state: state_t::ok when any data was read or length == 0; state_t::eof when
+			///                     offset is at or past the end of file; state_t::fail on error.
+			///
+			/// \return Number of bytes successfully read. Less than length is returned only on EOF or error.
+			///
+			virtual _Success_(return != 0 || length == 0) size_t read_at(
+				_In_ fpos_t offset, _Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length,
+				_Out_opt_ state_t* state = nullptr)
+			{
+				stdex_assert(data || !length);
+				state_t state_orig = m_state;
+				fpos_t pos = tell();
+				if (pos == fpos_max || seekbeg(offset) == fpos_max) _Unlikely_ {
+					m_state = state_orig;
+					if (state) *state = state_t::fail;
+					return 0;
+				}
+				size_t num_read = read_array(data, sizeof(uint8_t), length);
+				if (state) *state = num_read ? state_t::ok : m_state;
+				seekbeg(pos);
+				m_state = state_orig;
+				return num_read;
+			}
+
+			///
+			/// Writes block of data to given file position without moving the file pointer
+			///
+			/// Neither file position nor stream state are updated. Descendants implementing this method natively
+			/// allow concurrent calls. Default implementation seeks and writes, and is not safe for concurrent use.
+			///
+			/// \param[in]  offset  Absolute file position to write to
+			/// \param[in]  data    Buffer to write data from
+			/// \param[in]  length  Number of bytes to write
+			/// \param[out] state   Operation state: state_t::ok on success; state_t::fail on error.
+			///
+			/// \return Number of bytes successfully written.
+			///
+			virtual _Success_(return != 0) size_t write_at(
+				_In_ fpos_t offset, _In_reads_bytes_opt_(length) const void* data, _In_ size_t length,
+				_Out_opt_ state_t* state = nullptr)
+			{
+				stdex_assert(data || !length);
+				state_t state_orig = m_state;
+				fpos_t pos = tell();
+				if (pos == fpos_max || seekbeg(offset) == fpos_max) _Unlikely_ {
+					m_state = state_orig;
+					if (state) *state = state_t::fail;
+					return 0;
+				}
+				size_t num_written = write(data, length);
+				if (state) *state = m_state;
+				seekbeg(pos);
+				m_state = state_orig;
+				return num_written;
 			}
 
 			///
@@ -893,6 +1526,33 @@ namespace stdex
 				throw std::domain_error("not implemented");
 			}
 
+			///
+			/// Advises how file section will be accessed
+			///
+			/// Hints are best-effort: they neither fail nor update stream state. Default implementation ignores them.
+			///
+			/// \param[in] hint    Access hint
+			/// \param[in] offset  Absolute file position of the section
+			/// \param[in] length  Length of the section. fsize_max extends it to the end of file.
+			///
+			virtual void advise(_In_ access_hint_t hint, _In_ fpos_t offset = 0, _In_ fsize_t length = fsize_max)
+			{
+				_Unreferenced_(hint);
+				_Unreferenced_(offset);
+				_Unreferenced_(length);
+			}
+
+			///
+			/// Requests file section to be read into OS cache in the background
+			///
+			/// \param[in] offset  Absolute file position of the section
+			/// \param[in] length  Length of the section
+			///
+			virtual void prefetch(_In_ fpos_t offset, _In_ fsize_t length)
+			{
+				advise(access_hint_t::willneed, offset, length);
+			}
+
 			///
 			/// Returns file size
 			/// Should the file size cannot be determined, the method returns fsize_max and it does not reset the state to failed.
@@ -1074,6 +1734,19 @@ namespace stdex
 				m_state = m_source->state();
 			}
 
+#if __cpp_impl_coroutine >= 201902L
+			///
+			/// Forwards asynchronous request to the source
+			///
+			/// Source completes it by calling our read() or write(). This way, non-blocking sockets with a reactor
+			/// complete requests on converters when socket is ready, without blocking a worker thread.
+			///
+			virtual bool async_submit(_Inout_ async_request& req)
+			{
+				return m_source->async_submit(req);
+			}
+#endif
+
 		protected:
 			basic* m_source;
 		};
@@ -1081,9 +1754,24 @@ namespace stdex
 		///
 		/// Replicates writing of the same data to multiple streams
 		///
+		/// In synchronous mode (default), write() waits for all streams to complete writing.
+		/// In pipelined mode, write() copies data to a bounded queue shared by all streams and returns immediately. Each
+		/// stream writes the queued data at its own pace and write() blocks only when the queue is full. Write errors
+		/// are reported on flush() or close().
+		///
 		class replicator : public basic
 		{
 		public:
+			///
+			/// Constructs replicator
+			///
+			/// \param[in] queue_limit  Maximum number of bytes queued for writing in pipelined mode. 0 for synchronous mode.
+			///
+			replicator(_In_ size_t queue_limit = 0) :
+				m_queue_limit(queue_limit),
+				m_queued(0)
+			{}
+
 			virtual ~replicator()
 			{
 				for (auto w = m_workers.begin(), w_end = m_workers.end(); w != w_end; ++w) {
@@ -1103,12 +1791,14 @@ namespace stdex
 			///
 			void push_back(_In_ basic* source)
 			{
-				m_workers.push_back(std::unique_ptr<worker>(new worker(source)));
+				m_workers.push_back(std::unique_ptr<worker>(new worker(this, source)));
 			}
 
 			///
 			/// Removes stream from the list.
 			///
+			/// In pipelined mode, data queued for the stream is written before the stream is removed.
+			///
 			void remove(basic* source)
 			{
 				for (auto w = m_workers.begin(), w_end = m_workers.end(); w != w_end; ++w) {
@@ -1126,9 +1816,54 @@ namespace stdex
 				}
 			}
 
+			///
+			/// Returns state of the stream after the last write(), flush() or close()
+			///
+			/// In pipelined mode, a write error is reported by the following flush() or close().
+			///
+			/// \param[in] source  Stream
+			///
+			/// \return Stream state or state_t::fail if stream is not on the list.
+			///
+			state_t sink_state(_In_ const basic* source)
+			{
+				for (auto w = m_workers.begin(), w_end = m_workers.end(); w != w_end; ++w) {
+					auto _w = w->get();
+					if (_w->source == source) {
+						const std::lock_guard<std::mutex> lk(_w->mutex);
+						return _w->result;
+					}
+				}
+				return state_t::fail;
+			}
+
 			virtual _Success_(return != 0) size_t write(
 				_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
 			{
+				if (m_queue_limit) {
+					if (m_workers.empty()) _Unlikely_ {
+						m_state = state_t::ok;
+						return length;
+					}
+					auto c = new chunk(data, length, m_workers.size());
+					{
+						std::unique_lock<std::mutex> lk(m_queue_mutex);
+						// Always allow a single chunk exceeding the limit to prevent a deadlock.
+						m_queue_cv.wait(lk, [&] {return !m_queued || m_queued + length <= m_queue_limit; });
+						m_queued += length;
+					}
+					for (auto w = m_workers.begin(), w_end = m_workers.end(); w != w_end; ++w) {
+						auto _w = w->get();
+						{
+							const std::lock_guard<std::mutex> lk(_w->mutex);
+							_w->queue.push_back(c);
+						}
+						_w->cv.notify_one();
+					}
+					m_state = state_t::ok;
+					return length;
+				}
+
 				for (auto w = m_workers.begin(), w_end = m_workers.end(); w != w_end; ++w) {
 					auto _w = w->get();
 					{
@@ -1147,8 +1882,8 @@ namespace stdex
 					_w->cv.wait(lk, [&] {return _w->op == worker::op_t::noop; });
 					if (_w->num_written < num_written)
 						num_written = _w->num_written;
-					if (ok() && !_w->source->ok())
-						m_state = _w->source->state();
+					if (ok() && _w->result != state_t::ok)
+						m_state = _w->result;
 				}
 				return num_written;
 			}
@@ -1164,15 +1899,37 @@ namespace stdex
 			}
 
 		protected:
+			///
+			/// Data queued for writing in pipelined mode. Shared by all workers.
+			///
+			struct chunk
+			{
+				std::unique_ptr<uint8_t[]> data;
+				size_t length;
+				std::atomic<size_t> refs; ///< Number of workers that have not written this chunk yet
+
+				chunk(_In_reads_bytes_opt_(_length) const void* _data, _In_ size_t _length, _In_ size_t _refs) :
+					data(_length ? new uint8_t[_length] : nullptr),
+					length(_length),
+					refs(_refs)
+				{
+					if (_length)
+						memcpy(data.get(), _data, _length);
+				}
+			};
+
 			class worker : public std::thread
 			{
 			public:
-				worker(_In_ basic* _source) :
+				worker(_In_ replicator* _owner, _In_ basic* _source) :
+					owner(_owner),
 					source(_source),
 					op(op_t::noop),
 					data(nullptr),
 					length(0),
-					num_written(0)
+					num_written(0),
+					result(state_t::ok),
+					error(state_t::ok)
 				{
 					*static_cast<std::thread*>(this) = std::thread([](_Inout_ worker& w) { w.process_op(); }, std::ref(*this));
 				}
@@ -1182,18 +1939,41 @@ namespace stdex
 				{
 					for (;;) {
 						std::unique_lock<std::mutex> lk(mutex);
-						cv.wait(lk, [&] {return op != op_t::noop; });
+						cv.wait(lk, [&] {return op != op_t::noop || !queue.empty(); });
+						if (!queue.empty()) {
+							// Queued data is written before any pending operation.
+							chunk* c = queue.front();
+							queue.pop_front();
+							lk.unlock();
+							if (error == state_t::ok) {
+								// After an error, discard queued data until the error is reported.
+								source->write(c->data.get(), c->length);
+								if (!source->ok()) _Unlikely_
+									error = source->state();
+							}
+							owner->release(c);
+							continue;
+						}
 						switch (op) {
 						case op_t::quit:
 							return;
 						case op_t::write:
 							num_written = source->write(data, length);
+							result = source->state();
 							break;
 						case op_t::close:
 							source->close();
+							result = error != state_t::ok ? error : source->state();
+							error = state_t::ok;
 							break;
 						case op_t::flush:
-							source->flush();
+							if (error == state_t::ok) {
+								source->flush();
+								result = source->state();
+							}
+							else
+								result = error;
+							error = state_t::ok;
 							break;
 						case op_t::noop:;
 						}
@@ -1204,6 +1984,7 @@ namespace stdex
 				}
 
 			public:
+				replicator* owner;
 				basic* source;
 				enum class op_t {
 					noop = 0,
@@ -1215,6 +1996,9 @@ namespace stdex
 				const void* data; ///< Data to write
 				size_t length; ///< Byte limit of data to write
 				size_t num_written; ///< Number of bytes written
+				state_t result; ///< Stream state after last operation
+				state_t error; ///< First write error in pipelined mode not reported yet
+				std::list<chunk*> queue; ///< Data queued for writing in pipelined mode
 				std::mutex mutex;
 				std::condition_variable cv;
 			};
@@ -1235,11 +2019,30 @@ namespace stdex
 					std::unique_lock<std::mutex> lk(_w->mutex);
 					_w->cv.wait(lk, [&] {return _w->op == worker::op_t::noop; });
 					if (ok())
-						m_state = _w->source->state();
+						m_state = _w->result;
 				}
 			}
 
-			std::list<std::unique_ptr<worker>> m_workers;
+			///
+			/// Releases worker's reference to the chunk
+			///
+			void release(_In_ chunk* c)
+			{
+				if (--c->refs)
+					return;
+				{
+					const std::lock_guard<std::mutex> lk(m_queue_mutex);
+					m_queued -= c->length;
+				}
+				m_queue_cv.notify_one();
+				delete c;
+			}
+
+			size_t m_queue_limit; ///< Maximum number of bytes queued in pipelined mode
+			size_t m_queued; ///< Number of bytes queued in pipelined mode
+			std::mutex m_queue_mutex;
+			std::condition_variable m_queue_cv;
+			std::list<std::unique_ptr<worker>> m_workers;
 		};
 
 		constexpr size_t default_async_limit = 0x100000; ///< Default queue limit for readahead/writeback (in bytes)
@@ -1255,6 +2058,7 @@ namespace stdex
 		public:
 			async_reader(_Inout_ basic& source) :
 				converter(source),
+				m_file(dynamic_cast<basic_file*>(&source)),
 				m_worker([](_Inout_ async_reader& w) { w.process(); }, std::ref(*this))
 			{}
 
@@ -1292,13 +2096,23 @@ namespace stdex
 		protected:
 			void process()
 			{
+				// Source is read sequentially. When it is a file, advise OS and keep it reading ahead of us.
+				fpos_t offset = m_file ? m_file->tell() : fpos_max, prefetched = offset;
+				if (offset != fpos_max)
+					m_file->advise(access_hint_t::sequential, offset);
 				for (;;) {
 					uint8_t* ptr; size_t num_write;
 					std::tie(ptr, num_write) = m_ring.back();
 					if (!ptr) _Unlikely_
 						break;
+					if (offset != fpos_max && prefetched < offset + N_cap) {
+						m_file->prefetch(prefetched, offset + 2 * N_cap - prefetched);
+						prefetched = offset + 2 * N_cap;
+					}
 					num_write = m_source->read(ptr, num_write);
 					m_ring.push(num_write);
+					if (offset != fpos_max)
+						offset += num_write;
 					if (!m_source->ok()) {
 						m_ring.quit();
 						break;
@@ -1307,7 +2121,8 @@ namespace stdex
 			}
 
 		protected:
-			ring<uint8_t, N_cap> m_ring;
+			basic_file* m_file; ///< Source as a file, or nullptr if source is not a file
+			spsc_ring<uint8_t, N_cap> m_ring;
 			std::thread m_worker;
 		};
 
@@ -1379,7 +2194,7 @@ namespace stdex
 			}
 
 		protected:
-			ring<uint8_t, N_cap> m_ring;
+			spsc_ring<uint8_t, N_cap> m_ring;
 			std::thread m_worker;
 		};
 
@@ -1455,6 +2270,95 @@ namespace stdex
 				}
 			}
 
+			virtual bool read_until(_In_ uint8_t delim, _Outptr_result_bytebuffer_(length) const void*& data, _Out_ size_t& length)
+			{
+				if (!m_read_buffer.capacity) _Unlikely_ {
+					data = nullptr;
+					length = 0;
+					return false;
+				}
+				if (m_read_buffer.head >= m_read_buffer.tail) {
+					m_read_buffer.head = 0;
+					m_read_buffer.tail = m_source->read(m_read_buffer.data, m_read_buffer.capacity);
+					if (!m_read_buffer.tail) {
+						data = m_read_buffer.data;
+						length = 0;
+						m_state = m_source->state();
+						return true;
+					}
+				}
+				data = m_read_buffer.data + m_read_buffer.head;
+				size_t available = m_read_buffer.tail - m_read_buffer.head;
+				auto end = reinterpret_cast<const uint8_t*>(memchr(data, delim, available));
+				length = end ? static_cast<size_t>(end - reinterpret_cast<const uint8_t*>(data)) + 1 : available;
+				m_read_buffer.head += length;
+				m_state = state_t::ok;
+				return true;
+			}
+
+			virtual bool peek(_In_ size_t length, _Outptr_result_bytebuffer_(available) const void*& data, _Out_ size_t& available)
+			{
+				if (!m_read_buffer.capacity) _Unlikely_ {
+					data = nullptr;
+					available = 0;
+					return false;
+				}
+				if (length > m_read_buffer.capacity)
+					length = m_read_buffer.capacity;
+				if (m_read_buffer.tail - m_read_buffer.head < length) {
+					if (m_read_buffer.head) {
+						// Move remaining data to the front to make room.
+						memmove(m_read_buffer.data, m_read_buffer.data + m_read_buffer.head, m_read_buffer.tail - m_read_buffer.head);
+						m_read_buffer.tail -= m_read_buffer.head;
+						m_read_buffer.head = 0;
+					}
+					while (m_read_buffer.tail < length) {
+						size_t num_read = m_source->read(m_read_buffer.data + m_read_buffer.tail, m_read_buffer.capacity - m_read_buffer.tail);
+						m_read_buffer.tail += num_read;
+						if (!num_read || !m_source->ok())
+							break; // Stop when source makes no progress, as non-blocking sockets do.
+					}
+				}
+				data = m_read_buffer.data + m_read_buffer.head;
+				available = m_read_buffer.tail - m_read_buffer.head;
+				m_state = available || !length ? state_t::ok : m_source->state();
+				return true;
+			}
+
+			virtual void consume(_In_ size_t length)
+			{
+				stdex_assert(length <= m_read_buffer.tail - m_read_buffer.head);
+				m_read_buffer.head += length;
+				m_state = state_t::ok;
+			}
+
+#if __cpp_impl_coroutine >= 201902L
+			virtual bool async_submit(_Inout_ async_request& req)
+			{
+				// Serve requests from buffers in place. Only go to the source when it must be accessed.
+				if (req.stream != this)
+					; // Forwarded by a converter reading or writing through us
+				else if (req.op == async_request::op_t::read) {
+					size_t available = m_read_buffer.tail - m_read_buffer.head;
+					if (available && req.length) {
+						req.result = std::min(available, req.length);
+						memcpy(req.data, m_read_buffer.data + m_read_buffer.head, req.result);
+						m_read_buffer.head += req.result;
+						m_state = state_t::ok;
+						return true;
+					}
+				}
+				else if (req.length && req.length <= m_write_buffer.capacity - m_write_buffer.tail) {
+					memcpy(m_write_buffer.data + m_write_buffer.tail, req.data, req.length);
+					m_write_buffer.tail += req.length;
+					req.result = req.length;
+					m_state = state_t::ok;
+					return true;
+				}
+				return converter::async_submit(req);
+			}
+#endif
+
 			virtual _Success_(return != 0) size_t write(
 				_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
 			{
@@ -1498,6 +2402,48 @@ namespace stdex
 				}
 			}
 
+			virtual size_t writev(_In_reads_(count) const const_iovec_t* iov, _In_ size_t count)
+			{
+				stdex_assert(iov || !count);
+				size_t length = 0;
+				for (size_t i = 0; i < count; ++i)
+					length = stdex::add(length, iov[i].length);
+				if (length <= m_write_buffer.capacity - m_write_buffer.tail) {
+					for (size_t i = 0; i < count; ++i) {
+						memcpy(m_write_buffer.data + m_write_buffer.tail, iov[i].data, iov[i].length);
+						m_write_buffer.tail += iov[i].length;
+					}
+					m_state = state_t::ok;
+					return length;
+				}
+				if (length < m_write_buffer.capacity)
+					return basic::writev(iov, count);
+
+				// When needing to write more data than buffer capacity, bypass the buffer.
+				// Gather buffered data and given data into a single write.
+				size_t buffer_size = m_write_buffer.tail - m_write_buffer.head;
+				if (buffer_size && count < 0x10) {
+					const_iovec_t batch[0x10];
+					batch[0].data = m_write_buffer.data + m_write_buffer.head;
+					batch[0].length = buffer_size;
+					std::copy(iov, iov + count, batch + 1);
+					size_t num_written = m_source->writev(batch, count + 1);
+					m_state = m_source->state();
+					if (num_written < buffer_size) _Unlikely_ {
+						m_write_buffer.head += num_written;
+						return 0;
+					}
+					m_write_buffer.head = m_write_buffer.tail = 0;
+					return num_written - buffer_size;
+				}
+				flush_write();
+				if (!ok()) _Unlikely_
+					return 0;
+				size_t num_written = m_source->writev(iov, count);
+				m_state = m_source->state();
+				return num_written;
+			}
+
 			virtual void flush()
 			{
 				flush_write();
@@ -1777,6 +2723,13 @@ namespace stdex
 					m_state = state_t::fail;
 			}
 
+			virtual void advise(_In_ access_hint_t hint, _In_ fpos_t offset = 0, _In_ fsize_t length = fsize_max)
+			{
+				fsize_t size = m_region.size();
+				if (offset < size)
+					m_source.advise(hint, m_region.start + offset, std::min<fsize_t>(length, size - offset));
+			}
+
 			virtual fsize_t size() const
 			{
 				return m_region.size();
@@ -1794,19 +2747,34 @@ namespace stdex
 		};
 
 		constexpr size_t default_cache_size = 0x1000; ///< Default cache size
+		constexpr size_t default_cache_pages = 8; ///< Default number of cache pages
 
 		///
 		/// Cached file
 		///
+		/// Keeps a number of file pages in memory. On a miss, the least recently used page is evicted.
+		/// Sequential access is detected and reads the following pages ahead.
+		///
 		class cache : public basic_file
 		{
 		protected:
 			/// \cond internal
 #pragma warning(suppress: 26495) // The delayed init call will finish initializing the class.
-			explicit cache(_In_ size_t cache_size = default_cache_size) :
+			explicit cache(_In_ size_t cache_size = default_cache_size, _In_ size_t cache_pages = default_cache_pages) :
 				basic(state_t::fail),
-				m_cache(cache_size)
-			{}
+				m_source(nullptr),
+				m_page_size(cache_size),
+				m_data(new uint8_t[stdex::mul(cache_size, cache_pages ? cache_pages : 1)]),
+				m_pages(cache_pages ? cache_pages : 1),
+				m_tick(0),
+				m_seq_next(fpos_max),
+				m_seq_count(0),
+				m_hits(0),
+				m_misses(0)
+			{
+				for (size_t i = 0, n = m_pages.size(); i < n; ++i)
+					m_pages[i].data = m_data.get() + i * m_page_size;
+			}
 
 			void init(_Inout_ basic_file& source)
 			{
@@ -1818,6 +2786,8 @@ namespace stdex
 			{
 				m_state = m_source->state();
 				m_offset = m_source->tell();
+				m_seq_next = fpos_max;
+				m_seq_count = 0;
 #if SET_FILE_OP_TIMES
 				m_atime = m_source->atime();
 				m_mtime = m_source->mtime();
@@ -1841,16 +2811,18 @@ namespace stdex
 			/// \endcond
 
 		public:
-			cache(_Inout_ basic_file& source, _In_ size_t cache_size = default_cache_size) :
-				basic(source.state()),
-				m_source(&source),
-				m_cache(cache_size),
-				m_offset(source.tell())
-#if SET_FILE_OP_TIMES
-				, m_atime(source.atime())
-				, m_mtime(source.mtime())
-#endif
-			{}
+			///
+			/// Constructs a cache
+			///
+			/// \param[in] source       Source file
+			/// \param[in] cache_size   Size of a cache page
+			/// \param[in] cache_pages  Number of cache pages
+			///
+			cache(_Inout_ basic_file& source, _In_ size_t cache_size = default_cache_size, _In_ size_t cache_pages = default_cache_pages) :
+				cache(cache_size, cache_pages)
+			{
+				init(source);
+			}
 
 			virtual ~cache() noexcept(false)
 			{
@@ -1874,64 +2846,138 @@ namespace stdex
 				m_atime = time_point::now();
 #endif
 				for (size_t to_read = length;;) {
-					if (m_cache.status != cache_t::cache_t::status_t::empty) {
-						if (m_cache.region.contains(m_offset)) {
-							size_t remaining_cache = static_cast<size_t>(m_cache.region.end - m_offset);
-							if (to_read <= remaining_cache) {
-								memcpy(data, m_cache.data + static_cast<size_t>(m_offset - m_cache.region.start), to_read);
-								m_offset += to_read;
-								m_state = state_t::ok;
-								return length;
-							}
-							memcpy(data, m_cache.data + static_cast<size_t>(m_offset - m_cache.region.start), remaining_cache);
-							reinterpret_cast<uint8_t*&>(data) += remaining_cache;
-							to_read -= remaining_cache;
-							m_offset += remaining_cache;
-						}
-						flush_cache();
-						if (!ok()) _Unlikely_ {
-							if (to_read < length)
-								m_state = state_t::ok;
-							return length - to_read;
-						}
+					if (!to_read) {
+						m_state = state_t::ok;
+						return length;
 					}
-					{
+					fpos_t start = m_offset - m_offset % m_page_size;
+					page_t* p = find_page(start);
+					if (!p) {
 						fpos_t end_max = m_offset + to_read;
-						if (m_offset / m_cache.capacity < end_max / m_cache.capacity) {
-							// Read spans multiple cache blocks. Bypass cache to the last block.
+						if (m_offset / m_page_size < end_max / m_page_size) {
+							// Read spans multiple cache pages. Bypass cache to the last page.
+							size_t num_bypass = to_read - static_cast<size_t>(end_max % m_page_size);
+							write_pages(m_offset, m_offset + num_bypass);
+							if (!ok()) _Unlikely_ {
+								if (to_read < length)
+									m_state = state_t::ok;
+								return length - to_read;
+							}
 							m_source->seekbeg(m_offset);
 							if (!m_source->ok()) _Unlikely_ {
 								m_state = to_read < length ? state_t::ok : state_t::fail;
 								return length - to_read;
 							}
-							size_t num_read = m_source->read(data, to_read - static_cast<size_t>(end_max % m_cache.capacity));
+							size_t num_read = m_source->read(data, num_bypass);
+							m_state = m_source->state();
+							if (num_read < num_bypass && m_state != state_t::fail) {
+								// Source ends inside the region. Dirty pages further on might have extended the file: the gap reads as zeros.
+								size_t num_zero = static_cast<size_t>(std::min<fpos_t>(data_end(m_offset + num_read) - (m_offset + num_read), num_bypass - num_read));
+								if (num_zero) {
+									memset(reinterpret_cast<uint8_t*>(data) + num_read, 0, num_zero);
+									num_read += num_zero;
+									m_state = state_t::ok;
+								}
+							}
 							m_offset += num_read;
 							to_read -= num_read;
-							if (!to_read) {
-								m_state = state_t::ok;
-								return length;
-							}
 							reinterpret_cast<uint8_t*&>(data) += num_read;
-							m_state = m_source->state();
-							if (!ok()) {
-								if (to_read < length)
-									m_state = state_t::ok;
+							if (!ok() || num_read < num_bypass) {
+								m_state = to_read < length ? state_t::ok : m_state;
 								return length - to_read;
 							}
+							continue;
+						}
+						p = load_page(start);
+						if (!p) _Unlikely_ {
+							m_state = to_read < length ? state_t::ok : state_t::fail;
+							return length - to_read;
 						}
 					}
-					load_cache(m_offset);
-					if (!ok()) _Unlikely_ {
-						m_state = to_read < length ? state_t::ok : state_t::fail;
+					if (p->region.end <= m_offset) _Unlikely_ {
+						m_state = to_read < length ? state_t::ok : state_t::eof;
 						return length - to_read;
 					}
-					if (m_cache.region.end <= m_offset) _Unlikely_ {
-						m_state = to_read < length ? state_t::ok : state_t::eof;
+					size_t remaining_page = static_cast<size_t>(p->region.end - m_offset);
+					if (to_read <= remaining_page) {
+						memcpy(data, p->data + static_cast<size_t>(m_offset - start), to_read);
+						m_offset += to_read;
+						m_state = state_t::ok;
+						return length;
+					}
+					memcpy(data, p->data + static_cast<size_t>(m_offset - start), remaining_page);
+					reinterpret_cast<uint8_t*&>(data) += remaining_page;
+					to_read -= remaining_page;
+					m_offset += remaining_page;
+					if (p->region.end < start + m_page_size) {
+						// Page ends before its boundary: end of file.
+						m_state = state_t::ok;
 						return length - to_read;
 					}
 				}
 			}
 
+			virtual bool read_until(_In_ uint8_t delim, _Outptr_result_bytebuffer_(length) const void*& data, _Out_ size_t& length)
+			{
+#if SET_FILE_OP_TIMES
+				m_atime = time_point::now();
+#endif
+				data = nullptr;
+				length = 0;
+				fpos_t start = m_offset - m_offset % m_page_size;
+				page_t* p = find_page(start);
+				if (!p) {
+					p = load_page(start);
+					if (!p) _Unlikely_ {
+						m_state = state_t::fail;
+						return true;
+					}
+				}
+				if (p->region.end <= m_offset) {
+					m_state = state_t::eof;
+					return true;
+				}
+				data = p->data + static_cast<size_t>(m_offset - start);
+				size_t available = static_cast<size_t>(p->region.end - m_offset);
+				auto end = reinterpret_cast<const uint8_t*>(memchr(data, delim, available));
+				length = end ? static_cast<size_t>(end - reinterpret_cast<const uint8_t*>(data)) + 1 : available;
+				m_offset += length;
+				m_state = state_t::ok;
+				return true;
+			}
+
+			virtual bool peek(_In_ size_t length, _Outptr_result_bytebuffer_(available) const void*& data, _Out_ size_t& available)
+			{
+#if SET_FILE_OP_TIMES
+				m_atime = time_point::now();
+#endif
+				data = nullptr;
+				available = 0;
+				fpos_t start = m_offset - m_offset % m_page_size;
+				page_t* p = find_page(start);
+				if (!p) {
+					p = load_page(start);
+					if (!p) _Unlikely_ {
+						m_state = state_t::fail;
+						return true;
+					}
+				}
+				if (p->region.end <= m_offset) {
+					m_state = length ? state_t::eof : state_t::ok;
+					return true;
+				}
+				data = p->data + static_cast<size_t>(m_offset - start);
+				available = static_cast<size_t>(p->region.end - m_offset);
+				m_state = state_t::ok;
+				return true;
+			}
+
+			virtual void consume(_In_ size_t length)
+			{
+				m_offset += length;
+				m_state = state_t::ok;
+			}
+
 			virtual _Success_(return != 0) size_t write(
 				_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
 			{
@@ -1939,49 +2985,50 @@ namespace stdex
 #if SET_FILE_OP_TIMES
 				m_atime = m_mtime = time_point::now();
 #endif
+				if (length)
+					extend_pages(m_offset);
 				for (size_t to_write = length;;) {
-					if (m_cache.status != cache_t::cache_t::status_t::empty) {
-						fpos_t end_max = m_cache.region.start + m_cache.capacity;
-						if (m_cache.region.start <= m_offset && m_offset < end_max) {
-							size_t remaining_cache = static_cast<size_t>(end_max - m_offset);
-							if (to_write <= remaining_cache) {
-								memcpy(m_cache.data + static_cast<size_t>(m_offset - m_cache.region.start), data, to_write);
-								m_offset += to_write;
-								m_cache.status = cache_t::cache_t::status_t::dirty;
-								m_cache.region.end = std::max(m_cache.region.end, m_offset);
-								m_state = state_t::ok;
-								return length;
-							}
-							memcpy(m_cache.data + static_cast<size_t>(m_offset - m_cache.region.start), data, remaining_cache);
-							reinterpret_cast<const uint8_t*&>(data) += remaining_cache;
-							to_write -= remaining_cache;
-							m_offset += remaining_cache;
-							m_cache.status = cache_t::cache_t::status_t::dirty;
-							m_cache.region.end = end_max;
-						}
-						flush_cache();
-						if (!ok()) _Unlikely_
-							return length - to_write;
+					if (!to_write) {
+						m_state = state_t::ok;
+						return length;
 					}
-					{
+					fpos_t start = m_offset - m_offset % m_page_size;
+					page_t* p = find_page(start);
+					if (!p) {
 						fpos_t end_max = m_offset + to_write;
-						if (m_offset / m_cache.capacity < end_max / m_cache.capacity) {
-							// Write spans multiple cache blocks. Bypass cache to the last block.
+						if (m_offset / m_page_size < end_max / m_page_size) {
+							// Write spans multiple cache pages. Bypass cache to the last page.
 							m_source->seekbeg(m_offset);
+							m_state = m_source->state();
 							if (!ok()) _Unlikely_
 								return length - to_write;
-							size_t num_written = m_source->write(data, to_write - static_cast<size_t>(end_max % m_cache.capacity));
+							size_t num_written = m_source->write(data, to_write - static_cast<size_t>(end_max % m_page_size));
+							discard_pages(m_offset, m_offset + num_written);
 							m_offset += num_written;
 							m_state = m_source->state();
 							to_write -= num_written;
 							if (!to_write || !ok())
 								return length - to_write;
 							reinterpret_cast<const uint8_t*&>(data) += num_written;
+							continue;
 						}
+						p = read_page(start);
+						if (!p) _Unlikely_
+							return length - to_write;
+						p->used = ++m_tick;
 					}
-					load_cache(m_offset);
-					if (!ok()) _Unlikely_
-						return length - to_write;
+					if (p->region.end < m_offset) {
+						// Writing past the end of file. Zero the gap.
+						memset(p->data + static_cast<size_t>(p->region.end - start), 0, static_cast<size_t>(m_offset - p->region.end));
+					}
+					size_t remaining_page = static_cast<size_t>(start + m_page_size - m_offset);
+					size_t num_written = std::min(to_write, remaining_page);
+					memcpy(p->data + static_cast<size_t>(m_offset - start), data, num_written);
+					reinterpret_cast<const uint8_t*&>(data) += num_written;
+					to_write -= num_written;
+					m_offset += num_written;
+					p->status = page_t::status_t::dirty;
+					p->region.end = std::max(p->region.end, m_offset);
 				}
 			}
 
@@ -2048,11 +3095,21 @@ namespace stdex
 				m_state = m_source->state();
 			}
 
+			virtual void advise(_In_ access_hint_t hint, _In_ fpos_t offset = 0, _In_ fsize_t length = fsize_max)
+			{
+				m_source->advise(hint, offset, length);
+			}
+
 			virtual fsize_t size() const
 			{
-				return m_cache.status != cache_t::cache_t::status_t::empty ?
-					std::max(m_source->size(), m_cache.region.end) :
-					m_source->size();
+				fsize_t n = m_source->size();
+				if (n == fsize_max) _Unlikely_
+					return n;
+				for (auto& p : m_pages) {
+					if (p.status != page_t::status_t::empty && !p.region.empty() && n < p.region.end)
+						n = p.region.end;
+				}
+				return n;
 			}
 
 			virtual void truncate()
@@ -2061,16 +3118,19 @@ namespace stdex
 				m_atime = m_mtime = time_point::now();
 #endif
 				m_source->seekbeg(m_offset);
-				if (m_cache.region.end <= m_offset) {
-					// Truncation does not affect cache.
-				}
-				else if (m_cache.region.start <= m_offset) {
-					// Truncation truncates cache.
-					m_cache.region.end = m_offset;
-				}
-				else {
-					// Truncation invalidates cache.
-					m_cache.status = cache_t::cache_t::status_t::empty;
+				extend_pages(m_offset);
+				for (auto& p : m_pages) {
+					if (p.status == page_t::status_t::empty || p.region.end <= m_offset) {
+						// Truncation does not affect page.
+					}
+					else if (p.region.start <= m_offset) {
+						// Truncation truncates page.
+						p.region.end = m_offset;
+					}
+					else {
+						// Truncation invalidates page.
+						p.status = page_t::status_t::empty;
+					}
 				}
 				m_source->truncate();
 				m_state = m_source->state();
@@ -2120,87 +3180,238 @@ namespace stdex
 				m_source->set_mtime(date);
 			}
 
+			///
+			/// Returns number of page lookups served from the cache
+			///
+			uint64_t cache_hits() const { return m_hits; }
+
+			///
+			/// Returns number of page lookups that required loading the page from the source
+			///
+			uint64_t cache_misses() const { return m_misses; }
+
 		protected:
 			/// \cond internal
-			void flush_cache()
+			struct page_t {
+				uint8_t* data;
+				enum class status_t {
+					empty = 0,
+					loaded,
+					dirty,
+				} status;
+				interval<fpos_t> region; ///< valid data region
+				uint64_t used; ///< last access tick
+
+				page_t() :
+					data(nullptr),
+					status(status_t::empty),
+					region(0),
+					used(0)
+				{}
+			};
+
+			///
+			/// Looks up the page starting at given file offset
+			///
+			page_t* find_page(_In_ fpos_t start)
 			{
-				if (m_cache.status != cache_t::cache_t::status_t::dirty)
-					m_state = state_t::ok;
-				else if (!m_cache.region.empty()) {
-					write_cache();
-					if (ok())
-						m_cache.status = cache_t::cache_t::status_t::loaded;
+				for (auto& p : m_pages) {
+					if (p.status != page_t::status_t::empty && p.region.start == start) {
+						p.used = ++m_tick;
+						++m_hits;
+						return &p;
+					}
 				}
-				else {
-					m_state = state_t::ok;
-					m_cache.status = cache_t::cache_t::status_t::loaded;
+				++m_misses;
+				return nullptr;
+			}
+
+			///
+			/// Picks a page for reuse: either an empty one or the least recently used one. Dirty pages are written back.
+			///
+			page_t* evict_page()
+			{
+				page_t* victim = nullptr;
+				for (auto& p : m_pages) {
+					if (p.status == page_t::status_t::empty)
+						return &p;
+					if (!victim || p.used < victim->used)
+						victim = &p;
+				}
+				stdex_assert(victim);
+				if (victim->status == page_t::status_t::dirty) {
+					write_page(*victim);
+					if (!ok()) _Unlikely_
+						return nullptr;
 				}
+				victim->status = page_t::status_t::empty;
+				return victim;
 			}
 
-			void invalidate_cache()
+			///
+			/// Loads page from the source, reading ahead when access is sequential
+			///
+			page_t* load_page(_In_ fpos_t start)
+			{
+				stdex_assert(start % m_page_size == 0);
+				if (start == m_seq_next)
+					m_seq_count = std::min(m_seq_count + 1, m_pages.size() / 2);
+				else
+					m_seq_count = 0;
+				page_t* p = read_page(start);
+				if (!p) _Unlikely_
+					return nullptr;
+				p->used = ++m_tick;
+				m_seq_next = start + m_page_size;
+				for (size_t i = 0; i < m_seq_count && p->region.end == m_seq_next; ++i) {
+					// Sequential access detected. Read ahead.
+					if (std::any_of(m_pages.cbegin(), m_pages.cend(), [&](_In_ const page_t& q) { return q.status != page_t::status_t::empty && q.region.start == m_seq_next; }))
+						break;
+					page_t* q = read_page(m_seq_next);
+					if (!q) _Unlikely_
+						break;
+					q->used = m_tick;
+					m_seq_next += m_page_size;
+					if (q->region.end < m_seq_next)
+						break;
+				}
+				if (m_seq_count) {
+					// Have OS read the following pages in the background.
+					m_source->prefetch(m_seq_next, stdex::mul(m_page_size, m_seq_count));
+				}
+				m_state = state_t::ok; // Regardless readahead failure, we still might have cached some data.
+				return p;
+			}
+
+			page_t* read_page(_In_ fpos_t start)
+			{
+				page_t* p = evict_page();
+				if (!p) _Unlikely_
+					return nullptr;
+				m_source->seekbeg(start);
+				if (!m_source->ok()) _Unlikely_ {
+					m_state = state_t::fail;
+					return nullptr;
+				}
+				p->region.start = start;
+				p->region.end = start + m_source->read(p->data, m_page_size);
+				p->status = page_t::status_t::loaded;
+				if (p->region.end < start + m_page_size) {
+					// Source ends inside the page. Dirty pages further on might have extended the file: the gap reads as zeros.
+					fpos_t end = std::min(data_end(p->region.end), start + m_page_size);
+					memset(p->data + static_cast<size_t>(p->region.end - start), 0, static_cast<size_t>(end - p->region.end));
+					p->region.end = end;
+				}
+				m_state = state_t::ok; // Regardless the read failure, we still might have cached some data.
+				return p;
+			}
+
+			void write_page(_Inout_ page_t& p)
 			{
-				if (m_cache.status == cache_t::cache_t::status_t::dirty && !m_cache.region.empty()) {
-					write_cache();
+				stdex_assert(p.status == page_t::status_t::dirty);
+				if (!p.region.empty()) {
+					m_source->seekbeg(p.region.start);
+					m_source->write(p.data, static_cast<size_t>(p.region.size()));
+					m_state = m_source->state();
 					if (!ok()) _Unlikely_
 						return;
-				} else
+				}
+				else
 					m_state = state_t::ok;
-				m_cache.status = cache_t::cache_t::status_t::empty;
+				p.status = page_t::status_t::loaded;
 			}
 
-			void load_cache(_In_ fpos_t start)
+			///
+			/// Writes back dirty pages overlapping given file region in file offset order
+			///
+			void write_pages(_In_ fpos_t start = 0, _In_ fpos_t end = fpos_max)
 			{
-				stdex_assert(m_cache.status != cache_t::cache_t::status_t::dirty);
-				start -= start % m_cache.capacity; // Align to cache block size.
-				m_source->seekbeg(m_cache.region.start = start);
-				if (m_source->ok()) {
-					m_cache.region.end = start + m_source->read(m_cache.data, m_cache.capacity);
-					m_cache.status = cache_t::cache_t::status_t::loaded;
-					m_state = state_t::ok; // Regardless the read failure, we still might have cached some data.
+				std::vector<page_t*> dirty;
+				for (auto& p : m_pages) {
+					if (p.status == page_t::status_t::dirty && p.region.start < end && start < p.region.start + m_page_size)
+						dirty.push_back(&p);
+				}
+				std::sort(dirty.begin(), dirty.end(), [](_In_ const page_t* a, _In_ const page_t* b) { return a->region.start < b->region.start; });
+				m_state = state_t::ok;
+				for (auto p : dirty) {
+					write_page(*p);
+					if (!ok()) _Unlikely_
+						return;
 				}
-				else
-					m_state = state_t::fail;
 			}
 
-			void write_cache()
+			///
+			/// Returns end of data cached in pages starting past given file offset, or the offset when there are none
+			///
+			fpos_t data_end(_In_ fpos_t offset) const
 			{
-				stdex_assert(m_cache.status == cache_t::cache_t::status_t::dirty);
-				m_source->seekbeg(m_cache.region.start);
-				m_source->write(m_cache.data, static_cast<size_t>(m_cache.region.size()));
-				m_state = m_source->state();
+				fpos_t end = offset;
+				for (auto& p : m_pages) {
+					if (p.status != page_t::status_t::empty && offset < p.region.start && !p.region.empty() && end < p.region.end)
+						end = p.region.end;
+				}
+				return end;
 			}
 
-			basic_file* m_source;
-			struct cache_t {
-				uint8_t* data;
-				size_t capacity;
-				enum class status_t {
-					empty = 0,
-					loaded,
-					dirty,
-				} status;
-				interval<fpos_t> region; ///< valid data region
-
-				cache_t(_In_ size_t _capacity) :
-					data(new uint8_t[_capacity]),
-					capacity(_capacity),
-					status(status_t::empty),
-					region(0)
-				{}
+			///
+			/// Zero-fills pages ending before given file offset up to their boundary or the offset
+			///
+			/// Call before writing or truncating at the offset, as either extends the file past such pages.
+			///
+			void extend_pages(_In_ fpos_t offset)
+			{
+				for (auto& p : m_pages) {
+					if (p.status == page_t::status_t::empty || offset <= p.region.end)
+						continue;
+					fpos_t end = std::min(p.region.start + m_page_size, offset);
+					if (p.region.end < end) {
+						memset(p.data + static_cast<size_t>(p.region.end - p.region.start), 0, static_cast<size_t>(end - p.region.end));
+						p.region.end = end;
+					}
+				}
+			}
 
-				~cache_t()
-				{
-					delete[] data;
+			///
+			/// Drops pages completely inside given file region
+			///
+			void discard_pages(_In_ fpos_t start, _In_ fpos_t end)
+			{
+				for (auto& p : m_pages) {
+					if (p.status != page_t::status_t::empty && start <= p.region.start && p.region.start + m_page_size <= end)
+						p.status = page_t::status_t::empty;
 				}
-			} m_cache;
-			fpos_t m_offset; ///< Logical absolute file position
-#if SET_FILE_OP_TIMES
-			time_point
-				m_atime,
-				m_mtime;
-#endif
-			/// \endcond
-		};
+			}
+
+			void flush_cache()
+			{
+				write_pages();
+			}
+
+			void invalidate_cache()
+			{
+				write_pages();
+				if (!ok()) _Unlikely_
+					return;
+				for (auto& p : m_pages)
+					p.status = page_t::status_t::empty;
+			}
+
+			basic_file* m_source;
+			size_t m_page_size; ///< size of a page
+			std::unique_ptr<uint8_t[]> m_data; ///< data of all pages
+			std::vector<page_t> m_pages;
+			uint64_t m_tick; ///< page access counter
+			fpos_t m_seq_next; ///< page start expected next on sequential access
+			size_t m_seq_count; ///< number of sequential page loads in a row
+			uint64_t m_hits, m_misses;
+			fpos_t m_offset; ///< Logical absolute file position
+#if SET_FILE_OP_TIMES
+			time_point
+				m_atime,
+				m_mtime;
+#endif
+			/// \endcond
+		};
 
 		///
 		/// OS data stream (file, pipe, socket...)
@@ -2310,6 +3521,167 @@ namespace stdex
 				}
 			}
 
+#ifndef _WIN32
+			virtual size_t readv(_In_reads_(count) const iovec_t* iov, _In_ size_t count)
+			{
+				stdex_assert(iov || !count);
+				size_t total = 0;
+				for (size_t i = 0;;) {
+					// Zero-length buffers would make readv() return 0, which is indistinguishable from EOF.
+					while (i < count && !iov[i].length) ++i;
+					if (i >= count) {
+						m_state = state_t::ok;
+						return total;
+					}
+					auto num_read = ::readv(m_h, reinterpret_cast<const struct iovec*>(iov + i), static_cast<int>(std::min<size_t>(count - i, IOV_MAX)));
+					if (num_read < 0) _Unlikely_ {
+						m_state = total ? state_t::ok : state_t::fail;
+						return total;
+					}
+					if (!num_read) _Unlikely_ {
+						m_state = total ? state_t::ok : state_t::eof;
+						return total;
+					}
+					total += static_cast<size_t>(num_read);
+					for (; iov[i].length <= static_cast<size_t>(num_read); num_read -= static_cast<decltype(num_read)>(iov[i++].length))
+						if (i + 1 >= count) {
+							m_state = state_t::ok;
+							return total;
+						}
+					if (num_read) {
+						// Buffer was filled partially. Complete it before proceeding to the next one.
+						size_t to_read = iov[i].length - static_cast<size_t>(num_read);
+						size_t num_read2 = read(reinterpret_cast<uint8_t*>(iov[i].data) + num_read, to_read);
+						total += num_read2;
+						if (num_read2 < to_read) {
+							m_state = state_t::ok;
+							return total;
+						}
+						++i;
+					}
+				}
+			}
+
+			virtual size_t writev(_In_reads_(count) const const_iovec_t* iov, _In_ size_t count)
+			{
+				stdex_assert(iov || !count);
+				size_t total = 0;
+				for (size_t i = 0;;) {
+					while (i < count && !iov[i].length) ++i;
+					if (i >= count) {
+						m_state = state_t::ok;
+						return total;
+					}
+					auto num_written = ::writev(m_h, reinterpret_cast<const struct iovec*>(iov + i), static_cast<int>(std::min<size_t>(count - i, IOV_MAX)));
+					if (num_written < 0) _Unlikely_ {
+						m_state = state_t::fail;
+						return total;
+					}
+					total += static_cast<size_t>(num_written);
+					for (; iov[i].length <= static_cast<size_t>(num_written); num_written -= static_cast<decltype(num_written)>(iov[i++].length))
+						if (i + 1 >= count) {
+							m_state = state_t::ok;
+							return total;
+						}
+					if (num_written) {
+						// Buffer was written partially. Complete it before proceeding to the next one.
+						size_t to_write = iov[i].length - static_cast<size_t>(num_written);
+						size_t num_written2 = write(reinterpret_cast<const uint8_t*>(iov[i].data) + num_written, to_write);
+						total += num_written2;
+						if (num_written2 < to_write) _Unlikely_
+							return total;
+						++i;
+					}
+				}
+			}
+#endif
+
+#ifdef __linux__
+			///
+			/// Writes content of another stream
+			///
+			/// When source is an OS data stream too, data is copied inside kernel.
+			///
+			/// \param[in,out] stream  Source stream
+			/// \param[in]     amount  Maximum number of bytes to copy
+			///
+			/// \return Number of bytes written
+			///
+			virtual fsize_t write_stream(_Inout_ basic& stream, _In_ fsize_t amount = fsize_max)
+			{
+				fsize_t num_copied = 0;
+				auto source = dynamic_cast<basic_sys*>(&stream);
+				if (source && source->copy_to(m_h, amount, num_copied, m_state))
+					return num_copied;
+				return num_copied + basic::write_stream(stream, amount - num_copied);
+			}
+
+			///
+			/// Copies data to another OS handle inside kernel
+			///
+			/// Uses copy_file_range() for file to file, sendfile() for file to anything, and splice() for pipe to anything
+			/// and anything to pipe copying. Sets this stream state as read() would.
+			///
+			/// \param[in]     h           Destination handle
+			/// \param[in]     amount      Maximum number of bytes to copy
+			/// \param[in,out] num_copied  Number of bytes copied is added to this variable
+			/// \param[out]    state       Destination state
+			///
+			/// \return
+			/// - true when copying completed (successfully or not)
+			/// - false when handles do not support kernel-side copying. Copy the remaining amount in user space.
+			///
+			bool copy_to(_In_ int h, _In_ fsize_t amount, _Inout_ fsize_t& num_copied, _Out_ state_t& state)
+			{
+				enum class method_t {
+					copy_file_range = 0,
+					sendfile,
+					splice,
+				} method = method_t::copy_file_range;
+				for (fsize_t to_copy = amount;;) {
+					if (!to_copy) {
+						m_state = state = state_t::ok;
+						return true;
+					}
+					// Linux transfers at most 0x7ffff000 bytes per call.
+					size_t block_size = static_cast<size_t>(std::min<fsize_t>(to_copy, 0x7ffff000));
+					ssize_t result;
+					switch (method) {
+					case method_t::copy_file_range: result = ::copy_file_range(m_h, nullptr, h, nullptr, block_size, 0); break;
+					case method_t::sendfile: result = ::sendfile(h, m_h, nullptr, block_size); break;
+					default: result = ::splice(m_h, nullptr, h, nullptr, block_size, SPLICE_F_MOVE); break;
+					}
+					if (result > 0) {
+						num_copied += static_cast<fsize_t>(result);
+						to_copy -= static_cast<fsize_t>(result);
+						continue;
+					}
+					if (!result) {
+						if (to_copy == amount) {
+							// Some special files (e.g. in /proc) report zero size. Let read() confirm EOF.
+							return false;
+						}
+						m_state = state_t::eof;
+						state = state_t::ok;
+						return true;
+					}
+					switch (errno) {
+					case EINTR:
+						continue;
+					case EINVAL: case EXDEV: case ENOSYS: case EOPNOTSUPP: case EBADF: case ESPIPE:
+						// Handles not supported by this method. Try the next one.
+						if (method == method_t::splice)
+							return false;
+						method = static_cast<method_t>(static_cast<int>(method) + 1);
+						continue;
+					}
+					m_state = state_t::ok;
+					state = state_t::fail;
+					return true;
+				}
+			}
+#endif
+
 			virtual void close()
 			{
 				try {
@@ -2361,7 +3733,16 @@ namespace stdex
 		public:
 			socket(_In_opt_ socket_t h = stdex::invalid_socket, _In_ state_t state = state_t::ok) :
 				basic(state),
-				m_h(h)
+				m_h(h),
+				m_nonblocking(false),
+				m_send_flags(0)
+#ifdef __linux__
+				, m_reactor(nullptr)
+#if __cpp_impl_coroutine >= 201902L
+				, m_async_read(nullptr)
+				, m_async_write(nullptr)
+#endif
+#endif
 			{}
 
 		private:
@@ -2369,7 +3750,17 @@ namespace stdex
 			socket& operator =(_In_ const socket& other);
 
 		public:
-			socket(_Inout_ socket&& other) noexcept : m_h(other.m_h)
+			socket(_Inout_ socket&& other) noexcept :
+				m_h(other.m_h),
+				m_nonblocking(other.m_nonblocking),
+				m_send_flags(other.m_send_flags)
+#ifdef __linux__
+				, m_reactor(other.m_reactor)
+#if __cpp_impl_coroutine >= 201902L
+				, m_async_read(nullptr)
+				, m_async_write(nullptr)
+#endif
+#endif
 			{
 				other.m_h = stdex::invalid_socket;
 			}
@@ -2378,8 +3769,16 @@ namespace stdex
 			{
 				if (this != std::addressof(other)) {
 					if (m_h != stdex::invalid_socket)
-						closesocket(m_h);
+						release();
 					m_h = other.m_h;
+					m_nonblocking = other.m_nonblocking;
+					m_send_flags = other.m_send_flags;
+#ifdef __linux__
+					m_reactor = other.m_reactor;
+#if __cpp_impl_coroutine >= 201902L
+					m_async_read = m_async_write = nullptr;
+#endif
+#endif
 					other.m_h = stdex::invalid_socket;
 				}
 				return *this;
@@ -2392,7 +3791,16 @@ namespace stdex
 			/// \param[in] type      Socket type
 			/// \param[in] protocol  Socket protocol
 			///
-			socket(_In_ int af, _In_ int type, _In_ int protocol)
+			socket(_In_ int af, _In_ int type, _In_ int protocol) :
+				m_nonblocking(false),
+				m_send_flags(0)
+#ifdef __linux__
+				, m_reactor(nullptr)
+#if __cpp_impl_coroutine >= 201902L
+				, m_async_read(nullptr)
+				, m_async_write(nullptr)
+#endif
+#endif
 			{
 				m_h = ::socket(af, type, protocol);
 				if (m_h == stdex::invalid_socket) _Unlikely_
@@ -2402,7 +3810,7 @@ namespace stdex
 			virtual ~socket()
 			{
 				if (m_h != stdex::invalid_socket)
-					closesocket(m_h);
+					release();
 			}
 
 			///
@@ -2415,6 +3823,94 @@ namespace stdex
 			///
 			socket_t get() const noexcept { return m_h; }
 
+			///
+			/// Switches socket to non-blocking mode
+			///
+			/// In non-blocking mode, read() and write() return early when socket is not ready. When nothing could be
+			/// transferred, or a write was cut short, stream state is set to state_t::wait. Helpers looping while the
+			/// stream is ok, like read_array() or readln(), stop at that point. Use a reactor to wait for socket readiness.
+			///
+			/// \param[in] nonblocking  true to enable non-blocking mode; false to switch back to blocking mode
+			///
+			/// \return true on success; false otherwise
+			///
+			bool set_nonblocking(_In_ bool nonblocking = true)
+			{
+#ifdef _WIN32
+				u_long mode = nonblocking ? 1 : 0;
+				if (ioctlsocket(m_h, FIONBIO, &mode) == SOCKET_ERROR) _Unlikely_
+					return false;
+#else
+				int flags = fcntl(m_h, F_GETFL);
+				if (flags < 0 || fcntl(m_h, F_SETFL, nonblocking ? flags | O_NONBLOCK : flags & ~O_NONBLOCK) < 0) _Unlikely_
+					return false;
+#endif
+				m_nonblocking = nonblocking;
+				return true;
+			}
+
+			///
+			/// Returns true if socket is in non-blocking mode
+			///
+			bool nonblocking() const noexcept { return m_nonblocking; }
+
+			///
+			/// Shuts down sending, signalling end of file to the peer
+			///
+			/// Socket remains open for reading.
+			///
+			/// \return true on success; false otherwise
+			///
+			bool shutdown_write()
+			{
+#ifdef _WIN32
+				return ::shutdown(m_h, SD_SEND) != SOCKET_ERROR;
+#else
+				return ::shutdown(m_h, SHUT_WR) == 0;
+#endif
+			}
+
+			///
+			/// Holds back partial TCP segments to coalesce small writes
+			///
+			/// Pending data is sent when cork is removed. Uses TCP_CORK on Linux and TCP_NOPUSH on BSD/macOS.
+			///
+			/// \param[in] enable  true to cork; false to uncork and send pending data
+			///
+			/// \return true on success; false if not supported or failed
+			///
+			bool cork(_In_ bool enable = true)
+			{
+#if defined(__linux__) || defined(__APPLE__)
+				int value = enable ? 1 : 0;
+#ifdef __linux__
+				return setsockopt(m_h, IPPROTO_TCP, TCP_CORK, &value, sizeof(value)) == 0;
+#else
+				return setsockopt(m_h, IPPROTO_TCP, TCP_NOPUSH, &value, sizeof(value)) == 0;
+#endif
+#else
+				_Unreferenced_(enable);
+				return false;
+#endif
+			}
+
+			///
+			/// Hints that more data follows
+			///
+			/// While enabled, writes are sent with MSG_MORE on Linux, allowing the kernel to batch them into full
+			/// segments. Disable to push the data. Has no effect on other platforms.
+			///
+			/// \param[in] enable  true when more data follows; false to send the data with the next write
+			///
+			void more(_In_ bool enable = true)
+			{
+#ifdef __linux__
+				m_send_flags = enable ? MSG_MORE : 0;
+#else
+				_Unreferenced_(enable);
+#endif
+			}
+
 			virtual _Success_(return != 0 || length == 0) size_t read(
 				_Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length)
 			{
@@ -2429,7 +3925,7 @@ namespace stdex
 #endif
 						0);
 					if (num_read < 0) _Unlikely_ {
-						m_state = to_read < length ? state_t::ok : state_t::fail;
+						m_state = to_read < length ? state_t::ok : would_block() ? state_t::wait : state_t::fail;
 						return length - to_read;
 					}
 					if (!num_read) {
@@ -2457,9 +3953,9 @@ namespace stdex
 #else
 						std::min<size_t>(to_write, block_size),
 #endif
-						0);
+						m_send_flags);
 					if (num_written < 0) _Unlikely_ {
-						m_state = state_t::fail;
+						m_state = would_block() ? state_t::wait : state_t::fail;
 						return length - to_write;
 					}
 					to_write -= static_cast<size_t>(num_written);
@@ -2471,17 +3967,309 @@ namespace stdex
 				}
 			}
 
+			virtual size_t readv(_In_reads_(count) const iovec_t* iov, _In_ size_t count)
+			{
+				stdex_assert(iov || !count);
+				size_t total = 0;
+				for (size_t i = 0;;) {
+					// Zero-length buffers would make receive return 0, which is indistinguishable from connection close.
+					while (i < count && !iov[i].length) ++i;
+					if (i >= count) {
+						m_state = state_t::ok;
+						return total;
+					}
+#ifdef _WIN32
+					WSABUF buf[0x10];
+					DWORD num_buf = 0;
+					for (size_t j = i; j < count && num_buf < _countof(buf); ++j, ++num_buf) {
+						buf[num_buf].buf = reinterpret_cast<CHAR*>(iov[j].data);
+						buf[num_buf].len = static_cast<ULONG>(std::min<size_t>(iov[j].length, ULONG_MAX));
+					}
+					DWORD num_read, flags = 0;
+					if (WSARecv(m_h, buf, num_buf, &num_read, &flags, nullptr, nullptr) == SOCKET_ERROR) _Unlikely_ {
+#else
+					msghdr msg = {};
+					msg.msg_iov = reinterpret_cast<struct iovec*>(const_cast<iovec_t*>(iov + i));
+					msg.msg_iovlen = std::min<size_t>(count - i, IOV_MAX);
+					auto num_read = recvmsg(m_h, &msg, 0);
+					if (num_read < 0) _Unlikely_ {
+#endif
+						m_state = total ? state_t::ok : would_block() ? state_t::wait : state_t::fail;
+						return total;
+					}
+					if (!num_read) _Unlikely_ {
+						m_state = total ? state_t::ok : state_t::eof;
+						return total;
+					}
+					total += static_cast<size_t>(num_read);
+					for (; iov[i].length <= static_cast<size_t>(num_read); num_read -= static_cast<decltype(num_read)>(iov[i++].length))
+						if (i + 1 >= count) {
+							m_state = state_t::ok;
+							return total;
+						}
+					if (num_read) {
+						// Buffer was filled partially. Complete it before proceeding to the next one.
+						size_t to_read = iov[i].length - static_cast<size_t>(num_read);
+						size_t num_read2 = read(reinterpret_cast<uint8_t*>(iov[i].data) + num_read, to_read);
+						total += num_read2;
+						if (num_read2 < to_read) {
+							m_state = state_t::ok;
+							return total;
+						}
+						++i;
+					}
+				}
+			}
+
+			virtual size_t writev(_In_reads_(count) const const_iovec_t* iov, _In_ size_t count)
+			{
+				stdex_assert(iov || !count);
+				size_t total = 0;
+				for (size_t i = 0;;) {
+					while (i < count && !iov[i].length) ++i;
+					if (i >= count) {
+						m_state = state_t::ok;
+						return total;
+					}
+#ifdef _WIN32
+					WSABUF buf[0x10];
+					DWORD num_buf = 0;
+					for (size_t j = i; j < count && num_buf < _countof(buf); ++j, ++num_buf) {
+						buf[num_buf].buf = reinterpret_cast<CHAR*>(const_cast<void*>(iov[j].data));
+						buf[num_buf].len = static_cast<ULONG>(std::min<size_t>(iov[j].length, ULONG_MAX));
+					}
+					DWORD num_written;
+					if (WSASend(m_h, buf, num_buf, &num_written, m_send_flags, nullptr, nullptr) == SOCKET_ERROR) _Unlikely_ {
+#else
+					msghdr msg = {};
+					msg.msg_iov = reinterpret_cast<struct iovec*>(const_cast<const_iovec_t*>(iov + i));
+					msg.msg_iovlen = std::min<size_t>(count - i, IOV_MAX);
+					auto num_written = sendmsg(m_h, &msg, m_send_flags);
+					if (num_written < 0) _Unlikely_ {
+#endif
+						m_state = would_block() ? state_t::wait : state_t::fail;
+						return total;
+					}
+					total += static_cast<size_t>(num_written);
+					for (; iov[i].length <= static_cast<size_t>(num_written); num_written -= static_cast<decltype(num_written)>(iov[i++].length))
+						if (i + 1 >= count) {
+							m_state = state_t::ok;
+							return total;
+						}
+					if (num_written) {
+						// Buffer was sent partially. Complete it before proceeding to the next one.
+						size_t to_write = iov[i].length - static_cast<size_t>(num_written);
+						size_t num_written2 = write(reinterpret_cast<const uint8_t*>(iov[i].data) + num_written, to_write);
+						total += num_written2;
+						if (num_written2 < to_write) _Unlikely_
+							return total;
+						++i;
+					}
+				}
+			}
+
+#ifdef __linux__
+			///
+			/// Writes content of another stream
+			///
+			/// When source is an OS data stream (file, pipe...), data is copied inside kernel.
+			///
+			/// \param[in,out] stream  Source stream
+			/// \param[in]     amount  Maximum number of bytes to copy
+			///
+			/// \return Number of bytes written
+			///
+			virtual fsize_t write_stream(_Inout_ basic& stream, _In_ fsize_t amount = fsize_max)
+			{
+				fsize_t num_copied = 0;
+				auto source = dynamic_cast<basic_sys*>(&stream);
+				if (source && source->copy_to(m_h, amount, num_copied, m_state))
+					return num_copied;
+				return num_copied + basic::write_stream(stream, amount - num_copied);
+			}
+#endif
+
+#ifdef __linux__
+			///
+			/// Sets reactor to wait for socket readiness on
+			///
+			/// Asynchronous requests on non-blocking sockets with a reactor set complete on reactor's thread without
+			/// blocking. Otherwise, they are completed by a worker thread. With a reactor, one read and one write may be
+			/// awaited at the same time. This includes requests on converters reading or writing through this socket.
+			/// Requests submitted from other threads are posted to reactor's thread: socket state is only accessed there
+			/// and is published to the awaiting coroutine by its resumption.
+			///
+			/// \param[in] r  Reactor or nullptr to detach
+			///
+			void set_reactor(_In_opt_ stdex::reactor* r) { m_reactor = r; }
+#endif
+
+#if __cpp_impl_coroutine >= 201902L
+			virtual bool async_submit(_Inout_ async_request& req)
+			{
+#ifdef __linux__
+				if (m_reactor && m_nonblocking) {
+					if (m_reactor->in_thread()) {
+						if (async_progress(req))
+							return true;
+						async_wait(req);
+						return false;
+					}
+					// Neither reactor nor stream state is thread-safe. Progress on reactor's thread only.
+					m_reactor->post([this, &req] {
+						if (async_progress(req))
+							req.continuation.resume();
+						else
+							async_wait(req);
+					});
+					return false;
+				}
+#endif
+				return basic::async_submit(req);
+			}
+#endif
+
+			///
+			/// Closes socket
+			///
+			/// When a reactor is set, socket is removed from it first. Called from another thread than the one running
+			/// the reactor, removal and closing are posted to reactor's thread.
+			///
 			virtual void close()
 			{
 				if (m_h != stdex::invalid_socket) {
-					closesocket(m_h);
+					release();
 					m_h = stdex::invalid_socket;
 				}
 				m_state = state_t::ok;
 			}
 
+		protected:
+			///
+			/// Stops monitoring socket and closes its handle
+			///
+			void release()
+			{
+#ifdef __linux__
+				if (m_reactor) {
+#if __cpp_impl_coroutine >= 201902L
+					m_async_read = m_async_write = nullptr;
+#endif
+					if (!m_reactor->in_thread()) {
+						// Remove on reactor's thread. Closing there too keeps handle from being reused meanwhile.
+						m_reactor->post([r = m_reactor, h = m_h] {
+							if (r->contains(h))
+								r->remove(h);
+							closesocket(h);
+						});
+						return;
+					}
+					if (m_reactor->contains(m_h))
+						m_reactor->remove(m_h);
+				}
+#endif
+				closesocket(m_h);
+			}
+
+#if __cpp_impl_coroutine >= 201902L
+			///
+			/// Makes progress on asynchronous request without blocking
+			///
+			/// \return true if request completed; false if socket was not ready
+			///
+			bool async_progress(_Inout_ async_request& req)
+			{
+				auto& s = *req.stream; // This socket or a converter reading and writing through it
+				if (req.op == async_request::op_t::read) {
+					req.result = s.read(req.data, req.length);
+					return req.result || s.state() != state_t::wait;
+				}
+				req.result += s.write(reinterpret_cast<const uint8_t*>(req.data) + req.result, req.length - req.result);
+				return req.result >= req.length || s.state() != state_t::wait;
+			}
+
+#ifdef __linux__
+			///
+			/// Waits for socket readiness to make progress on request
+			///
+			/// Must be called on reactor's thread.
+			///
+			void async_wait(_Inout_ async_request& req)
+			{
+				(req.op == async_request::op_t::read ? m_async_read : m_async_write) = &req;
+				async_monitor();
+			}
+
+			///
+			/// Updates reactor to monitor events of pending requests. Socket is registered once for both reading and
+			/// writing.
+			///
+			/// Must be called on reactor's thread.
+			///
+			void async_monitor()
+			{
+				uint32_t events =
+					(m_async_read ? stdex::reactor::event_read : 0) |
+					(m_async_write ? stdex::reactor::event_write : 0);
+				if (!events) {
+					if (m_reactor->contains(m_h))
+						m_reactor->remove(m_h);
+				}
+				else if (m_reactor->contains(m_h))
+					m_reactor->modify(m_h, events);
+				else
+					m_reactor->add(m_h, events, [this](_In_ uint32_t events) { async_ready(events); });
+			}
+
+			///
+			/// Makes progress on pending requests when socket is ready and resumes completed ones
+			///
+			void async_ready(_In_ uint32_t events)
+			{
+				constexpr uint32_t event_any = stdex::reactor::event_hangup | stdex::reactor::event_error;
+				async_request* done[2] = {};
+				if (m_async_read && (events & (stdex::reactor::event_read | event_any)) && async_progress(*m_async_read)) {
+					done[0] = m_async_read;
+					m_async_read = nullptr;
+				}
+				if (m_async_write && (events & (stdex::reactor::event_write | event_any)) && async_progress(*m_async_write)) {
+					done[1] = m_async_write;
+					m_async_write = nullptr;
+				}
+				async_monitor();
+				// Resuming might complete the coroutine and destroy this socket. Do not touch it any more.
+				for (auto req : done)
+					if (req)
+						req->continuation.resume();
+			}
+#endif
+#endif
+
+			///
+			/// Returns true if the last socket operation failed because non-blocking socket was not ready
+			///
+			bool would_block() const
+			{
+				if (!m_nonblocking)
+					return false;
+#ifdef _WIN32
+				return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+				return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+			}
+
 		protected:
 			socket_t m_h;
+			bool m_nonblocking;
+			int m_send_flags;
+#ifdef __linux__
+			stdex::reactor* m_reactor;
+#if __cpp_impl_coroutine >= 201902L
+			async_request* m_async_read; ///< Pending read request waiting for the reactor
+			async_request* m_async_write; ///< Pending write request waiting for the reactor
+#endif
+#endif
 		};
 
 #ifdef _WIN32
@@ -2705,6 +4493,8 @@ namespace stdex
 			hint_no_buffering = 1 << 13,      ///< The file or device is being opened with no system caching for data reads and writes. (Windows-specific)
 			hint_random_access = 1 << 14,     ///< Access is intended to be random. (Windows-specific)
 			hint_sequential_access = 1 << 15, ///< Access is intended to be sequential from beginning to end. (Windows-specific)
+
+			mode_direct = 1 << 16,            ///< Bypass OS file cache. Reads and writes must be sector-aligned: use with aligned_buffer.
 		};
 
 #pragma warning(push)
@@ -2774,7 +4564,7 @@ namespace stdex
 
 				DWORD dwFlagsAndAttributes = FILE_ATTRIBUTE_NORMAL;
 				if (mode & hint_write_thru)        dwFlagsAndAttributes |= FILE_FLAG_WRITE_THROUGH;
-				if (mode & hint_no_buffering)      dwFlagsAndAttributes |= FILE_FLAG_NO_BUFFERING;
+				if (mode & (hint_no_buffering | mode_direct)) dwFlagsAndAttributes |= FILE_FLAG_NO_BUFFERING;
 				if (mode & hint_random_access)     dwFlagsAndAttributes |= FILE_FLAG_RANDOM_ACCESS;
 				if (mode & hint_sequential_access) dwFlagsAndAttributes |= FILE_FLAG_SEQUENTIAL_SCAN;
 
@@ -2797,9 +4587,14 @@ namespace stdex
 				if (mode & hint_write_thru) flags |= O_DSYNC;
 #ifndef __APPLE__
 				if (mode & hint_no_buffering) flags |= O_RSYNC;
+				if (mode & mode_direct) flags |= O_DIRECT;
 #endif
 
 				m_h = ::open(filename, flags, DEFFILEMODE);
+#ifdef __APPLE__
+				if (m_h != invalid_handle && (mode & mode_direct))
+					fcntl(m_h, F_NOCACHE, 1);
+#endif
 #endif
 				if (m_h != invalid_handle) {
 					m_state = state_t::ok;
@@ -2843,20 +4638,80 @@ namespace stdex
 				return fpos_max;
 			}
 
-			virtual fpos_t tell() const
+			virtual _Success_(return != 0 || length == 0) size_t read_at(
+				_In_ fpos_t offset, _Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length,
+				_Out_opt_ state_t* state = nullptr)
 			{
-				if (m_h != invalid_handle) {
 #ifdef _WIN32
-					LARGE_INTEGER li;
-					li.QuadPart = 0;
-					li.LowPart = SetFilePointer(m_h, 0, &li.HighPart, FILE_CURRENT);
-					if (li.LowPart != 0xFFFFFFFF || GetLastError() == NO_ERROR)
-						return li.QuadPart;
+				// With synchronous handles, ReadFile() moves the file pointer regardless of OVERLAPPED. Seek, read and restore.
+				return basic_file::read_at(offset, data, length, state);
 #else
-					off64_t result = lseek64(m_h, 0, SEEK_CUR);
-					if (result >= 0)
-						return static_cast<fpos_t>(result);
-#endif
+				stdex_assert(data || !length);
+				for (size_t to_read = length;;) {
+					if (!to_read) {
+						if (state) *state = state_t::ok;
+						return length;
+					}
+					if (offset > static_cast<fpos_t>(std::numeric_limits<off64_t>::max())) _Unlikely_
+						throw std::invalid_argument("file offset too big");
+					auto num_read = pread64(m_h, data, std::min<size_t>(to_read, SSIZE_MAX), static_cast<off64_t>(offset));
+					if (num_read < 0) _Unlikely_ {
+						if (state) *state = to_read < length ? state_t::ok : state_t::fail;
+						return length - to_read;
+					}
+					if (!num_read) _Unlikely_ {
+						if (state) *state = to_read < length ? state_t::ok : state_t::eof;
+						return length - to_read;
+					}
+					to_read -= static_cast<size_t>(num_read);
+					offset += static_cast<fpos_t>(num_read);
+					reinterpret_cast<uint8_t*&>(data) += num_read;
+				}
+#endif
+			}
+
+			virtual _Success_(return != 0) size_t write_at(
+				_In_ fpos_t offset, _In_reads_bytes_opt_(length) const void* data, _In_ size_t length,
+				_Out_opt_ state_t* state = nullptr)
+			{
+#ifdef _WIN32
+				// With synchronous handles, WriteFile() moves the file pointer regardless of OVERLAPPED. Seek, write and restore.
+				return basic_file::write_at(offset, data, length, state);
+#else
+				stdex_assert(data || !length);
+				for (size_t to_write = length;;) {
+					if (!to_write) {
+						if (state) *state = state_t::ok;
+						return length;
+					}
+					if (offset > static_cast<fpos_t>(std::numeric_limits<off64_t>::max())) _Unlikely_
+						throw std::invalid_argument("file offset too big");
+					auto num_written = pwrite64(m_h, data, std::min<size_t>(to_write, SSIZE_MAX), static_cast<off64_t>(offset));
+					if (num_written < 0) _Unlikely_ {
+						if (state) *state = state_t::fail;
+						return length - to_write;
+					}
+					to_write -= static_cast<size_t>(num_written);
+					offset += static_cast<fpos_t>(num_written);
+					reinterpret_cast<const uint8_t*&>(data) += num_written;
+				}
+#endif
+			}
+
+			virtual fpos_t tell() const
+			{
+				if (m_h != invalid_handle) {
+#ifdef _WIN32
+					LARGE_INTEGER li;
+					li.QuadPart = 0;
+					li.LowPart = SetFilePointer(m_h, 0, &li.HighPart, FILE_CURRENT);
+					if (li.LowPart != 0xFFFFFFFF || GetLastError() == NO_ERROR)
+						return li.QuadPart;
+#else
+					off64_t result = lseek64(m_h, 0, SEEK_CUR);
+					if (result >= 0)
+						return static_cast<fpos_t>(result);
+#endif
 				}
 				return fpos_max;
 			}
@@ -2917,6 +4772,46 @@ namespace stdex
 				m_state = state_t::fail;
 			}
 
+#ifndef _WIN32
+			virtual void advise(_In_ access_hint_t hint, _In_ fpos_t offset = 0, _In_ fsize_t length = fsize_max)
+			{
+#ifdef __APPLE__
+				switch (hint) {
+				case access_hint_t::normal:
+				case access_hint_t::sequential:
+					fcntl(m_h, F_RDAHEAD, 1);
+					break;
+				case access_hint_t::random:
+					fcntl(m_h, F_RDAHEAD, 0);
+					break;
+				case access_hint_t::willneed: {
+					struct radvisory ra;
+					ra.ra_offset = static_cast<off_t>(offset);
+					ra.ra_count = static_cast<int>(std::min<fsize_t>(length, INT_MAX));
+					fcntl(m_h, F_RDADVISE, &ra);
+					break;
+				}
+				default:
+					break;
+				}
+#else
+				int advice;
+				switch (hint) {
+				case access_hint_t::sequential: advice = POSIX_FADV_SEQUENTIAL; break;
+				case access_hint_t::random: advice = POSIX_FADV_RANDOM; break;
+				case access_hint_t::willneed: advice = POSIX_FADV_WILLNEED; break;
+				case access_hint_t::dontneed: advice = POSIX_FADV_DONTNEED; break;
+				default: advice = POSIX_FADV_NORMAL;
+				}
+				if (offset > static_cast<fpos_t>(std::numeric_limits<off64_t>::max())) _Unlikely_
+					return;
+				// Zero length extends section to the end of file.
+				off64_t len = length < static_cast<fsize_t>(std::numeric_limits<off64_t>::max()) ? static_cast<off64_t>(length) : 0;
+				posix_fadvise64(m_h, static_cast<off64_t>(offset), len, advice);
+#endif
+			}
+#endif
+
 			virtual fsize_t size() const
 			{
 #ifdef _WIN32
@@ -3128,1222 +5023,3720 @@ namespace stdex
 		};
 #pragma warning(pop)
 
+		constexpr size_t default_direct_alignment = 0x1000; ///< Default file offset and memory alignment for mode_direct files
+
 		///
-		/// Cached file-system file
+		/// Buffered access to files opened with mode_direct
 		///
-		class cached_file : public cache
+		/// Reads and writes the file in whole sectors from sector-aligned memory. Unaligned head and tail sectors are
+		/// read, modified and written back. The tail sector is written zero-padded and the file is truncated back to
+		/// its size afterwards.
+		/// The source file pointer is not maintained while reading or writing. It is set to the logical position on
+		/// flush, close or destruction.
+		///
+		class aligned_buffer : public converter
 		{
 		public:
-			cached_file(_In_opt_ sys_handle h = invalid_handle, _In_ state_t state = state_t::ok, _In_ size_t cache_size = default_cache_size) :
-				cache(cache_size),
-				m_source(h, state)
-			{
-				init(m_source);
-			}
-
 			///
-			/// Opens file
+			/// Starts reading or writing the file at its current position
 			///
-			/// \param[in] filename    Filename
-			/// \param[in] mode        Bitwise combination of mode_t flags
-			/// \param[in] cache_size  Size of the cache block
+			/// \param[in] source       Source file
+			/// \param[in] buffer_size  Buffer size (in bytes). Rounded up to a multiple of alignment.
+			/// \param[in] alignment    File offset and memory alignment (in bytes). Must be a power of 2 and a multiple of
+			///                         the sector size.
 			///
-			cached_file(_In_z_ const schar_t* filename, _In_ int mode, _In_ size_t cache_size = default_cache_size) :
-				cache(cache_size),
-				m_source(filename, mode & mode_for_writing ? mode | mode_for_reading : mode)
+			aligned_buffer(_Inout_ basic_file& source, _In_ size_t buffer_size = default_block_size, _In_ size_t alignment = default_direct_alignment) :
+				converter(source),
+				m_file(source),
+				m_alignment(alignment),
+				m_valid(0),
+				m_dirty_begin(0),
+				m_dirty_end(0)
+			{
+				if (!alignment || (alignment & (alignment - 1))) _Unlikely_
+					throw std::invalid_argument("alignment must be a power of 2");
+				m_capacity = align_up(std::max<size_t>(buffer_size, 1));
+				m_storage.reset(new uint8_t[stdex::add(m_capacity, alignment)]);
+				m_data = reinterpret_cast<uint8_t*>(align_up(reinterpret_cast<uintptr_t>(m_storage.get())));
+				m_offset = source.tell();
+				if (m_offset == fpos_max) _Unlikely_ {
+					m_state = state_t::fail;
+					m_offset = m_size = 0;
+				}
+				else {
+					m_size = source.size();
+					if (m_size == fsize_max) _Unlikely_
+						m_size = 0;
+				}
+				m_base = align_down(m_offset);
+			}
+
+			virtual ~aligned_buffer()
 			{
-				init(m_source);
+				if (m_source)
+					sync();
 			}
 
-			///
-			/// Opens file
-			///
-			/// \param[in] filename    Filename
-			/// \param[in] mode        Bitwise combination of mode_t flags
-			/// \param[in] cache_size  Size of the cache block
-			///
-			template <class TR = std::char_traits<schar_t>, class AX = std::allocator<schar_t>>
-			cached_file(_In_ const std::basic_string<TR, AX>& filename, _In_ int mode, _In_ size_t cache_size = default_cache_size) : cached_file(filename.c_str(), mode, cache_size) {}
+			virtual _Success_(return != 0 || length == 0) size_t read(
+				_Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length)
+			{
+				stdex_assert(data || !length);
+				for (size_t to_read = length;;) {
+					if (!to_read) {
+						m_state = state_t::ok;
+						return length;
+					}
+					if (m_offset < m_base || m_base + m_valid <= m_offset) {
+						if (!flush_data()) _Unlikely_ {
+							m_state = to_read < length ? state_t::ok : state_t::fail;
+							return length - to_read;
+						}
+						m_base = align_down(m_offset);
+						state_t state;
+						m_valid = m_file.read_at(m_base, m_data, m_capacity, &state);
+						if (state == state_t::fail) _Unlikely_
+							m_valid = 0;
+						if (m_base + m_valid <= m_offset) {
+							m_state = to_read < length ? state_t::ok : state == state_t::fail ? state_t::fail : state_t::eof;
+							return length - to_read;
+						}
+					}
+					size_t offset = static_cast<size_t>(m_offset - m_base);
+					size_t num_read = std::min(m_valid - offset, to_read);
+					memcpy(data, m_data + offset, num_read);
+					reinterpret_cast<uint8_t*&>(data) += num_read;
+					to_read -= num_read;
+					m_offset += num_read;
+				}
+			}
 
-			virtual ~cached_file()
+			virtual _Success_(return != 0) size_t write(
+				_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
 			{
-				done();
+				stdex_assert(data || !length);
+				for (size_t to_write = length;;) {
+					if (!to_write) {
+						m_state = state_t::ok;
+						return length;
+					}
+					if (m_offset < m_base || m_base + m_capacity <= m_offset) {
+						if (!flush_data()) _Unlikely_ {
+							m_state = state_t::fail;
+							return length - to_write;
+						}
+						m_base = align_down(m_offset);
+						m_valid = 0;
+					}
+					size_t offset = static_cast<size_t>(m_offset - m_base);
+					size_t num_written = std::min(m_capacity - offset, to_write);
+					if (m_valid < m_capacity && (offset > m_valid || offset + num_written < m_capacity) && m_base + m_valid < m_size) {
+						// Read existing data around the written range.
+						if (m_dirty_begin < m_dirty_end && !flush_data()) _Unlikely_ {
+							m_state = state_t::fail;
+							return length - to_write;
+						}
+						state_t state;
+						m_valid = m_file.read_at(m_base, m_data, m_capacity, &state);
+						if (state == state_t::fail) _Unlikely_ {
+							m_valid = 0;
+							m_state = state_t::fail;
+							return length - to_write;
+						}
+					}
+					if (offset > m_valid)
+						memset(m_data + m_valid, 0, offset - m_valid);
+					memcpy(m_data + offset, data, num_written);
+					if (m_dirty_begin < m_dirty_end) {
+						m_dirty_begin = std::min(m_dirty_begin, offset);
+						m_dirty_end = std::max(m_dirty_end, offset + num_written);
+					}
+					else {
+						m_dirty_begin = offset;
+						m_dirty_end = offset + num_written;
+					}
+					m_valid = std::max(m_valid, offset + num_written);
+					reinterpret_cast<const uint8_t*&>(data) += num_written;
+					to_write -= num_written;
+					m_offset += num_written;
+					if (m_size < m_offset)
+						m_size = m_offset;
+				}
 			}
 
-			///
-			/// Opens file
-			///
-			/// \param[in] filename    Filename
-			/// \param[in] mode        Bitwise combination of mode_t flags
-			///
-			void open(_In_z_ const schar_t* filename, _In_ int mode)
+			virtual void flush()
 			{
-				invalidate_cache();
-				if (!ok()) _Unlikely_{
+				if (!sync()) _Unlikely_ {
 					m_state = state_t::fail;
 					return;
 				}
-				m_source.open(filename, mode & mode_for_writing ? mode | mode_for_reading : mode);
-				if (m_source.ok()) {
-					init();
-					return;
-				}
-				m_state = state_t::fail;
+				converter::flush();
+			}
+
+			virtual void close()
+			{
+				bool succeeded = sync();
+				converter::close();
+				if (!succeeded) _Unlikely_
+					m_state = state_t::fail;
 			}
 
+		protected:
+			template <class T>
+			T align_down(_In_ T n) const { return n & ~static_cast<T>(m_alignment - 1); }
+
+			template <class T>
+			T align_up(_In_ T n) const { return (n + m_alignment - 1) & ~static_cast<T>(m_alignment - 1); }
+
 			///
-			/// Opens file
+			/// Writes dirty sectors to file
 			///
-			/// \param[in] filename    Filename
-			/// \param[in] mode        Bitwise combination of mode_t flags
+			/// \return true on success; false otherwise
 			///
-			template <class TR = std::char_traits<schar_t>, class AX = std::allocator<schar_t>>
-			void open(_In_ const std::basic_string<TR, AX>& filename, _In_ int mode)
+			bool flush_data()
 			{
-				open(filename.c_str(), mode);
+				if (m_dirty_begin >= m_dirty_end)
+					return true;
+				size_t begin = align_down(m_dirty_begin), end = align_up(m_dirty_end);
+				if (end > m_valid)
+					memset(m_data + m_valid, 0, end - m_valid);
+				state_t state;
+				m_file.write_at(m_base + begin, m_data + begin, end - begin, &state);
+				if (state != state_t::ok) _Unlikely_
+					return false;
+				m_dirty_begin = m_dirty_end = 0;
+				if (m_base + end > m_size) {
+					// Zero-padded tail sector was written. Restore file size.
+					m_file.seekbeg(m_size);
+					m_file.truncate();
+					return m_file.ok();
+				}
+				return true;
 			}
 
 			///
-			/// Returns true if file has a valid handle
+			/// Writes dirty sectors and sets file pointer to the logical position
 			///
-			operator bool() const noexcept { return m_source; }
+			bool sync()
+			{
+				bool succeeded = flush_data();
+				m_file.seekbeg(m_offset);
+				return succeeded && m_file.ok();
+			}
 
 		protected:
-			file m_source;
+			basic_file& m_file;
+			size_t m_alignment;
+			size_t m_capacity;
+			std::unique_ptr<uint8_t[]> m_storage;
+			uint8_t* m_data; ///< Aligned buffer
+			fpos_t m_offset; ///< Logical file position
+			fsize_t m_size; ///< Logical file size
+			fpos_t m_base; ///< File offset of the buffer
+			size_t m_valid; ///< Number of bytes in the buffer matching file content
+			size_t m_dirty_begin, m_dirty_end; ///< Range of bytes in the buffer to write
 		};
 
+#ifdef __linux__
+		constexpr size_t default_uring_block_size = 0x10000; ///< Default io_uring request size (in bytes)
+		constexpr size_t default_uring_depth = 8; ///< Default number of io_uring requests in flight
+
 		///
-		/// In-memory file
+		/// Provides read-ahead for files using Linux io_uring
 		///
-		class memory_file : public basic_file
+		/// Keeps multiple reads of consecutive file blocks in flight. Unlike async_reader, no worker thread is involved.
+		/// Short reads are resubmitted; only an empty read is taken for end of file.
+		/// Should io_uring not be available, reads are passed to the source file synchronously.
+		/// The source file pointer is not maintained while reading. It is set to the logical position on close or destruction.
+		///
+		class uring_reader : public converter
 		{
 		public:
-			memory_file(_In_ state_t state = state_t::ok) :
-				basic(state),
-				m_data(nullptr),
-				m_offset(0),
-				m_size(0),
-				m_reserved(0),
-				m_manage(true)
-			{
-#if SET_FILE_OP_TIMES
-				m_ctime = m_atime = m_mtime = time_point::now();
-#endif
-			}
-
 			///
-			/// Creates an empty file of reserved size
+			/// Starts reading the file from its current position
 			///
-			/// \param[in] size   Reserved size
-			/// \param[in] state  Initial stream state
+			/// \param[in] source      Source file
+			/// \param[in] block_size  Size of a single read request (in bytes)
+			/// \param[in] depth       Number of read requests in flight
 			///
-			memory_file(_In_ size_t size, _In_ state_t state = state_t::ok) :
-				basic(state),
-				m_data(reinterpret_cast<uint8_t*>(malloc(size))),
-				m_offset(0),
-				m_size(0),
-				m_reserved(size),
-				m_manage(true)
-			{
-				if (!m_data) {
-					m_state = state_t::fail;
-					throw std::bad_alloc();
+			uring_reader(_Inout_ file& source, _In_ size_t block_size = default_uring_block_size, _In_ size_t depth = default_uring_depth) :
+				converter(source),
+				m_file(source),
+				m_block_size(block_size),
+				m_head(0),
+				m_fixed(false)
+			{
+				if (!block_size || block_size > UINT_MAX || !depth || depth > UINT_MAX) _Unlikely_
+					throw std::invalid_argument("invalid io_uring block size or depth");
+				m_offset = source.tell();
+				if (m_offset == fpos_max) _Unlikely_
+					return;
+				try { m_ring.reset(new uring(static_cast<unsigned>(depth))); }
+				catch (const std::system_error&) { return; }
+				m_data.reset(new uint8_t[mul(block_size, depth)]);
+				m_slots.resize(depth);
+				std::vector<struct iovec> iov(depth);
+				for (size_t i = 0; i < depth; ++i) {
+					iov[i].iov_base = m_slots[i].data = m_data.get() + i * block_size;
+					iov[i].iov_len = block_size;
 				}
-#if SET_FILE_OP_TIMES
-				m_ctime = m_atime = m_mtime = time_point::now();
-#endif
+				m_fixed = m_ring->register_buffers(iov.data(), static_cast<unsigned>(depth));
+				for (size_t i = 0; i < depth; ++i)
+					queue_read(i);
+				m_ring->submit();
 			}
 
-			///
-			/// Creates a file based on available data
-			///
-			/// \param[in] data      Pointer to data
-			/// \param[in] size      Valid data size
-			/// \param[in] reserved  Reserved data size
-			/// \param[in] manage    Is input data allocated using malloc() and this class may reallocate data?
-			/// \param[in] state     Initial stream state
-			///
-			memory_file(_Inout_ void* data, _In_ size_t size, _In_ size_t reserved, _In_ bool manage = false, _In_ state_t state = state_t::ok) :
-				basic(state),
-				m_data(reinterpret_cast<uint8_t*>(data)),
-				m_offset(0),
-				m_size(size),
-				m_reserved(reserved),
-				m_manage(manage)
+			virtual ~uring_reader()
 			{
-				stdex_assert(data || !size);
-				stdex_assert(reserved >= size);
-#if SET_FILE_OP_TIMES
-				m_ctime = m_atime = m_mtime = time_point::now();
-#endif
+				if (m_ring)
+					stop();
 			}
 
-			///
-			/// Creates a file based on available data
-			///
-			/// \param[in] data      Pointer to data
-			/// \param[in] size      Valid and reserved data size
-			/// \param[in] manage    Is input data allocated using malloc() and this class may reallocate data?
-			/// \param[in] state     Initial stream state
-			///
-			memory_file(_Inout_ void* data, _In_ size_t size, _In_ bool manage = false, _In_ state_t state = state_t::ok) :
-				memory_file(data, size, size, manage, state)
-			{}
-
-			///
-			/// Loads content from file-system file
-			///
-			/// \param[in] filename  Filename
-			/// \param[in] mode      Bitwise combination of mode_t flags
-			///
-			memory_file(_In_z_ const schar_t* filename, _In_ int mode) : memory_file()
+			virtual _Success_(return != 0 || length == 0) size_t read(
+				_Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length)
 			{
-				load(filename, mode);
-			}
+				stdex_assert(data || !length);
+				if (!m_ring) _Unlikely_
+					return converter::read(data, length);
+				for (size_t to_read = length;;) {
+					auto& s = m_slots[m_head];
+					while (s.status == slot_t::status_t::pending)
+						reap();
+					if (s.error) _Unlikely_ {
+						m_state = to_read < length ? state_t::ok : state_t::fail;
+						m_ring->submit();
+						return length - to_read;
+					}
+					size_t available = s.length - s.pos;
+					if (!available) {
+						if (s.length < m_block_size) {
+							// Block ended with an empty read: end of file.
+							m_state = to_read < length || !length ? state_t::ok : state_t::eof;
+							m_ring->submit();
+							return length - to_read;
+						}
+						// Block consumed. Reuse its slot to read ahead.
+						queue_read(m_head);
+						m_head = (m_head + 1) % m_slots.size();
+						continue;
+					}
+					size_t num_read = std::min(available, to_read);
+					memcpy(data, s.data + s.pos, num_read);
+					s.pos += num_read;
+					to_read -= num_read;
+					if (!to_read) {
+						m_state = state_t::ok;
+						m_ring->submit();
+						return length;
+					}
+					reinterpret_cast<uint8_t*&>(data) += num_read;
+				}
+			}
+
+			virtual void close()
+			{
+				if (m_ring)
+					stop();
+				converter::close();
+			}
+
+		protected:
+			struct slot_t {
+				uint8_t* data;
+				fpos_t offset;
+				size_t length, pos;
+				int error;
+				enum class status_t {
+					idle = 0,
+					pending,
+					ready,
+				} status;
+
+				slot_t() :
+					data(nullptr),
+					offset(0),
+					length(0),
+					pos(0),
+					error(0),
+					status(status_t::idle)
+				{}
+			};
 
 			///
-			/// Loads content from file-system file
-			///
-			/// \param[in] filename  Filename
-			/// \param[in] mode      Bitwise combination of mode_t flags
+			/// Prepares read request for the next file block. Submitted on next uring::submit().
 			///
-			template <class TR = std::char_traits<schar_t>, class AX = std::allocator<schar_t>>
-			memory_file(_In_ const std::basic_string<TR, AX>& filename, _In_ int mode) : memory_file(filename.c_str(), mode) {}
+			void queue_read(_In_ size_t i)
+			{
+				auto& s = m_slots[i];
+				s.offset = m_offset;
+				s.length = s.pos = 0;
+				s.status = slot_t::status_t::pending;
+				m_offset += m_block_size;
+				queue_remainder(i);
+			}
+
+			void queue_remainder(_In_ size_t i)
+			{
+				auto& s = m_slots[i];
+				io_uring_sqe* sqe = m_ring->get_sqe();
+				stdex_assert(sqe);
+				sqe->opcode = m_fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+				sqe->fd = m_file.get();
+				sqe->addr = reinterpret_cast<uint64_t>(s.data + s.length);
+				sqe->len = static_cast<uint32_t>(m_block_size - s.length);
+				sqe->off = s.offset + s.length;
+				sqe->buf_index = m_fixed ? static_cast<uint16_t>(i) : 0;
+				sqe->user_data = i;
+			}
 
 			///
-			/// Copies content from another file
-			///
-			/// \param[in] other  Other file
+			/// Waits for a read request to complete
 			///
-			memory_file(_In_ const memory_file& other) :
-				basic_file(other),
-				m_data(reinterpret_cast<uint8_t*>(malloc(other.m_size))),
-				m_offset(other.m_offset),
-				m_size(other.m_size),
-				m_reserved(other.m_size),
-				m_manage(true)
-#if SET_FILE_OP_TIMES
-				, m_ctime(other.m_ctime)
-				, m_atime(other.m_atime)
-				, m_mtime(other.m_mtime)
-#endif
+			void reap()
 			{
-				if (!m_data) {
-					m_state = state_t::fail;
-					throw std::bad_alloc();
-				}
-				memcpy(m_data, other.m_data, other.m_size);
+				io_uring_cqe* cqe = m_ring->wait_cqe();
+				size_t i = static_cast<size_t>(cqe->user_data);
+				int res = cqe->res;
+				m_ring->seen();
+				complete(i, res);
 			}
 
 			///
-			/// Copies content from another file
+			/// Processes read request completion
 			///
-			/// \param[in] other  Other file
+			/// \param[in] i    Slot index
+			/// \param[in] res  Number of bytes read or negative error code
 			///
-			memory_file& operator=(_In_ const memory_file& other)
+			virtual void complete(_In_ size_t i, _In_ int res)
 			{
-				if (this != std::addressof(other)) {
-					*static_cast<basic_file*>(this) = other;
-					if (m_manage && m_data)
-						free(m_data);
-					m_data = reinterpret_cast<uint8_t*>(malloc(other.m_size));
-					if (!m_data) {
-						m_state = state_t::fail;
-						throw std::bad_alloc();
+				auto& s = m_slots[i];
+				if (res < 0) _Unlikely_
+					s.error = -res;
+				else if (res > 0) {
+					s.length += static_cast<size_t>(res);
+					if (s.length < m_block_size) {
+						// Short read does not imply end of file. Resubmit the remainder.
+						queue_remainder(i);
+						m_ring->submit();
+						return;
 					}
-					memcpy(m_data, other.m_data, other.m_size);
-					m_offset = other.m_offset;
-					m_size = other.m_size;
-					m_reserved = other.m_size;
-					m_manage = true;
-#if SET_FILE_OP_TIMES
-					m_ctime = other.m_ctime;
-					m_atime = other.m_atime;
-					m_mtime = other.m_mtime;
-#endif
 				}
-				return *this;
+				s.status = slot_t::status_t::ready;
 			}
 
 			///
-			/// Moves content from another file
-			///
-			/// \param[in] other  Other file
+			/// Waits for all requests to complete and sets file pointer to the logical position
 			///
-			memory_file(_Inout_ memory_file&& other) noexcept :
-				basic_file(std::move(other)),
-				m_data(other.m_data),
-				m_offset(other.m_offset),
-				m_size(other.m_size),
-				m_reserved(other.m_reserved),
-				m_manage(other.m_manage)
-#if SET_FILE_OP_TIMES
-				, m_ctime(other.m_ctime)
-				, m_atime(other.m_atime)
-				, m_mtime(other.m_mtime)
-#endif
+			void stop()
 			{
-				other.m_state = state_t::ok;
-				other.m_data = nullptr;
-				other.m_offset = 0;
-				other.m_size = 0;
-				other.m_reserved = 0;
-				other.m_manage = true;
-#if SET_FILE_OP_TIMES
-				other.m_ctime = other.m_atime = other.m_mtime = time_point::now();
-#endif
+				for (auto& s : m_slots)
+					while (s.status == slot_t::status_t::pending)
+						reap();
+				auto& s = m_slots[m_head];
+				m_file.seekbeg(s.offset + s.pos);
+				m_ring.reset();
 			}
 
+		protected:
+			file& m_file;
+			size_t m_block_size;
+			fpos_t m_offset; ///< File offset of the next read request
+			std::unique_ptr<uring> m_ring;
+			std::unique_ptr<uint8_t[]> m_data;
+			std::vector<slot_t> m_slots;
+			size_t m_head; ///< Index of slot to read data from
+			bool m_fixed; ///< Are buffers registered with io_uring?
+		};
+
+		///
+		/// Provides write-back for files using Linux io_uring
+		///
+		/// Keeps multiple writes of consecutive file blocks in flight. Unlike async_writer, no worker thread is involved.
+		/// Write errors are reported on the following write() or flush().
+		/// Should io_uring not be available, writes are passed to the source file synchronously.
+		/// The source file pointer is not maintained while writing. It is set to the logical position on flush, close or
+		/// destruction.
+		///
+		class uring_writer : public converter
+		{
+		public:
 			///
-			/// Moves content from another file
+			/// Starts writing the file at its current position
 			///
-			/// \param[in] other  Other file
+			/// \param[in] source      Source file
+			/// \param[in] block_size  Size of a single write request (in bytes)
+			/// \param[in] depth       Number of write requests in flight
 			///
-			memory_file& operator=(_Inout_ memory_file&& other) noexcept
-			{
-				if (this != std::addressof(other)) {
-					*static_cast<basic_file*>(this) = std::move(other);
-					if (m_manage && m_data)
-						free(m_data);
-					m_data = other.m_data;
-					other.m_data = nullptr;
-					m_offset = other.m_offset;
-					other.m_offset = 0;
-					m_size = other.m_size;
-					other.m_size = 0;
-					m_reserved = other.m_reserved;
-					other.m_reserved = 0;
-					m_manage = other.m_manage;
-					other.m_manage = true;
-#if SET_FILE_OP_TIMES
-					m_ctime = other.m_ctime;
-					m_atime = other.m_atime;
-					m_mtime = other.m_mtime;
-					other.m_ctime = other.m_atime = other.m_mtime = time_point::now();
-#endif
+			uring_writer(_Inout_ file& source, _In_ size_t block_size = default_uring_block_size, _In_ size_t depth = default_uring_depth) :
+				converter(source),
+				m_file(source),
+				m_block_size(block_size),
+				m_head(0),
+				m_fixed(false),
+				m_error(0)
+			{
+				if (!block_size || block_size > UINT_MAX || !depth || depth > UINT_MAX) _Unlikely_
+					throw std::invalid_argument("invalid io_uring block size or depth");
+				m_offset = source.tell();
+				if (m_offset == fpos_max) _Unlikely_
+					return;
+				try { m_ring.reset(new uring(static_cast<unsigned>(depth))); }
+				catch (const std::system_error&) { return; }
+				m_data.reset(new uint8_t[mul(block_size, depth)]);
+				m_slots.resize(depth);
+				std::vector<struct iovec> iov(depth);
+				for (size_t i = 0; i < depth; ++i) {
+					iov[i].iov_base = m_slots[i].data = m_data.get() + i * block_size;
+					iov[i].iov_len = block_size;
 				}
-				return *this;
+				m_fixed = m_ring->register_buffers(iov.data(), static_cast<unsigned>(depth));
 			}
 
-			virtual ~memory_file()
+			virtual ~uring_writer()
 			{
-				if (m_manage && m_data)
-					free(m_data);
+				if (m_ring)
+					sync();
 			}
 
-			///
-			/// Reallocates memory
-			///
-			/// \param[in] required  Demanded memory size
-			/// \param[in] tight     Don't over-allocate on grow, release excessive on decrease.
-			///
-			void reserve(_In_ size_t required, _In_ bool tight = false) noexcept
+			virtual _Success_(return != 0) size_t write(
+				_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
 			{
-				if (required <= m_reserved && (!tight || required >= m_reserved)) {
-					m_state = state_t::ok;
-					return;
-				}
-				if (!m_manage) {
+				stdex_assert(data || !length);
+				if (!m_ring) _Unlikely_
+					return converter::write(data, length);
+				if (m_error) _Unlikely_ {
 					m_state = state_t::fail;
-					return;
+					return 0;
 				}
-				size_t reserved = tight ? required : ((required + required / 4 + (default_block_size - 1)) / default_block_size) * default_block_size;
-				auto data = reinterpret_cast<uint8_t*>(realloc(m_data, reserved));
-				if (!data && reserved) _Unlikely_ {
-					m_state = state_t::fail;
-					return;
+				for (size_t to_write = length;;) {
+					auto& s = m_slots[m_head];
+					while (s.status == slot_t::status_t::pending)
+						reap();
+					size_t num_written = std::min(m_block_size - s.length, to_write);
+					memcpy(s.data + s.length, data, num_written);
+					s.length += num_written;
+					to_write -= num_written;
+					if (s.length == m_block_size) {
+						queue_write(m_head);
+						m_ring->submit();
+						m_head = (m_head + 1) % m_slots.size();
+					}
+					if (!to_write) {
+						m_state = state_t::ok;
+						return length;
+					}
+					reinterpret_cast<const uint8_t*&>(data) += num_written;
 				}
-				m_data = data;
-				if (reserved < m_size)
-					m_size = reserved;
-				m_reserved = reserved;
-				m_state = state_t::ok;
 			}
 
-			///
-			/// Loads content from a file-system file
-			///
-			/// \param[in] filename  Filename
-			/// \param[in] mode      Bitwise combination of mode_t flags
-			///
-			void load(_In_z_ const schar_t* filename, _In_ int mode)
+			virtual void flush()
 			{
-				file f(filename, (mode & ~hint_random_access) | mode_for_reading | hint_sequential_access);
-				if (!f.ok()) {
-					m_state = state_t::fail;
-					return;
+				if (m_ring) {
+					sync();
+					if (m_error) _Unlikely_ {
+						m_error = 0;
+						m_state = state_t::fail;
+						return;
+					}
 				}
-				fsize_t size = f.size();
-				if (size > SIZE_MAX) {
-					m_state = state_t::fail;
-					return;
+				converter::flush();
+			}
+
+			virtual void close()
+			{
+				if (m_ring) {
+					sync();
+					m_ring.reset();
 				}
-				reserve(static_cast<size_t>(size), true);
-				if (!ok()) _Unlikely_ {
-					return;
+				converter::close();
+				if (m_error) _Unlikely_ {
+					m_error = 0;
+					m_state = state_t::fail;
 				}
-				m_offset = m_size = 0;
-				write_stream(f);
-				if (ok())
-					m_offset = 0;
-#if SET_FILE_OP_TIMES
-				m_ctime = f.ctime();
-				m_atime = f.atime();
-				m_mtime = f.mtime();
-#endif
 			}
 
+		protected:
+			struct slot_t {
+				uint8_t* data;
+				fpos_t offset;
+				size_t length, done;
+				enum class status_t {
+					idle = 0,
+					pending,
+				} status;
+
+				slot_t() :
+					data(nullptr),
+					offset(0),
+					length(0),
+					done(0),
+					status(status_t::idle)
+				{}
+			};
+
 			///
-			/// Loads content from a file-system file
-			///
-			/// \param[in] filename  Filename
-			/// \param[in] mode      Bitwise combination of mode_t flags
+			/// Prepares write request for the slot data. Submitted on next uring::submit().
 			///
-			template <class TR = std::char_traits<schar_t>, class AX = std::allocator<schar_t>>
-			void load(_In_ const std::basic_string<TR, AX>& filename, _In_ int mode)
+			void queue_write(_In_ size_t i)
 			{
-				load(filename.c_str(), mode);
+				auto& s = m_slots[i];
+				s.offset = m_offset;
+				s.done = 0;
+				s.status = slot_t::status_t::pending;
+				m_offset += s.length;
+				queue_remainder(i);
+			}
+
+			void queue_remainder(_In_ size_t i)
+			{
+				auto& s = m_slots[i];
+				io_uring_sqe* sqe = m_ring->get_sqe();
+				stdex_assert(sqe);
+				sqe->opcode = m_fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+				sqe->fd = m_file.get();
+				sqe->addr = reinterpret_cast<uint64_t>(s.data + s.done);
+				sqe->len = static_cast<uint32_t>(s.length - s.done);
+				sqe->off = s.offset + s.done;
+				sqe->buf_index = m_fixed ? static_cast<uint16_t>(i) : 0;
+				sqe->user_data = i;
 			}
 
 			///
-			/// Saves content to a file-system file
+			/// Waits for a write request to complete
 			///
-			/// \param[in] filename  Filename
-			/// \param[in] mode      Bitwise combination of mode_t flags
+			void reap()
+			{
+				io_uring_cqe* cqe = m_ring->wait_cqe();
+				size_t i = static_cast<size_t>(cqe->user_data);
+				auto& s = m_slots[i];
+				int res = cqe->res;
+				m_ring->seen();
+				if (res > 0) {
+					s.done += static_cast<size_t>(res);
+					if (s.done < s.length) {
+						// Short write. Resubmit the remainder.
+						queue_remainder(i);
+						m_ring->submit();
+						return;
+					}
+				}
+				else if (!m_error) _Unlikely_
+					m_error = res ? -res : EIO;
+				s.length = s.done = 0;
+				s.status = slot_t::status_t::idle;
+			}
+
 			///
-			void save(_In_z_ const schar_t* filename, _In_ int mode)
+			/// Writes pending data, waits for all requests to complete and sets file pointer to the logical position
+			///
+			void sync()
 			{
-				file f(filename, (mode & ~hint_random_access) | mode_for_writing | hint_sequential_access);
-				if (!f.ok()) {
-					m_state = state_t::fail;
-					return;
+				if (m_slots[m_head].length) {
+					queue_write(m_head);
+					m_ring->submit();
+					m_head = (m_head + 1) % m_slots.size();
 				}
-				f.write(m_data, m_size);
-				if (!f.ok()) {
-					m_state = state_t::fail;
-					return;
-				}
-				f.truncate();
-#if SET_FILE_OP_TIMES
-				f.set_ctime(m_ctime);
-				f.set_atime(m_atime);
-				f.set_mtime(m_mtime);
+				for (auto& s : m_slots)
+					while (s.status == slot_t::status_t::pending)
+						reap();
+				m_file.seekbeg(m_offset);
+			}
+
+		protected:
+			file& m_file;
+			size_t m_block_size;
+			fpos_t m_offset; ///< File offset of the next write request
+			std::unique_ptr<uring> m_ring;
+			std::unique_ptr<uint8_t[]> m_data;
+			std::vector<slot_t> m_slots;
+			size_t m_head; ///< Index of slot to write data to
+			bool m_fixed; ///< Are buffers registered with io_uring?
+			int m_error; ///< First write error not reported yet
+		};
 #endif
+
+		///
+		/// Cached file-system file
+		///
+		class cached_file : public cache
+		{
+		public:
+			cached_file(_In_opt_ sys_handle h = invalid_handle, _In_ state_t state = state_t::ok, _In_ size_t cache_size = default_cache_size, _In_ size_t cache_pages = default_cache_pages) :
+				cache(cache_size, cache_pages),
+				m_source(h, state)
+			{
+				init(m_source);
 			}
 
 			///
-			/// Saves content to a file-system file
+			/// Opens file
 			///
-			/// \param[in] filename  Filename
-			/// \param[in] mode      Bitwise combination of mode_t flags
+			/// \param[in] filename     Filename
+			/// \param[in] mode         Bitwise combination of mode_t flags
+			/// \param[in] cache_size   Size of the cache page
+			/// \param[in] cache_pages  Number of cache pages
 			///
-			template <class TR = std::char_traits<schar_t>, class AX = std::allocator<schar_t>>
-			void save(_In_ const std::basic_string<TR, AX>& filename, _In_ int mode)
+			cached_file(_In_z_ const schar_t* filename, _In_ int mode, _In_ size_t cache_size = default_cache_size, _In_ size_t cache_pages = default_cache_pages) :
+				cache(cache_size, cache_pages),
+				m_source(filename, mode & mode_for_writing ? mode | mode_for_reading : mode)
 			{
-				save(filename.c_str(), mode);
+				init(m_source);
 			}
 
 			///
-			/// Returns pointer to data
+			/// Opens file
 			///
-			const void* data() const { return m_data; }
+			/// \param[in] filename     Filename
+			/// \param[in] mode         Bitwise combination of mode_t flags
+			/// \param[in] cache_size   Size of the cache page
+			/// \param[in] cache_pages  Number of cache pages
+			///
+			template <class TR = std::char_traits<schar_t>, class AX = std::allocator<schar_t>>
+			cached_file(_In_ const std::basic_string<TR, AX>& filename, _In_ int mode, _In_ size_t cache_size = default_cache_size, _In_ size_t cache_pages = default_cache_pages) : cached_file(filename.c_str(), mode, cache_size, cache_pages) {}
 
-			virtual _Success_(return != 0 || length == 0) size_t read(
-				_Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length)
+			virtual ~cached_file()
 			{
-				stdex_assert(data || !length);
-#if SET_FILE_OP_TIMES
-				m_atime = time_point::now();
-#endif
-				size_t available = m_size - m_offset;
-				if (length <= available) {
-					memcpy(data, &m_data[m_offset], length);
-					m_offset += length;
-					m_state = state_t::ok;
-					return length;
-				}
-				if (length && !available) {
-					m_state = state_t::eof;
-					return 0;
-				}
-				memcpy(data, &m_data[m_offset], available);
-				m_offset += available;
-				m_state = state_t::ok;
-				return available;
+				done();
 			}
 
 			///
-			/// Reads one primitive data type
-			///
-			/// This method is intended for chaining: e.g. stream.read_str(a).read_str(b).read_str(c)...
-			/// Since it would make it impossible to detect if any of the read_str(a) or read_str(b) failed should
-			/// read_str(c) succeed, the method skips reading if stream state is not ok.
-			///
-			/// As memory read rarely fails, a #define CHECK_STREAM_STATE 0 turns this checking off when
-			/// performance is paramount.
-			///
-			/// \param[in] data  Where to store read data
+			/// Opens file
 			///
-			/// \returns This stream
+			/// \param[in] filename    Filename
+			/// \param[in] mode        Bitwise combination of mode_t flags
 			///
-			template <class T>
-			memory_file& read_data(_Out_ T& data)
+			void open(_In_z_ const schar_t* filename, _In_ int mode)
 			{
-#if SET_FILE_OP_TIMES
-				m_atime = time_point::now();
-#endif
-				if (CHECK_STREAM_STATE && !ok()) _Unlikely_ {
-					data = 0;
-					return *this;
-				}
-				size_t end_offset = m_offset + sizeof(T);
-				if (end_offset <= m_size) {
-					data = LE2HE(*reinterpret_cast<T*>(&m_data[m_offset]));
-					m_offset = end_offset;
-#if !CHECK_STREAM_STATE
-					m_state = state_t::ok;
-#endif
+				invalidate_cache();
+				if (!ok()) _Unlikely_{
+					m_state = state_t::fail;
+					return;
 				}
-				else {
-					data = 0;
-					m_offset = m_size;
-					m_state = state_t::eof;
+				m_source.open(filename, mode & mode_for_writing ? mode | mode_for_reading : mode);
+				if (m_source.ok()) {
+					init();
+					return;
 				}
-				return *this;
+				m_state = state_t::fail;
 			}
 
 			///
-			/// Reads length-prefixed string from the stream
-			///
-			/// This method is intended for chaining: e.g. stream.read_str(a).read_str(b).read_str(c)...
-			/// Since it would make it impossible to detect if any of the read_str(a) or read_str(b) failed should
-			/// read_str(c) succeed, the method skips reading if stream state is not ok.
+			/// Opens file
 			///
-			/// As memory read rarely fails, a #define CHECK_STREAM_STATE 0 turns this checking off when
-			/// performance is paramount.
+			/// \param[in] filename    Filename
+			/// \param[in] mode        Bitwise combination of mode_t flags
 			///
-			/// \param[in] data  String to read to
+			template <class TR = std::char_traits<schar_t>, class AX = std::allocator<schar_t>>
+			void open(_In_ const std::basic_string<TR, AX>& filename, _In_ int mode)
+			{
+				open(filename.c_str(), mode);
+			}
+
 			///
-			/// \return This stream
+			/// Returns true if file has a valid handle
 			///
-			template<class T, class TR = std::char_traits<T>, class AX = std::allocator<T>>
-			memory_file& read_str(_Inout_ std::basic_string<T, TR, AX>&data)
+			operator bool() const noexcept { return m_source; }
+
+		protected:
+			file m_source;
+		};
+
+		///
+		/// In-memory file
+		///
+		class memory_file : public basic_file
+		{
+		public:
+			memory_file(_In_ state_t state = state_t::ok) :
+				basic(state),
+				m_data(nullptr),
+				m_offset(0),
+				m_size(0),
+				m_reserved(0),
+				m_manage(true)
 			{
 #if SET_FILE_OP_TIMES
-				m_atime = time_point::now();
-#endif
-				if (CHECK_STREAM_STATE && !ok()) _Unlikely_ {
-					data.clear();
-					return *this;
-				}
-				size_t end_offset = m_offset + sizeof(uint32_t);
-				if (end_offset <= m_size) {
-					uint32_t num_chars = LE2HE(*reinterpret_cast<uint32_t*>(&m_data[m_offset]));
-					m_offset = end_offset;
-					end_offset = stdex::add(m_offset, stdex::mul(num_chars, sizeof(T)));
-					T* start = reinterpret_cast<T*>(&m_data[m_offset]);
-					if (end_offset <= m_size) {
-						data.assign(start, start + num_chars);
-						m_offset = end_offset;
-#if !CHECK_STREAM_STATE
-						m_state = state_t::ok;
+				m_ctime = m_atime = m_mtime = time_point::now();
 #endif
-						return *this;
-					}
-					if (end_offset <= m_size)
-						data.assign(start, reinterpret_cast<T*>(&m_data[m_size]));
-				}
-				m_offset = m_size;
-				m_state = state_t::eof;
-				return *this;
 			}
 
-			virtual _Success_(return != 0) size_t write(
-				_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
+			///
+			/// Creates an empty file of reserved size
+			///
+			/// \param[in] size   Reserved size
+			/// \param[in] state  Initial stream state
+			///
+			memory_file(_In_ size_t size, _In_ state_t state = state_t::ok) :
+				basic(state),
+				m_data(reinterpret_cast<uint8_t*>(malloc(size))),
+				m_offset(0),
+				m_size(0),
+				m_reserved(size),
+				m_manage(true)
 			{
-				stdex_assert(data || !length);
+				if (!m_data) {
+					m_state = state_t::fail;
+					throw std::bad_alloc();
+				}
 #if SET_FILE_OP_TIMES
-				m_atime = m_mtime = time_point::now();
+				m_ctime = m_atime = m_mtime = time_point::now();
 #endif
-				size_t end_offset = m_offset + length;
-				if (end_offset > m_reserved) {
-					reserve(end_offset);
-					if (!ok()) _Unlikely_
-						return 0;
-				}
-				memcpy(&m_data[m_offset], data, length);
-				m_offset = end_offset;
-				if (m_offset > m_size)
-					m_size = m_offset;
-				m_state = state_t::ok;
-				return length;
 			}
 
 			///
-			/// Writes a byte of data
+			/// Creates a file based on available data
 			///
-			void write_byte(_In_ uint8_t byte, _In_ size_t amount = 1)
+			/// \param[in] data      Pointer to data
+			/// \param[in] size      Valid data size
+			/// \param[in] reserved  Reserved data size
+			/// \param[in] manage    Is input data allocated using malloc() and this class may reallocate data?
+			/// \param[in] state     Initial stream state
+			///
+			memory_file(_Inout_ void* data, _In_ size_t size, _In_ size_t reserved, _In_ bool manage = false, _In_ state_t state = state_t::ok) :
+				basic(state),
+				m_data(reinterpret_cast<uint8_t*>(data)),
+				m_offset(0),
+				m_size(size),
+				m_reserved(reserved),
+				m_manage(manage)
 			{
+				stdex_assert(data || !size);
+				stdex_assert(reserved >= size);
 #if SET_FILE_OP_TIMES
-				m_atime = m_mtime = time_point::now();
+				m_ctime = m_atime = m_mtime = time_point::now();
 #endif
-				size_t end_offset = m_offset + amount;
-				if (end_offset > m_reserved) {
-					reserve(end_offset);
-					if (!ok()) _Unlikely_
-						return;
-				}
-				memset(&m_data[m_offset], byte, amount);
-				m_offset = end_offset;
-				if (m_offset > m_size)
-					m_size = m_offset;
-				m_state = state_t::ok;
 			}
 
 			///
-			/// Writes one primitive data type
+			/// Creates a file based on available data
 			///
-			/// This method is intended for chaining: e.g. stream.write_data(a).write_data(b).write_data(c)...
-			/// Since it would make it impossible to detect if any of the write_data(a) or write_data(b) failed should
-			/// write_data(c) succeed, the method skips writing if stream state is not ok.
+			/// \param[in] data      Pointer to data
+			/// \param[in] size      Valid and reserved data size
+			/// \param[in] manage    Is input data allocated using malloc() and this class may reallocate data?
+			/// \param[in] state     Initial stream state
 			///
-			/// As memory write rarely fails, a #define CHECK_STREAM_STATE 0 turns this checking off when
-			/// performance is paramount.
+			memory_file(_Inout_ void* data, _In_ size_t size, _In_ bool manage = false, _In_ state_t state = state_t::ok) :
+				memory_file(data, size, size, manage, state)
+			{}
+
 			///
-			/// \param[in] data  Data to write
+			/// Loads content from file-system file
 			///
-			/// \returns This stream
+			/// \param[in] filename  Filename
+			/// \param[in] mode      Bitwise combination of mode_t flags
 			///
-			template <class T>
-			memory_file& write_data(const T data)
+			memory_file(_In_z_ const schar_t* filename, _In_ int mode) : memory_file()
 			{
+				load(filename, mode);
+			}
+
+			///
+			/// Loads content from file-system file
+			///
+			/// \param[in] filename  Filename
+			/// \param[in] mode      Bitwise combination of mode_t flags
+			///
+			template <class TR = std::char_traits<schar_t>, class AX = std::allocator<schar_t>>
+			memory_file(_In_ const std::basic_string<TR, AX>& filename, _In_ int mode) : memory_file(filename.c_str(), mode) {}
+
+			///
+			/// Copies content from another file
+			///
+			/// \param[in] other  Other file
+			///
+			memory_file(_In_ const memory_file& other) :
+				basic_file(other),
+				m_data(reinterpret_cast<uint8_t*>(malloc(other.m_size))),
+				m_offset(other.m_offset),
+				m_size(other.m_size),
+				m_reserved(other.m_size),
+				m_manage(true)
 #if SET_FILE_OP_TIMES
-				m_atime = m_mtime = time_point::now();
+				, m_ctime(other.m_ctime)
+				, m_atime(other.m_atime)
+				, m_mtime(other.m_mtime)
 #endif
-				if (CHECK_STREAM_STATE && !ok()) _Unlikely_
-					return *this;
-				size_t end_offset = m_offset + sizeof(T);
-				if (end_offset > m_reserved) {
-					reserve(end_offset);
-					if (!ok()) _Unlikely_
-						return *this;
+			{
+				if (!m_data) {
+					m_state = state_t::fail;
+					throw std::bad_alloc();
 				}
-				(*reinterpret_cast<T*>(&m_data[m_offset])) = HE2LE(data);
-				m_offset = end_offset;
-				if (m_offset > m_size)
-					m_size = m_offset;
-#if !CHECK_STREAM_STATE
-				m_state = state_t::ok;
+				memcpy(m_data, other.m_data, other.m_size);
+			}
+
+			///
+			/// Copies content from another file
+			///
+			/// \param[in] other  Other file
+			///
+			memory_file& operator=(_In_ const memory_file& other)
+			{
+				if (this != std::addressof(other)) {
+					*static_cast<basic_file*>(this) = other;
+					if (m_manage && m_data)
+						free(m_data);
+					m_data = reinterpret_cast<uint8_t*>(malloc(other.m_size));
+					if (!m_data) {
+						m_state = state_t::fail;
+						throw std::bad_alloc();
+					}
+					memcpy(m_data, other.m_data, other.m_size);
+					m_offset = other.m_offset;
+					m_size = other.m_size;
+					m_reserved = other.m_size;
+					m_manage = true;
+#if SET_FILE_OP_TIMES
+					m_ctime = other.m_ctime;
+					m_atime = other.m_atime;
+					m_mtime = other.m_mtime;
 #endif
+				}
 				return *this;
 			}
 
 			///
-			/// Writes string to the stream length-prefixed
+			/// Moves content from another file
 			///
-			/// This method is intended for chaining: e.g. stream.write_str(a).write_str(b).write_str(c)...
-			/// Since it would make it impossible to detect if any of the write_str(a) or write_str(b) failed should
-			/// write_str(c) succeed, the method skips writing if stream state is not ok.
+			/// \param[in] other  Other file
 			///
-			/// As memory write rarely fails, a #define CHECK_STREAM_STATE 0 turns this checking off when
-			/// performance is paramount.
+			memory_file(_Inout_ memory_file&& other) noexcept :
+				basic_file(std::move(other)),
+				m_data(other.m_data),
+				m_offset(other.m_offset),
+				m_size(other.m_size),
+				m_reserved(other.m_reserved),
+				m_manage(other.m_manage)
+#if SET_FILE_OP_TIMES
+				, m_ctime(other.m_ctime)
+				, m_atime(other.m_atime)
+				, m_mtime(other.m_mtime)
+#endif
+			{
+				other.m_state = state_t::ok;
+				other.m_data = nullptr;
+				other.m_offset = 0;
+				other.m_size = 0;
+				other.m_reserved = 0;
+				other.m_manage = true;
+#if SET_FILE_OP_TIMES
+				other.m_ctime = other.m_atime = other.m_mtime = time_point::now();
+#endif
+			}
+
 			///
-			/// \param[in] data  String to write
+			/// Moves content from another file
 			///
-			/// \return This stream
+			/// \param[in] other  Other file
 			///
-			template <class T>
-			memory_file& write_str(_In_z_ const T * data)
+			memory_file& operator=(_Inout_ memory_file&& other) noexcept
 			{
+				if (this != std::addressof(other)) {
+					*static_cast<basic_file*>(this) = std::move(other);
+					if (m_manage && m_data)
+						free(m_data);
+					m_data = other.m_data;
+					other.m_data = nullptr;
+					m_offset = other.m_offset;
+					other.m_offset = 0;
+					m_size = other.m_size;
+					other.m_size = 0;
+					m_reserved = other.m_reserved;
+					other.m_reserved = 0;
+					m_manage = other.m_manage;
+					other.m_manage = true;
 #if SET_FILE_OP_TIMES
-				m_atime = m_mtime = time_point::now();
+					m_ctime = other.m_ctime;
+					m_atime = other.m_atime;
+					m_mtime = other.m_mtime;
+					other.m_ctime = other.m_atime = other.m_mtime = time_point::now();
 #endif
-				if (CHECK_STREAM_STATE && !ok()) _Unlikely_
-					return *this;
-				size_t num_chars = stdex::strlen(data);
-				if (num_chars > UINT32_MAX)
-					throw std::invalid_argument("string too long");
-				size_t size_chars = num_chars * sizeof(T);
-				size_t size = sizeof(uint32_t) + size_chars;
-				size_t end_offset = m_offset + size;
-				if (end_offset > m_reserved) {
-					reserve(end_offset);
-					if (!ok()) _Unlikely_
-						return *this;
 				}
-				auto p = &m_data[m_offset];
-				*reinterpret_cast<uint32_t*>(p) = HE2LE((uint32_t)num_chars);
-				memcpy(p + sizeof(uint32_t), data, size_chars);
-				m_offset = end_offset;
-				if (m_offset > m_size)
-					m_size = m_offset;
-#if !CHECK_STREAM_STATE
-				m_state = state_t::ok;
-#endif
 				return *this;
 			}
 
+			virtual ~memory_file()
+			{
+				if (m_manage && m_data)
+					free(m_data);
+			}
+
 			///
-			/// Writes string to the stream length-prefixed
+			/// Reallocates memory
 			///
-			/// This method is intended for chaining: e.g. stream.write_str(a).write_str(b).write_str(c)...
-			/// Since it would make it impossible to detect if any of the write_str(a) or write_str(b) failed should
-			/// write_str(c) succeed, the method skips writing if stream state is not ok.
+			/// \param[in] required  Demanded memory size
+			/// \param[in] tight     Don't over-allocate on grow, release excessive on decrease.
 			///
-			/// As memory write rarely fails, a #define CHECK_STREAM_STATE 0 turns this checking off when
-			/// performance is paramount.
+			void reserve(_In_ size_t required, _In_ bool tight = false) noexcept
+			{
+				if (required <= m_reserved && (!tight || required >= m_reserved)) {
+					m_state = state_t::ok;
+					return;
+				}
+				if (!m_manage) {
+					m_state = state_t::fail;
+					return;
+				}
+				size_t reserved = tight ? required : ((required + required / 4 + (default_block_size - 1)) / default_block_size) * default_block_size;
+				auto data = reinterpret_cast<uint8_t*>(realloc(m_data, reserved));
+				if (!data && reserved) _Unlikely_ {
+					m_state = state_t::fail;
+					return;
+				}
+				m_data = data;
+				if (reserved < m_size)
+					m_size = reserved;
+				m_reserved = reserved;
+				m_state = state_t::ok;
+			}
+
 			///
-			/// \param[in] data  String to write
+			/// Loads content from a file-system file
 			///
-			/// \return This stream
+			/// \param[in] filename  Filename
+			/// \param[in] mode      Bitwise combination of mode_t flags
 			///
-			template<class T, class TR = std::char_traits<T>, class AX = std::allocator<T>>
-			memory_file& write_str(_In_ const std::basic_string<T, TR, AX>& data)
+			void load(_In_z_ const schar_t* filename, _In_ int mode)
 			{
-#if SET_FILE_OP_TIMES
-				m_atime = m_mtime = time_point::now();
-#endif
-				if (CHECK_STREAM_STATE && !ok()) _Unlikely_
-					return *this;
-				size_t num_chars = data.size();
-				if (num_chars > UINT32_MAX)
-					throw std::invalid_argument("string too long");
-				size_t size_chars = num_chars * sizeof(T);
-				size_t size = sizeof(uint32_t) + size_chars;
-				size_t end_offset = m_offset + size;
-				if (end_offset > m_reserved) {
-					reserve(end_offset);
-					if (!ok()) _Unlikely_
-						return *this;
+				file f(filename, (mode & ~hint_random_access) | mode_for_reading | hint_sequential_access);
+				if (!f.ok()) {
+					m_state = state_t::fail;
+					return;
 				}
-				auto p = &m_data[m_offset];
-				*reinterpret_cast<uint32_t*>(p) = HE2LE((uint32_t)num_chars);
-				memcpy(p + sizeof(uint32_t), data.data(), size_chars);
-				m_offset = end_offset;
-				if (m_offset > m_size)
-					m_size = m_offset;
-#if !CHECK_STREAM_STATE
-				m_state = state_t::ok;
+				fsize_t size = f.size();
+				if (size > SIZE_MAX) {
+					m_state = state_t::fail;
+					return;
+				}
+				reserve(static_cast<size_t>(size), true);
+				if (!ok()) _Unlikely_ {
+					return;
+				}
+				m_offset = m_size = 0;
+				write_stream(f);
+				if (ok())
+					m_offset = 0;
+#if SET_FILE_OP_TIMES
+				m_ctime = f.ctime();
+				m_atime = f.atime();
+				m_mtime = f.mtime();
 #endif
-				return *this;
 			}
 
 			///
-			/// Writes content of another stream
+			/// Loads content from a file-system file
 			///
-			/// \return Number of bytes written
+			/// \param[in] filename  Filename
+			/// \param[in] mode      Bitwise combination of mode_t flags
 			///
-			size_t write_stream(_Inout_ basic & stream, _In_ size_t amount = SIZE_MAX)
+			template <class TR = std::char_traits<schar_t>, class AX = std::allocator<schar_t>>
+			void load(_In_ const std::basic_string<TR, AX>& filename, _In_ int mode)
 			{
-#if SET_FILE_OP_TIMES
-				m_atime = m_mtime = time_point::now();
-#endif
+				load(filename.c_str(), mode);
+			}
+
+			///
+			/// Saves content to a file-system file
+			///
+			/// \param[in] filename  Filename
+			/// \param[in] mode      Bitwise combination of mode_t flags
+			///
+			void save(_In_z_ const schar_t* filename, _In_ int mode)
+			{
+				file f(filename, (mode & ~hint_random_access) | mode_for_writing | hint_sequential_access);
+				if (!f.ok()) {
+					m_state = state_t::fail;
+					return;
+				}
+				f.write(m_data, m_size);
+				if (!f.ok()) {
+					m_state = state_t::fail;
+					return;
+				}
+				f.truncate();
+#if SET_FILE_OP_TIMES
+				f.set_ctime(m_ctime);
+				f.set_atime(m_atime);
+				f.set_mtime(m_mtime);
+#endif
+			}
+
+			///
+			/// Saves content to a file-system file
+			///
+			/// \param[in] filename  Filename
+			/// \param[in] mode      Bitwise combination of mode_t flags
+			///
+			template <class TR = std::char_traits<schar_t>, class AX = std::allocator<schar_t>>
+			void save(_In_ const std::basic_string<TR, AX>& filename, _In_ int mode)
+			{
+				save(filename.c_str(), mode);
+			}
+
+			///
+			/// Returns pointer to data
+			///
+			const void* data() const { return m_data; }
+
+			virtual _Success_(return != 0 || length == 0) size_t read(
+				_Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length)
+			{
+				stdex_assert(data || !length);
+#if SET_FILE_OP_TIMES
+				m_atime = time_point::now();
+#endif
+				size_t available = m_size - m_offset;
+				if (length <= available) {
+					memcpy(data, &m_data[m_offset], length);
+					m_offset += length;
+					m_state = state_t::ok;
+					return length;
+				}
+				if (length && !available) {
+					m_state = state_t::eof;
+					return 0;
+				}
+				memcpy(data, &m_data[m_offset], available);
+				m_offset += available;
+				m_state = state_t::ok;
+				return available;
+			}
+
+			virtual bool read_until(_In_ uint8_t delim, _Outptr_result_bytebuffer_(length) const void*& data, _Out_ size_t& length)
+			{
+#if SET_FILE_OP_TIMES
+				m_atime = time_point::now();
+#endif
+				data = m_data + m_offset;
+				if (m_offset >= m_size) {
+					length = 0;
+					m_state = state_t::eof;
+					return true;
+				}
+				size_t available = m_size - m_offset;
+				auto end = reinterpret_cast<const uint8_t*>(memchr(m_data + m_offset, delim, available));
+				length = end ? static_cast<size_t>(end - (m_data + m_offset)) + 1 : available;
+				m_offset += length;
+				m_state = state_t::ok;
+				return true;
+			}
+
+			virtual bool peek(_In_ size_t length, _Outptr_result_bytebuffer_(available) const void*& data, _Out_ size_t& available)
+			{
+#if SET_FILE_OP_TIMES
+				m_atime = time_point::now();
+#endif
+				data = m_data + m_offset;
+				available = m_offset < m_size ? m_size - m_offset : 0;
+				m_state = available || !length ? state_t::ok : state_t::eof;
+				return true;
+			}
+
+			virtual void consume(_In_ size_t length)
+			{
+				stdex_assert(m_offset + length <= m_size);
+				m_offset += length;
+				m_state = state_t::ok;
+			}
+
+#if __cpp_impl_coroutine >= 201902L
+			virtual bool async_submit(_Inout_ async_request& req)
+			{
+				// Memory operations do not block. Complete them in place.
+				req.result = req.op == async_request::op_t::read ?
+					req.stream->read(req.data, req.length) :
+					req.stream->write(req.data, req.length);
+				return true;
+			}
+#endif
+
+			virtual size_t readv(_In_reads_(count) const iovec_t* iov, _In_ size_t count)
+			{
+				stdex_assert(iov || !count);
+#if SET_FILE_OP_TIMES
+				m_atime = time_point::now();
+#endif
+				size_t total = 0;
+				for (size_t i = 0; i < count; ++i) {
+					size_t available = m_offset < m_size ? m_size - m_offset : 0;
+					if (iov[i].length > available) {
+						memcpy(iov[i].data, &m_data[m_offset], available);
+						m_offset += available;
+						total += available;
+						m_state = total ? state_t::ok : state_t::eof;
+						return total;
+					}
+					memcpy(iov[i].data, &m_data[m_offset], iov[i].length);
+					m_offset += iov[i].length;
+					total += iov[i].length;
+				}
+				m_state = state_t::ok;
+				return total;
+			}
+
+			virtual _Success_(return != 0 || length == 0) size_t read_at(
+				_In_ fpos_t offset, _Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length,
+				_Out_opt_ state_t* state = nullptr)
+			{
+				stdex_assert(data || !length);
+				if (offset >= m_size) {
+					if (state) *state = length ? state_t::eof : state_t::ok;
+					return 0;
+				}
+				size_t num_read = std::min<size_t>(length, m_size - static_cast<size_t>(offset));
+				memcpy(data, m_data + static_cast<size_t>(offset), num_read);
+				if (state) *state = state_t::ok;
+				return num_read;
+			}
+
+			///
+			/// Reads one primitive data type
+			///
+			/// This method is intended for chaining: e.g. stream.read_str(a).read_str(b).read_str(c)...
+			/// Since it would make it impossible to detect if any of the read_str(a) or read_str(b) failed should
+			/// read_str(c) succeed, the method skips reading if stream state is not ok.
+			///
+			/// As memory read rarely fails, a #define CHECK_STREAM_STATE 0 turns this checking off when
+			/// performance is paramount.
+			///
+			/// \param[in] data  Where to store read data
+			///
+			/// \returns This stream
+			///
+			template <class T>
+			memory_file& read_data(_Out_ T& data)
+			{
+#if SET_FILE_OP_TIMES
+				m_atime = time_point::now();
+#endif
+				if (CHECK_STREAM_STATE && !ok()) _Unlikely_ {
+					data = 0;
+					return *this;
+				}
+				size_t end_offset = m_offset + sizeof(T);
+				if (end_offset <= m_size) {
+					data = LE2HE(*reinterpret_cast<T*>(&m_data[m_offset]));
+					m_offset = end_offset;
+#if !CHECK_STREAM_STATE
+					m_state = state_t::ok;
+#endif
+				}
+				else {
+					data = 0;
+					m_offset = m_size;
+					m_state = state_t::eof;
+				}
+				return *this;
+			}
+
+			///
+			/// Reads an array of primitive data type
+			///
+			/// Copies all elements at once and converts them from little-endian in place.
+			/// Like read_data(T&), the method skips reading if stream state is not ok.
+			///
+			/// \param[out] data   Where to store read data
+			/// \param[in]  count  Number of elements to read
+			///
+			/// \returns This stream. On EOF, elements not read are zeroed and stream state is set to state_t::eof.
+			///
+			template <class T>
+			memory_file& read_data(_Out_writes_(count) T* data, _In_ size_t count)
+			{
+#if SET_FILE_OP_TIMES
+				m_atime = time_point::now();
+#endif
+				size_t num_read = 0;
+				if (!CHECK_STREAM_STATE || ok()) _Likely_ {
+					num_read = std::min(count, (m_size - std::min(m_offset, m_size)) / sizeof(T));
+					if (num_read)
+						memcpy(data, m_data + m_offset, num_read * sizeof(T));
+#if BYTE_ORDER == BIG_ENDIAN
+					stdex::byteswap(data, num_read);
+#endif
+					m_offset += num_read * sizeof(T);
+					m_state = state_t::ok;
+					if (num_read < count) _Unlikely_ {
+						m_offset = m_size;
+						m_state = state_t::eof;
+					}
+				}
+				if (num_read < count) _Unlikely_
+					memset(data + num_read, 0, (count - num_read) * sizeof(T));
+				return *this;
+			}
+
+			///
+			/// Reads length-prefixed string from the stream
+			///
+			/// This method is intended for chaining: e.g. stream.read_str(a).read_str(b).read_str(c)...
+			/// Since it would make it impossible to detect if any of the read_str(a) or read_str(b) failed should
+			/// read_str(c) succeed, the method skips reading if stream state is not ok.
+			///
+			/// As memory read rarely fails, a #define CHECK_STREAM_STATE 0 turns this checking off when
+			/// performance is paramount.
+			///
+			/// \param[in] data  String to read to
+			///
+			/// \return This stream
+			///
+			template<class T, class TR = std::char_traits<T>, class AX = std::allocator<T>>
+			memory_file& read_str(_Inout_ std::basic_string<T, TR, AX>&data)
+			{
+#if SET_FILE_OP_TIMES
+				m_atime = time_point::now();
+#endif
+				if (CHECK_STREAM_STATE && !ok()) _Unlikely_ {
+					data.clear();
+					return *this;
+				}
+				size_t end_offset = m_offset + sizeof(uint32_t);
+				if (end_offset <= m_size) {
+					uint32_t num_chars = LE2HE(*reinterpret_cast<uint32_t*>(&m_data[m_offset]));
+					m_offset = end_offset;
+					end_offset = stdex::add(m_offset, stdex::mul(num_chars, sizeof(T)));
+					T* start = reinterpret_cast<T*>(&m_data[m_offset]);
+					if (end_offset <= m_size) {
+						data.assign(start, start + num_chars);
+						m_offset = end_offset;
+#if !CHECK_STREAM_STATE
+						m_state = state_t::ok;
+#endif
+						return *this;
+					}
+					if (end_offset <= m_size)
+						data.assign(start, reinterpret_cast<T*>(&m_data[m_size]));
+				}
+				m_offset = m_size;
+				m_state = state_t::eof;
+				return *this;
+			}
+
+			virtual _Success_(return != 0) size_t write(
+				_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
+			{
+				stdex_assert(data || !length);
+#if SET_FILE_OP_TIMES
+				m_atime = m_mtime = time_point::now();
+#endif
+				size_t end_offset = m_offset + length;
+				if (end_offset > m_reserved) {
+					reserve(end_offset);
+					if (!ok()) _Unlikely_
+						return 0;
+				}
+				memcpy(&m_data[m_offset], data, length);
+				m_offset = end_offset;
+				if (m_offset > m_size)
+					m_size = m_offset;
+				m_state = state_t::ok;
+				return length;
+			}
+
+			virtual size_t writev(_In_reads_(count) const const_iovec_t* iov, _In_ size_t count)
+			{
+				stdex_assert(iov || !count);
+#if SET_FILE_OP_TIMES
+				m_atime = m_mtime = time_point::now();
+#endif
+				size_t length = 0;
+				for (size_t i = 0; i < count; ++i)
+					length = stdex::add(length, iov[i].length);
+				size_t end_offset = m_offset + length;
+				if (end_offset > m_reserved) {
+					reserve(end_offset);
+					if (!ok()) _Unlikely_
+						return 0;
+				}
+				for (size_t i = 0; i < count; ++i) {
+					memcpy(&m_data[m_offset], iov[i].data, iov[i].length);
+					m_offset += iov[i].length;
+				}
+				if (m_offset > m_size)
+					m_size = m_offset;
+				m_state = state_t::ok;
+				return length;
+			}
+
+			///
+			/// Writes block of data to given file position without moving the file pointer
+			///
+			/// Concurrent calls are safe only when each of them ends within the current file size and SET_FILE_OP_TIMES
+			/// is 0. A call extending the file zero-fills the gap and updates the size, and must not run concurrently
+			/// with other write_at() or read_at() calls.
+			///
+			virtual _Success_(return != 0) size_t write_at(
+				_In_ fpos_t offset, _In_reads_bytes_opt_(length) const void* data, _In_ size_t length,
+				_Out_opt_ state_t* state = nullptr)
+			{
+				stdex_assert(data || !length);
+#if SET_FILE_OP_TIMES
+				m_atime = m_mtime = time_point::now();
+#endif
+				if (offset > SIZE_MAX) _Unlikely_
+					throw std::invalid_argument("file offset too big");
+				size_t end_offset = stdex::add(static_cast<size_t>(offset), length);
+				if (end_offset > m_reserved) {
+					state_t state_orig = m_state;
+					reserve(end_offset);
+					bool succeeded = ok();
+					m_state = state_orig;
+					if (!succeeded) _Unlikely_ {
+						if (state) *state = state_t::fail;
+						return 0;
+					}
+				}
+				if (offset > m_size)
+					memset(&m_data[m_size], 0, static_cast<size_t>(offset) - m_size);
+				memcpy(&m_data[static_cast<size_t>(offset)], data, length);
+				if (end_offset > m_size)
+					m_size = end_offset;
+				if (state) *state = state_t::ok;
+				return length;
+			}
+
+			///
+			/// Writes a byte of data
+			///
+			void write_byte(_In_ uint8_t byte, _In_ size_t amount = 1)
+			{
+#if SET_FILE_OP_TIMES
+				m_atime = m_mtime = time_point::now();
+#endif
+				size_t end_offset = m_offset + amount;
+				if (end_offset > m_reserved) {
+					reserve(end_offset);
+					if (!ok()) _Unlikely_
+						return;
+				}
+				memset(&m_data[m_offset], byte, amount);
+				m_offset = end_offset;
+				if (m_offset > m_size)
+					m_size = m_offset;
+				m_state = state_t::ok;
+			}
+
+			///
+			/// Writes one primitive data type
+			///
+			/// This method is intended for chaining: e.g. stream.write_data(a).write_data(b).write_data(c)...
+			/// Since it would make it impossible to detect if any of the write_data(a) or write_data(b) failed should
+			/// write_data(c) succeed, the method skips writing if stream state is not ok.
+			///
+			/// As memory write rarely fails, a #define CHECK_STREAM_STATE 0 turns this checking off when
+			/// performance is paramount.
+			///
+			/// \param[in] data  Data to write
+			///
+			/// \returns This stream
+			///
+			template <class T>
+			memory_file& write_data(const T data)
+			{
+#if SET_FILE_OP_TIMES
+				m_atime = m_mtime = time_point::now();
+#endif
+				if (CHECK_STREAM_STATE && !ok()) _Unlikely_
+					return *this;
+				size_t end_offset = m_offset + sizeof(T);
+				if (end_offset > m_reserved) {
+					reserve(end_offset);
+					if (!ok()) _Unlikely_
+						return *this;
+				}
+				(*reinterpret_cast<T*>(&m_data[m_offset])) = HE2LE(data);
+				m_offset = end_offset;
+				if (m_offset > m_size)
+					m_size = m_offset;
+#if !CHECK_STREAM_STATE
+				m_state = state_t::ok;
+#endif
+				return *this;
+			}
+
+			///
+			/// Writes an array of primitive data type
+			///
+			/// Copies all elements at once and converts them to little-endian in place.
+			/// Like write_data(T), the method skips writing if stream state is not ok.
+			///
+			/// \param[in] data   Data to write
+			/// \param[in] count  Number of elements to write
+			///
+			/// \returns This stream
+			///
+			template <class T>
+			memory_file& write_data(_In_reads_(count) const T* data, _In_ size_t count)
+			{
+#if SET_FILE_OP_TIMES
+				m_atime = m_mtime = time_point::now();
+#endif
+				if ((CHECK_STREAM_STATE && !ok()) || !count) _Unlikely_
+					return *this;
+				size_t end_offset = m_offset + mul(sizeof(T), count);
+				if (end_offset > m_reserved) {
+					reserve(end_offset);
+					if (!ok()) _Unlikely_
+						return *this;
+				}
+				memcpy(m_data + m_offset, data, count * sizeof(T));
+#if BYTE_ORDER == BIG_ENDIAN
+				stdex::byteswap(reinterpret_cast<T*>(m_data + m_offset), count);
+#endif
+				m_offset = end_offset;
+				if (m_offset > m_size)
+					m_size = m_offset;
+#if !CHECK_STREAM_STATE
+				m_state = state_t::ok;
+#endif
+				return *this;
+			}
+
+			///
+			/// Writes string to the stream length-prefixed
+			///
+			/// This method is intended for chaining: e.g. stream.write_str(a).write_str(b).write_str(c)...
+			/// Since it would make it impossible to detect if any of the write_str(a) or write_str(b) failed should
+			/// write_str(c) succeed, the method skips writing if stream state is not ok.
+			///
+			/// As memory write rarely fails, a #define CHECK_STREAM_STATE 0 turns this checking off when
+			/// performance is paramount.
+			///
+			/// \param[in] data  String to write
+			///
+			/// \return This stream
+			///
+			template <class T>
+			memory_file& write_str(_In_z_ const T * data)
+			{
+#if SET_FILE_OP_TIMES
+				m_atime = m_mtime = time_point::now();
+#endif
+				if (CHECK_STREAM_STATE && !ok()) _Unlikely_
+					return *this;
+				size_t num_chars = stdex::strlen(data);
+				if (num_chars > UINT32_MAX)
+					throw std::invalid_argument("string too long");
+				size_t size_chars = num_chars * sizeof(T);
+				size_t size = sizeof(uint32_t) + size_chars;
+				size_t end_offset = m_offset + size;
+				if (end_offset > m_reserved) {
+					reserve(end_offset);
+					if (!ok()) _Unlikely_
+						return *this;
+				}
+				auto p = &m_data[m_offset];
+				*reinterpret_cast<uint32_t*>(p) = HE2LE((uint32_t)num_chars);
+				memcpy(p + sizeof(uint32_t), data, size_chars);
+				m_offset = end_offset;
+				if (m_offset > m_size)
+					m_size = m_offset;
+#if !CHECK_STREAM_STATE
+				m_state = state_t::ok;
+#endif
+				return *this;
+			}
+
+			///
+			/// Writes string to the stream length-prefixed
+			///
+			/// This method is intended for chaining: e.g. stream.write_str(a).write_str(b).write_str(c)...
+			/// Since it would make it impossible to detect if any of the write_str(a) or write_str(b) failed should
+			/// write_str(c) succeed, the method skips writing if stream state is not ok.
+			///
+			/// As memory write rarely fails, a #define CHECK_STREAM_STATE 0 turns this checking off when
+			/// performance is paramount.
+			///
+			/// \param[in] data  String to write
+			///
+			/// \return This stream
+			///
+			template<class T, class TR = std::char_traits<T>, class AX = std::allocator<T>>
+			memory_file& write_str(_In_ const std::basic_string<T, TR, AX>& data)
+			{
+#if SET_FILE_OP_TIMES
+				m_atime = m_mtime = time_point::now();
+#endif
+				if (CHECK_STREAM_STATE && !ok()) _Unlikely_
+					return *this;
+				size_t num_chars = data.size();
+				if (num_chars > UINT32_MAX)
+					throw std::invalid_argument("string too long");
+				size_t size_chars = num_chars * sizeof(T);
+				size_t size = sizeof(uint32_t) + size_chars;
+				size_t end_offset = m_offset + size;
+				if (end_offset > m_reserved) {
+					reserve(end_offset);
+					if (!ok()) _Unlikely_
+						return *this;
+				}
+				auto p = &m_data[m_offset];
+				*reinterpret_cast<uint32_t*>(p) = HE2LE((uint32_t)num_chars);
+				memcpy(p + sizeof(uint32_t), data.data(), size_chars);
+				m_offset = end_offset;
+				if (m_offset > m_size)
+					m_size = m_offset;
+#if !CHECK_STREAM_STATE
+				m_state = state_t::ok;
+#endif
+				return *this;
+			}
+
+			///
+			/// Writes content of another stream
+			///
+			/// \param[in,out] stream  Source stream
+			/// \param[in]     amount  Maximum number of bytes to copy
+			///
+			/// \return Number of bytes written
+			///
+			virtual fsize_t write_stream(_Inout_ basic& stream, _In_ fsize_t amount = fsize_max)
+			{
+#if SET_FILE_OP_TIMES
+				m_atime = m_mtime = time_point::now();
+#endif
 				size_t num_read, dst_offset = m_offset, dst_size = m_offset;
-				size_t num_copied = 0, to_write = amount;
+				size_t num_copied = 0, to_write = amount < SIZE_MAX ? static_cast<size_t>(amount) : SIZE_MAX;
+				m_state = state_t::ok;
+				if (to_write != SIZE_MAX) {
+					dst_size = stdex::add(dst_size, to_write);
+					reserve(dst_size);
+					if (!ok()) _Unlikely_
+						return 0;
+					while (to_write) {
+						num_read = stream.read(&m_data[dst_offset], to_write);
+						/*dst_size =*/ dst_offset += num_read;
+						num_copied += num_read;
+						to_write -= num_read;
+						if (!stream.ok()) {
+							if (stream.state() != state_t::eof)
+								m_state = state_t::fail;
+							break;
+						}
+					};
+				}
+				else {
+					size_t block_size;
+					while (to_write) {
+						block_size = std::min(to_write, default_block_size);
+						dst_size = stdex::add(dst_size, block_size);
+						reserve(dst_size);
+						if (!ok()) _Unlikely_
+							break;
+						num_read = stream.read(&m_data[dst_offset], block_size);
+						dst_size = dst_offset += num_read;
+						num_copied += num_read;
+						to_write -= num_read;
+						if (!stream.ok()) {
+							if (stream.state() != state_t::eof)
+								m_state = state_t::fail;
+							break;
+						}
+					};
+				}
+				m_offset = dst_offset;
+				if (m_offset > m_size)
+					m_size = m_offset;
+				return num_copied;
+			}
+
+			virtual void close()
+			{
+				if (m_manage && m_data)
+					free(m_data);
+				m_data = nullptr;
+				m_manage = true;
+				m_offset = 0;
+				m_size = m_reserved = 0;
+#if SET_FILE_OP_TIMES
+				m_ctime = m_atime = m_mtime = time_point::min();
+#endif
+				m_state = state_t::ok;
+			}
+
+			virtual fpos_t seek(_In_ foff_t offset, _In_ seek_t how = seek_t::beg)
+			{
+				switch (how) {
+				case seek_t::beg: break;
+				case seek_t::cur: offset = static_cast<foff_t>(m_offset) + offset; break;
+				case seek_t::end: offset = static_cast<foff_t>(m_size) + offset; break;
+				default: throw std::invalid_argument("unknown seek origin");
+				}
+				if (offset < 0) _Unlikely_
+					throw std::invalid_argument("negative file offset");
+				if (static_cast<fpos_t>(offset) > SIZE_MAX) _Unlikely_
+					throw std::invalid_argument("file offset too big");
+				m_state = state_t::ok;
+				return m_offset = static_cast<size_t>(offset);
+			}
+
+			virtual fpos_t tell() const
+			{
+				return m_offset;
+			}
+
+			virtual fsize_t size() const
+			{
+				return m_size;
+			}
+
+			virtual void truncate()
+			{
+#if SET_FILE_OP_TIMES
+				m_atime = m_mtime = time_point::now();
+#endif
+				m_size = m_offset;
+				reserve(m_offset);
+			}
+
+#if SET_FILE_OP_TIMES
+			virtual time_point ctime() const
+			{
+				return m_ctime;
+			}
+
+			virtual time_point atime() const
+			{
+				return m_atime;
+			}
+
+			virtual time_point mtime() const
+			{
+				return m_mtime;
+			}
+
+			virtual void set_ctime(time_point date)
+			{
+				m_ctime = date;
+			}
+
+			virtual void set_atime(time_point date)
+			{
+				m_atime = date;
+			}
+
+			virtual void set_mtime(time_point date)
+			{
+				m_mtime = date;
+			}
+#endif
+
+		protected:
+			///
+			/// Writes data to specified file location
+			/// This does not move file pointer nor update file size. It checks for reserved space stdex_assert-only (in Debug builds). Use with caution!
+			///
+			/// \param[in] offset  Offset in file where to write data
+			/// \param[in] data    Data to write
+			///
+			template <class T>
+			void set(_In_ fpos_t offset, _In_ const T data)
+			{
+#if SET_FILE_OP_TIMES
+				m_atime = m_mtime = time_point::now();
+#endif
+				stdex_assert(offset + sizeof(T) < m_size);
+				(*reinterpret_cast<T*>(&m_data[offset])) = HE2LE(data);
+			}
+
+		public:
+			void set(_In_ fpos_t offset, _In_ const int8_t data) { set<int8_t>(offset, data); }
+			void set(_In_ fpos_t offset, _In_ const int16_t data) { set<int16_t>(offset, data); }
+			void set(_In_ fpos_t offset, _In_ const int32_t data) { set<int32_t>(offset, data); }
+			void set(_In_ fpos_t offset, _In_ const int64_t data) { set<int64_t>(offset, data); }
+			void set(_In_ fpos_t offset, _In_ const uint8_t data) { set<uint8_t>(offset, data); }
+			void set(_In_ fpos_t offset, _In_ const uint16_t data) { set<uint16_t>(offset, data); }
+			void set(_In_ fpos_t offset, _In_ const uint32_t data) { set<uint32_t>(offset, data); }
+			void set(_In_ fpos_t offset, _In_ const uint64_t data) { set<uint64_t>(offset, data); }
+			void set(_In_ fpos_t offset, _In_ const float data) { set<float>(offset, data); }
+			void set(_In_ fpos_t offset, _In_ const double data) { set<double>(offset, data); }
+			void set(_In_ fpos_t offset, _In_ const char data) { set<char>(offset, data); }
+#ifdef _NATIVE_WCHAR_T_DEFINED
+			void set(_In_ fpos_t offset, _In_ const wchar_t data) { set<wchar_t>(offset, data); }
+#endif
+
+			///
+			/// Reads data from specified file location
+			/// This does not move file pointer. It checks for data size stdex_assert-only (in Debug builds). Use with caution!
+			///
+			/// \param[in] offset  Offset in file where to write data
+			/// \param[in] data    Data to write
+			///
+		protected:
+			template <class T>
+			void get(_In_ fpos_t offset, _Out_ T & data)
+			{
+				stdex_assert(offset + sizeof(T) < m_size);
+				data = LE2HE(*(T*)(&m_data[offset]));
+#if SET_FILE_OP_TIMES
+				m_atime = time_point::now();
+#endif
+			}
+
+		public:
+			void get(_In_ fpos_t offset, _Out_ int8_t & data) { get<int8_t>(offset, data); }
+			void get(_In_ fpos_t offset, _Out_ int16_t & data) { get<int16_t>(offset, data); }
+			void get(_In_ fpos_t offset, _Out_ int32_t & data) { get<int32_t>(offset, data); }
+			void get(_In_ fpos_t offset, _Out_ int64_t & data) { get<int64_t>(offset, data); }
+			void get(_In_ fpos_t offset, _Out_ uint8_t & data) { get<uint8_t>(offset, data); }
+			void get(_In_ fpos_t offset, _Out_ uint16_t & data) { get<uint16_t>(offset, data); }
+			void get(_In_ fpos_t offset, _Out_ uint32_t & data) { get<uint32_t>(offset, data); }
+			void get(_In_ fpos_t offset, _Out_ uint64_t & data) { get<uint64_t>(offset, data); }
+			void get(_In_ fpos_t offset, _Out_ float& data) { get<float>(offset, data); }
+			void get(_In_ fpos_t offset, _Out_ double& data) { get<double>(offset, data); }
+			void get(_In_ fpos_t offset, _Out_ char& data) { get<char>(offset, data); }
+#ifdef _NATIVE_WCHAR_T_DEFINED
+			void get(_In_ fpos_t offset, _Out_ wchar_t& data) { get<wchar_t>(offset, data); }
+#endif
+
+			memory_file& operator <<(_In_ const int8_t data) { return write_data(data); }
+			memory_file& operator >>(_Out_ int8_t & data) { return read_data(data); }
+			memory_file& operator <<(_In_ const int16_t data) { return write_data(data); }
+			memory_file& operator >>(_Out_ int16_t & data) { return read_data(data); }
+			memory_file& operator <<(_In_ const int32_t data) { return write_data(data); }
+			memory_file& operator >>(_Out_ int32_t & data) { return read_data(data); }
+			memory_file& operator <<(_In_ const int64_t data) { return write_data(data); }
+			memory_file& operator >>(_Out_ int64_t & data) { return read_data(data); }
+			memory_file& operator <<(_In_ const uint8_t data) { return write_data(data); }
+			memory_file& operator >>(_Out_ uint8_t & data) { return read_data(data); }
+			memory_file& operator <<(_In_ const uint16_t data) { return write_data(data); }
+			memory_file& operator >>(_Out_ uint16_t & data) { return read_data(data); }
+			memory_file& operator <<(_In_ const uint32_t data) { return write_data(data); }
+			memory_file& operator >>(_Out_ uint32_t & data) { return read_data(data); }
+			memory_file& operator <<(_In_ const uint64_t data) { return write_data(data); }
+			memory_file& operator >>(_Out_ uint64_t & data) { return read_data(data); }
+			memory_file& operator <<(_In_ const float data) { return write_data(data); }
+			memory_file& operator >>(_Out_ float& data) { return read_data(data); }
+			memory_file& operator <<(_In_ const double data) { return write_data(data); }
+			memory_file& operator >>(_Out_ double& data) { return read_data(data); }
+			memory_file& operator <<(_In_ const char data) { return write_data(data); }
+			memory_file& operator >>(_Out_ char& data) { return read_data(data); }
+#ifdef _NATIVE_WCHAR_T_DEFINED
+			memory_file& operator <<(_In_ const wchar_t data) { return write_data(data); }
+			memory_file& operator >>(_Out_ wchar_t& data) { return read_data(data); }
+#endif
+			template<class T, class TR = std::char_traits<T>, class AX = std::allocator<T>>
+			memory_file& operator >>(_Out_ std::basic_string<T, TR, AX>&data) { return read_str(data); }
+			template <class T>
+			memory_file& operator <<(_In_ const T * data) { return write_str(data); }
+			template<class T, class TR = std::char_traits<T>, class AX = std::allocator<T>>
+			memory_file& operator <<(_In_ const std::basic_string<T, TR, AX>& data) { return write_str(data); }
+
+		protected:
+			uint8_t* m_data; ///< file data
+			bool m_manage; ///< may reallocate m_data?
+			size_t m_offset; ///< file pointer
+			size_t m_size; ///< file size
+			size_t m_reserved; ///< reserved file size
+#if SET_FILE_OP_TIMES
+			time_point
+				m_ctime,
+				m_atime,
+				m_mtime;
+#endif
+		};
+
+		constexpr size_t default_chunk_size = 0x10000; ///< Default chunk size of chunked_memory_file
+
+		///
+		/// In-memory file stored in fixed-size chunks
+		///
+		/// Unlike memory_file, growing the file never reallocates or copies data: appending is O(1) and peak memory is
+		/// the file size rounded up to the chunk size. The price is that data is not contiguous. Use segments() to
+		/// gather data for writev().
+		///
+		class chunked_memory_file : public basic_file
+		{
+		public:
+			///
+			/// Creates an empty file
+			///
+			/// \param[in] chunk_size  Size of a single chunk (in bytes)
+			/// \param[in] state       Initial stream state
+			///
+			chunked_memory_file(_In_ size_t chunk_size = default_chunk_size, _In_ state_t state = state_t::ok) :
+				basic(state),
+				m_chunk_size(chunk_size),
+				m_offset(0),
+				m_size(0)
+			{
+				if (!chunk_size) _Unlikely_
+					throw std::invalid_argument("zero chunk size");
+#if SET_FILE_OP_TIMES
+				m_ctime = m_atime = m_mtime = time_point::now();
+#endif
+			}
+
+		private:
+			chunked_memory_file(_In_ const chunked_memory_file& other);
+			chunked_memory_file& operator =(_In_ const chunked_memory_file& other);
+
+		public:
+			///
+			/// Returns chunk size
+			///
+			size_t chunk_size() const { return m_chunk_size; }
+
+			///
+			/// Returns file data segments
+			///
+			/// Segments reference internal storage. They are valid until the file is written to, truncated or closed.
+			///
+			/// \param[out] iov     Segments
+			/// \param[in]  count   Maximum number of segments to return
+			/// \param[in]  offset  Absolute file position of the first segment
+			///
+			/// \return Number of segments returned. Less than count is returned only when segments reach the end of file.
+			///
+			size_t segments(_Out_writes_to_(count, return) const_iovec_t* iov, _In_ size_t count, _In_ fpos_t offset = 0) const
+			{
+				stdex_assert(iov || !count);
+				size_t i = 0;
+				for (; i < count && offset < m_size; ++i) {
+					size_t chunk_offset = static_cast<size_t>(offset % m_chunk_size);
+					iov[i].data = m_chunks[static_cast<size_t>(offset / m_chunk_size)].get() + chunk_offset;
+					iov[i].length = static_cast<size_t>(std::min<fsize_t>(m_chunk_size - chunk_offset, m_size - offset));
+					offset += iov[i].length;
+				}
+				return i;
+			}
+
+			virtual _Success_(return != 0 || length == 0) size_t read(
+				_Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length)
+			{
+				stdex_assert(data || !length);
+#if SET_FILE_OP_TIMES
+				m_atime = time_point::now();
+#endif
+				if (length && m_offset >= m_size) {
+					m_state = state_t::eof;
+					return 0;
+				}
+				size_t num_read = copy_out(m_offset, data, length);
+				m_offset += num_read;
+				m_state = state_t::ok;
+				return num_read;
+			}
+
+			virtual bool read_until(_In_ uint8_t delim, _Outptr_result_bytebuffer_(length) const void*& data, _Out_ size_t& length)
+			{
+#if SET_FILE_OP_TIMES
+				m_atime = time_point::now();
+#endif
+				if (m_offset >= m_size) {
+					data = nullptr;
+					length = 0;
+					m_state = state_t::eof;
+					return true;
+				}
+				// Search within the current chunk only. Caller will call us again for the rest of the line.
+				size_t chunk_offset = static_cast<size_t>(m_offset % m_chunk_size);
+				auto ptr = m_chunks[static_cast<size_t>(m_offset / m_chunk_size)].get() + chunk_offset;
+				size_t available = static_cast<size_t>(std::min<fsize_t>(m_chunk_size - chunk_offset, m_size - m_offset));
+				auto end = reinterpret_cast<const uint8_t*>(memchr(ptr, delim, available));
+				data = ptr;
+				length = end ? static_cast<size_t>(end - ptr) + 1 : available;
+				m_offset += length;
+				m_state = state_t::ok;
+				return true;
+			}
+
+			virtual _Success_(return != 0 || length == 0) size_t read_at(
+				_In_ fpos_t offset, _Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length,
+				_Out_opt_ state_t* state = nullptr)
+			{
+				stdex_assert(data || !length);
+				if (offset >= m_size) {
+					if (state) *state = length ? state_t::eof : state_t::ok;
+					return 0;
+				}
+				size_t num_read = copy_out(offset, data, length);
+				if (state) *state = state_t::ok;
+				return num_read;
+			}
+
+			virtual _Success_(return != 0) size_t write(
+				_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
+			{
+				stdex_assert(data || !length);
+#if SET_FILE_OP_TIMES
+				m_atime = m_mtime = time_point::now();
+#endif
+				if (!copy_in(m_offset, data, length)) _Unlikely_ {
+					m_state = state_t::fail;
+					return 0;
+				}
+				m_offset += length;
+				m_state = state_t::ok;
+				return length;
+			}
+
+			virtual _Success_(return != 0) size_t write_at(
+				_In_ fpos_t offset, _In_reads_bytes_opt_(length) const void* data, _In_ size_t length,
+				_Out_opt_ state_t* state = nullptr)
+			{
+				stdex_assert(data || !length);
+#if SET_FILE_OP_TIMES
+				m_atime = m_mtime = time_point::now();
+#endif
+				if (!copy_in(offset, data, length)) _Unlikely_ {
+					if (state) *state = state_t::fail;
+					return 0;
+				}
+				if (state) *state = state_t::ok;
+				return length;
+			}
+
+			virtual void close()
+			{
+				m_chunks.clear();
+				m_chunks.shrink_to_fit();
+				m_offset = 0;
+				m_size = 0;
+#if SET_FILE_OP_TIMES
+				m_ctime = m_atime = m_mtime = time_point::min();
+#endif
+				m_state = state_t::ok;
+			}
+
+			virtual fpos_t seek(_In_ foff_t offset, _In_ seek_t how = seek_t::beg)
+			{
+				switch (how) {
+				case seek_t::beg: break;
+				case seek_t::cur: offset = static_cast<foff_t>(m_offset) + offset; break;
+				case seek_t::end: offset = static_cast<foff_t>(m_size) + offset; break;
+				default: throw std::invalid_argument("unknown seek origin");
+				}
+				if (offset < 0) _Unlikely_
+					throw std::invalid_argument("negative file offset");
+				m_state = state_t::ok;
+				return m_offset = static_cast<fpos_t>(offset);
+			}
+
+			virtual fpos_t tell() const
+			{
+				return m_offset;
+			}
+
+			virtual fsize_t size() const
+			{
+				return m_size;
+			}
+
+			virtual void truncate()
+			{
+#if SET_FILE_OP_TIMES
+				m_atime = m_mtime = time_point::now();
+#endif
+				if (m_offset > m_size) {
+					if (!reserve(m_offset)) _Unlikely_ {
+						m_state = state_t::fail;
+						return;
+					}
+					zero(m_size, m_offset);
+				}
+				m_size = m_offset;
+				m_chunks.resize(static_cast<size_t>(chunk_count(m_size)));
+				m_state = state_t::ok;
+			}
+
+#if SET_FILE_OP_TIMES
+			virtual time_point ctime() const
+			{
+				return m_ctime;
+			}
+
+			virtual time_point atime() const
+			{
+				return m_atime;
+			}
+
+			virtual time_point mtime() const
+			{
+				return m_mtime;
+			}
+
+			virtual void set_ctime(time_point date)
+			{
+				m_ctime = date;
+			}
+
+			virtual void set_atime(time_point date)
+			{
+				m_atime = date;
+			}
+
+			virtual void set_mtime(time_point date)
+			{
+				m_mtime = date;
+			}
+#endif
+
+		protected:
+			///
+			/// Allocates chunks to hold data up to given file size
+			///
+			/// \return true on success; false on out of memory
+			///
+			bool reserve(_In_ fsize_t size) noexcept
+			{
+				fsize_t count = chunk_count(size);
+				if (count > SIZE_MAX) _Unlikely_
+					return false;
+				try {
+					while (m_chunks.size() < count) {
+						std::unique_ptr<uint8_t[]> chunk(new uint8_t[m_chunk_size]);
+						m_chunks.push_back(std::move(chunk)); // Geometric growth keeps appending amortized O(1)
+					}
+					return true;
+				}
+				catch (const std::bad_alloc&) {
+					return false;
+				}
+			}
+
+			///
+			/// Returns number of chunks required to hold data up to given file size
+			///
+			fsize_t chunk_count(_In_ fsize_t size) const
+			{
+				// Rounding up as (size + m_chunk_size - 1) / m_chunk_size would overflow for sizes near fsize_max.
+				return size / m_chunk_size + (size % m_chunk_size != 0);
+			}
+
+			///
+			/// Zeroes data in [start, end) range of allocated chunks
+			///
+			void zero(_In_ fpos_t start, _In_ fpos_t end)
+			{
+				while (start < end) {
+					size_t chunk_offset = static_cast<size_t>(start % m_chunk_size);
+					size_t n = static_cast<size_t>(std::min<fsize_t>(m_chunk_size - chunk_offset, end - start));
+					memset(m_chunks[static_cast<size_t>(start / m_chunk_size)].get() + chunk_offset, 0, n);
+					start += n;
+				}
+			}
+
+			///
+			/// Copies data from the file without updating file pointer
+			///
+			/// \return Number of bytes copied
+			///
+			size_t copy_out(_In_ fpos_t offset, _Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length) const
+			{
+				if (offset >= m_size)
+					return 0;
+				length = static_cast<size_t>(std::min<fsize_t>(length, m_size - offset));
+				for (size_t to_read = length; to_read;) {
+					size_t chunk_offset = static_cast<size_t>(offset % m_chunk_size);
+					size_t n = std::min(m_chunk_size - chunk_offset, to_read);
+					memcpy(data, m_chunks[static_cast<size_t>(offset / m_chunk_size)].get() + chunk_offset, n);
+					reinterpret_cast<uint8_t*&>(data) += n;
+					offset += n;
+					to_read -= n;
+				}
+				return length;
+			}
+
+			///
+			/// Copies data to the file without updating file pointer. Extends the file as required.
+			///
+			/// \return true on success; false on out of memory
+			///
+			bool copy_in(_In_ fpos_t offset, _In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
+			{
+				fpos_t end = offset + length;
+				if (end < offset || !reserve(end)) _Unlikely_
+					return false;
+				if (offset > m_size)
+					zero(m_size, offset);
+				for (size_t to_write = length; to_write;) {
+					size_t chunk_offset = static_cast<size_t>(offset % m_chunk_size);
+					size_t n = std::min(m_chunk_size - chunk_offset, to_write);
+					memcpy(m_chunks[static_cast<size_t>(offset / m_chunk_size)].get() + chunk_offset, data, n);
+					reinterpret_cast<const uint8_t*&>(data) += n;
+					offset += n;
+					to_write -= n;
+				}
+				if (end > m_size)
+					m_size = end;
+				return true;
+			}
+
+		protected:
+			size_t m_chunk_size; ///< chunk size
+			std::vector<std::unique_ptr<uint8_t[]>> m_chunks; ///< file data
+			fpos_t m_offset; ///< file pointer
+			fsize_t m_size; ///< file size
+#if SET_FILE_OP_TIMES
+			time_point
+				m_ctime,
+				m_atime,
+				m_mtime;
+#endif
+		};
+
+		///
+		/// Memory-mapped file-system file
+		///
+		/// Reads and writes are served directly from the mapped view of the file.
+		/// Writing past the end of the view extends the file and remaps it. The file is trimmed to its
+		/// logical size on close.
+		///
+		class mapped_file : public basic_file
+		{
+		public:
+			mapped_file() :
+				basic(state_t::fail),
+				m_data(nullptr),
+				m_offset(0),
+				m_size(0),
+				m_reserved(0),
+				m_writable(false)
+#ifdef _WIN32
+				, m_mapping(NULL)
+#endif
+			{}
+
+			///
+			/// Opens and maps file
+			///
+			/// \param[in] filename  Filename
+			/// \param[in] mode      Bitwise combination of mode_t flags
+			///
+			mapped_file(_In_z_ const schar_t* filename, _In_ int mode) : mapped_file()
+			{
+				open(filename, mode);
+			}
+
+			///
+			/// Opens and maps file
+			///
+			/// \param[in] filename  Filename
+			/// \param[in] mode      Bitwise combination of mode_t flags
+			///
+			template <class TR = std::char_traits<schar_t>, class AX = std::allocator<schar_t>>
+			mapped_file(_In_ const std::basic_string<TR, AX>& filename, _In_ int mode) : mapped_file(filename.c_str(), mode) {}
+
+		private:
+			mapped_file(_In_ const mapped_file& other);
+			mapped_file& operator =(_In_ const mapped_file& other);
+
+		public:
+			virtual ~mapped_file()
+			{
+				if (m_source) {
+					unmap();
+					if (m_writable) {
+						m_source.seekbeg(m_size);
+						m_source.truncate();
+					}
+				}
+			}
+
+			///
+			/// Opens and maps file
+			///
+			/// \param[in] filename  Filename
+			/// \param[in] mode      Bitwise combination of mode_t flags
+			///
+			void open(_In_z_ const schar_t* filename, _In_ int mode)
+			{
+				close();
+				m_writable = (mode & mode_for_writing) != 0;
+				// Writable mappings require read access to the file.
+				m_source.open(filename, m_writable ? mode | mode_for_reading : mode);
+				if (!m_source.ok()) _Unlikely_ {
+					m_state = state_t::fail;
+					return;
+				}
+				fsize_t size = m_source.size();
+				if (size > SIZE_MAX) _Unlikely_ {
+					m_source.close();
+					m_state = state_t::fail;
+					return;
+				}
+				m_size = static_cast<size_t>(size);
+				map(m_size);
+				if (!ok()) _Unlikely_ {
+					m_source.close();
+					return;
+				}
+				m_offset = mode & mode_append ? m_size : 0;
+			}
+
+			///
+			/// Opens and maps file
+			///
+			/// \param[in] filename  Filename
+			/// \param[in] mode      Bitwise combination of mode_t flags
+			///
+			template <class TR = std::char_traits<schar_t>, class AX = std::allocator<schar_t>>
+			void open(_In_ const std::basic_string<TR, AX>& filename, _In_ int mode)
+			{
+				open(filename.c_str(), mode);
+			}
+
+			///
+			/// Returns true if file has a valid handle
+			///
+			operator bool() const noexcept { return m_source; }
+
+			///
+			/// Returns pointer to mapped data
+			///
+			/// The pointer is invalidated when the file is extended past its reserved size, or closed.
+			///
+			const void* data() const { return m_data; }
+
+			///
+			/// Extends the file and remaps it
+			///
+			/// \param[in] required  Demanded file size
+			///
+			void reserve(_In_ size_t required)
+			{
+				if (required <= m_reserved) {
+					m_state = state_t::ok;
+					return;
+				}
+				if (!m_writable) _Unlikely_ {
+					m_state = state_t::fail;
+					return;
+				}
+				size_t reserved = ((required + required / 4 + (default_block_size - 1)) / default_block_size) * default_block_size;
+				size_t reserved_prev = m_reserved;
+				unmap();
+				m_source.seekbeg(reserved);
+				m_source.truncate();
+				if (!m_source.ok()) _Unlikely_ {
+					map(reserved_prev);
+					m_state = state_t::fail;
+					return;
+				}
+				map(reserved);
+			}
+
+			virtual _Success_(return != 0 || length == 0) size_t read(
+				_Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length)
+			{
+				stdex_assert(data || !length);
+				size_t available = m_offset < m_size ? m_size - m_offset : 0;
+				if (length <= available) {
+					memcpy(data, m_data + m_offset, length);
+					m_offset += length;
+					m_state = state_t::ok;
+					return length;
+				}
+				if (length && !available) {
+					m_state = state_t::eof;
+					return 0;
+				}
+				memcpy(data, m_data + m_offset, available);
+				m_offset += available;
+				m_state = state_t::ok;
+				return available;
+			}
+
+			virtual bool read_until(_In_ uint8_t delim, _Outptr_result_bytebuffer_(length) const void*& data, _Out_ size_t& length)
+			{
+				data = m_data + m_offset;
+				if (m_offset >= m_size) {
+					length = 0;
+					m_state = state_t::eof;
+					return true;
+				}
+				size_t available = m_size - m_offset;
+				auto end = reinterpret_cast<const uint8_t*>(memchr(m_data + m_offset, delim, available));
+				length = end ? static_cast<size_t>(end - (m_data + m_offset)) + 1 : available;
+				m_offset += length;
+				m_state = state_t::ok;
+				return true;
+			}
+
+			virtual bool peek(_In_ size_t length, _Outptr_result_bytebuffer_(available) const void*& data, _Out_ size_t& available)
+			{
+				data = m_data + m_offset;
+				available = m_offset < m_size ? m_size - m_offset : 0;
+				m_state = available || !length ? state_t::ok : state_t::eof;
+				return true;
+			}
+
+			virtual void consume(_In_ size_t length)
+			{
+				stdex_assert(m_offset + length <= m_size);
+				m_offset += length;
+				m_state = state_t::ok;
+			}
+
+			virtual _Success_(return != 0 || length == 0) size_t read_at(
+				_In_ fpos_t offset, _Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length,
+				_Out_opt_ state_t* state = nullptr)
+			{
+				stdex_assert(data || !length);
+				if (offset >= m_size) {
+					if (state) *state = length ? state_t::eof : state_t::ok;
+					return 0;
+				}
+				size_t num_read = std::min<size_t>(length, m_size - static_cast<size_t>(offset));
+				memcpy(data, m_data + static_cast<size_t>(offset), num_read);
+				if (state) *state = state_t::ok;
+				return num_read;
+			}
+
+			virtual _Success_(return != 0) size_t write(
+				_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
+			{
+				stdex_assert(data || !length);
+				if (!m_writable) _Unlikely_ {
+					m_state = state_t::fail;
+					return 0;
+				}
+				size_t end_offset = stdex::add(m_offset, length);
+				if (end_offset > m_reserved) {
+					reserve(end_offset);
+					if (!ok()) _Unlikely_
+						return 0;
+				}
+				if (m_offset > m_size) {
+					// Previous truncate() might have left stale data behind the logical end of file.
+					memset(m_data + m_size, 0, m_offset - m_size);
+				}
+				memcpy(m_data + m_offset, data, length);
+				m_offset = end_offset;
+				if (m_offset > m_size)
+					m_size = m_offset;
+				m_state = state_t::ok;
+				return length;
+			}
+
+			///
+			/// Writes block of data to given file position without moving the file pointer
+			///
+			/// Concurrent calls are safe only when each of them ends within the current file size. A call extending the
+			/// file zero-fills the gap and updates the size, and must not run concurrently with other write_at() or
+			/// read_at() calls.
+			///
+			virtual _Success_(return != 0) size_t write_at(
+				_In_ fpos_t offset, _In_reads_bytes_opt_(length) const void* data, _In_ size_t length,
+				_Out_opt_ state_t* state = nullptr)
+			{
+				stdex_assert(data || !length);
+				if (offset > SIZE_MAX) _Unlikely_
+					throw std::invalid_argument("file offset too big");
+				size_t end_offset = stdex::add(static_cast<size_t>(offset), length);
+				if (end_offset > m_reserved) {
+					state_t state_orig = m_state;
+					reserve(end_offset);
+					bool succeeded = ok();
+					m_state = state_orig;
+					if (!succeeded) _Unlikely_ {
+						if (state) *state = state_t::fail;
+						return 0;
+					}
+				}
+				else if (!m_writable) _Unlikely_ {
+					if (state) *state = state_t::fail;
+					return 0;
+				}
+				if (offset > m_size)
+					memset(m_data + m_size, 0, static_cast<size_t>(offset) - m_size);
+				memcpy(m_data + static_cast<size_t>(offset), data, length);
+				if (end_offset > m_size)
+					m_size = end_offset;
+				if (state) *state = state_t::ok;
+				return length;
+			}
+
+			virtual void close()
+			{
+				state_t state = state_t::ok;
+				if (m_source) {
+					unmap();
+					if (m_writable) {
+						m_source.seekbeg(m_size);
+						m_source.truncate();
+						state = m_source.state();
+					}
+					m_source.close();
+				}
+				m_offset = m_size = 0;
+				m_writable = false;
+				m_state = state;
+			}
+
+			virtual void flush()
+			{
+				if (m_data && m_writable) {
+#ifdef _WIN32
+					if (!FlushViewOfFile(m_data, m_size)) _Unlikely_ {
+#else
+					if (msync(m_data, m_reserved, MS_SYNC) < 0) _Unlikely_ {
+#endif
+						m_state = state_t::fail;
+						return;
+					}
+				}
+				m_source.flush();
+				m_state = m_source.state();
+			}
+
+			virtual fpos_t seek(_In_ foff_t offset, _In_ seek_t how = seek_t::beg)
+			{
+				switch (how) {
+				case seek_t::beg: break;
+				case seek_t::cur: offset = static_cast<foff_t>(m_offset) + offset; break;
+				case seek_t::end: offset = static_cast<foff_t>(m_size) + offset; break;
+				default: throw std::invalid_argument("unknown seek origin");
+				}
+				if (offset < 0) _Unlikely_
+					throw std::invalid_argument("negative file offset");
+				if (static_cast<fpos_t>(offset) > SIZE_MAX) _Unlikely_
+					throw std::invalid_argument("file offset too big");
+				m_state = state_t::ok;
+				return m_offset = static_cast<size_t>(offset);
+			}
+
+			virtual fpos_t tell() const
+			{
+				return m_source ? m_offset : fpos_max;
+			}
+
+			virtual void lock(_In_ fpos_t offset, _In_ fsize_t length)
+			{
+				m_source.lock(offset, length);
+				m_state = m_source.state();
+			}
+
+			virtual void unlock(_In_ fpos_t offset, _In_ fsize_t length)
+			{
+				m_source.unlock(offset, length);
+				m_state = m_source.state();
+			}
+
+			virtual void advise(_In_ access_hint_t hint, _In_ fpos_t offset = 0, _In_ fsize_t length = fsize_max)
+			{
+#ifdef _WIN32
+				m_source.advise(hint, offset, length);
+#else
+				if (offset >= m_reserved)
+					return;
+				int advice;
+				switch (hint) {
+				case access_hint_t::sequential: advice = MADV_SEQUENTIAL; break;
+				case access_hint_t::random: advice = MADV_RANDOM; break;
+				case access_hint_t::willneed: advice = MADV_WILLNEED; break;
+				case access_hint_t::dontneed: advice = MADV_DONTNEED; break;
+				default: advice = MADV_NORMAL;
+				}
+				// madvise() requires page-aligned address.
+				size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+				size_t start = static_cast<size_t>(offset) / page_size * page_size;
+				size_t end = static_cast<size_t>(std::min<fsize_t>(length, m_reserved - offset)) + static_cast<size_t>(offset);
+				madvise(m_data + start, end - start, advice);
+#endif
+			}
+
+			virtual fsize_t size() const
+			{
+				return m_source ? m_size : fsize_max;
+			}
+
+			virtual void truncate()
+			{
+				if (!m_writable) _Unlikely_ {
+					m_state = state_t::fail;
+					return;
+				}
+				if (m_offset > m_size) {
+					reserve(m_offset);
+					if (!ok()) _Unlikely_
+						return;
+					memset(m_data + m_size, 0, m_offset - m_size);
+				}
+				m_size = m_offset;
+				m_state = state_t::ok;
+			}
+
+			virtual time_point ctime() const
+			{
+				return m_source.ctime();
+			}
+
+			virtual time_point atime() const
+			{
+				return m_source.atime();
+			}
+
+			virtual time_point mtime() const
+			{
+				return m_source.mtime();
+			}
+
+			virtual void set_ctime(time_point date)
+			{
+				m_source.set_ctime(date);
+			}
+
+			virtual void set_atime(time_point date)
+			{
+				m_source.set_atime(date);
+			}
+
+			virtual void set_mtime(time_point date)
+			{
+				m_source.set_mtime(date);
+			}
+
+		protected:
+			/// \cond internal
+			void map(_In_ size_t size)
+			{
+				stdex_assert(!m_data);
+				if (!size) {
+					// Empty files cannot be mapped.
+					m_reserved = 0;
+					m_state = state_t::ok;
+					return;
+				}
+#ifdef _WIN32
+				ULARGE_INTEGER li;
+				li.QuadPart = size;
+				m_mapping = CreateFileMapping(m_source.get(), NULL, m_writable ? PAGE_READWRITE : PAGE_READONLY, li.HighPart, li.LowPart, NULL);
+				if (m_mapping) {
+					m_data = reinterpret_cast<uint8_t*>(MapViewOfFile(m_mapping, m_writable ? FILE_MAP_READ | FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size));
+					if (m_data) {
+						m_reserved = size;
+						m_state = state_t::ok;
+						return;
+					}
+					CloseHandle(m_mapping);
+					m_mapping = NULL;
+				}
+#else
+				void* data = mmap(nullptr, size, m_writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_source.get(), 0);
+				if (data != MAP_FAILED) {
+					m_data = reinterpret_cast<uint8_t*>(data);
+					m_reserved = size;
+					m_state = state_t::ok;
+					return;
+				}
+#endif
+				m_reserved = 0;
+				m_state = state_t::fail;
+			}
+
+			void unmap()
+			{
+				if (m_data) {
+#ifdef _WIN32
+					UnmapViewOfFile(m_data);
+					CloseHandle(m_mapping);
+					m_mapping = NULL;
+#else
+					munmap(m_data, m_reserved);
+#endif
+					m_data = nullptr;
+				}
+				m_reserved = 0;
+			}
+			/// \endcond
+
+		protected:
+			file m_source;
+			uint8_t* m_data; ///< mapped file data
+			size_t m_offset; ///< file pointer
+			size_t m_size; ///< logical file size
+			size_t m_reserved; ///< mapped file size
+			bool m_writable; ///< is mapping writable?
+#ifdef _WIN32
+			HANDLE m_mapping; ///< file mapping object
+#endif
+		};
+
+		constexpr size_t default_fifo_page_size = 0x1000; ///< Default size of fifo page (in bytes)
+		constexpr size_t default_fifo_pool_pages = 0x10; ///< Default number of free fifo pages kept for reuse
+
+		///
+		/// In-memory FIFO queue
+		///
+		/// Data is stored in fixed-size pages. Small writes are coalesced into the last page. Consumed pages are kept in
+		/// a pool for reuse.
+		///
+		/// In sync mode, one thread may write while another one reads, making fifo an in-process pipe: read() waits for
+		/// data until quit() is called.
+		///
+		class fifo : public basic {
+		public:
+			///
+			/// Constructs an empty queue
+			///
+			/// \param[in] page_size   Size of a page (in bytes)
+			/// \param[in] sync        Allow concurrent writing and reading by two threads
+			/// \param[in] pool_pages  Maximum number of free pages kept for reuse
+			///
+			fifo(_In_ size_t page_size = default_fifo_page_size, _In_ bool sync = false, _In_ size_t pool_pages = default_fifo_pool_pages) :
+				m_page_size(page_size),
+				m_pool_pages(pool_pages),
+				m_sync(sync),
+				m_quit(false),
+				m_close_count(0),
+				m_size(0),
+				m_head(nullptr),
+				m_tail(nullptr),
+				m_free(nullptr),
+				m_free_count(0)
+			{
+				if (!page_size) _Unlikely_
+					throw std::invalid_argument("zero page size");
+			}
+
+			virtual ~fifo()
+			{
+				free_list(m_head);
+				free_list(m_free);
+			}
+
+		private:
+			fifo(_In_ const fifo& other);
+			fifo& operator =(_In_ const fifo& other);
+
+		public:
+			virtual _Success_(return != 0 || length == 0) size_t read(
+				_Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length)
+			{
+				stdex_assert(data || !length);
+				std::unique_lock<std::mutex> lk(m_mutex, std::defer_lock);
+				if (m_sync) lk.lock();
+				size_t close_count = m_close_count;
+				for (size_t to_read = length;;) {
+					if (!to_read) {
+						m_state = state_t::ok;
+						return length;
+					}
+					if (!m_size) {
+						if (m_sync && !m_quit && m_close_count == close_count) {
+							m_cv.wait(lk);
+							continue;
+						}
+						m_state = to_read < length ? state_t::ok : state_t::eof;
+						return length - to_read;
+					}
+					size_t num_read = std::min(m_head->end - m_head->start, to_read);
+					memcpy(data, m_head->data + m_head->start, num_read);
+					reinterpret_cast<uint8_t*&>(data) += num_read;
+					to_read -= num_read;
+					discard(num_read);
+				}
+			}
+
+			virtual bool peek(_In_ size_t length, _Outptr_result_bytebuffer_(available) const void*& data, _Out_ size_t& available)
+			{
+				std::unique_lock<std::mutex> lk(m_mutex, std::defer_lock);
+				if (m_sync) {
+					lk.lock();
+					size_t close_count = m_close_count;
+					while (length && !m_size && !m_quit && m_close_count == close_count)
+						m_cv.wait(lk);
+				}
+				if (!m_size) {
+					data = nullptr;
+					available = 0;
+					m_state = length ? state_t::eof : state_t::ok;
+					return true;
+				}
+				// Data up to end is not modified by the writer. No need to keep the lock.
+				data = m_head->data + m_head->start;
+				available = m_head->end - m_head->start;
+				m_state = state_t::ok;
+				return true;
+			}
+
+			virtual void consume(_In_ size_t length)
+			{
+				std::unique_lock<std::mutex> lk(m_mutex, std::defer_lock);
+				if (m_sync) lk.lock();
+				stdex_assert(length <= m_size);
+				discard(length);
 				m_state = state_t::ok;
-				if (amount != SIZE_MAX) {
-					dst_size = stdex::add(dst_size, amount);
-					reserve(dst_size);
-					if (!ok()) _Unlikely_
-						return 0;
-					while (to_write) {
-						num_read = stream.read(&m_data[dst_offset], to_write);
-						/*dst_size =*/ dst_offset += num_read;
-						num_copied += num_read;
-						to_write -= num_read;
-						if (!stream.ok()) {
-							if (stream.state() != state_t::eof)
-								m_state = state_t::fail;
-							break;
+			}
+
+			virtual _Success_(return != 0) size_t write(
+				_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
+			{
+				stdex_assert(data || !length);
+				std::unique_lock<std::mutex> lk(m_mutex, std::defer_lock);
+				if (m_sync) lk.lock();
+				for (size_t to_write = length; to_write;) {
+					if (!m_tail || m_tail->end == m_tail->capacity) {
+						node_t* n = alloc_page();
+						if (!n) _Unlikely_ {
+							m_state = state_t::fail;
+							return length - to_write;
 						}
-					};
+						append_page(n);
+					}
+					size_t num_written = std::min(m_tail->capacity - m_tail->end, to_write);
+					memcpy(m_tail->data + m_tail->end, data, num_written);
+					m_tail->end += num_written;
+					m_size += num_written;
+					reinterpret_cast<const uint8_t*&>(data) += num_written;
+					to_write -= num_written;
 				}
-				else {
-					size_t block_size;
-					while (to_write) {
-						block_size = std::min(to_write, default_block_size);
-						dst_size = stdex::add(dst_size, block_size);
-						reserve(dst_size);
-						if (!ok()) _Unlikely_
+				if (m_sync)
+					m_cv.notify_one();
+				m_state = state_t::ok;
+				return length;
+			}
+
+			///
+			/// Moves pending data to another stream
+			///
+			/// Pages are written to destination directly using writev(). When destination is a fifo, full pages are
+			/// relinked to it without copying. This method does not wait for more data in sync mode.
+			///
+			/// \param[in,out] dest    Destination stream
+			/// \param[in]     amount  Maximum number of bytes to move
+			///
+			/// \return Number of bytes moved
+			///
+			size_t splice_to(_Inout_ basic& dest, _In_ size_t amount = SIZE_MAX)
+			{
+				auto dest_fifo = dynamic_cast<fifo*>(&dest);
+				if (dest_fifo == this) _Unlikely_
+					throw std::invalid_argument("cannot splice fifo to itself");
+				std::unique_lock<std::mutex> lk(m_mutex, std::defer_lock);
+				if (m_sync) lk.lock();
+				size_t total = 0;
+				while (total < amount && m_size) {
+					if (dest_fifo) {
+						// Unlink whole pages. Tail page is not moved, as it might be written to concurrently.
+						node_t* first = nullptr, * last = nullptr;
+						size_t length = 0;
+						while (m_head != m_tail && m_head->end - m_head->start <= amount - total - length) {
+							node_t* n = m_head;
+							m_head = n->next;
+							n->next = nullptr;
+							length += n->end - n->start;
+							if (last)
+								last = last->next = n;
+							else
+								first = last = n;
+						}
+						if (first) {
+							m_size -= length;
+							// Relink pages with our lock released: two fifos splicing to each other must not deadlock.
+							if (m_sync) lk.unlock();
+							dest_fifo->push_pages(first, last, length);
+							if (m_sync) lk.lock();
+							total += length;
+							continue;
+						}
+						// Copy partial page. Data up to end is not modified by the writer.
+						size_t available = m_head->end - m_head->start;
+						size_t num_moved = std::min(available, amount - total);
+						const uint8_t* ptr = m_head->data + m_head->start;
+						if (m_sync) lk.unlock();
+						num_moved = dest.write(ptr, num_moved);
+						if (m_sync) lk.lock();
+						discard(num_moved);
+						total += num_moved;
+						if (!dest.ok()) _Unlikely_
 							break;
-						num_read = stream.read(&m_data[dst_offset], block_size);
-						dst_size = dst_offset += num_read;
-						num_copied += num_read;
-						to_write -= num_read;
-						if (!stream.ok()) {
-							if (stream.state() != state_t::eof)
-								m_state = state_t::fail;
+						continue;
+					}
+					const_iovec_t iov[0x10];
+					size_t count = 0, length = 0;
+					for (node_t* n = m_head; n && count < _countof(iov) && length < amount - total; n = n->next) {
+						iov[count].data = n->data + n->start;
+						length += iov[count].length = std::min(n->end - n->start, amount - total - length);
+						++count;
+					}
+					// Writer only appends past the pages gathered. No need to keep the lock while writing.
+					if (m_sync) lk.unlock();
+					size_t num_moved = dest.writev(iov, count);
+					if (m_sync) lk.lock();
+					discard(num_moved);
+					total += num_moved;
+					if (!dest.ok()) _Unlikely_
+						break;
+				}
+				m_state = dest.ok() ? state_t::ok : state_t::fail;
+				return total;
+			}
+
+			///
+			/// Signals no more data will be written. Readers waiting in sync mode receive remaining data and EOF.
+			///
+			void quit()
+			{
+				std::unique_lock<std::mutex> lk(m_mutex, std::defer_lock);
+				if (m_sync) lk.lock();
+				m_quit = true;
+				if (m_sync)
+					m_cv.notify_all();
+			}
+
+			virtual void close()
+			{
+				std::unique_lock<std::mutex> lk(m_mutex, std::defer_lock);
+				if (m_sync) lk.lock();
+				free_list(m_head);
+				m_head = m_tail = nullptr;
+				m_size = 0;
+				// Release waiting readers with EOF, but keep the fifo usable for further writing.
+				m_quit = false;
+				++m_close_count;
+				if (m_sync)
+					m_cv.notify_all();
+				m_state = state_t::ok;
+			}
+
+			///
+			/// Returns total size of pending data in the queue
+			///
+			size_t size() const
+			{
+				std::unique_lock<std::mutex> lk(m_mutex, std::defer_lock);
+				if (m_sync) lk.lock();
+				return m_size;
+			}
+
+		protected:
+			struct node_t {
+				node_t* next;
+				size_t capacity; ///< Size of data
+				size_t start, end; ///< Pending data range
+#pragma warning(suppress:4200)
+				uint8_t data[0];
+			};
+
+			///
+			/// Takes a page from the pool or allocates a new one
+			///
+			/// \return Empty page or nullptr on out of memory
+			///
+			node_t* alloc_page() noexcept
+			{
+				node_t* n;
+				if (m_free) {
+					n = m_free;
+					m_free = n->next;
+					--m_free_count;
+				}
+				else {
+					try { n = reinterpret_cast<node_t*>(new uint8_t[sizeof(node_t) + m_page_size]); }
+					catch (const std::bad_alloc&) { return nullptr; }
+					n->capacity = m_page_size;
+				}
+				n->next = nullptr;
+				n->start = n->end = 0;
+				return n;
+			}
+
+			///
+			/// Returns page to the pool or frees it
+			///
+			void free_page(_In_ node_t* n) noexcept
+			{
+				if (n->capacity == m_page_size && m_free_count < m_pool_pages) {
+					n->next = m_free;
+					m_free = n;
+					++m_free_count;
+				}
+				else
+					delete[] reinterpret_cast<uint8_t*>(n);
+			}
+
+			static void free_list(_In_opt_ node_t* n) noexcept
+			{
+				while (n) {
+					auto next = n->next;
+					delete[] reinterpret_cast<uint8_t*>(n);
+					n = next;
+				}
+			}
+
+			void append_page(_In_ node_t* n) noexcept
+			{
+				if (m_tail)
+					m_tail = m_tail->next = n;
+				else
+					m_head = m_tail = n;
+			}
+
+			///
+			/// Appends list of pages with data moved from another fifo
+			///
+			void push_pages(_In_ node_t* first, _In_ node_t* last, _In_ size_t length)
+			{
+				std::unique_lock<std::mutex> lk(m_mutex, std::defer_lock);
+				if (m_sync) lk.lock();
+				if (m_tail && m_tail->start == m_tail->end) {
+					// Drop empty tail page to maintain data order.
+					stdex_assert(m_head == m_tail);
+					free_page(m_tail);
+					m_head = m_tail = nullptr;
+				}
+				append_page(first);
+				m_tail = last;
+				m_size += length;
+				if (m_sync)
+					m_cv.notify_one();
+				m_state = state_t::ok;
+			}
+
+			///
+			/// Discards data from the head of the queue
+			///
+			void discard(_In_ size_t length) noexcept
+			{
+				m_size -= length;
+				while (length) {
+					size_t n = std::min(m_head->end - m_head->start, length);
+					m_head->start += n;
+					length -= n;
+					if (m_head->start == m_head->end) {
+						if (m_head == m_tail) {
+							// Keep the last page for writing.
+							m_head->start = m_head->end = 0;
 							break;
 						}
-					};
+						auto p = m_head;
+						m_head = p->next;
+						free_page(p);
+					}
+				}
+			}
+
+		protected:
+			size_t m_page_size;
+			size_t m_pool_pages;
+			bool m_sync;
+			bool m_quit;
+			size_t m_close_count; ///< Number of close() calls. Releases readers waiting at the time.
+			mutable std::mutex m_mutex;
+			std::condition_variable m_cv;
+			size_t m_size; ///< Total size of pending data
+			node_t* m_head, * m_tail;
+			node_t* m_free; ///< Pool of free pages
+			size_t m_free_count; ///< Number of pages in pool
+		};
+
+		///
+		/// Compares multiple files to perform the same
+		///
+		class diag_file : public basic_file {
+		public:
+			diag_file(_In_count_(num_files) basic_file* const* files, _In_ size_t num_files) :
+				basic(num_files ? files[0]->state() : state_t::fail),
+				m_files(files, files + num_files)
+			{}
+
+			virtual _Success_(return != 0 || length == 0) size_t read(
+				_Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length)
+			{
+				stdex_assert(data || !length);
+				if (m_files.empty()) {
+					m_state = state_t::fail;
+					return 0;
+				}
+				size_t result = m_files[0]->read(data, length);
+				stdex_assert(result <= length);
+				m_state = m_files[0]->state();
+				if (length > m_tmp.size())
+					m_tmp.resize(length);
+				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
+					if (m_files[i]->read(m_tmp.data(), length) != result ||
+						memcmp(m_tmp.data(), data, result))
+						throw std::runtime_error("read mismatch");
+					if (m_files[i]->state() != m_state)
+						throw std::runtime_error("state mismatch");
+				}
+				return result;
+			}
+
+			virtual _Success_(return != 0) size_t write(
+				_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
+			{
+				if (m_files.empty()) {
+					m_state = state_t::fail;
+					return 0;
+				}
+				size_t result = m_files[0]->write(data, length);
+				m_state = m_files[0]->state();
+				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
+					if (m_files[i]->write(data, length) != result)
+						throw std::runtime_error("write mismatch");
+					if (m_files[i]->state() != m_state)
+						throw std::runtime_error("state mismatch");
+				}
+				return result;
+			}
+
+			virtual void flush()
+			{
+				if (m_files.empty()) {
+					m_state = state_t::ok;
+					return;
+				}
+				m_files[0]->flush();
+				m_state = m_files[0]->state();
+				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
+					m_files[i]->flush();
+					if (m_files[i]->state() != m_state)
+						throw std::runtime_error("state mismatch");
+				}
+			}
+
+			virtual void close()
+			{
+				if (m_files.empty()) {
+					m_state = state_t::ok;
+					return;
+				}
+				m_files[0]->close();
+				m_state = m_files[0]->state();
+				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
+					m_files[i]->close();
+					if (m_files[i]->state() != m_state)
+						throw std::runtime_error("state mismatch");
+				}
+				m_tmp.clear();
+				m_tmp.shrink_to_fit();
+			}
+
+			virtual fpos_t seek(_In_ foff_t offset, _In_ seek_t how = seek_t::beg)
+			{
+				if (m_files.empty()) {
+					m_state = state_t::fail;
+					return fpos_max;
+				}
+				fpos_t result = m_files[0]->seek(offset, how);
+				m_state = m_files[0]->state();
+				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
+					if (m_files[i]->seek(offset, how) != result)
+						throw std::runtime_error("seek mismatch");
+					if (m_files[i]->state() != m_state)
+						throw std::runtime_error("state mismatch");
+				}
+				return result;
+			}
+
+			virtual fpos_t tell() const
+			{
+				if (m_files.empty())
+					return fpos_max;
+				fpos_t result = m_files[0]->tell();
+				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
+					if (m_files[i]->tell() != result)
+						throw std::runtime_error("tell mismatch");
+				}
+				return result;
+			}
+
+			virtual void lock(_In_ fpos_t offset, _In_ fsize_t length)
+			{
+				if (m_files.empty())
+					m_state = state_t::fail;
+				m_files[0]->lock(offset, length);
+				m_state = m_files[0]->state();
+				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
+					m_files[i]->lock(offset, length);
+					if (m_files[i]->state() != m_state)
+						throw std::runtime_error("state mismatch");
+				}
+			}
+
+			virtual void unlock(_In_ fpos_t offset, _In_ fsize_t length)
+			{
+				if (m_files.empty())
+					m_state = state_t::fail;
+				m_files[0]->unlock(offset, length);
+				m_state = m_files[0]->state();
+				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
+					m_files[i]->unlock(offset, length);
+					if (m_files[i]->state() != m_state)
+						throw std::runtime_error("state mismatch");
 				}
-				m_offset = dst_offset;
-				if (m_offset > m_size)
-					m_size = m_offset;
-				return num_copied;
 			}
 
-			virtual void close()
+			virtual void advise(_In_ access_hint_t hint, _In_ fpos_t offset = 0, _In_ fsize_t length = fsize_max)
 			{
-				if (m_manage && m_data)
-					free(m_data);
-				m_data = nullptr;
-				m_manage = true;
-				m_offset = 0;
-				m_size = m_reserved = 0;
-#if SET_FILE_OP_TIMES
-				m_ctime = m_atime = m_mtime = time_point::min();
-#endif
-				m_state = state_t::ok;
+				for (auto f : m_files)
+					f->advise(hint, offset, length);
 			}
 
-			virtual fpos_t seek(_In_ foff_t offset, _In_ seek_t how = seek_t::beg)
+			virtual fsize_t size() const
 			{
-				switch (how) {
-				case seek_t::beg: break;
-				case seek_t::cur: offset = static_cast<foff_t>(m_offset) + offset; break;
-				case seek_t::end: offset = static_cast<foff_t>(m_size) + offset; break;
-				default: throw std::invalid_argument("unknown seek origin");
+				if (m_files.empty())
+					return fsize_max;
+				fsize_t result = m_files[0]->size();
+				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
+					if (m_files[i]->size() != result)
+						throw std::runtime_error("size mismatch");
 				}
-				if (offset < 0) _Unlikely_
-					throw std::invalid_argument("negative file offset");
-				if (static_cast<fpos_t>(offset) > SIZE_MAX) _Unlikely_
-					throw std::invalid_argument("file offset too big");
-				m_state = state_t::ok;
-				return m_offset = static_cast<size_t>(offset);
+				return result;
 			}
 
-			virtual fpos_t tell() const
+			virtual void truncate()
 			{
-				return m_offset;
+				if (m_files.empty())
+					m_state = state_t::fail;
+				m_files[0]->truncate();
+				m_state = m_files[0]->state();
+				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
+					m_files[i]->truncate();
+					if (m_files[i]->state() != m_state)
+						throw std::runtime_error("state mismatch");
+				}
 			}
 
-			virtual fsize_t size() const
+		protected:
+			std::vector<basic_file*> m_files;
+			std::vector<uint8_t> m_tmp;
+		};
+
+		///
+		/// Lock-free latency histogram
+		///
+		/// Values are counted in log-linear buckets (HDR-style): exact below 32, and with relative error under 1/16
+		/// above. Recording is wait-free and may run concurrently with reading.
+		///
+		class latency_histogram
+		{
+		public:
+			static constexpr size_t sub_bits = 4; ///< Number of bits of precision below the most significant bit
+			static constexpr size_t sub_count = size_t(1) << sub_bits; ///< Number of buckets per power of 2
+			static constexpr size_t num_buckets = 2 * sub_count + (63 - sub_bits) * sub_count; ///< Total number of buckets
+
+			latency_histogram() { reset(); }
+
+			///
+			/// Records a value
+			///
+			/// \param[in] value  Value (typically in nanoseconds)
+			///
+			void record(_In_ uint64_t value)
 			{
-				return m_size;
+				m_buckets[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+				m_count.fetch_add(1, std::memory_order_relaxed);
+				m_sum.fetch_add(value, std::memory_order_relaxed);
+				for (uint64_t max = m_max.load(std::memory_order_relaxed); max < value && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed);) {}
 			}
 
-			virtual void truncate()
+			///
+			/// Resets all counters
+			///
+			void reset()
 			{
-#if SET_FILE_OP_TIMES
-				m_atime = m_mtime = time_point::now();
-#endif
-				m_size = m_offset;
-				reserve(m_offset);
+				for (auto& b : m_buckets)
+					b.store(0, std::memory_order_relaxed);
+				m_count.store(0, std::memory_order_relaxed);
+				m_sum.store(0, std::memory_order_relaxed);
+				m_max.store(0, std::memory_order_relaxed);
 			}
 
-#if SET_FILE_OP_TIMES
-			virtual time_point ctime() const
+			///
+			/// Returns number of recorded values
+			///
+			uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+
+			///
+			/// Returns sum of recorded values
+			///
+			uint64_t sum() const { return m_sum.load(std::memory_order_relaxed); }
+
+			///
+			/// Returns maximum recorded value
+			///
+			uint64_t maximum() const { return m_max.load(std::memory_order_relaxed); }
+
+			///
+			/// Returns value at given percentile
+			///
+			/// \param[in] p  Percentile (0-100)
+			///
+			/// \return Upper bound of the bucket containing the percentile; 0 if no values were recorded
+			///
+			uint64_t percentile(_In_ double p) const
 			{
-				return m_ctime;
+				uint64_t count = 0;
+				for (auto& b : m_buckets)
+					count += b.load(std::memory_order_relaxed);
+				if (!count)
+					return 0;
+				uint64_t rank = static_cast<uint64_t>(p / 100 * static_cast<double>(count) + 0.5);
+				if (rank < 1) rank = 1;
+				if (rank > count) rank = count;
+				for (size_t i = 0, n = 0; i < num_buckets; ++i) {
+					n += m_buckets[i].load(std::memory_order_relaxed);
+					if (n >= rank)
+						return std::min(upper_bound(i), maximum());
+				}
+				return maximum();
 			}
 
-			virtual time_point atime() const
+			///
+			/// Returns bucket index for given value
+			///
+			static size_t bucket(_In_ uint64_t value)
 			{
-				return m_atime;
+				if (value < 2 * sub_count)
+					return static_cast<size_t>(value);
+				size_t e = static_cast<size_t>(msb(value));
+				return 2 * sub_count + (e - sub_bits - 1) * sub_count + static_cast<size_t>((value >> (e - sub_bits)) & (sub_count - 1));
 			}
 
-			virtual time_point mtime() const
+			///
+			/// Returns the largest value counted in given bucket
+			///
+			static uint64_t upper_bound(_In_ size_t bucket)
 			{
-				return m_mtime;
+				if (bucket < 2 * sub_count)
+					return bucket;
+				size_t e = (bucket - 2 * sub_count) / sub_count + sub_bits + 1;
+				uint64_t m = (bucket - 2 * sub_count) % sub_count + sub_count;
+				return ((m + 1) << (e - sub_bits)) - 1;
 			}
 
-			virtual void set_ctime(time_point date)
+		protected:
+			std::atomic<uint64_t> m_buckets[num_buckets];
+			std::atomic<uint64_t> m_count, m_sum, m_max;
+		};
+
+		///
+		/// Statistics of a single stream operation type
+		///
+		struct io_counter
+		{
+			std::atomic<uint64_t> calls; ///< Number of calls
+			std::atomic<uint64_t> bytes; ///< Number of bytes transferred
+			latency_histogram latency; ///< Call latency in nanoseconds
+
+			io_counter() : calls(0), bytes(0) {}
+
+			///
+			/// Records a call
+			///
+			/// \param[in] start  Time the call started
+			/// \param[in] size   Number of bytes transferred
+			///
+			void record(_In_ std::chrono::steady_clock::time_point start, _In_ uint64_t size = 0)
 			{
-				m_ctime = date;
+				auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+				calls.fetch_add(1, std::memory_order_relaxed);
+				bytes.fetch_add(size, std::memory_order_relaxed);
+				latency.record(duration > 0 ? static_cast<uint64_t>(duration) : 0);
 			}
 
-			virtual void set_atime(time_point date)
+			void reset()
 			{
-				m_atime = date;
+				calls.store(0, std::memory_order_relaxed);
+				bytes.store(0, std::memory_order_relaxed);
+				latency.reset();
 			}
+		};
 
-			virtual void set_mtime(time_point date)
+		///
+		/// Stream I/O statistics
+		///
+		struct io_stats
+		{
+			io_counter read; ///< read(), readv(), read_at(), read_until(), peek() and consume()
+			io_counter write; ///< write(), writev(), write_at(), write_stream()
+			io_counter flush; ///< flush()
+			io_counter seek; ///< seek()
+
+			void reset()
 			{
-				m_mtime = date;
+				read.reset();
+				write.reset();
+				flush.reset();
+				seek.reset();
 			}
-#endif
 
-		protected:
 			///
-			/// Writes data to specified file location
-			/// This does not move file pointer nor update file size. It checks for reserved space stdex_assert-only (in Debug builds). Use with caution!
+			/// Writes statistics as text table
 			///
-			/// \param[in] offset  Offset in file where to write data
-			/// \param[in] data    Data to write
+			/// \param[in,out] stream  Stream to write to
 			///
-			template <class T>
-			void set(_In_ fpos_t offset, _In_ const T data)
+			void dump_text(_Inout_ basic& stream) const
 			{
-#if SET_FILE_OP_TIMES
-				m_atime = m_mtime = time_point::now();
-#endif
-				stdex_assert(offset + sizeof(T) < m_size);
-				(*reinterpret_cast<T*>(&m_data[offset])) = HE2LE(data);
+				stream.write_sprintf("%-6s %12s %16s %12s %12s %12s %12s %12s\n", nullptr, "op", "calls", "bytes", "avg ns", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+				for (auto& i : items()) {
+					auto& c = *i.second;
+					uint64_t calls = c.calls.load(std::memory_order_relaxed);
+					stream.write_sprintf("%-6s %12llu %16llu %12llu %12llu %12llu %12llu %12llu\n", nullptr,
+						i.first,
+						static_cast<unsigned long long>(calls),
+						static_cast<unsigned long long>(c.bytes.load(std::memory_order_relaxed)),
+						static_cast<unsigned long long>(calls ? c.latency.sum() / calls : 0),
+						static_cast<unsigned long long>(c.latency.percentile(50)),
+						static_cast<unsigned long long>(c.latency.percentile(99)),
+						static_cast<unsigned long long>(c.latency.percentile(99.9)),
+						static_cast<unsigned long long>(c.latency.maximum()));
+				}
 			}
 
-		public:
-			void set(_In_ fpos_t offset, _In_ const int8_t data) { set<int8_t>(offset, data); }
-			void set(_In_ fpos_t offset, _In_ const int16_t data) { set<int16_t>(offset, data); }
-			void set(_In_ fpos_t offset, _In_ const int32_t data) { set<int32_t>(offset, data); }
-			void set(_In_ fpos_t offset, _In_ const int64_t data) { set<int64_t>(offset, data); }
-			void set(_In_ fpos_t offset, _In_ const uint8_t data) { set<uint8_t>(offset, data); }
-			void set(_In_ fpos_t offset, _In_ const uint16_t data) { set<uint16_t>(offset, data); }
-			void set(_In_ fpos_t offset, _In_ const uint32_t data) { set<uint32_t>(offset, data); }
-			void set(_In_ fpos_t offset, _In_ const uint64_t data) { set<uint64_t>(offset, data); }
-			void set(_In_ fpos_t offset, _In_ const float data) { set<float>(offset, data); }
-			void set(_In_ fpos_t offset, _In_ const double data) { set<double>(offset, data); }
-			void set(_In_ fpos_t offset, _In_ const char data) { set<char>(offset, data); }
-#ifdef _NATIVE_WCHAR_T_DEFINED
-			void set(_In_ fpos_t offset, _In_ const wchar_t data) { set<wchar_t>(offset, data); }
-#endif
-
 			///
-			/// Reads data from specified file location
-			/// This does not move file pointer. It checks for data size stdex_assert-only (in Debug builds). Use with caution!
+			/// Writes statistics as JSON object
 			///
-			/// \param[in] offset  Offset in file where to write data
-			/// \param[in] data    Data to write
+			/// \param[in,out] stream  Stream to write to
 			///
-		protected:
-			template <class T>
-			void get(_In_ fpos_t offset, _Out_ T & data)
+			void dump_json(_Inout_ basic& stream) const
 			{
-				stdex_assert(offset + sizeof(T) < m_size);
-				data = LE2HE(*(T*)(&m_data[offset]));
-#if SET_FILE_OP_TIMES
-				m_atime = time_point::now();
-#endif
+				stream.write_byte('{');
+				bool first = true;
+				for (auto& i : items()) {
+					auto& c = *i.second;
+					stream.write_sprintf(
+						"%s\"%s\":{\"calls\":%llu,\"bytes\":%llu,\"latency_ns\":{\"sum\":%llu,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu}}", nullptr,
+						first ? "" : ",",
+						i.first,
+						static_cast<unsigned long long>(c.calls.load(std::memory_order_relaxed)),
+						static_cast<unsigned long long>(c.bytes.load(std::memory_order_relaxed)),
+						static_cast<unsigned long long>(c.latency.sum()),
+						static_cast<unsigned long long>(c.latency.percentile(50)),
+						static_cast<unsigned long long>(c.latency.percentile(90)),
+						static_cast<unsigned long long>(c.latency.percentile(99)),
+						static_cast<unsigned long long>(c.latency.percentile(99.9)),
+						static_cast<unsigned long long>(c.latency.maximum()));
+					first = false;
+				}
+				stream.write_byte('}');
 			}
 
-		public:
-			void get(_In_ fpos_t offset, _Out_ int8_t & data) { get<int8_t>(offset, data); }
-			void get(_In_ fpos_t offset, _Out_ int16_t & data) { get<int16_t>(offset, data); }
-			void get(_In_ fpos_t offset, _Out_ int32_t & data) { get<int32_t>(offset, data); }
-			void get(_In_ fpos_t offset, _Out_ int64_t & data) { get<int64_t>(offset, data); }
-			void get(_In_ fpos_t offset, _Out_ uint8_t & data) { get<uint8_t>(offset, data); }
-			void get(_In_ fpos_t offset, _Out_ uint16_t & data) { get<uint16_t>(offset, data); }
-			void get(_In_ fpos_t offset, _Out_ uint32_t & data) { get<uint32_t>(offset, data); }
-			void get(_In_ fpos_t offset, _Out_ uint64_t & data) { get<uint64_t>(offset, data); }
-			void get(_In_ fpos_t offset, _Out_ float& data) { get<float>(offset, data); }
-			void get(_In_ fpos_t offset, _Out_ double& data) { get<double>(offset, data); }
-			void get(_In_ fpos_t offset, _Out_ char& data) { get<char>(offset, data); }
-#ifdef _NATIVE_WCHAR_T_DEFINED
-			void get(_In_ fpos_t offset, _Out_ wchar_t& data) { get<wchar_t>(offset, data); }
-#endif
-
-			memory_file& operator <<(_In_ const int8_t data) { return write_data(data); }
-			memory_file& operator >>(_Out_ int8_t & data) { return read_data(data); }
-			memory_file& operator <<(_In_ const int16_t data) { return write_data(data); }
-			memory_file& operator >>(_Out_ int16_t & data) { return read_data(data); }
-			memory_file& operator <<(_In_ const int32_t data) { return write_data(data); }
-			memory_file& operator >>(_Out_ int32_t & data) { return read_data(data); }
-			memory_file& operator <<(_In_ const int64_t data) { return write_data(data); }
-			memory_file& operator >>(_Out_ int64_t & data) { return read_data(data); }
-			memory_file& operator <<(_In_ const uint8_t data) { return write_data(data); }
-			memory_file& operator >>(_Out_ uint8_t & data) { return read_data(data); }
-			memory_file& operator <<(_In_ const uint16_t data) { return write_data(data); }
-			memory_file& operator >>(_Out_ uint16_t & data) { return read_data(data); }
-			memory_file& operator <<(_In_ const uint32_t data) { return write_data(data); }
-			memory_file& operator >>(_Out_ uint32_t & data) { return read_data(data); }
-			memory_file& operator <<(_In_ const uint64_t data) { return write_data(data); }
-			memory_file& operator >>(_Out_ uint64_t & data) { return read_data(data); }
-			memory_file& operator <<(_In_ const float data) { return write_data(data); }
-			memory_file& operator >>(_Out_ float& data) { return read_data(data); }
-			memory_file& operator <<(_In_ const double data) { return write_data(data); }
-			memory_file& operator >>(_Out_ double& data) { return read_data(data); }
-			memory_file& operator <<(_In_ const char data) { return write_data(data); }
-			memory_file& operator >>(_Out_ char& data) { return read_data(data); }
-#ifdef _NATIVE_WCHAR_T_DEFINED
-			memory_file& operator <<(_In_ const wchar_t data) { return write_data(data); }
-			memory_file& operator >>(_Out_ wchar_t& data) { return read_data(data); }
-#endif
-			template<class T, class TR = std::char_traits<T>, class AX = std::allocator<T>>
-			memory_file& operator >>(_Out_ std::basic_string<T, TR, AX>&data) { return read_str(data); }
-			template <class T>
-			memory_file& operator <<(_In_ const T * data) { return write_str(data); }
-			template<class T, class TR = std::char_traits<T>, class AX = std::allocator<T>>
-			memory_file& operator <<(_In_ const std::basic_string<T, TR, AX>& data) { return write_str(data); }
-
 		protected:
-			uint8_t* m_data; ///< file data
-			bool m_manage; ///< may reallocate m_data?
-			size_t m_offset; ///< file pointer
-			size_t m_size; ///< file size
-			size_t m_reserved; ///< reserved file size
-#if SET_FILE_OP_TIMES
-			time_point
-				m_ctime,
-				m_atime,
-				m_mtime;
-#endif
+			std::array<std::pair<const char*, const io_counter*>, 4> items() const
+			{
+				return { {
+					{ "read", &read },
+					{ "write", &write },
+					{ "flush", &flush },
+					{ "seek", &seek },
+				} };
+			}
 		};
 
 		///
-		/// In-memory FIFO queue
+		/// Collects I/O statistics of a stream
 		///
-		class fifo : public basic {
+		/// Wrap streams at multiple layers (e.g. buffer, zlib_writer, file) to see where time is spent.
+		///
+		class stats_stream : public converter
+		{
 		public:
-			fifo() :
-				m_offset(0),
-				m_size(0),
-				m_head(nullptr),
-				m_tail(nullptr)
-			{}
+			stats_stream(_Inout_ basic& source) : converter(source) {}
+
+			virtual _Success_(return != 0 || length == 0) size_t read(
+				_Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length)
+			{
+				auto start = std::chrono::steady_clock::now();
+				size_t num_read = converter::read(data, length);
+				m_stats.read.record(start, num_read);
+				return num_read;
+			}
+
+			virtual _Success_(return != 0) size_t write(
+				_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
+			{
+				auto start = std::chrono::steady_clock::now();
+				size_t num_written = converter::write(data, length);
+				m_stats.write.record(start, num_written);
+				return num_written;
+			}
+
+			virtual size_t readv(_In_reads_(count) const iovec_t* iov, _In_ size_t count)
+			{
+				auto start = std::chrono::steady_clock::now();
+				size_t num_read = m_source->readv(iov, count);
+				m_state = m_source->state();
+				m_stats.read.record(start, num_read);
+				return num_read;
+			}
+
+			virtual size_t writev(_In_reads_(count) const const_iovec_t* iov, _In_ size_t count)
+			{
+				auto start = std::chrono::steady_clock::now();
+				size_t num_written = m_source->writev(iov, count);
+				m_state = m_source->state();
+				m_stats.write.record(start, num_written);
+				return num_written;
+			}
 
-			virtual ~fifo()
+			virtual fsize_t write_stream(_Inout_ basic& stream, _In_ fsize_t amount = fsize_max)
 			{
-				while (m_head) {
-					auto p = m_head;
-					m_head = p->next;
-					delete p;
-				}
+				auto start = std::chrono::steady_clock::now();
+				fsize_t num_written = m_source->write_stream(stream, amount);
+				m_state = m_source->state();
+				m_stats.write.record(start, num_written);
+				return num_written;
 			}
 
-#pragma warning(suppress: 6101) // See [2] below
-			virtual _Success_(return != 0 || length == 0) size_t read(
-				_Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length)
+			virtual bool read_until(_In_ uint8_t delim, _Outptr_result_bytebuffer_(length) const void*& data, _Out_ size_t& length)
 			{
-				stdex_assert(data || !length);
-				for (size_t to_read = length;;) {
-					if (!m_head) _Unlikely_ {
-						m_state = to_read < length || !length ? state_t::ok : state_t::eof;
-						return length - to_read; // [2] Code analysis misses `length - to_read` bytes were written to data in previous loop iterations.
-					}
-					size_t remaining = m_head->size - m_offset;
-					if (remaining > to_read) {
-						memcpy(data, m_head->data + m_offset, to_read);
-						m_offset += to_read;
-						m_size -= to_read;
-						m_state = state_t::ok;
-						return length;
-					}
-					memcpy(data, m_head->data + m_offset, remaining);
-					m_offset = 0;
-					m_size -= remaining;
-					reinterpret_cast<uint8_t*&>(data) += remaining;
-					to_read -= remaining;
-					auto p = m_head;
-					m_head = p->next;
-					delete p;
-				}
+				auto start = std::chrono::steady_clock::now();
+				bool result = m_source->read_until(delim, data, length);
+				m_state = m_source->state();
+				if (result)
+					m_stats.read.record(start, length);
+				return result;
 			}
 
-			virtual _Success_(return != 0) size_t write(
-				_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
+			///
+			/// Returns data available in source's internal memory without consuming it
+			///
+			/// Counted as a read call. Bytes are counted once consumed.
+			///
+			virtual bool peek(_In_ size_t length, _Outptr_result_bytebuffer_(available) const void*& data, _Out_ size_t& available)
 			{
-				stdex_assert(data || !length);
-				try {
-					std::unique_ptr<node_t> n(reinterpret_cast<node_t*>(new uint8_t[sizeof(node_t) + length]));
-					n->next = nullptr;
-					n->size = length;
-					memcpy(n->data, data, length);
-					m_size += length;
-					if (m_head)
-						m_tail = m_tail->next = n.release();
-					else
-						m_head = m_tail = n.release();
-					m_state = state_t::ok;
-					return length;
-				}
-				catch (const std::bad_alloc&) {
-					m_state = state_t::fail;
-					return 0;
-				}
+				auto start = std::chrono::steady_clock::now();
+				bool result = m_source->peek(length, data, available);
+				m_state = m_source->state();
+				if (result)
+					m_stats.read.record(start);
+				return result;
 			}
 
-			virtual void close()
+			virtual void consume(_In_ size_t length)
 			{
-				m_size = m_offset = 0;
-				while (m_head) {
-					auto p = m_head;
-					m_head = p->next;
-					delete p;
-				}
-				m_state = state_t::ok;
+				m_source->consume(length);
+				m_stats.read.bytes.fetch_add(length, std::memory_order_relaxed);
+			}
+
+			virtual void flush()
+			{
+				auto start = std::chrono::steady_clock::now();
+				converter::flush();
+				m_stats.flush.record(start);
 			}
 
 			///
-			/// Returns total size of pending data in the queue
+			/// Returns collected statistics
 			///
-			size_t size() const { return m_size; };
+			io_stats& stats() { return m_stats; }
+
+			///
+			/// Returns collected statistics
+			///
+			const io_stats& stats() const { return m_stats; }
 
 		protected:
-			size_t m_offset, m_size;
-			struct node_t {
-				node_t* next;
-				size_t size;
-#pragma warning(suppress:4200)
-				uint8_t data[0];
-			} *m_head, * m_tail;
+			io_stats m_stats;
 		};
 
 		///
-		/// Compares multiple files to perform the same
+		/// Collects I/O statistics of a file
 		///
-		class diag_file : public basic_file {
+		class stats_file : public basic_file
+		{
 		public:
-			diag_file(_In_count_(num_files) basic_file* const* files, _In_ size_t num_files) :
-				basic(num_files ? files[0]->state() : state_t::fail),
-				m_files(files, files + num_files)
+			stats_file(_Inout_ basic_file& source) :
+				basic(source.state()),
+				m_source(source)
 			{}
 
 			virtual _Success_(return != 0 || length == 0) size_t read(
 				_Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length)
 			{
-				stdex_assert(data || !length);
-				if (m_files.empty()) {
-					m_state = state_t::fail;
-					return 0;
-				}
-				size_t result = m_files[0]->read(data, length);
-				stdex_assert(result <= length);
-				m_state = m_files[0]->state();
-				if (length > m_tmp.size())
-					m_tmp.resize(length);
-				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
-					if (m_files[i]->read(m_tmp.data(), length) != result ||
-						memcmp(m_tmp.data(), data, result))
-						throw std::runtime_error("read mismatch");
-					if (m_files[i]->state() != m_state)
-						throw std::runtime_error("state mismatch");
-				}
-				return result;
+				auto start = std::chrono::steady_clock::now();
+				size_t num_read = m_source.read(data, length);
+				m_state = m_source.state();
+				m_stats.read.record(start, num_read);
+				return num_read;
 			}
 
 			virtual _Success_(return != 0) size_t write(
 				_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
 			{
-				if (m_files.empty()) {
-					m_state = state_t::fail;
-					return 0;
-				}
-				size_t result = m_files[0]->write(data, length);
-				m_state = m_files[0]->state();
-				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
-					if (m_files[i]->write(data, length) != result)
-						throw std::runtime_error("write mismatch");
-					if (m_files[i]->state() != m_state)
-						throw std::runtime_error("state mismatch");
-				}
+				auto start = std::chrono::steady_clock::now();
+				size_t num_written = m_source.write(data, length);
+				m_state = m_source.state();
+				m_stats.write.record(start, num_written);
+				return num_written;
+			}
+
+			virtual size_t readv(_In_reads_(count) const iovec_t* iov, _In_ size_t count)
+			{
+				auto start = std::chrono::steady_clock::now();
+				size_t num_read = m_source.readv(iov, count);
+				m_state = m_source.state();
+				m_stats.read.record(start, num_read);
+				return num_read;
+			}
+
+			virtual size_t writev(_In_reads_(count) const const_iovec_t* iov, _In_ size_t count)
+			{
+				auto start = std::chrono::steady_clock::now();
+				size_t num_written = m_source.writev(iov, count);
+				m_state = m_source.state();
+				m_stats.write.record(start, num_written);
+				return num_written;
+			}
+
+			virtual _Success_(return != 0 || length == 0) size_t read_at(
+				_In_ fpos_t offset, _Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length,
+				_Out_opt_ state_t* state = nullptr)
+			{
+				auto start = std::chrono::steady_clock::now();
+				size_t num_read = m_source.read_at(offset, data, length, state);
+				m_stats.read.record(start, num_read);
+				return num_read;
+			}
+
+			virtual _Success_(return != 0) size_t write_at(
+				_In_ fpos_t offset, _In_reads_bytes_opt_(length) const void* data, _In_ size_t length,
+				_Out_opt_ state_t* state = nullptr)
+			{
+				auto start = std::chrono::steady_clock::now();
+				size_t num_written = m_source.write_at(offset, data, length, state);
+				m_stats.write.record(start, num_written);
+				return num_written;
+			}
+
+			virtual fsize_t write_stream(_Inout_ basic& stream, _In_ fsize_t amount = fsize_max)
+			{
+				auto start = std::chrono::steady_clock::now();
+				fsize_t num_written = m_source.write_stream(stream, amount);
+				m_state = m_source.state();
+				m_stats.write.record(start, num_written);
+				return num_written;
+			}
+
+			virtual bool read_until(_In_ uint8_t delim, _Outptr_result_bytebuffer_(length) const void*& data, _Out_ size_t& length)
+			{
+				auto start = std::chrono::steady_clock::now();
+				bool result = m_source.read_until(delim, data, length);
+				m_state = m_source.state();
+				if (result)
+					m_stats.read.record(start, length);
+				return result;
+			}
+
+			///
+			/// Returns data available in source's internal memory without consuming it
+			///
+			/// Counted as a read call. Bytes are counted once consumed.
+			///
+			virtual bool peek(_In_ size_t length, _Outptr_result_bytebuffer_(available) const void*& data, _Out_ size_t& available)
+			{
+				auto start = std::chrono::steady_clock::now();
+				bool result = m_source.peek(length, data, available);
+				m_state = m_source.state();
+				if (result)
+					m_stats.read.record(start);
 				return result;
 			}
 
+			virtual void consume(_In_ size_t length)
+			{
+				m_source.consume(length);
+				m_stats.read.bytes.fetch_add(length, std::memory_order_relaxed);
+			}
+
 			virtual void flush()
 			{
-				if (m_files.empty()) {
-					m_state = state_t::ok;
-					return;
-				}
-				m_files[0]->flush();
-				m_state = m_files[0]->state();
-				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
-					m_files[i]->flush();
-					if (m_files[i]->state() != m_state)
-						throw std::runtime_error("state mismatch");
-				}
+				auto start = std::chrono::steady_clock::now();
+				m_source.flush();
+				m_state = m_source.state();
+				m_stats.flush.record(start);
 			}
 
 			virtual void close()
 			{
-				if (m_files.empty()) {
-					m_state = state_t::ok;
-					return;
-				}
-				m_files[0]->close();
-				m_state = m_files[0]->state();
-				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
-					m_files[i]->close();
-					if (m_files[i]->state() != m_state)
-						throw std::runtime_error("state mismatch");
-				}
-				m_tmp.clear();
-				m_tmp.shrink_to_fit();
+				m_source.close();
+				m_state = m_source.state();
 			}
 
 			virtual fpos_t seek(_In_ foff_t offset, _In_ seek_t how = seek_t::beg)
 			{
-				if (m_files.empty()) {
-					m_state = state_t::fail;
-					return fpos_max;
-				}
-				fpos_t result = m_files[0]->seek(offset, how);
-				m_state = m_files[0]->state();
-				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
-					if (m_files[i]->seek(offset, how) != result)
-						throw std::runtime_error("seek mismatch");
-					if (m_files[i]->state() != m_state)
-						throw std::runtime_error("state mismatch");
-				}
+				auto start = std::chrono::steady_clock::now();
+				fpos_t result = m_source.seek(offset, how);
+				m_state = m_source.state();
+				m_stats.seek.record(start);
 				return result;
 			}
 
 			virtual fpos_t tell() const
 			{
-				if (m_files.empty())
-					return fpos_max;
-				fpos_t result = m_files[0]->tell();
-				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
-					if (m_files[i]->tell() != result)
-						throw std::runtime_error("tell mismatch");
-				}
-				return result;
+				return m_source.tell();
 			}
 
 			virtual void lock(_In_ fpos_t offset, _In_ fsize_t length)
 			{
-				if (m_files.empty())
-					m_state = state_t::fail;
-				m_files[0]->lock(offset, length);
-				m_state = m_files[0]->state();
-				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
-					m_files[i]->lock(offset, length);
-					if (m_files[i]->state() != m_state)
-						throw std::runtime_error("state mismatch");
-				}
+				m_source.lock(offset, length);
+				m_state = m_source.state();
 			}
 
 			virtual void unlock(_In_ fpos_t offset, _In_ fsize_t length)
 			{
-				if (m_files.empty())
-					m_state = state_t::fail;
-				m_files[0]->unlock(offset, length);
-				m_state = m_files[0]->state();
-				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
-					m_files[i]->unlock(offset, length);
-					if (m_files[i]->state() != m_state)
-						throw std::runtime_error("state mismatch");
-				}
+				m_source.unlock(offset, length);
+				m_state = m_source.state();
+			}
+
+			virtual void advise(_In_ access_hint_t hint, _In_ fpos_t offset = 0, _In_ fsize_t length = fsize_max)
+			{
+				m_source.advise(hint, offset, length);
+			}
+
+			virtual void prefetch(_In_ fpos_t offset, _In_ fsize_t length)
+			{
+				m_source.prefetch(offset, length);
 			}
 
 			virtual fsize_t size() const
 			{
-				if (m_files.empty())
-					return fsize_max;
-				fsize_t result = m_files[0]->size();
-				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
-					if (m_files[i]->size() != result)
-						throw std::runtime_error("size mismatch");
-				}
-				return result;
+				return m_source.size();
 			}
 
 			virtual void truncate()
 			{
-				if (m_files.empty())
-					m_state = state_t::fail;
-				m_files[0]->truncate();
-				m_state = m_files[0]->state();
-				for (size_t i = 1, n = m_files.size(); i < n; ++i) {
-					m_files[i]->truncate();
-					if (m_files[i]->state() != m_state)
-						throw std::runtime_error("state mismatch");
-				}
+				m_source.truncate();
+				m_state = m_source.state();
+			}
+
+			virtual time_point ctime() const
+			{
+				return m_source.ctime();
+			}
+
+			virtual time_point atime() const
+			{
+				return m_source.atime();
+			}
+
+			virtual time_point mtime() const
+			{
+				return m_source.mtime();
+			}
+
+			virtual void set_ctime(time_point date)
+			{
+				m_source.set_ctime(date);
+			}
+
+			virtual void set_atime(time_point date)
+			{
+				m_source.set_atime(date);
+			}
+
+			virtual void set_mtime(time_point date)
+			{
+				m_source.set_mtime(date);
 			}
 
+			///
+			/// Returns collected statistics
+			///
+			io_stats& stats() { return m_stats; }
+
+			///
+			/// Returns collected statistics
+			///
+			const io_stats& stats() const { return m_stats; }
+
 		protected:
-			std::vector<basic_file*> m_files;
-			std::vector<uint8_t> m_tmp;
+			basic_file& m_source;
+			io_stats m_stats;
 		};
 	}
 }
@@ -0,0 +1,214 @@
+﻿/*
+	SPDX-License-Identifier: MIT
+	Copyright © 2023-2024 Amebis
+*/
+
+#pragma once
+
+#include "compat.hpp"
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <system_error>
+
+namespace stdex
+{
+	///
+	/// Linux io_uring instance
+	///
+	/// Thin wrapper over io_uring system calls. It does not depend on liburing.
+	/// Not thread-safe: a single thread should prepare submissions and reap completions.
+	///
+	class uring
+	{
+	public:
+		///
+		/// Creates io_uring instance
+		///
+		/// \param[in] entries  Minimum number of submission queue entries
+		/// \param[in] flags    IORING_SETUP_* flags
+		///
+		uring(_In_ unsigned entries, _In_ unsigned flags = 0)
+		{
+			io_uring_params p;
+			memset(&p, 0, sizeof(p));
+			p.flags = flags;
+			m_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+			if (m_fd < 0) _Unlikely_
+				throw std::system_error(errno, std::system_category(), "io_uring_setup failed");
+			m_sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+			m_cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+			if (p.features & IORING_FEAT_SINGLE_MMAP)
+				m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+			m_sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+			m_sq = m_cq = m_sqes = MAP_FAILED;
+			m_sq = mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+			if (m_sq != MAP_FAILED) {
+				m_cq = p.features & IORING_FEAT_SINGLE_MMAP ?
+					m_sq :
+					mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+				if (m_cq != MAP_FAILED)
+					m_sqes = mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+			}
+			if (m_sqes == MAP_FAILED) _Unlikely_ {
+				int err = errno;
+				unmap();
+				::close(m_fd);
+				throw std::system_error(err, std::system_category(), "io_uring mmap failed");
+			}
+
+			auto sq = static_cast<uint8_t*>(m_sq);
+			m_sq_head = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+			m_sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+			m_sq_mask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+			m_sq_entries = p.sq_entries;
+			m_sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+			auto cq = static_cast<uint8_t*>(m_cq);
+			m_cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+			m_cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+			m_cq_mask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+			m_cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+			m_sqe_tail = *m_sq_tail;
+		}
+
+		virtual ~uring()
+		{
+			unmap();
+			::close(m_fd);
+		}
+
+	private:
+		uring(_In_ const uring& other);
+		uring& operator =(_In_ const uring& other);
+
+	public:
+		///
+		/// Returns number of submission queue entries
+		///
+		unsigned entries() const { return m_sq_entries; }
+
+		///
+		/// Registers fixed buffers for IORING_OP_READ_FIXED/IORING_OP_WRITE_FIXED
+		///
+		/// \param[in] iov    Buffers
+		/// \param[in] count  Number of buffers
+		///
+		/// \return true on success; false otherwise (e.g. when buffers exceed RLIMIT_MEMLOCK)
+		///
+		bool register_buffers(_In_reads_(count) const struct iovec* iov, _In_ unsigned count)
+		{
+			return syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_BUFFERS, iov, count) >= 0;
+		}
+
+		///
+		/// Returns next zeroed submission queue entry to populate
+		///
+		/// The entry is submitted on the next submit() call.
+		///
+		/// \return Submission queue entry or nullptr if the submission queue is full
+		///
+		io_uring_sqe* get_sqe()
+		{
+			unsigned head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+			if (m_sqe_tail - head >= m_sq_entries) _Unlikely_
+				return nullptr;
+			unsigned idx = m_sqe_tail++ & m_sq_mask;
+			m_sq_array[idx] = idx;
+			io_uring_sqe* sqe = &static_cast<io_uring_sqe*>(m_sqes)[idx];
+			memset(sqe, 0, sizeof(*sqe));
+			return sqe;
+		}
+
+		///
+		/// Submits all populated submission queue entries in a single system call
+		///
+		/// \param[in] wait_nr  Number of completions to wait for
+		///
+		/// \return Number of entries submitted
+		///
+		unsigned submit(_In_ unsigned wait_nr = 0)
+		{
+			__atomic_store_n(m_sq_tail, m_sqe_tail, __ATOMIC_RELEASE);
+			for (;;) {
+				unsigned to_submit = m_sqe_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+				if (!to_submit && !wait_nr)
+					return 0;
+				auto result = syscall(__NR_io_uring_enter, m_fd, to_submit, wait_nr, wait_nr ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+				if (result >= 0)
+					return static_cast<unsigned>(result);
+				if (errno != EINTR) _Unlikely_
+					throw std::system_error(errno, std::system_category(), "io_uring_enter failed");
+			}
+		}
+
+		///
+		/// Returns next completion queue entry without waiting
+		///
+		/// \return Completion queue entry or nullptr if none available. Call seen() after the entry is processed.
+		///
+		io_uring_cqe* peek_cqe()
+		{
+			unsigned head = *m_cq_head;
+			if (head == __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE))
+				return nullptr;
+			return &m_cqes[head & m_cq_mask];
+		}
+
+		///
+		/// Returns next completion queue entry. Submits pending entries and waits when none available.
+		///
+		/// \return Completion queue entry. Call seen() after the entry is processed.
+		///
+		io_uring_cqe* wait_cqe()
+		{
+			for (;;) {
+				io_uring_cqe* cqe = peek_cqe();
+				if (cqe)
+					return cqe;
+				submit(1);
+			}
+		}
+
+		///
+		/// Marks completion queue entry returned by peek_cqe() or wait_cqe() as processed
+		///
+		void seen()
+		{
+			__atomic_store_n(m_cq_head, *m_cq_head + 1, __ATOMIC_RELEASE);
+		}
+
+	protected:
+		void unmap()
+		{
+			if (m_sqes != MAP_FAILED)
+				munmap(m_sqes, m_sqes_size);
+			if (m_cq != MAP_FAILED && m_cq != m_sq)
+				munmap(m_cq, m_cq_size);
+			if (m_sq != MAP_FAILED)
+				munmap(m_sq, m_sq_size);
+		}
+
+	protected:
+		int m_fd;
+		void* m_sq;
+		void* m_cq;
+		void* m_sqes;
+		size_t m_sq_size, m_cq_size, m_sqes_size;
+		unsigned* m_sq_head;
+		unsigned* m_sq_tail;
+		unsigned m_sq_mask, m_sq_entries;
+		unsigned* m_sq_array;
+		unsigned m_sqe_tail; ///< Tail including populated, but not yet published entries
+		unsigned* m_cq_head;
+		unsigned* m_cq_tail;
+		unsigned m_cq_mask;
+		io_uring_cqe* m_cqes;
+	};
+}
+#endif
@@ -17,8 +17,14 @@
 #if _MSC_VER
 #pragma warning(pop)
 #endif
+#include <algorithm>
+#include <condition_variable>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 #if defined(__GNUC__)
 #pragma GCC diagnostic push
@@ -113,6 +119,324 @@ namespace stdex
 		std::unique_ptr<Byte[]> m_block;
 	};
 
+	///
+	/// Default size of blocks compressed independently by parallel_zlib_writer
+	///
+	constexpr size_t default_zlib_parallel_block_size = 0x20000;
+
+	///
+	/// Compresses data on multiple threads when writing to a stream
+	///
+	/// Input is split into blocks compressed concurrently. Each block is primed with the last 32kB of preceding data
+	/// to keep compression ratio close to single-threaded compression. Blocks are written in order as a single
+	/// valid zlib or gzip stream.
+	///
+	class parallel_zlib_writer : public stdex::stream::converter
+	{
+	public:
+		///
+		/// Starts compression
+		///
+		/// \param[in,out] source             Stream to write compressed data to
+		/// \param[in]     compression_level  Compression level (0-9 or Z_DEFAULT_COMPRESSION)
+		/// \param[in]     num_threads        Number of worker threads
+		/// \param[in]     block_size         Number of bytes of input per block
+		/// \param[in]     gzip               true to write gzip format; false to write zlib format
+		///
+		parallel_zlib_writer(
+			_Inout_ stdex::stream::basic& source,
+			_In_ int compression_level = Z_BEST_COMPRESSION,
+			_In_ size_t num_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1),
+			_In_ size_t block_size = default_zlib_parallel_block_size,
+			_In_ bool gzip = false) :
+			stdex::stream::converter(source),
+			m_compression_level(compression_level),
+			m_block_size(block_size),
+			m_max_pending(num_threads * 2),
+			m_gzip(gzip),
+			m_check(gzip ? crc32(0, Z_NULL, 0) : adler32(0, Z_NULL, 0)),
+			m_total(0),
+			m_quit(false)
+		{
+			stdex_assert(num_threads && block_size);
+			if (compression_level < Z_DEFAULT_COMPRESSION || compression_level > Z_BEST_COMPRESSION) _Unlikely_
+				throw std::invalid_argument("invalid compression level");
+			write_header();
+			m_input.reserve(block_size);
+			m_workers.reserve(num_threads);
+			for (size_t i = 0; i < num_threads; ++i)
+				m_workers.push_back(std::thread(process, std::ref(*this)));
+		}
+
+		virtual ~parallel_zlib_writer()
+		{
+			try {
+				submit(true);
+				drain(0);
+			}
+			catch (...) {
+				stop();
+				throw;
+			}
+			stop();
+			write_trailer();
+			if (!m_source->ok()) _Unlikely_
+				throw std::system_error(sys_error(), std::system_category(), "failed to flush compressed stream"); // Data loss occured
+		}
+
+		virtual _Success_(return != 0) size_t write(
+			_In_reads_bytes_opt_(length) const void* data, _In_ size_t length)
+		{
+			stdex_assert(data || !length);
+			if (!ok()) _Unlikely_
+				return 0;
+			for (size_t num_written = 0;;) {
+				size_t n = std::min(length - num_written, m_block_size - m_input.size());
+				m_input.insert(m_input.end(), reinterpret_cast<const Byte*>(data) + num_written, reinterpret_cast<const Byte*>(data) + num_written + n);
+				num_written += n;
+				if (m_input.size() < m_block_size)
+					return num_written;
+				submit(false);
+				drain(m_max_pending);
+				if (!ok()) _Unlikely_
+					return num_written;
+			}
+		}
+
+		///
+		/// Compresses buffered data and writes all pending blocks
+		///
+		/// Blocks are terminated with a sync flush, so all data written so far can be decompressed.
+		///
+		virtual void flush()
+		{
+			if (!m_input.empty())
+				submit(false);
+			drain(0);
+			if (ok())
+				converter::flush();
+		}
+
+	protected:
+		///
+		/// Block compression job
+		///
+		struct job_t
+		{
+			std::vector<Byte> dictionary; ///< Preceding data to prime compression with
+			std::vector<Byte> input; ///< Data to compress
+			std::vector<Byte> output; ///< Compressed data
+			uLong check; ///< Adler-32 or CRC-32 of input
+			bool last; ///< Is this the final block?
+			bool done; ///< Has the job been processed?
+			int error; ///< zlib error code
+		};
+
+		void write_header()
+		{
+			if (m_gzip) {
+				const Byte header[10] = {
+					0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0,
+					static_cast<Byte>(m_compression_level == Z_BEST_COMPRESSION ? 2 : m_compression_level == Z_BEST_SPEED ? 4 : 0),
+					0xff };
+				m_source->write(header, sizeof(header));
+			}
+			else {
+				Byte header[2] = {
+					0x78,
+					static_cast<Byte>(
+						m_compression_level == Z_DEFAULT_COMPRESSION || m_compression_level == 6 ? 2 << 6 :
+						m_compression_level < 2 ? 0 :
+						m_compression_level < 6 ? 1 << 6 :
+						3 << 6) };
+				header[1] |= static_cast<Byte>(31 - (header[0] * 256 + header[1]) % 31);
+				m_source->write(header, sizeof(header));
+			}
+			m_state = m_source->state();
+		}
+
+		void write_trailer()
+		{
+			if (m_gzip) {
+				Byte trailer[8];
+				for (size_t i = 0; i < 4; ++i) {
+					trailer[i] = static_cast<Byte>(m_check >> (8 * i));
+					trailer[4 + i] = static_cast<Byte>(m_total >> (8 * i));
+				}
+				m_source->write(trailer, sizeof(trailer));
+			}
+			else {
+				Byte trailer[4];
+				for (size_t i = 0; i < 4; ++i)
+					trailer[i] = static_cast<Byte>(m_check >> (8 * (3 - i)));
+				m_source->write(trailer, sizeof(trailer));
+			}
+			m_state = m_source->state();
+		}
+
+		///
+		/// Queues buffered input for compression
+		///
+		void submit(_In_ bool last)
+		{
+			std::unique_ptr<job_t> job(new job_t);
+			job->last = last;
+			job->done = false;
+			job->error = Z_OK;
+			// Next block is primed with the last window of data preceding it.
+			constexpr size_t window_size = size_t(1) << MAX_WBITS;
+			std::vector<Byte> dictionary;
+			if (m_input.size() >= window_size)
+				dictionary.assign(m_input.end() - window_size, m_input.end());
+			else {
+				size_t keep = std::min(window_size - m_input.size(), m_dictionary.size());
+				dictionary.reserve(keep + m_input.size());
+				dictionary.assign(m_dictionary.end() - keep, m_dictionary.end());
+				dictionary.insert(dictionary.end(), m_input.begin(), m_input.end());
+			}
+			job->dictionary = std::move(m_dictionary);
+			m_dictionary = std::move(dictionary);
+			job->input = std::move(m_input);
+			m_input.clear();
+			m_input.reserve(m_block_size);
+			{
+				const std::lock_guard<std::mutex> lk(m_mutex);
+				m_queue.push_back(job.get());
+				m_jobs.push_back(std::move(job));
+			}
+			m_queue_cv.notify_one();
+		}
+
+		///
+		/// Writes compressed blocks in order
+		///
+		/// \param[in] max_pending  Number of jobs allowed to stay queued. Waits for the oldest jobs to complete when
+		///                         more are queued.
+		///
+		void drain(_In_ size_t max_pending)
+		{
+			std::unique_lock<std::mutex> lk(m_mutex);
+			while (!m_jobs.empty() && (m_jobs.front()->done || m_jobs.size() > max_pending)) {
+				while (!m_jobs.front()->done)
+					m_done_cv.wait(lk);
+				auto job = std::move(m_jobs.front());
+				m_jobs.pop_front();
+				lk.unlock();
+				throw_on_zlib_error(job->error);
+				m_check = m_gzip ?
+					crc32_combine(m_check, job->check, static_cast<z_off_t>(job->input.size())) :
+					adler32_combine(m_check, job->check, static_cast<z_off_t>(job->input.size()));
+				m_total += job->input.size();
+				if (ok()) {
+					m_source->write(job->output.data(), job->output.size());
+					m_state = m_source->state();
+				}
+				lk.lock();
+			}
+		}
+
+		///
+		/// Stops worker threads
+		///
+		void stop()
+		{
+			{
+				const std::lock_guard<std::mutex> lk(m_mutex);
+				m_quit = true;
+			}
+			m_queue_cv.notify_all();
+			for (auto& w : m_workers)
+				w.join();
+			m_workers.clear();
+		}
+
+		static void process(_Inout_ parallel_zlib_writer& w)
+		{
+			for (;;) {
+				job_t* job;
+				{
+					std::unique_lock<std::mutex> lk(w.m_mutex);
+					while (w.m_queue.empty() && !w.m_quit)
+						w.m_queue_cv.wait(lk);
+					if (w.m_queue.empty())
+						return;
+					job = w.m_queue.front();
+					w.m_queue.pop_front();
+				}
+				job->error = compress(*job, w.m_compression_level);
+				job->check = w.m_gzip ?
+					crc32(crc32(0, Z_NULL, 0), job->input.data(), static_cast<uInt>(job->input.size())) :
+					adler32(adler32(0, Z_NULL, 0), job->input.data(), static_cast<uInt>(job->input.size()));
+				{
+					const std::lock_guard<std::mutex> lk(w.m_mutex);
+					job->done = true;
+				}
+				w.m_done_cv.notify_one();
+			}
+		}
+
+		///
+		/// Compresses a block as raw deflate data
+		///
+		/// Non-final blocks end with a sync flush to align them to a byte boundary.
+		///
+		/// \return zlib result code
+		///
+		static int compress(_Inout_ job_t& job, _In_ int compression_level)
+		{
+			z_stream zlib;
+			memset(&zlib, 0, sizeof(zlib));
+			int result = deflateInit2(&zlib, compression_level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+			if (result != Z_OK) _Unlikely_
+				return result;
+			if (!job.dictionary.empty())
+				result = deflateSetDictionary(&zlib, job.dictionary.data(), static_cast<uInt>(job.dictionary.size()));
+			if (result == Z_OK) {
+				job.output.resize(deflateBound(&zlib, static_cast<uLong>(job.input.size())) + 6);
+				zlib.next_in = job.input.data();
+				zlib.avail_in = static_cast<uInt>(job.input.size());
+				zlib.next_out = job.output.data();
+				zlib.avail_out = static_cast<uInt>(job.output.size());
+				int flush = job.last ? Z_FINISH : Z_SYNC_FLUSH;
+				for (;;) {
+					result = deflate(&zlib, flush);
+					if (result == Z_STREAM_END || (result == Z_OK && flush == Z_SYNC_FLUSH && zlib.avail_out)) {
+						result = Z_OK;
+						break;
+					}
+					if (result != Z_OK && result != Z_BUF_ERROR) _Unlikely_
+						break;
+					// Output buffer full. Grow it and continue.
+					size_t size = job.output.size();
+					job.output.resize(size * 2);
+					zlib.next_out = job.output.data() + size;
+					zlib.avail_out = static_cast<uInt>(job.output.size() - size);
+				}
+				job.output.resize(zlib.total_out);
+			}
+			deflateEnd(&zlib);
+			return result;
+		}
+
+	protected:
+		int m_compression_level;
+		size_t m_block_size;
+		size_t m_max_pending; ///< Maximum number of jobs queued before write() waits
+		bool m_gzip;
+		std::vector<Byte> m_input; ///< Data collected for the next block
+		std::vector<Byte> m_dictionary; ///< Last window of data preceding m_input
+		uLong m_check; ///< Adler-32 or CRC-32 of data compressed so far
+		uint64_t m_total; ///< Number of bytes compressed so far
+
+		std::mutex m_mutex;
+		std::condition_variable m_queue_cv; ///< Signals workers a job was queued
+		std::condition_variable m_done_cv; ///< Signals writer a job completed
+		std::list<std::unique_ptr<job_t>> m_jobs; ///< Jobs in output order
+		std::list<job_t*> m_queue; ///< Jobs waiting to be compressed
+		bool m_quit;
+		std::vector<std::thread> m_workers;
+	};
+
 	///
 	/// Decompresses data when reading from a stream
 	///
@@ -172,6 +496,352 @@ namespace stdex
 		uInt m_block_size;
 		std::unique_ptr<Byte[]> m_block;
 	};
+
+	///
+	/// Default distance between zlib_index checkpoints in decompressed data
+	///
+	constexpr stdex::stream::fsize_t default_zlib_index_span = 0x100000;
+
+	///
+	/// Random access index of a zlib or gzip stream
+	///
+	/// Records decompressor state at deflate block boundaries about every span bytes of decompressed data. The
+	/// decompression can then resume at any checkpoint without decompressing the data preceding it.
+	///
+	class zlib_index
+	{
+	public:
+		///
+		/// Decompressor state at a deflate block boundary
+		///
+		struct checkpoint_t
+		{
+			stdex::stream::fpos_t in; ///< Offset of the first full byte in compressed data, relative to its beginning
+			stdex::stream::fpos_t out; ///< Offset in decompressed data
+			uint8_t bits; ///< Number of bits (0-7) of the byte preceding in, that belong to the block
+			std::vector<Byte> window; ///< Up to 32kB of decompressed data preceding out
+		};
+
+		zlib_index() : m_size(0) {}
+
+		///
+		/// Builds index by decompressing entire stream
+		///
+		/// \param[in,out] source  Stream positioned at the beginning of zlib or gzip data
+		/// \param[in]     span    Minimum distance between checkpoints in decompressed data
+		///
+		void build(_Inout_ stdex::stream::basic& source, _In_ stdex::stream::fsize_t span = default_zlib_index_span)
+		{
+			m_checkpoints.clear();
+			m_size = 0;
+			constexpr uInt block_size = 0x10000, window_size = 1 << MAX_WBITS;
+			std::unique_ptr<Byte[]> block(new Byte[block_size]), window(new Byte[window_size]);
+			z_stream zlib;
+			memset(&zlib, 0, sizeof(zlib));
+			throw_on_zlib_error(inflateInit2(&zlib, 32 + MAX_WBITS)); // Detect zlib or gzip header
+			try {
+				stdex::stream::fpos_t total_in = 0, total_out = 0, last = 0;
+				for (int result = Z_OK; result != Z_STREAM_END;) {
+					zlib.next_in = block.get();
+					zlib.avail_in = static_cast<uInt>(source.read(block.get(), block_size));
+					if (!zlib.avail_in) _Unlikely_ {
+						if (source.state() == stdex::stream::state_t::eof)
+							throw std::runtime_error("zlib stream truncated");
+						throw std::system_error(sys_error(), std::system_category(), "failed to read compressed stream");
+					}
+					do {
+						if (!zlib.avail_out) {
+							zlib.next_out = window.get();
+							zlib.avail_out = window_size;
+						}
+						total_in += zlib.avail_in;
+						total_out += zlib.avail_out;
+						result = inflate(&zlib, Z_BLOCK);
+						total_in -= zlib.avail_in;
+						total_out -= zlib.avail_out;
+						throw_on_zlib_error(result == Z_NEED_DICT ? Z_DATA_ERROR : result);
+						if (result == Z_STREAM_END)
+							break;
+						// At the end of a block header, unless it is the last block
+						if ((zlib.data_type & 128) && !(zlib.data_type & 64) && (total_out == 0 || total_out - last >= span)) {
+							checkpoint_t cp;
+							cp.in = total_in;
+							cp.out = total_out;
+							cp.bits = static_cast<uint8_t>(zlib.data_type & 7);
+							size_t pos = window_size - zlib.avail_out;
+							if (total_out >= window_size) {
+								cp.window.assign(window.get() + pos, window.get() + window_size);
+								cp.window.insert(cp.window.end(), window.get(), window.get() + pos);
+							}
+							else
+								cp.window.assign(window.get(), window.get() + pos);
+							m_checkpoints.push_back(std::move(cp));
+							last = total_out;
+						}
+					} while (zlib.avail_in);
+				}
+				m_size = total_out;
+			}
+			catch (...) {
+				inflateEnd(&zlib);
+				throw;
+			}
+			inflateEnd(&zlib);
+		}
+
+		///
+		/// Returns size of decompressed data
+		///
+		stdex::stream::fsize_t size() const { return m_size; }
+
+		///
+		/// Returns checkpoints ordered by offset
+		///
+		const std::vector<checkpoint_t>& checkpoints() const { return m_checkpoints; }
+
+		///
+		/// Returns the last checkpoint at or before given offset in decompressed data
+		///
+		const checkpoint_t& find(_In_ stdex::stream::fpos_t offset) const
+		{
+			if (m_checkpoints.empty()) _Unlikely_
+				throw std::invalid_argument("zlib index is empty");
+			auto cp = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), offset,
+				[](_In_ stdex::stream::fpos_t offset, _In_ const checkpoint_t& cp) { return offset < cp.out; });
+			return cp != m_checkpoints.begin() ? *(cp - 1) : m_checkpoints.front();
+		}
+
+		friend stdex::stream::basic& operator <<(_Inout_ stdex::stream::basic& dat, _In_ const zlib_index& index);
+		friend stdex::stream::basic& operator >>(_Inout_ stdex::stream::basic& dat, _Out_ zlib_index& index);
+
+	protected:
+		std::vector<checkpoint_t> m_checkpoints;
+		stdex::stream::fsize_t m_size;
+	};
+
+	///
+	/// Writes zlib index to a stream
+	///
+	inline stdex::stream::basic& operator <<(_Inout_ stdex::stream::basic& dat, _In_ const zlib_index& index)
+	{
+		size_t num = index.m_checkpoints.size();
+		if (num > UINT32_MAX) _Unlikely_
+			throw std::invalid_argument("index too big");
+		dat << index.m_size;
+		dat << static_cast<uint32_t>(num);
+		for (auto& cp : index.m_checkpoints) {
+			dat << cp.in;
+			dat << cp.out;
+			dat << cp.bits;
+			dat << cp.window;
+		}
+		return dat;
+	}
+
+	///
+	/// Reads zlib index from a stream
+	///
+	inline stdex::stream::basic& operator >>(_Inout_ stdex::stream::basic& dat, _Out_ zlib_index& index)
+	{
+		index.m_checkpoints.clear();
+		uint32_t num;
+		dat >> index.m_size;
+		dat >> num;
+		if (!dat.ok()) _Unlikely_
+			return dat;
+		index.m_checkpoints.reserve(num);
+		for (uint32_t i = 0; i < num; ++i) {
+			zlib_index::checkpoint_t cp;
+			dat >> cp.in;
+			dat >> cp.out;
+			dat >> cp.bits;
+			dat >> cp.window;
+			if (!dat.ok()) _Unlikely_ {
+				index.m_checkpoints.clear();
+				return dat;
+			}
+			index.m_checkpoints.push_back(std::move(cp));
+		}
+		return dat;
+	}
+
+	///
+	/// Random access reader of zlib or gzip compressed data
+	///
+	/// Seeking resumes decompression at the nearest preceding index checkpoint. Compressed data may start anywhere in
+	/// the source; index offsets are relative to its beginning.
+	///
+	class seekable_zlib_reader : public stdex::stream::basic_file
+	{
+	public:
+		///
+		/// Opens compressed data for random access
+		///
+		/// \param[in,out] source      Stream positioned at the beginning of compressed data
+		/// \param[in]     index       Index of compressed data. Must remain valid for the lifetime of the reader.
+		/// \param[in]     block_size  Size of compressed data read from source at once
+		///
+		seekable_zlib_reader(_Inout_ stdex::stream::basic_file& source, _In_ const zlib_index& index, _In_ uInt block_size = 0x10000) :
+			basic(source.state()),
+			m_source(source),
+			m_index(index),
+			m_base(source.tell()),
+			m_block_size(block_size),
+			m_block(new Byte[block_size]),
+			m_offset(0),
+			m_inflated(stdex::stream::fpos_max),
+			m_stream_end(false)
+		{
+			memset(&m_zlib, 0, sizeof(m_zlib));
+			throw_on_zlib_error(inflateInit2(&m_zlib, -MAX_WBITS));
+		}
+
+		virtual ~seekable_zlib_reader()
+		{
+			inflateEnd(&m_zlib);
+		}
+
+		virtual _Success_(return != 0 || length == 0) size_t read(
+			_Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length)
+		{
+			stdex_assert(data || !length);
+			if (!length) _Unlikely_ {
+				m_state = stdex::stream::state_t::ok;
+				return 0;
+			}
+			if (m_offset != m_inflated) {
+				position(m_offset);
+				if (!ok()) _Unlikely_
+					return 0;
+			}
+			size_t num_read = inflate_data(data, length);
+			m_offset = m_inflated;
+			return num_read;
+		}
+
+		virtual void close()
+		{
+			m_source.close();
+			m_state = m_source.state();
+		}
+
+		virtual stdex::stream::fpos_t seek(_In_ stdex::stream::foff_t offset, _In_ stdex::stream::seek_t how = stdex::stream::seek_t::beg)
+		{
+			switch (how) {
+			case stdex::stream::seek_t::beg: break;
+			case stdex::stream::seek_t::cur: offset = static_cast<stdex::stream::foff_t>(m_offset) + offset; break;
+			case stdex::stream::seek_t::end: offset = static_cast<stdex::stream::foff_t>(m_index.size()) + offset; break;
+			default: throw std::invalid_argument("unknown seek origin");
+			}
+			if (offset < 0) _Unlikely_
+				throw std::invalid_argument("negative file offset");
+			m_state = stdex::stream::state_t::ok;
+			return m_offset = static_cast<stdex::stream::fpos_t>(offset);
+		}
+
+		virtual stdex::stream::fpos_t tell() const
+		{
+			return m_offset;
+		}
+
+		virtual stdex::stream::fsize_t size() const
+		{
+			return m_index.size();
+		}
+
+		virtual void truncate()
+		{
+			m_state = stdex::stream::state_t::fail;
+		}
+
+	protected:
+		///
+		/// Positions decompressor at given offset of decompressed data
+		///
+		/// Continues decompression when offset is ahead within the same checkpoint span. Otherwise, restarts at the
+		/// nearest preceding checkpoint.
+		///
+		void position(_In_ stdex::stream::fpos_t offset)
+		{
+			auto& cp = m_index.find(offset);
+			if (m_inflated == stdex::stream::fpos_max || offset < m_inflated || m_inflated < cp.out) {
+				throw_on_zlib_error(inflateReset(&m_zlib));
+				m_zlib.avail_in = 0;
+				m_stream_end = false;
+				m_inflated = stdex::stream::fpos_max;
+				m_source.seekbeg(m_base + cp.in - (cp.bits ? 1 : 0));
+				if (cp.bits) {
+					uint8_t prev;
+					m_source >> prev;
+					if (m_source.ok())
+						throw_on_zlib_error(inflatePrime(&m_zlib, cp.bits, prev >> (8 - cp.bits)));
+				}
+				m_state = m_source.state();
+				if (!ok()) _Unlikely_
+					return;
+				if (!cp.window.empty())
+					throw_on_zlib_error(inflateSetDictionary(&m_zlib, cp.window.data(), static_cast<uInt>(cp.window.size())));
+				m_inflated = cp.out;
+			}
+			// Decompress and discard data up to offset.
+			Byte discard[0x1000];
+			while (m_inflated < offset) {
+				if (!inflate_data(discard, static_cast<size_t>(std::min<stdex::stream::fpos_t>(offset - m_inflated, sizeof(discard))))) _Unlikely_
+					return;
+			}
+			m_state = stdex::stream::state_t::ok;
+		}
+
+		///
+		/// Decompresses data at current decompressor position
+		///
+		size_t inflate_data(_Out_writes_bytes_to_opt_(length, return) void* data, _In_ size_t length)
+		{
+			size_t num_read = 0;
+			while (length && !m_stream_end) {
+				uInt num_deflated = static_cast<uInt>(std::min<size_t>(length, UINT_MAX));
+				m_zlib.avail_out = num_deflated;
+				m_zlib.next_out = reinterpret_cast<Bytef*>(data);
+				do {
+					if (m_zlib.avail_in == 0) {
+						m_zlib.next_in = m_block.get();
+						m_zlib.avail_in = static_cast<uInt>(m_source.read(m_block.get(), m_block_size));
+						if (!m_zlib.avail_in) _Unlikely_ {
+							size_t n = num_deflated - m_zlib.avail_out;
+							num_read += n;
+							m_inflated += n;
+							m_state = num_read ? stdex::stream::state_t::ok : m_source.state();
+							return num_read;
+						}
+					}
+					int result = inflate(&m_zlib, Z_NO_FLUSH);
+					throw_on_zlib_error(result == Z_NEED_DICT ? Z_DATA_ERROR : result);
+					if (result == Z_STREAM_END) {
+						m_stream_end = true;
+						break;
+					}
+				} while (m_zlib.avail_out);
+				size_t n = num_deflated - m_zlib.avail_out;
+				num_read += n;
+				m_inflated += n;
+				reinterpret_cast<Bytef*&>(data) += n;
+				length -= n;
+			}
+			m_state = num_read || !length ? stdex::stream::state_t::ok : stdex::stream::state_t::eof;
+			return num_read;
+		}
+
+	protected:
+		stdex::stream::basic_file& m_source;
+		const zlib_index& m_index;
+		stdex::stream::fpos_t m_base; ///< Offset of compressed data in source
+		z_stream m_zlib;
+		uInt m_block_size;
+		std::unique_ptr<Byte[]> m_block;
+		stdex::stream::fpos_t m_offset; ///< Logical read position
+		stdex::stream::fpos_t m_inflated; ///< Position of decompressor output or fpos_max if not positioned
+		bool m_stream_end; ///< Has decompressor reached the end of deflate data?
+	};
 }
 
 #if defined(__GNUC__)